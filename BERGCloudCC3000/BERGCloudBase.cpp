@@ -28,7 +28,6 @@ THE SOFTWARE.
 #include <stdint.h>
 #include <stddef.h>
 #include <string.h> /* For memcpy() */
-#include <stdlib.h> /* For free() */
 
 #include "BERGCloudBase.h"
 
@@ -112,7 +111,7 @@ bool BERGCloudBase::pollForCommand(uint8_t *commandBuffer, uint16_t commandBuffe
     sendDeviceCommandResponse(command.id, result ? 0x00 : 0xff);
 
     /* Free command buffer */
-    free(command.data);
+    commandPool.release(command.data);
     command.data = NULL;
   }
 
@@ -130,6 +129,7 @@ bool BERGCloudBase::pollForCommand(BERGCloudMessageBuffer& buffer, char *command
   uint8_t msgPackByte;
   uint16_t cmd;
   uint16_t commandSize;
+  uint8_t *commandData;
   bool result = false;
   
   if ((commandName == NULL) || (commandNameMaxSize < 2))
@@ -137,7 +137,8 @@ bool BERGCloudBase::pollForCommand(BERGCloudMessageBuffer& buffer, char *command
     return false;
   }
 
-  /* Defaults */
+  /* Defaults; a block taken by an earlier takeCommand() is released */
+  buffer.releaseBlock();
   buffer.clear();
   *commandName = '\0';
 
@@ -146,27 +147,29 @@ bool BERGCloudBase::pollForCommand(BERGCloudMessageBuffer& buffer, char *command
     command.available = false;
     commandSize = command.size - BC_COMMAND_HEADER_SIZE_BYTES;
     dataSize = commandSize;
-    
-    if (buffer.size() >= commandSize)
+    commandData = &command.data[BC_COMMAND_HEADER_SIZE_BYTES];
+
+    /* Get command */
+    cmd = command.data[3];
+    cmd <<= 8;
+    cmd |= command.data[2];
+
+    if ((cmd == BC_COMMAND_NAMED_PACKED) && (commandSize > 0))
     {
-      /* Get command */
-      cmd = command.data[3];
-      cmd <<= 8;
-      cmd |= command.data[2];
-      
-      if (cmd == BC_COMMAND_NAMED_PACKED)
-      {
-        /* Copy command data */
-        memcpy(buffer.ptr(), &command.data[BC_COMMAND_HEADER_SIZE_BYTES], commandSize);
+      /* Get command name string size */
+      msgPackByte = commandData[0];
 
-        /* Get command name string size */
-        msgPackByte = *buffer.ptr();
+      /* Check for valid command name size */
+      if ((msgPackByte >= _MP_FIXRAW_MIN) && (msgPackByte <= _MP_FIXRAW_MAX) &&
+          ((uint16_t)(msgPackByte - _MP_FIXRAW_MIN) < commandSize))
+      {
+        commandNameSize = originalCommandNameSize = msgPackByte - _MP_FIXRAW_MIN;
+        dataSize -= (originalCommandNameSize + 1); /* +1 for messagePack fixraw byte */
 
-        /* Check for valid command name size */
-        if ((msgPackByte >= _MP_FIXRAW_MIN) && (msgPackByte <= _MP_FIXRAW_MAX))
+        /* Copy the packed data that follows the name; a chunked */
+        /* buffer grows to fit */
+        if (buffer.write(commandData + (originalCommandNameSize + 1), dataSize))
         {
-          commandNameSize = originalCommandNameSize = msgPackByte - _MP_FIXRAW_MIN;
-
           /* Limit to the size of the buffer provided */
           if (commandNameSize > (commandNameMaxSize-1)) /* -1 for null terminator */
           {
@@ -174,21 +177,15 @@ bool BERGCloudBase::pollForCommand(BERGCloudMessageBuffer& buffer, char *command
           }
 
           /* Copy command name string as a null-terminated C string */
-          bytecpy((uint8_t *)commandName, (buffer.ptr()+1), commandNameSize); /* +1 for messagePack fixraw byte */
+          bytecpy((uint8_t *)commandName, (commandData+1), commandNameSize); /* +1 for messagePack fixraw byte */
           commandName[commandNameSize] = '\0';
 
-          /* Move up remaining packed data, update size */
-          dataSize -= (originalCommandNameSize + 1); /* +1 for messagePack fixraw byte */
-          bytecpy(buffer.ptr(), buffer.ptr() + (originalCommandNameSize + 1), dataSize);
-
           /* Copy Command ID */
           if (id != NULL)
           {
             *id = command.id;
           }
 
-          buffer.used(dataSize);
-
           /* Success */
           result =  true;
         }
@@ -199,7 +196,88 @@ bool BERGCloudBase::pollForCommand(BERGCloudMessageBuffer& buffer, char *command
     sendDeviceCommandResponse(command.id, result ? 0x00 : 0xff);
 
     /* Free command buffer */
-    free(command.data);
+    commandPool.release(command.data);
+    command.data = NULL;
+  }
+
+  return result;
+}
+
+bool BERGCloudBase::takeCommand(BERGCloudMessageBuffer& buffer, char *commandName, uint8_t commandNameMaxSize, uint32_t *id)
+{
+  /* Returns TRUE if a valid command has been received; the command */
+  /* block is handed to 'buffer' to be read in place, without copying */
+
+  uint8_t commandNameSize;
+  uint8_t originalCommandNameSize;
+  uint8_t msgPackByte;
+  uint16_t cmd;
+  uint16_t dataOffset;
+  bool result = false;
+
+  if ((commandName == NULL) || (commandNameMaxSize < 2))
+  {
+    return false;
+  }
+
+  /* Defaults */
+  buffer.releaseBlock();
+  buffer.clear();
+  *commandName = '\0';
+
+  if (command.available)
+  {
+    command.available = false;
+
+    /* Get command */
+    cmd = command.data[3];
+    cmd <<= 8;
+    cmd |= command.data[2];
+
+    if ((cmd == BC_COMMAND_NAMED_PACKED) && (command.size > BC_COMMAND_HEADER_SIZE_BYTES))
+    {
+      /* Get command name string size */
+      msgPackByte = command.data[BC_COMMAND_HEADER_SIZE_BYTES];
+
+      /* Check for valid command name size */
+      if ((msgPackByte >= _MP_FIXRAW_MIN) && (msgPackByte <= _MP_FIXRAW_MAX))
+      {
+        commandNameSize = originalCommandNameSize = msgPackByte - _MP_FIXRAW_MIN;
+        dataOffset = BC_COMMAND_HEADER_SIZE_BYTES + originalCommandNameSize + 1; /* +1 for messagePack fixraw byte */
+
+        if (command.size >= dataOffset)
+        {
+          /* Limit to the size of the buffer provided */
+          if (commandNameSize > (commandNameMaxSize-1)) /* -1 for null terminator */
+          {
+            commandNameSize = (commandNameMaxSize-1);
+          }
+
+          /* Copy command name string as a null-terminated C string */
+          memcpy(commandName, &command.data[BC_COMMAND_HEADER_SIZE_BYTES + 1], commandNameSize); /* +1 for messagePack fixraw byte */
+          commandName[commandNameSize] = '\0';
+
+          /* Copy Command ID */
+          if (id != NULL)
+          {
+            *id = command.id;
+          }
+
+          /* Hand over the command block; the packed data follows the name */
+          buffer.adoptBlock(&commandPool, command.data, dataOffset, command.size - dataOffset);
+          command.data = NULL;
+
+          /* Success */
+          result = true;
+        }
+      }
+    }
+
+    /* Send response */
+    sendDeviceCommandResponse(command.id, result ? 0x00 : 0xff);
+
+    /* Free command buffer if not handed over */
+    commandPool.release(command.data);
     command.data = NULL;
   }
 
@@ -207,18 +285,21 @@ bool BERGCloudBase::pollForCommand(BERGCloudMessageBuffer& buffer, char *command
 }
 #endif
 
-bool BERGCloudBase::_sendEvent(uint16_t eventCode, uint8_t *eventBuffer, uint16_t eventSize)
+bool BERGCloudBase::_sendEvent(uint16_t eventCode, uint8_t *eventBuffer, uint16_t eventSize, bool inPlace)
 {
   /* Returns TRUE if the event is sent successfully */
-  uint32_t commandInvocationId;
-  uint32_t eventPayloadLength;
+  uint8_t headerBuffer[BC_EVENT_HEADER_SIZE_BYTES];
     
-  /* Create header */
-  uint8_t header[sizeof(eventCode) + sizeof(commandInvocationId) + sizeof(eventPayloadLength)];
+  /* Create header; in place if the caller has reserved space in front of the data */
+  uint8_t *header = inPlace ? (eventBuffer - BC_EVENT_HEADER_SIZE_BYTES) : headerBuffer;
 
-  commandInvocationId = 0;
-  eventPayloadLength = eventSize;
+  makeEventHeader(header, eventCode, eventSize);
+   
+  return sendDeviceEvent(header, BC_EVENT_HEADER_SIZE_BYTES, eventBuffer, eventSize);
+}
 
+void BERGCloudBase::makeEventHeader(uint8_t *header, uint16_t eventCode, uint32_t eventPayloadLength, uint32_t commandInvocationId)
+{
   header[0] = eventCode;
   header[1] = eventCode >> 8;
   header[2] = commandInvocationId; 
@@ -229,8 +310,6 @@ bool BERGCloudBase::_sendEvent(uint16_t eventCode, uint8_t *eventBuffer, uint16_
   header[7] = eventPayloadLength >> 8;
   header[8] = eventPayloadLength >> 16;
   header[9] = eventPayloadLength >> 24;
-   
-  return sendDeviceEvent(header, sizeof(header), eventBuffer, eventSize);
 }
 
 bool BERGCloudBase::sendEvent(const char *eventName, uint8_t *eventBuffer, uint16_t eventSize, bool packed)
@@ -280,7 +359,7 @@ bool BERGCloudBase::sendEvent(const char *eventName, uint8_t *eventBuffer, uint1
   result = _sendEvent(BC_EVENT_NAMED_PACKED, temp, tempUsed);
 
   /* Free temporary buffer */
-  delete temp;
+  delete [] temp;
   
   return result;
 }  
@@ -289,7 +368,47 @@ bool BERGCloudBase::sendEvent(const char *eventName, uint8_t *eventBuffer, uint1
 bool BERGCloudBase::sendEvent(const char *eventName, BERGCloudMessageBuffer& buffer)
 {
   /* Returns TRUE if the event is sent successfully */
-  return sendEvent(eventName, buffer.ptr(), buffer.used(), true /* Packed */);
+  uint8_t *start;
+  uint16_t nameSize;
+
+  if ((eventName == NULL) || (eventName[0] == '\0'))
+  {
+    _LOG("Event name must be at least one character.");
+    return false;
+  }
+
+  nameSize = strlen(eventName);
+
+  if (nameSize > _MAX_FIXRAW)
+  {
+    _LOG("Event name is too long.");
+    return false;
+  }
+
+  if (buffer.chunked())
+  {
+    /* Send the header and name, then the data a chunk at a time */
+    uint8_t header[BC_EVENT_HEADROOM_BYTES];
+
+    makeEventHeader(header, BC_EVENT_NAMED_PACKED, buffer.used() + nameSize + 1);
+    header[BC_EVENT_HEADER_SIZE_BYTES] = _MP_FIXRAW_MIN + nameSize;
+    memcpy(&header[BC_EVENT_HEADER_SIZE_BYTES + 1], eventName, nameSize);
+
+    return sendDeviceEvent(header, BC_EVENT_HEADER_SIZE_BYTES + 1 + nameSize, buffer);
+  }
+
+  if (buffer.headroom() < (BC_EVENT_HEADER_SIZE_BYTES + 1 + nameSize)) /* +1 for messagePack fixraw byte */
+  {
+    /* No space in front of the data; copy */
+    return sendEvent(eventName, buffer.ptr(), buffer.used(), true /* Packed */);
+  }
+
+  /* Add the name in messagePack format in front of the data */
+  start = buffer.ptr() - (nameSize + 1);
+  start[0] = _MP_FIXRAW_MIN + nameSize;
+  memcpy(&start[1], eventName, nameSize);
+
+  return _sendEvent(BC_EVENT_NAMED_PACKED, start, buffer.used() + nameSize + 1, true /* In place */);
 }
 #endif
 
@@ -320,6 +439,12 @@ bool BERGCloudBase::getClaimingState(uint8_t& state)
   return true;
 }
 
+bool BERGCloudBase::getCommandPoolStats(BC_POOL_STATS& stats)
+{
+  commandPool.getStats(stats);
+  return true;
+}
+
 bool BERGCloudBase::readNVData(void)
 {
   /* Read and validate non-volatile storage */
@@ -480,10 +605,7 @@ bool BERGCloudBase::connect(const char *key, uint16_t version)
 bool BERGCloudBase::reconnect(void)
 {
   /* Clear any pending command */
-  if (command.data != NULL)
-  {
-      free(command.data);
-  }
+  commandPool.release(command.data);
   memset(&command, 0x00, sizeof(command));
 
   if (!connectToNetwork())
@@ -673,6 +795,7 @@ void BERGCloudBase::begin(void)
   memset(deviceID, 0x00, sizeof(deviceID));
   memset(hardwareAddress, 0x00, sizeof(hardwareAddress));
   memset(&command, 0x00, sizeof(command));
+  commandPool.reset();
 }
 
 void BERGCloudBase::end(void)
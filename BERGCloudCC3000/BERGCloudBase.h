@@ -31,6 +31,7 @@ THE SOFTWARE.
 #include "BERGCloudConfig.h"
 #include "BERGCloudConst.h"
 #include "BERGCloudLogPrint.h"
+#include "BERGCloudCommandPool.h"
 
 #ifdef BERGCLOUD_PACK_UNPACK
 #include "BERGCloudMessageBuffer.h"
@@ -77,6 +78,8 @@ public:
   bool getConnectionState(uint8_t& state);
   /* Get the claiming state */
   bool getClaimingState(uint8_t& state);
+  /* Get the command pool statistics */
+  bool getCommandPoolStats(BC_POOL_STATS& stats);
   /* Connect */
   bool connect(const char *key, uint16_t version);
   /* Get the current claimcode */
@@ -101,8 +104,16 @@ protected:
   virtual bool nvRamRead(uint8_t *data, uint8_t size) = 0;
   virtual bool nvRamWrite(uint8_t *data, uint8_t size) = 0;
   virtual bool sendDeviceEvent(uint8_t *header, uint16_t headerSize, uint8_t *data, uint16_t dataSize) =0;
+#ifdef BERGCLOUD_PACK_UNPACK
+  /* As above, but the data is sent a segment at a time; see segment() */
+  virtual bool sendDeviceEvent(uint8_t *header, uint16_t headerSize, BERGCloudMessageBuffer& data) =0;
+#endif
   virtual bool pollForDeviceCommand(void) =0;
   virtual bool sendDeviceCommandResponse(uint32_t command_id, uint8_t returnCode) =0;
+#ifdef BERGCLOUD_PACK_UNPACK
+  bool takeCommand(BERGCloudMessageBuffer& buffer, char *commandName, uint8_t commandNameMaxSize, uint32_t *id);
+#endif
+  void makeEventHeader(uint8_t *header, uint16_t eventCode, uint32_t eventPayloadLength, uint32_t commandInvocationId = 0);
   bool deviceIDUpdated(void);
   bool reconnect(void);
   void eventDisconnected(void);
@@ -112,12 +123,15 @@ protected:
   uint8_t deviceID[BC_DEVICE_ID_SIZE_BYTES];
   uint8_t hardwareAddress[BC_EUI64_SIZE_BYTES];
   COMMAND_TYPE command;
+  BERGCloudCommandPool commandPool;
 private:
+  /* Times readNVData(), see bench/avr */
+  friend class BERGCloudNVBench;
   bool resetNVData(void);
   bool readNVData(void);
   bool updateNVData(void);
   char toClaimcodeChar(uint8_t n);
-  bool _sendEvent(uint16_t eventCode, uint8_t *eventBuffer, uint16_t eventSize);
+  bool _sendEvent(uint16_t eventCode, uint8_t *eventBuffer, uint16_t eventSize, bool inPlace = false);
   void bytecpy(uint8_t *dst, uint8_t *src, uint16_t size);
   virtual bool sendConnectEvent(void) = 0;
   virtual uint8_t randomByte(void) = 0;
@@ -0,0 +1,295 @@
+/*
+
+BERGCloud streaming base64
+
+Copyright (c) 2014 Berg Cloud Limited http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include "BERGCloudBase64.h"
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define BC_BASE64_PROGMEM PROGMEM
+#define BC_BASE64_READ(p) pgm_read_byte(p)
+#else
+#define BC_BASE64_PROGMEM
+#define BC_BASE64_READ(p) (*(p))
+#endif
+
+static bool isSpace(char c)
+{
+  return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+
+static const char characters[] BC_BASE64_PROGMEM =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static void encodeGroup(const uint8_t *group, char *text)
+{
+  text[0] = BC_BASE64_READ(&characters[group[0] >> 2]);
+  text[1] = BC_BASE64_READ(&characters[((group[0] & 0x03) << 4) | (group[1] >> 4)]);
+  text[2] = BC_BASE64_READ(&characters[((group[1] & 0x0f) << 2) | (group[2] >> 6)]);
+  text[3] = BC_BASE64_READ(&characters[group[2] & 0x3f]);
+}
+
+/* The value of each character from '+' to 'z', or -1 if it is not */
+/* a base64 one */
+static const int8_t sextets[] BC_BASE64_PROGMEM = {
+  62, -1, -1, -1, 63,                                 /* + , - . / */
+  52, 53, 54, 55, 56, 57, 58, 59, 60, 61,             /* 0 to 9 */
+  -1, -1, -1, -1, -1, -1, -1,                         /* : to @ */
+  0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12,           /* A to M */
+  13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24, 25, /* N to Z */
+  -1, -1, -1, -1, -1, -1,                             /* [ to ` */
+  26, 27, 28, 29, 30, 31, 32, 33, 34, 35, 36, 37, 38, /* a to m */
+  39, 40, 41, 42, 43, 44, 45, 46, 47, 48, 49, 50, 51  /* n to z */
+};
+
+static int8_t sextet(char c)
+{
+  if ((c < '+') || (c > 'z'))
+  {
+    return -1;
+  }
+
+  return (int8_t)BC_BASE64_READ(&sextets[c - '+']);
+}
+
+BERGCloudBase64Encoder::BERGCloudBase64Encoder(void)
+{
+  begin();
+}
+
+void BERGCloudBase64Encoder::begin(void)
+{
+  groupUsed = 0;
+}
+
+uint16_t BERGCloudBase64Encoder::encode(const uint8_t *&data, uint16_t& size, char *text, uint16_t textSize)
+{
+  uint16_t used = 0;
+
+  /* Finish the group kept from the last segment */
+  while ((groupUsed > 0) && (size > 0) && (textSize >= 4))
+  {
+    group[groupUsed++] = *data++;
+    size--;
+
+    if (groupUsed == 3)
+    {
+      encodeGroup(group, text);
+      used = 4;
+      groupUsed = 0;
+    }
+  }
+
+  /* Then whole groups straight from the data */
+  while ((groupUsed == 0) && (size >= 3) && ((textSize - used) >= 4))
+  {
+    encodeGroup(data, &text[used]);
+    used += 4;
+    data += 3;
+    size -= 3;
+  }
+
+  /* Keep the last one or two bytes for the next segment */
+  if ((groupUsed == 0) && (size < 3))
+  {
+    while (size > 0)
+    {
+      group[groupUsed++] = *data++;
+      size--;
+    }
+  }
+
+  return used;
+}
+
+uint8_t BERGCloudBase64Encoder::end(char *text)
+{
+  if (groupUsed == 0)
+  {
+    return 0;
+  }
+
+  if (groupUsed < 2)
+  {
+    group[1] = 0;
+  }
+
+  group[2] = 0;
+  encodeGroup(group, text);
+
+  text[3] = '=';
+  if (groupUsed < 2)
+  {
+    text[2] = '=';
+  }
+
+  groupUsed = 0;
+  return 4;
+}
+
+BERGCloudBase64Decoder::BERGCloudBase64Decoder(void)
+{
+  begin(NULL, 0);
+}
+
+void BERGCloudBase64Decoder::begin(uint8_t *data, uint16_t size)
+{
+  this->data = data;
+  this->size = size;
+  decoded = 0;
+  group = 0;
+  groupUsed = 0;
+  padding = 0;
+  failed = false;
+  full = false;
+}
+
+bool BERGCloudBase64Decoder::feed(char c)
+{
+  int8_t value;
+
+  if (failed)
+  {
+    return false;
+  }
+
+  value = sextet(c);
+
+  if ((value >= 0) && (padding == 0))
+  {
+    group = (group << 6) | (uint8_t)value;
+
+    if (++groupUsed == 4)
+    {
+      return groupDone(3);
+    }
+
+    return true;
+  }
+
+  if (isSpace(c))
+  {
+    return true;
+  }
+
+  if (c == '=')
+  {
+    /* Only the last one or two characters of a group may be padding */
+    padding++;
+    failed = (groupUsed < 2) || ((groupUsed + padding) > 4);
+    return !failed;
+  }
+
+  /* Not base64, or more of it after the padding */
+  failed = true;
+  return false;
+}
+
+bool BERGCloudBase64Decoder::feed(const char *text, uint16_t size)
+{
+  int8_t value;
+
+  while ((size-- > 0) && !failed)
+  {
+    /* Characters of a group are taken here; anything else is */
+    /* left to feed() */
+    value = sextet(*text);
+
+    if ((value >= 0) && (padding == 0))
+    {
+      group = (group << 6) | (uint8_t)value;
+
+      if (++groupUsed == 4)
+      {
+        groupDone(3);
+      }
+    }
+    else
+    {
+      feed(*text);
+    }
+
+    text++;
+  }
+
+  return !failed;
+}
+
+bool BERGCloudBase64Decoder::end(void)
+{
+  /* One character on its own is not a whole byte, and any padding */
+  /* must fill the group */
+  if (failed || (groupUsed == 1) || ((padding > 0) && ((groupUsed + padding) != 4)))
+  {
+    return false;
+  }
+
+  if (groupUsed == 0)
+  {
+    return true;
+  }
+
+  /* Two characters give one byte, three give two */
+  group <<= 6 * (4 - groupUsed);
+  return groupDone(groupUsed - 1);
+}
+
+bool BERGCloudBase64Decoder::groupDone(uint8_t bytes)
+{
+  /* Write the first 'bytes' bytes of the group */
+  if ((size - decoded) < bytes)
+  {
+    /* Does not fit */
+    failed = true;
+    full = true;
+    return false;
+  }
+
+  data[decoded++] = (uint8_t)(group >> 16);
+
+  if (bytes > 1)
+  {
+    data[decoded++] = (uint8_t)(group >> 8);
+  }
+
+  if (bytes > 2)
+  {
+    data[decoded++] = (uint8_t)group;
+  }
+
+  group = 0;
+  groupUsed = 0;
+  return true;
+}
+
+uint16_t BERGCloudBase64Decoder::used(void)
+{
+  return decoded;
+}
+
+bool BERGCloudBase64Decoder::overflowed(void)
+{
+  return full;
+}
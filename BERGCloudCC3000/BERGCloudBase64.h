@@ -0,0 +1,101 @@
+/*
+
+BERGCloud streaming base64
+
+Copyright (c) 2014 Berg Cloud Limited http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+/*
+  base64 encoded and decoded a piece at a time, so that neither the
+  whole text nor the whole of the data need be held at once.
+
+  The encoder takes the data in any number of segments, such as an
+  event header and then each chunk of its message, and hands out the
+  text in whole groups of four characters as it goes; the few bytes
+  that do not make up a whole group are kept for the next segment.
+
+  The decoder takes the text as it arrives, a character or a chunk at a
+  time, straight into the storage given. Whitespace, such as the line
+  breaks some encoders add every 76 characters, is skipped; the padding
+  at the end may be left out.
+*/
+
+#ifndef BERGCLOUDBASE64_H
+#define BERGCLOUDBASE64_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* Length of the text for 'size' bytes of data, with padding */
+#define BC_BASE64_SIZE(size) ((((size) + 2) / 3) * 4)
+
+class BERGCloudBase64Encoder
+{
+public:
+  BERGCloudBase64Encoder(void);
+  /* Forget any bytes kept, and start again */
+  void begin(void);
+  /* Encode as many of the 'size' bytes at 'data' as make up whole */
+  /* groups that fit in the 'textSize' bytes at 'text'; 'data' and */
+  /* 'size' are moved on past the bytes taken. Returns the number of */
+  /* characters written, a multiple of four */
+  uint16_t encode(const uint8_t *&data, uint16_t& size, char *text, uint16_t textSize);
+  /* Encode the bytes kept, with padding, into the four bytes at */
+  /* 'text'; returns the number of characters written, 0 or 4 */
+  uint8_t end(char *text);
+
+private:
+  uint8_t group[3];    /* Bytes not yet making up a whole group */
+  uint8_t groupUsed;
+};
+
+class BERGCloudBase64Decoder
+{
+public:
+  BERGCloudBase64Decoder(void);
+  /* Decode into the 'size' bytes at 'data', from the start */
+  void begin(uint8_t *data, uint16_t size);
+  /* Decode the next character or 'size' characters; returns false */
+  /* once decoding has failed on a bad character or a full buffer */
+  bool feed(char c);
+  bool feed(const char *text, uint16_t size);
+  /* Decode any last part group; returns true if all of the text */
+  /* was decoded and it ended where it should */
+  bool end(void);
+  /* The number of bytes decoded */
+  uint16_t used(void);
+  /* Test if decoding failed as the storage given was full */
+  bool overflowed(void);
+
+private:
+  bool groupDone(uint8_t bytes);
+  uint8_t *data;
+  uint16_t size;
+  uint16_t decoded;
+  uint32_t group;      /* Six bits for each character of the current group */
+  uint8_t groupUsed;   /* Characters in it */
+  uint8_t padding;     /* '=' characters ending the text */
+  bool failed;
+  bool full;
+};
+
+#endif // #ifndef BERGCLOUDBASE64_H
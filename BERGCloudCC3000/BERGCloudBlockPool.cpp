@@ -0,0 +1,156 @@
+/*
+
+Fixed-block memory pool
+
+Copyright (c) 2013 Berg Cloud Limited http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include "BERGCloudBlockPool.h"
+#include "BERGCloudLogPrint.h"
+
+BERGCloudBlockPool::BERGCloudBlockPool(uint8_t *storage, uint8_t *freeList, uint8_t *freeMap, uint8_t blocks, uint16_t blockSize)
+{
+  this->storage = storage;
+  this->freeList = freeList;
+  this->freeMap = freeMap;
+  this->blocks = blocks;
+  blockBytes = blockSize;
+}
+
+void BERGCloudBlockPool::reset(void)
+{
+  uint8_t i;
+
+  for (i = 0; i < blocks; i++)
+  {
+    freeList[i] = i;
+    freeMap[i / 8] |= (1 << (i % 8));
+  }
+
+  freeCount = lowestFree = blocks;
+  exhausted = 0;
+  oversize = 0;
+  invalid = 0;
+}
+
+uint8_t *BERGCloudBlockPool::acquire(uint16_t size)
+{
+  uint8_t index;
+
+  if (size > blockBytes)
+  {
+    refuseOversize();
+    return NULL;
+  }
+
+  if (freeCount == 0)
+  {
+    _LOG("Pool exhausted.");
+    if (exhausted < UINT16_MAX)
+    {
+      exhausted++;
+    }
+    return NULL;
+  }
+
+  freeCount--;
+
+  if (freeCount < lowestFree)
+  {
+    lowestFree = freeCount;
+  }
+
+  index = freeList[freeCount];
+  freeMap[index / 8] &= ~(1 << (index % 8));
+
+  return &storage[index * blockBytes];
+}
+
+void BERGCloudBlockPool::release(uint8_t *block)
+{
+  uint16_t offset;
+  uint8_t index;
+
+  if (block == NULL)
+  {
+    return;
+  }
+
+  /* Check the block came from this pool, starts on a block boundary */
+  /* and is not already free */
+  if ((block < storage) || (block > &storage[(blocks - 1) * blockBytes]))
+  {
+    invalidRelease();
+    return;
+  }
+
+  offset = block - storage;
+  index = offset / blockBytes;
+
+  if (((offset % blockBytes) != 0) || ((freeMap[index / 8] & (1 << (index % 8))) != 0))
+  {
+    invalidRelease();
+    return;
+  }
+
+  freeMap[index / 8] |= (1 << (index % 8));
+  freeList[freeCount++] = index;
+}
+
+void BERGCloudBlockPool::refuseOversize(void)
+{
+  _LOG("Too large for pool block.");
+  if (oversize < UINT16_MAX)
+  {
+    oversize++;
+  }
+}
+
+void BERGCloudBlockPool::invalidRelease(void)
+{
+  _LOG("Invalid pool release.");
+  if (invalid < UINT16_MAX)
+  {
+    invalid++;
+  }
+}
+
+void BERGCloudBlockPool::getStats(BC_POOL_STATS& stats)
+{
+  stats.blocks = blocks;
+  stats.blockSize = blockBytes;
+  stats.free = freeCount;
+  stats.lowestFree = lowestFree;
+  stats.exhausted = exhausted;
+  stats.oversize = oversize;
+  stats.invalid = invalid;
+}
+
+uint16_t BERGCloudBlockPool::blockSize(void)
+{
+  return blockBytes;
+}
+
+uint8_t BERGCloudBlockPool::freeBlocks(void)
+{
+  return freeCount;
+}
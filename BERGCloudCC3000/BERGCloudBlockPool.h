@@ -0,0 +1,87 @@
+/*
+
+Fixed-block memory pool
+
+Copyright (c) 2013 Berg Cloud Limited http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDBLOCKPOOL_H
+#define BERGCLOUDBLOCKPOOL_H
+
+#define __STDC_LIMIT_MACROS /* Include C99 stdint defines in C++ code */
+#include <stdint.h>
+#include <stddef.h>
+
+typedef struct {
+  uint8_t blocks;       /* Number of blocks in the pool */
+  uint16_t blockSize;   /* Size of each block in bytes */
+  uint8_t free;         /* Blocks free now */
+  uint8_t lowestFree;   /* Fewest blocks free since begin() */
+  uint16_t exhausted;   /* Requests refused as no block was free */
+  uint16_t oversize;    /* Requests refused as larger than a block */
+  uint16_t invalid;     /* Releases refused as not a block in use */
+} BC_POOL_STATS;
+
+/* Bytes of the bitmap of free blocks a derived class provides */
+#define BC_POOL_FREE_MAP_SIZE_BYTES(blocks) (((blocks) + 7) / 8)
+
+/* The storage is provided by a derived class, see BERGCloudCommandPool */
+class BERGCloudBlockPool
+{
+public:
+  /* Mark all blocks as free and clear the statistics */
+  void reset(void);
+  /* Get a free block of at least 'size' bytes; returns NULL if there is none */
+  uint8_t *acquire(uint16_t size);
+  /* Return a block to the pool; NULL is ignored, and a pointer that */
+  /* is not to a block of this pool in use is refused */
+  void release(uint8_t *block);
+  /* Count data refused elsewhere as larger than a block, such as a */
+  /* payload found to be too large only once it was being read */
+  void refuseOversize(void);
+  /* Get the pool statistics */
+  void getStats(BC_POOL_STATS& stats);
+  /* Size of each block in bytes */
+  uint16_t blockSize(void);
+  /* Number of blocks free now */
+  uint8_t freeBlocks(void);
+
+protected:
+  /* 'storage' is 'blocks' * 'blockSize' bytes; 'freeList' is 'blocks' */
+  /* bytes and 'freeMap' BC_POOL_FREE_MAP_SIZE_BYTES('blocks') bytes */
+  BERGCloudBlockPool(uint8_t *storage, uint8_t *freeList, uint8_t *freeMap, uint8_t blocks, uint16_t blockSize);
+
+private:
+  void invalidRelease(void);
+  uint8_t *storage;
+  uint8_t *freeList; /* Stack of free block indexes */
+  uint8_t *freeMap;  /* A bit set for each free block */
+  uint8_t blocks;
+  uint16_t blockBytes;
+  uint8_t freeCount;
+  uint8_t lowestFree;
+  uint16_t exhausted;
+  uint16_t oversize;
+  uint16_t invalid;
+};
+
+#endif // #ifndef BERGCLOUDBLOCKPOOL_H
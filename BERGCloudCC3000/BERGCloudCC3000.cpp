@@ -244,6 +244,9 @@ bool BERGCloudCC3000::connectToNetwork(void)
   webSocket.host = (char *)BC_WEBSOCKET_HOST_NAME;
   webSocket.path = (char *)BC_WEBSOCKET_PATH;
   webSocket.protocol = (char *)BC_WEBSOCKET_PROTOCOL;
+#if BC_WEBSOCKET_BINARY
+  binaryFrames = false;
+#endif
   
   if (!webSocket.handshake(wlan))
   {
@@ -251,6 +254,16 @@ bool BERGCloudCC3000::connectToNetwork(void)
     return false;
   }
 
+#if BC_WEBSOCKET_BINARY
+  /* The binary protocol is offered first */
+  binaryFrames = (webSocket.protocolChosen == 0);
+
+  if (binaryFrames)
+  {
+    _LOG("Using binary frames.");
+  }
+#endif
+
   /* Connected */
   eventConnected();
 
@@ -261,48 +274,86 @@ bool BERGCloudCC3000::connectToNetwork(void)
   return true; 
 }
 
-bool BERGCloudCC3000::sendJSON(aJsonObject* root)
-{
-  /* Caller must delete aJson root object after use. */
+/* Messages sent to the bridge; see BERGCloudJSONWriter.h */
 
-  char *tx_data = aJson.print(root);
-  webSocket.sendData((const char *)tx_data);
-  free(tx_data);
-  
+BC_JSON_TEMPLATE(connectEventTemplate) =
+  "{\"type\":\"WifiEvent\",\"name\":\"connect\",\"client_hardware_type\":\"CC3000\","
+  "\"client_library_version\":" BC_JSON_FIELD_1 ",\"hardware_address\":\"" BC_JSON_FIELD_2 "\","
+  "\"reset_description_code\":" BC_JSON_FIELD_3 ",\"developer_project_key\":\"" BC_JSON_FIELD_4 "\","
+  "\"developer_version\":" BC_JSON_FIELD_5 ",\"secret\":\"" BC_JSON_FIELD_6 "\"}";
+
+/* An event is written either side of its base64 payload, which is */
+/* encoded as it is sent */
+BC_JSON_TEMPLATE(deviceEventStartTemplate) =
+  "{\"type\":\"DeviceEvent\",\"bridge_address\":\"" BC_JSON_FIELD_1 "\","
+  "\"device_address\":\"" BC_JSON_FIELD_1 "\",\"binary_payload\":\"";
+
+BC_JSON_TEMPLATE(deviceEventEndTemplate) =
+  "\",\"timestamp\":0}";
+
+BC_JSON_TEMPLATE(commandResponseTemplate) =
+  "{\"type\":\"DeviceCommandResponse\",\"bridge_address\":\"" BC_JSON_FIELD_1 "\","
+  "\"device_address\":\"" BC_JSON_FIELD_1 "\",\"command_id\":" BC_JSON_FIELD_2 ","
+  "\"return_code\":" BC_JSON_FIELD_3 ",\"timestamp\":0}";
+
+bool BERGCloudCC3000::sendJSON(BERGCloudJSONWriter& json)
+{
+  /* Written to the client as a text frame */
+  sendFrameHeader(WS_OPCODE_TEXT, json.size());
+  sendJSONData(json);
   return true;
 }
 
-bool BERGCloudCC3000::receiveJSON(aJsonObject **obj)
+void BERGCloudCC3000::sendJSONData(BERGCloudJSONWriter& json)
 {
-  /* Caller must delete aJson root object after use. */
-  
-  String rxData;
+  /* Write the text to the client a chunk at a time */
+  uint8_t chunk[16];
+  uint16_t chunkSize;
+
+  while ((chunkSize = json.read(chunk, sizeof(chunk))) > 0)
+  {
+    sendFrameData(chunk, chunkSize);
+  }
+}
+
+bool BERGCloudCC3000::receiveJSON(BERGCloudJSONReader& json)
+{
+  /* Read the next text frame a chunk at a time into 'json'; */
+  /* returns TRUE if it held a whole JSON object */
+  uint8_t chunk[16];
+  uint16_t chunkSize;
+  uint8_t mask[4];
   uint8_t opcode;
-  bool result;
+  uint32_t size;
+  uint32_t offset = 0;
+
+  if (!receiveFrame(opcode, size, mask))
+  {
+    return false;
+  }
 
-  /* Process incoming data */
-  do {
-    result = webSocket.getData(rxData, &opcode);
-    
-    if (result)
+  if (opcode != WS_OPCODE_TEXT)
+  {
+    skipFrameData(size, mask, false);
+    return false;
+  }
+
+  while (offset < size)
+  {
+    chunkSize = ((size - offset) < sizeof(chunk)) ? (uint16_t)(size - offset) : sizeof(chunk);
+
+    if (!readFrameData(chunk, chunkSize))
     {
-      if (opcode == WS_OPCODE_PING)
-      {
-        webSocket.sendData(rxData, WS_OPCODE_PONG);
-        numberOfPings++;
-      }
-      
-      if (opcode == WS_OPCODE_TEXT)
-      {
-        /* JSON data */
-        *obj = aJson.parse((char *)rxData.c_str());
-        return true;
-      }
+      return false;
     }
-  } while (result == true);
-  
-  /* No JSON data */
-  return false;
+
+    /* Read to the end of the frame even once the JSON is found bad */
+    unmaskFrameData(chunk, chunkSize, mask, offset);
+    json.feed(chunk, chunkSize);
+    offset += chunkSize;
+  }
+
+  return json.done();
 }
 
 bool BERGCloudCC3000::isNonZero(uint8_t *data, uint8_t dataSize)
@@ -350,46 +401,34 @@ void BERGCloudCC3000::arrayToString(String& string, uint8_t *array, uint8_t item
 
 bool BERGCloudCC3000::sendConnectEvent(void)
 {
-  bool result = false;
-  String addressString;
-  String secretString;
-  
-  arrayToString(addressString, hardwareAddress, sizeof(hardwareAddress));
-  getClaimcode(secretString, false /* No hyphens */);
+  char secret[BC_CLAIMCODE_SIZE_BYTES];
   
   if (_key == NULL)
   {
     return false;
   }
   
-  aJsonObject* root = aJson.createObject();
-  if (root == NULL)
+  if (!getClaimcode(secret, false /* No hyphens */))
   {
-    return false;
+    /* Not yet claimed */
+    secret[0] = '\0';
   }
 
-  aJson.addItemToObject(root, "type", aJson.createItem("WifiEvent"));
-  aJson.addItemToObject(root, "name", aJson.createItem("connect"));
-  aJson.addItemToObject(root, "client_hardware_type", aJson.createItem("CC3000"));
-  aJson.addItemToObject(root, "client_library_version", aJson.createItem((uint32_t)BERGCLOUD_LIB_VERSION));
-  aJson.addItemToObject(root, "hardware_address", aJson.createItem(addressString.c_str()));
-  aJson.addItemToObject(root, "reset_description_code", aJson.createItem((uint32_t)getResetSource()));
-  aJson.addItemToObject(root, "developer_project_key", aJson.createItem(_key));
-  aJson.addItemToObject(root, "developer_version", aJson.createItem((uint32_t)_version));
-  aJson.addItemToObject(root, "secret", aJson.createItem(secretString.c_str()));
-
-  result = sendJSON(root);
-  aJson.deleteItem(root);
-
-  return result;
+  BC_JSON_FIELD fields[] = {
+    {BC_JSON_NUMBER, NULL, 0, (uint32_t)BERGCLOUD_LIB_VERSION},
+    {BC_JSON_HEX, hardwareAddress, sizeof(hardwareAddress), 0},
+    {BC_JSON_NUMBER, NULL, 0, (uint32_t)getResetSource()},
+    {BC_JSON_STRING, _key, 0, 0},
+    {BC_JSON_NUMBER, NULL, 0, (uint32_t)_version},
+    {BC_JSON_TEXT, secret, 0, 0}
+  };
+  BERGCloudJSONWriter json(connectEventTemplate, fields);
+
+  return sendJSON(json);
 }
 
-bool BERGCloudCC3000::sendDeviceEvent(uint8_t *header, uint16_t headerSize, uint8_t *data, uint16_t dataSize)
+bool BERGCloudCC3000::readyToSendEvent(void)
 {
-  bool result = false;
-  uint8_t binaryData[headerSize + dataSize];
-  int8_t encodedData[base64_enc_len(headerSize) + base64_enc_len(dataSize) + 1]; /* +1 for null terminator */
-  String addressString;
   uint8_t state;
 
   if (!getConnectionState(state))
@@ -410,32 +449,118 @@ bool BERGCloudCC3000::sendDeviceEvent(uint8_t *header, uint16_t headerSize, uint
     return false;
   }
 
-  /* Copy header and data */
-  memcpy(&binaryData[0], header, headerSize);
-  memcpy(&binaryData[headerSize], data, dataSize);
-  
-  /* Base64 encode - uses the base64 library included with the WebSockets library */
-  base64_encode((char *)encodedData, (char *)binaryData, sizeof(binaryData));
-  
-  aJsonObject* root = aJson.createObject();
-  if (root == NULL)
+  return true;
+}
+
+bool BERGCloudCC3000::sendDeviceEvent(uint8_t *header, uint16_t headerSize, uint8_t *data, uint16_t dataSize)
+{
+  BERGCloudBase64Encoder base64;
+
+  if (!readyToSendEvent())
   {
     return false;
   }
-  
-  arrayToString(addressString, hardwareAddress, sizeof(hardwareAddress));
 
-  aJson.addItemToObject(root, "type", aJson.createItem("DeviceEvent"));
-  aJson.addItemToObject(root, "bridge_address", aJson.createItem(addressString.c_str()));
-  aJson.addItemToObject(root, "device_address", aJson.createItem(addressString.c_str()));
-  aJson.addItemToObject(root, "binary_payload", aJson.createItem((char *)encodedData));
-  aJson.addItemToObject(root, "timestamp", aJson.createItem((uint32_t)0));
-  
-  result = sendJSON(root);
-  
-  aJson.deleteItem(root);
-  
-  return result;
+#if BC_WEBSOCKET_BINARY
+  if (binaryFrames)
+  {
+    /* The header and data are sent as they are, one after the other */
+    sendFrameHeader(WS_OPCODE_BINARY, (uint32_t)headerSize + dataSize);
+    sendFrameData(header, headerSize);
+    sendFrameData(data, dataSize);
+    return true;
+  }
+#endif
+
+  /* The header and data are base64 encoded as they are sent, */
+  /* one after the other, with no copy of either */
+  sendEncodedEventStart((uint32_t)headerSize + dataSize);
+  sendEncodedEventData(base64, header, headerSize);
+  sendEncodedEventData(base64, data, dataSize);
+  sendEncodedEventEnd(base64);
+  return true;
+}
+
+#ifdef BERGCLOUD_PACK_UNPACK
+bool BERGCloudCC3000::sendDeviceEvent(uint8_t *header, uint16_t headerSize, BERGCloudMessageBuffer& data)
+{
+  BERGCloudBase64Encoder base64;
+  uint8_t *segment;
+  uint16_t segmentSize;
+  uint16_t offset = 0;
+
+  if (!readyToSendEvent())
+  {
+    return false;
+  }
+
+#if BC_WEBSOCKET_BINARY
+  if (binaryFrames)
+  {
+    sendFrameHeader(WS_OPCODE_BINARY, (uint32_t)headerSize + data.used());
+    sendFrameData(header, headerSize);
+
+    while (data.segment(offset, segment, segmentSize))
+    {
+      sendFrameData(segment, segmentSize);
+      offset += segmentSize;
+    }
+
+    return true;
+  }
+#endif
+
+  /* Base64 encode the header, then each segment of the data in turn */
+  sendEncodedEventStart((uint32_t)headerSize + data.used());
+  sendEncodedEventData(base64, header, headerSize);
+
+  while (data.segment(offset, segment, segmentSize))
+  {
+    sendEncodedEventData(base64, segment, segmentSize);
+    offset += segmentSize;
+  }
+
+  sendEncodedEventEnd(base64);
+  return true;
+}
+#endif
+
+void BERGCloudCC3000::sendEncodedEventStart(uint32_t binaryDataSize)
+{
+  /* Send the frame header for a DeviceEvent carrying 'binaryDataSize' */
+  /* bytes, and the JSON up to its base64 payload */
+  BC_JSON_FIELD fields[] = {
+    {BC_JSON_HEX, hardwareAddress, sizeof(hardwareAddress), 0}
+  };
+  BERGCloudJSONWriter start(deviceEventStartTemplate, fields);
+  BERGCloudJSONWriter end(deviceEventEndTemplate, NULL);
+
+  sendFrameHeader(WS_OPCODE_TEXT, (uint32_t)start.size() + BC_BASE64_SIZE(binaryDataSize) + end.size());
+  sendJSONData(start);
+}
+
+void BERGCloudCC3000::sendEncodedEventData(BERGCloudBase64Encoder& base64, uint8_t *data, uint16_t size)
+{
+  /* Send the next part of the payload as whole groups of base64 */
+  const uint8_t *next = data;
+  char text[16];
+  uint16_t textSize;
+
+  while (size > 0)
+  {
+    textSize = base64.encode(next, size, text, sizeof(text));
+    sendFrameData((uint8_t *)text, textSize);
+  }
+}
+
+void BERGCloudCC3000::sendEncodedEventEnd(BERGCloudBase64Encoder& base64)
+{
+  /* Send the last group of the payload, with padding, and the JSON after it */
+  BERGCloudJSONWriter end(deviceEventEndTemplate, NULL);
+  char text[4];
+
+  sendFrameData((uint8_t *)text, base64.end(text));
+  sendJSONData(end);
 }
 
 void BERGCloudCC3000::loop(void)
@@ -487,14 +612,61 @@ void BERGCloudCC3000::loop(void)
   BERGCloudBase::loop();
 }
 
+/*
+  Reads a DeviceCommand, taking a command pool block for its payload
+  unless the type has already been read as something else. JSON does
+  not fix the order of members, so the payload may come before the
+  type; the caller releases the block if it was not a DeviceCommand.
+*/
+
+class BERGCloudCommandReader : public BERGCloudJSONReader
+{
+public:
+  BERGCloudCommandReader(BC_JSON_MEMBER *members, uint8_t count, BERGCloudBlockPool& pool)
+    : BERGCloudJSONReader(members, count), block(NULL), exhausted(false), type(members[0]), pool(pool)
+  {
+  }
+  /* The block taken, or NULL; released by the caller */
+  uint8_t *block;
+  /* Set if a payload was dropped as no block was free */
+  bool exhausted;
+
+protected:
+  virtual bool base64Start(BC_JSON_MEMBER *member)
+  {
+    if (type.found && (strcmp(type.data, "DeviceCommand") != 0))
+    {
+      return false;
+    }
+
+    if (block == NULL)
+    {
+      block = pool.acquire(pool.blockSize());
+      exhausted = (block == NULL);
+    }
+
+    member->data = (char *)block;
+    member->size = (block != NULL) ? pool.blockSize() : 0;
+    return block != NULL;
+  }
+
+private:
+  BC_JSON_MEMBER& type;
+  BERGCloudBlockPool& pool;
+};
+
 bool BERGCloudCC3000::pollForDeviceCommand(void)
 {
   uint8_t *binaryData;
-  int binaryDataSize;
-  uint16_t cmd = 0;
-  uint8_t i;
-  aJsonObject *root = NULL;
+  char type[sizeof("DeviceCommand")];
+  BC_JSON_MEMBER members[] = {
+    {"type", BC_JSON_STRING, type, sizeof(type), 0, 0, false},
+    {"binary_payload", BC_JSON_BASE64, NULL, 0, 0, 0, false},
+    {"command_id", BC_JSON_NUMBER, NULL, 0, 0, 0, false}
+  };
+  BERGCloudCommandReader json(members, sizeof(members) / sizeof(members[0]), commandPool);
   uint8_t state;
+  bool received;
 
   if (!getConnectionState(state))
   {
@@ -508,92 +680,74 @@ bool BERGCloudCC3000::pollForDeviceCommand(void)
     return false;
   }
 
-  if (!receiveJSON(&root))
+#if BC_WEBSOCKET_BINARY
+  if (binaryFrames)
   {
-    return false;
+    return pollForBinaryCommand(state);
   }
-  
-  if (root == NULL)
+#endif
+
+  if (wlan.available() == 0)
   {
     return false;
   }
-  
-  #ifdef JSON_DEBUG_PRINT
-  /* Print JSON */
-  char *text = aJson.print(root);
-  if (text != NULL)
+
+  /* The payload is decoded straight into a command pool block as it */
+  /* is read; if there is none free, or it does not fit, it is dropped */
+  received = receiveJSON(json);
+  binaryData = json.block;
+
+  if (json.overflowed())
   {
-    Serial.println(F("Command JSON:"));
-    Serial.println(text);
-    free(text);
+    commandPool.refuseOversize();
+
+    #ifdef JSON_DEBUG_PRINT
+    Serial.println(F("Command payload too large for a pool block"));
+    #endif
   }
-  #endif
-  
-  /* Check message type */
-  aJsonObject* type = aJson.getObjectItem(root, "type");
-  
-  if (type == NULL)
+  else if (json.exhausted)
   {
-    aJson.deleteItem(root);
-    return false;
+    #ifdef JSON_DEBUG_PRINT
+    Serial.println(F("Command dropped, no free pool block"));
+    #endif
   }
-  
-  if (strcmp((const char *)type->valuestring, "DeviceCommand") != 0)
+
+  if (!received)
   {
-    aJson.deleteItem(root);
+    commandPool.release(binaryData);
     return false;
   }
   
-  /* Get payload */
-  aJsonObject* payload = aJson.getObjectItem(root, "binary_payload");
-  
-  if (payload == NULL)
+  /* Check message type */
+  if (!members[0].found || (strcmp(type, "DeviceCommand") != 0))
   {
-    aJson.deleteItem(root);
+    commandPool.release(binaryData);
     return false;
   }
   
-  /* Get command_id */
-  aJsonObject* command_id = aJson.getObjectItem(root, "command_id");
-  
-  if (command_id == NULL)
+  /* Check payload and command_id */
+  if (!members[1].found || !members[2].found || (members[1].length < BC_COMMAND_HEADER_SIZE_BYTES))
   {
-    aJson.deleteItem(root);
+    commandPool.release(binaryData);
     return false;
   }
 
-  /* Remove spurious '\n' */
-  char *in, *out;
-  in = out = payload->valuestring;
+  #ifdef JSON_DEBUG_PRINT
+  Serial.print(F("Command payload: "));
+  Serial.print(members[1].length);
+  Serial.println(F(" bytes"));
+  #endif
+
+  return deviceCommandReceived(binaryData, members[1].length, members[2].number, state);
+}
+
+bool BERGCloudCC3000::deviceCommandReceived(uint8_t *binaryData, uint16_t binaryDataSize, uint32_t commandID, uint8_t state)
+{
+  /* Act on a command held in a command pool block; returns TRUE */
+  /* if it is handed on as 'command' or handled here */
+  uint16_t cmd = 0;
+  uint8_t i;
 
-  do {
-    if (*in != '\n')
-    {
-      *out++ = *in;
-    }
-    
-  } while (*in++ != '\0');
-  
-  /* Get decoded size & allocate memory */
-  binaryDataSize = base64_dec_len(payload->valuestring, strlen(payload->valuestring));
-  
-  if (binaryDataSize < BC_COMMAND_HEADER_SIZE_BYTES)
-  {
-    aJson.deleteItem(root);
-    return false;
-  }
-  
-  binaryData = (uint8_t *)malloc(binaryDataSize);
-  
-  if (binaryData == NULL)
-  {
-    aJson.deleteItem(root);
-    return false;
-  }
-  
-  /* Decode from Base64 */
-  base64_decode((char *)binaryData, payload->valuestring, strlen(payload->valuestring));
-  
   /* Get command */
   cmd = binaryData[3];
   cmd <<= 8;
@@ -604,21 +758,16 @@ bool BERGCloudCC3000::pollForDeviceCommand(void)
   {
     if ( ((cmd & BC_COMMAND_FORMAT_MASK) == BC_COMMAND_START_RAW) || ((cmd & BC_COMMAND_FORMAT_MASK) == BC_COMMAND_START_PACKED) )
     {
-		
-
-	  /* command.data should be NULL at this point, check: */
-	  if (command.data != NULL)
-	  {
-	    free(command.data);
-	  }	
-	      /* Command received */
+      /* command.data should be NULL at this point; release any unread command */
+      commandPool.release(command.data);
+
+      /* Command received */
       command.available = true;
-      command.id = command_id->valueint;
+      command.id = commandID;
       command.data = binaryData;
       command.size = (uint32_t)binaryDataSize;
-      // Command processing code must free(command.data)
+      // Command processing code must release command.data to commandPool
 
-      aJson.deleteItem(root);
       return true;
     }
   }
@@ -634,7 +783,7 @@ bool BERGCloudCC3000::pollForDeviceCommand(void)
         deviceID[i] = binaryData[BC_COMMAND_HEADER_SIZE_BYTES + sizeof(deviceID) - i - 1];
       }
       
-      free(binaryData);
+      commandPool.release(binaryData);
       
       
       if (isNonZero(deviceID, sizeof(deviceID)))
@@ -643,55 +792,365 @@ bool BERGCloudCC3000::pollForDeviceCommand(void)
         deviceIDUpdated();
         
         /* Send response - success */
-        sendDeviceCommandResponse(command_id->valueint, 0);
+        sendDeviceCommandResponse(commandID, 0);
       }
       else
       {
         /* Send response - failed */
-        sendDeviceCommandResponse(command_id->valueint, 0xff);
+        sendDeviceCommandResponse(commandID, 0xff);
       }
       
-      aJson.deleteItem(root);
       return true;
     }
   }
 
   /* Send response - failed */
-  sendDeviceCommandResponse(command_id->valueint, 0xff);
+  sendDeviceCommandResponse(commandID, 0xff);
 
-  free(binaryData);
+  commandPool.release(binaryData);
   
-  aJson.deleteItem(root);
   return false;
 }
 
 bool BERGCloudCC3000::sendDeviceCommandResponse(uint32_t command_id, uint8_t returnCode)
 {
-  bool result = false;
-  String addressString;
+#if BC_WEBSOCKET_BINARY
+  if (binaryFrames)
+  {
+    /* An event header carrying the command ID, then the return code */
+    uint8_t response[BC_EVENT_HEADER_SIZE_BYTES + 1];
 
-  arrayToString(addressString, hardwareAddress, sizeof(hardwareAddress));
-  
-  aJsonObject* root = aJson.createObject();
-  if (root == NULL)
+    makeEventHeader(response, BC_EVENT_COMMAND_RESPONSE, 1, command_id);
+    response[BC_EVENT_HEADER_SIZE_BYTES] = returnCode;
+
+    sendFrameHeader(WS_OPCODE_BINARY, sizeof(response));
+    sendFrameData(response, sizeof(response));
+    return true;
+  }
+#endif
+
+  BC_JSON_FIELD fields[] = {
+    {BC_JSON_HEX, hardwareAddress, sizeof(hardwareAddress), 0},
+    {BC_JSON_NUMBER, NULL, 0, command_id},
+    {BC_JSON_NUMBER, NULL, 0, (uint32_t)returnCode}
+  };
+  BERGCloudJSONWriter json(commandResponseTemplate, fields);
+
+  return sendJSON(json);
+}
+
+/*
+  WebSocket frames
+
+  Frames are read and written directly on the client, rather than by
+  webSocket, so that a received frame is parsed as it is read and a
+  message is sent as it is written, without holding either whole.
+*/
+
+bool BERGCloudCC3000::receiveFrame(uint8_t& opcode, uint32_t& size, uint8_t (&mask)[4])
+{
+  /* Read the header of the next frame, if one has arrived; returns */
+  /* TRUE if its payload is to be read, or FALSE if there is none, */
+  /* it was a ping, which is answered here, or it was dropped */
+  uint8_t frameHeader[2];
+  uint8_t extended[8];
+  uint8_t i;
+  bool fin;
+
+  if (wlan.available() == 0)
   {
     return false;
   }
 
-  aJson.addItemToObject(root, "type", aJson.createItem("DeviceCommandResponse"));
-  aJson.addItemToObject(root, "bridge_address", aJson.createItem(addressString.c_str()));
-  aJson.addItemToObject(root, "device_address", aJson.createItem(addressString.c_str()));
-  aJson.addItemToObject(root, "command_id", aJson.createItem(command_id));
-  aJson.addItemToObject(root, "return_code", aJson.createItem((uint32_t)returnCode));
-  aJson.addItemToObject(root, "timestamp", aJson.createItem((uint32_t)0));
-  
-  result = sendJSON(root);
-  
-  aJson.deleteItem(root);
-  
-  return result;
+  if (!readFrameData(frameHeader, sizeof(frameHeader)))
+  {
+    return false;
+  }
+
+  fin = ((frameHeader[0] & WS_FIN) != 0);
+  opcode = frameHeader[0] & ~WS_FIN;
+  size = frameHeader[1] & ~WS_MASK;
+
+  if (size == WS_SIZE16)
+  {
+    if (!readFrameData(extended, 2))
+    {
+      return false;
+    }
+
+    size = ((uint16_t)extended[0] << 8) | extended[1];
+  }
+  else if (size == WS_SIZE64)
+  {
+    if (!readFrameData(extended, 8))
+    {
+      return false;
+    }
+
+    /* Nothing this device can receive is 4GB or more */
+    if ((extended[0] | extended[1] | extended[2] | extended[3]) != 0)
+    {
+      _LOG("Disconnected (WebSocket frame too large)");
+      closeConnection();
+      return false;
+    }
+
+    size = 0;
+    for (i = 4; i < 8; i++)
+    {
+      size = (size << 8) | extended[i];
+    }
+  }
+
+  /* The bridge should not mask its frames, but may */
+  memset(mask, 0x00, sizeof(mask));
+  if ((frameHeader[1] & WS_MASK) && !readFrameData(mask, sizeof(mask)))
+  {
+    return false;
+  }
+
+  if (opcode == WS_OPCODE_PING)
+  {
+    numberOfPings++;
+
+    /* Send the payload straight back */
+    sendFrameHeader(WS_OPCODE_PONG, size);
+    skipFrameData(size, mask, true /* Pong */);
+    return false;
+  }
+
+  if (opcode == WS_OPCODE_CLOSE)
+  {
+    _LOG("Disconnected (WebSocket closed)");
+    closeConnection();
+    return false;
+  }
+
+  if (!fin || (opcode == WS_OPCODE_CONTINUATION))
+  {
+    /* The bridge does not fragment messages, and this device has */
+    /* nowhere to join them, so each part is dropped */
+    _LOG("Fragmented WebSocket frame dropped");
+    skipFrameData(size, mask, false);
+    return false;
+  }
+
+  return true;
+}
+
+bool BERGCloudCC3000::readFrameData(uint8_t *data, uint16_t size)
+{
+  /* Wait for the rest of a frame, as it may arrive in pieces, but */
+  /* not for longer than FRAME_TIMEOUT_MS between each piece */
+  int received;
+  uint32_t lastReceived = millis();
+
+  while (size > 0)
+  {
+    if (wlan.available() == 0)
+    {
+      if (!wlan.connected())
+      {
+        return false;
+      }
+
+      if ((millis() - lastReceived) > FRAME_TIMEOUT_MS)
+      {
+        _LOG("Disconnected (WebSocket frame timed out)");
+        closeConnection();
+        return false;
+      }
+
+      delay(1);
+      continue;
+    }
+
+    received = wlan.read(data, size);
+
+    if (received <= 0)
+    {
+      return false;
+    }
+
+    data += received;
+    size -= received;
+    lastReceived = millis();
+  }
+
+  return true;
 }
 
+bool BERGCloudCC3000::skipFrameData(uint32_t size, uint8_t *mask, bool pong)
+{
+  /* Read and discard the payload of a frame, or send it back as a pong */
+  uint8_t chunk[16];
+  uint16_t chunkSize;
+  uint32_t offset = 0;
+
+  while (offset < size)
+  {
+    chunkSize = ((size - offset) < sizeof(chunk)) ? (uint16_t)(size - offset) : sizeof(chunk);
+
+    if (!readFrameData(chunk, chunkSize))
+    {
+      return false;
+    }
+
+    if (pong)
+    {
+      unmaskFrameData(chunk, chunkSize, mask, offset);
+      sendFrameData(chunk, chunkSize);
+    }
+
+    offset += chunkSize;
+  }
+
+  return true;
+}
+
+void BERGCloudCC3000::unmaskFrameData(uint8_t *data, uint16_t size, uint8_t *mask, uint32_t offset)
+{
+  while (size-- > 0)
+  {
+    *data++ ^= mask[offset++ % 4];
+  }
+}
+
+void BERGCloudCC3000::sendFrameHeader(uint8_t opcode, uint32_t size)
+{
+  /* Frames sent by a client are always masked */
+  uint8_t i;
+
+  wlan.write((uint8_t)(WS_FIN | opcode));
+
+  if (size > 0xffff)
+  {
+    /* The 64-bit length form; the upper 32 bits are always zero */
+    wlan.write((uint8_t)(WS_SIZE64 | WS_MASK));
+    for (i = 0; i < 4; i++)
+    {
+      wlan.write((uint8_t)0x00);
+    }
+    wlan.write((uint8_t)(size >> 24));
+    wlan.write((uint8_t)((size >> 16) & 0xff));
+    wlan.write((uint8_t)((size >> 8) & 0xff));
+    wlan.write((uint8_t)(size & 0xff));
+  }
+  else if (size > 125)
+  {
+    wlan.write((uint8_t)(WS_SIZE16 | WS_MASK));
+    wlan.write((uint8_t)(size >> 8));
+    wlan.write((uint8_t)(size & 0xff));
+  }
+  else
+  {
+    wlan.write((uint8_t)(size | WS_MASK));
+  }
+
+  for (i = 0; i < sizeof(frameMask); i++)
+  {
+    frameMask[i] = randomByte();
+    wlan.write(frameMask[i]);
+  }
+
+  frameMaskIndex = 0;
+}
+
+void BERGCloudCC3000::closeConnection(void)
+{
+  /* Close the socket; the next poll or send reconnects */
+  wlan.stop();
+  eventDisconnected();
+}
+
+void BERGCloudCC3000::sendFrameData(const uint8_t *data, uint16_t size)
+{
+  while (size-- > 0)
+  {
+    wlan.write((uint8_t)(*data++ ^ frameMask[frameMaskIndex++ % 4]));
+  }
+}
+
+#if BC_WEBSOCKET_BINARY
+/*
+  Binary frames
+
+  Once the bridge has chosen BC_WEBSOCKET_PROTOCOL_BINARY, each event,
+  command and command response is a WS_OPCODE_BINARY frame:
+
+    Event             10-byte event header, then the payload
+    Command           16-byte command header, with the command ID at
+                      BC_COMMAND_ID_OFFSET, then the payload
+    Command response  10-byte event header of BC_EVENT_COMMAND_RESPONSE,
+                      with the command ID as its invocation ID, then the
+                      return code
+
+  The connect event is still sent as JSON. A command is read straight
+  into a command pool block, and an event sent straight from the message.
+*/
+
+bool BERGCloudCC3000::pollForBinaryCommand(uint8_t state)
+{
+  uint8_t mask[4];
+  uint8_t opcode;
+  uint32_t size;
+  uint32_t commandID;
+  uint8_t *binaryData;
+  uint8_t i;
+
+  if (!receiveFrame(opcode, size, mask))
+  {
+    return false;
+  }
+
+  if ((opcode != WS_OPCODE_BINARY) || (size < BC_COMMAND_HEADER_SIZE_BYTES))
+  {
+    skipFrameData(size, mask, false);
+    return false;
+  }
+
+  /* Counted and logged as for a JSON command */
+  if (size > commandPool.blockSize())
+  {
+    commandPool.refuseOversize();
+    skipFrameData(size, mask, false);
+
+    #ifdef JSON_DEBUG_PRINT
+    Serial.println(F("Command payload too large for a pool block"));
+    #endif
+    return false;
+  }
+
+  binaryData = commandPool.acquire(size);
+
+  if (binaryData == NULL)
+  {
+    skipFrameData(size, mask, false);
+
+    #ifdef JSON_DEBUG_PRINT
+    Serial.println(F("Command dropped, no free pool block"));
+    #endif
+    return false;
+  }
+
+  if (!readFrameData(binaryData, size))
+  {
+    commandPool.release(binaryData);
+    return false;
+  }
+
+  unmaskFrameData(binaryData, size, mask, 0);
+
+  commandID = 0;
+  for (i = 0; i < sizeof(commandID); i++)
+  {
+    commandID |= (uint32_t)binaryData[BC_COMMAND_ID_OFFSET + i] << (i * 8);
+  }
+
+  return deviceCommandReceived(binaryData, size, commandID, state);
+}
+#endif // #if BC_WEBSOCKET_BINARY
+
 bool BERGCloudCC3000::nvRamRead(uint8_t *data, uint8_t size)
 {
   uint8_t i;
@@ -768,24 +1227,9 @@ uint8_t BERGCloudCC3000::randomByte(void)
 
 #ifdef BERGCLOUD_PACK_UNPACK
 
-bool BERGCloudMessage::pack(double& n)
-{
-  /* For 16-bit Arduino platforms we can treat a double literal */
-  /* value as as float; this is so pack(1.234) will work. */
-
-  if (sizeof(double) == sizeof(float))
-  {
-    return pack((float)n);
-  }
-
-  _LOG("Pack: 8-byte double type is not supported.\r\n");
-  return false;
-}
-
 bool BERGCloudMessage::pack(String& s)
 {
   uint16_t strLen = s.length();
-  uint32_t i = 0;
 
   /* Add header */
   if (!pack_raw_header(strLen))
@@ -794,16 +1238,12 @@ bool BERGCloudMessage::pack(String& s)
   }
 
   /* Add data */
-  while (strLen-- > 0)
-  {
-    add((uint8_t)s.charAt(i++));
-  }
-
-  return true;
+  return write((const uint8_t *)s.c_str(), strLen);
 }
 
 bool BERGCloudMessage::unpack(String& s)
 {
+  uint16_t start = bytesRead;
   uint16_t sizeInBytes;
 
   if (!unpack_raw_header(&sizeInBytes))
@@ -813,14 +1253,39 @@ bool BERGCloudMessage::unpack(String& s)
 
   if (!remaining(sizeInBytes))
   {
+    bytesRead = start;
     _LOG_UNPACK_ERROR_NO_DATA;
     return false;
   }
 
   s = ""; /* Empty string */
-  while (sizeInBytes-- > 0)
+  if (!s.reserve(sizeInBytes))
+  {
+    _LOG("Unpack: Out of memory for string.");
+    return false;
+  }
+
+  /* Append in chunks, each null-terminated for concat(). A String */
+  /* can't hold a null character, so data containing one is refused */
+  /* and left unread, to be unpacked as binary data instead. */
+  while (sizeInBytes > 0)
   {
-    s += (char)read();
+    char chunk[STRING_CHUNK_SIZE_BYTES + 1];
+    uint16_t chunkSize = (sizeInBytes < STRING_CHUNK_SIZE_BYTES) ? sizeInBytes : STRING_CHUNK_SIZE_BYTES;
+
+    read((uint8_t *)chunk, chunkSize);
+
+    if (memchr(chunk, '\0', chunkSize) != NULL)
+    {
+      _LOG("Unpack: Null character in string.");
+      s = "";
+      bytesRead = start;
+      return false;
+    }
+
+    chunk[chunkSize] = '\0';
+    s += chunk;
+    sizeInBytes -= chunkSize;
   }
 
   return true;
@@ -868,6 +1333,36 @@ bool BERGCloudCC3000::pollForCommand(BERGCloudMessageBuffer& buffer, String& com
   return result;
 }
 
+bool BERGCloudCC3000::pollForCommand(BERGCloudCommand& command, char *commandName, uint8_t commandNameMaxSize, uint32_t *id)
+{
+  return takeCommand(command, commandName, commandNameMaxSize, id);
+}
+
+bool BERGCloudCC3000::pollForCommand(BERGCloudCommand& command, String& commandName)
+{
+  String unused;
+
+  return pollForCommand(command, commandName, unused);
+}
+
+bool BERGCloudCC3000::pollForCommand(BERGCloudCommand& command, String& commandName, String& commandID)
+{
+  bool result = false;
+  char tmp[31 + 1]; /* +1 for null terminator */
+  uint32_t id = 0;
+
+  commandName = ""; /* Empty string */
+  result = takeCommand(command, (char *)tmp, (uint8_t)sizeof(tmp), &id);
+
+  if (result)
+  {
+    commandName = String(tmp);
+    commandID = String(id);
+  }
+
+  return result;
+}
+
 bool BERGCloudCC3000::sendEvent(String& eventName, BERGCloudMessageBuffer& buffer)
 {
   uint8_t temp[eventName.length() + 1]; /* +1 for null terminator */
@@ -29,10 +29,14 @@ THE SOFTWARE.
 #include "CC3000Client.h"
 #include "WebSocketClient.h"
 #include "Base64.h"
-#include "aJSON.h"
+#include "BERGCloudJSONWriter.h"
+#include "BERGCloudJSONReader.h"
+#include "BERGCloudBase64.h"
 
 #ifdef BERGCLOUD_PACK_UNPACK
 #include "BERGCloudMessageBase.h"
+#include "BERGCloudChunkPool.h"
+#include "BERGCloudStreamDecoder.h"
 #endif
 
 // These are the interrupt and control pins
@@ -44,9 +48,12 @@ THE SOFTWARE.
 // On an UNO, SCK = 13, MISO = 12, and MOSI = 11
 
 #define DHCP_TIMEOUT_100MS   300 // 30 Seconds
+#define FRAME_TIMEOUT_MS     5000 // 5 Seconds, between parts of a frame
 #define DNS_RESOLVE_ATTEMPTS 10
 #define SMARTCONFIG_ATTEMPTS 10
 
+#define STRING_CHUNK_SIZE_BYTES 32 // Stack used when unpacking a String
+
 //#define JSON_DEBUG_PRINT
 
 class BERGCloudWLANConfig 
@@ -72,6 +79,10 @@ public:
   bool smartConfigReconnect;
 };
 
+#ifdef BERGCLOUD_PACK_UNPACK
+class BERGCloudCommand;
+#endif
+
 class BERGCloudCC3000 : public BERGCloudBase
 {
 public:
@@ -83,6 +94,10 @@ public:
   using BERGCloudBase::pollForCommand;
   bool pollForCommand(BERGCloudMessageBuffer& buffer, String& commandName);
   bool pollForCommand(BERGCloudMessageBuffer& buffer, String& commandName, String& commandID);
+  /* As above, but the command is read in place rather than copied */
+  bool pollForCommand(BERGCloudCommand& command, char *commandName, uint8_t commandNameMaxSize, uint32_t *id = NULL);
+  bool pollForCommand(BERGCloudCommand& command, String& commandName);
+  bool pollForCommand(BERGCloudCommand& command, String& commandName, String& commandID);
   using BERGCloudBase::sendEvent;
   bool sendEvent(String& eventName, BERGCloudMessageBuffer& buffer);
 #endif
@@ -90,11 +105,34 @@ public:
   void begin(void);
   virtual void loop(void);
 protected:
-  bool sendJSON(aJsonObject* root);
-  bool receiveJSON(aJsonObject** obj);
+  bool sendJSON(BERGCloudJSONWriter& json);
+  void sendJSONData(BERGCloudJSONWriter& json);
+  bool receiveJSON(BERGCloudJSONReader& json);
   virtual bool sendDeviceEvent(uint8_t *header, uint16_t headerSize, uint8_t *data, uint16_t dataSize);
+#ifdef BERGCLOUD_PACK_UNPACK
+  virtual bool sendDeviceEvent(uint8_t *header, uint16_t headerSize, BERGCloudMessageBuffer& data);
+#endif
+  bool readyToSendEvent(void);
+  void sendEncodedEventStart(uint32_t binaryDataSize);
+  void sendEncodedEventData(BERGCloudBase64Encoder& base64, uint8_t *data, uint16_t size);
+  void sendEncodedEventEnd(BERGCloudBase64Encoder& base64);
   virtual bool pollForDeviceCommand(void);
+  bool deviceCommandReceived(uint8_t *binaryData, uint16_t binaryDataSize, uint32_t commandID, uint8_t state);
   virtual bool sendDeviceCommandResponse(uint32_t command_id, uint8_t returnCode);
+  /* Frames, read and written here rather than by webSocket */
+  bool receiveFrame(uint8_t& opcode, uint32_t& size, uint8_t (&mask)[4]);
+  bool readFrameData(uint8_t *data, uint16_t size);
+  bool skipFrameData(uint32_t size, uint8_t *mask, bool pong);
+  void unmaskFrameData(uint8_t *data, uint16_t size, uint8_t *mask, uint32_t offset);
+  void sendFrameHeader(uint8_t opcode, uint32_t size);
+  void sendFrameData(const uint8_t *data, uint16_t size);
+  void closeConnection(void);
+  uint8_t frameMask[4];   /* Of the frame being sent */
+  uint8_t frameMaskIndex;
+#if BC_WEBSOCKET_BINARY
+  bool pollForBinaryCommand(uint8_t state);
+  bool binaryFrames;      /* Chosen by the bridge during the handshake */
+#endif
   bool connectToNetwork(void);
   virtual bool nvRamRead(uint8_t *data, uint8_t size);
   virtual bool nvRamWrite(uint8_t *data, uint8_t size);
@@ -130,20 +168,157 @@ class BERGCloudMessage : public BERGCloudMessageBase
   BERGCloudMessage()
   {
   }
-  BERGCloudMessage(uint16_t size)
-    : BERGCloudMessageBase(size)
+  BERGCloudMessage(uint16_t size, uint16_t headroom = 0)
+    : BERGCloudMessageBase(size, headroom)
   {
   }
   using BERGCloudMessageBase::pack;
   using BERGCloudMessageBase::unpack;
-  /* Pack a 4-byte double */
-  bool pack(double& n);
-  /* Methods using Arduino string class */
+  /* Methods using Arduino string class; a String can't hold a null */
+  /* character, so data containing one is not unpacked */
   bool pack(String& s);
   bool unpack(String& s);
   /* Methods using Arduino boolean type */
   bool pack_boolean(boolean n);
   bool unpack_boolean(boolean &n);
+protected:
+  BERGCloudMessage(uint8_t *storage, uint16_t size, uint16_t headroom = 0)
+    : BERGCloudMessageBase(storage, size, headroom)
+  {
+  }
+#if BC_CHUNKED_MESSAGES
+  BERGCloudMessage(BERGCloudBlockPool& pool)
+    : BERGCloudMessageBase(pool)
+  {
+  }
+#endif
+};
+
+/* A message whose buffer of 'N' bytes is held inline rather than */
+/* allocated from the heap; it can be used wherever a BERGCloudMessage is. */
+/* With 'H' = BC_EVENT_HEADROOM_BYTES, sendEvent() sends it without copying. */
+template <uint16_t N, uint16_t H = 0>
+class BERGCloudStaticMessage : public BERGCloudMessage
+{
+  public:
+  BERGCloudStaticMessage()
+    : BERGCloudMessage(storage, N, H)
+  {
+  }
+  BERGCloudStaticMessage(const BERGCloudStaticMessage& other)
+    : BERGCloudMessage(storage, N, H)
+  {
+    copy(other);
+  }
+  BERGCloudStaticMessage& operator=(const BERGCloudStaticMessage& other)
+  {
+    if (this != &other)
+    {
+      copy(other);
+    }
+    return *this;
+  }
+  private:
+  void copy(const BERGCloudStaticMessage& other)
+  {
+    memcpy(&storage[H], &other.storage[H], other.bytesWritten);
+    bytesWritten = other.bytesWritten;
+    bytesRead = other.bytesRead;
+    findIndexValid = false;
+    openContainer = other.openContainer;
+    packSmallest = other.packSmallest;
+  }
+  uint8_t storage[H + N];
+};
+
+#if BC_CHUNKED_MESSAGES
+/* A message that grows in chunks from 'pool' as it is packed, rather than */
+/* failing once a fixed buffer is full. Packing fails only when the pool */
+/* is exhausted; sendEvent() sends the chunks without joining them. */
+class BERGCloudChunkedMessage : public BERGCloudMessage
+{
+  public:
+  BERGCloudChunkedMessage(BERGCloudChunkPool& pool)
+    : BERGCloudMessage(pool)
+  {
+  }
+  private:
+  /* Not copyable; the chunks have a single owner */
+  BERGCloudChunkedMessage(const BERGCloudChunkedMessage&);
+  BERGCloudChunkedMessage& operator=(const BERGCloudChunkedMessage&);
+};
+#endif
+
+/* A read-only message over memory it does not own, such as a decoded */
+/* block or a table in program memory, so that it can be unpacked without */
+/* first being copied. The memory must outlive the view. */
+class BERGCloudMessageView : private BERGCloudMessage
+{
+  public:
+  BERGCloudMessageView(const uint8_t *data, uint16_t sizeInBytes, bool progmem = false)
+    : BERGCloudMessage((uint8_t *)data, sizeInBytes)
+  {
+    bytesWritten = sizeInBytes;
+    inProgmem = progmem;
+  }
+  BERGCloudMessageView(const BERGCloudMessageView& other)
+    : BERGCloudMessage(other.buffer, other.bufferSize)
+  {
+    view(other);
+  }
+  BERGCloudMessageView& operator=(const BERGCloudMessageView& other)
+  {
+    buffer = other.buffer;
+    bufferSize = other.bufferSize;
+    view(other);
+    return *this;
+  }
+  using BERGCloudMessage::unpack;
+  using BERGCloudMessage::unpack_boolean;
+  using BERGCloudMessageBase::unpack_nil;
+  using BERGCloudMessageBase::unpack_array;
+  using BERGCloudMessageBase::unpack_map;
+  using BERGCloudMessageBase::unpack_peek;
+  using BERGCloudMessageBase::unpack_skip;
+  using BERGCloudMessageBase::unpack_restart;
+  using BERGCloudMessageBase::unpack_find;
+  using BERGCloudMessageBase::unpack_schema;
+  using BERGCloudMessageBase::unpack_view;
+  using BERGCloudMessageBase::unpack_array_of;
+  using BERGCloudMessageBase::count;
+#ifdef BERGCLOUD_LOG
+  using BERGCloudMessageBase::print;
+#endif
+  using BERGCloudMessageBuffer::size;
+  using BERGCloudMessageBuffer::remaining;
+  private:
+  void view(const BERGCloudMessageView& other)
+  {
+    bytesWritten = other.bytesWritten;
+    bytesRead = other.bytesRead;
+    inProgmem = other.inProgmem;
+    findIndexValid = false;
+  }
+};
+
+/* A received command, unpacked in place from the command pool rather than */
+/* copied into a buffer of its own. The memory is returned to the pool when */
+/* the command is destroyed, polled for again or release() is called. */
+class BERGCloudCommand : public BERGCloudMessage
+{
+  public:
+  BERGCloudCommand()
+    : BERGCloudMessage((uint8_t *)NULL, 0)
+  {
+  }
+  void release(void)
+  {
+    releaseBlock();
+  }
+  private:
+  /* Not copyable; the pool block has a single owner */
+  BERGCloudCommand(const BERGCloudCommand&);
+  BERGCloudCommand& operator=(const BERGCloudCommand&);
 };
 
 #endif // #ifdef BERGCLOUD_PACK_UNPACK
@@ -0,0 +1,58 @@
+/*
+
+Fixed-block pool for chunked message buffers
+
+Copyright (c) 2013 Berg Cloud Limited http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDCHUNKPOOL_H
+#define BERGCLOUDCHUNKPOOL_H
+
+#include "BERGCloudConfig.h"
+#include "BERGCloudBlockPool.h"
+
+#if (BC_CHUNK_POOL_CHUNKS < 1) || (BC_CHUNK_POOL_CHUNKS > 255)
+#error "BC_CHUNK_POOL_CHUNKS must be between 1 and 255"
+#endif
+
+#if (BC_CHUNK_POOL_CHUNK_SIZE_BYTES <= 8)
+#error "BC_CHUNK_POOL_CHUNK_SIZE_BYTES must be greater than 8"
+#endif
+
+/* Declare one of these and pass it to each BERGCloudChunkedMessage; */
+/* chunks are returned to it when a message is cleared or destroyed */
+class BERGCloudChunkPool : public BERGCloudBlockPool
+{
+public:
+  BERGCloudChunkPool(void)
+    : BERGCloudBlockPool(&storage[0][0], freeList, freeMap, BC_CHUNK_POOL_CHUNKS, BC_CHUNK_POOL_CHUNK_SIZE_BYTES)
+  {
+    reset();
+  }
+
+private:
+  uint8_t storage[BC_CHUNK_POOL_CHUNKS][BC_CHUNK_POOL_CHUNK_SIZE_BYTES];
+  uint8_t freeList[BC_CHUNK_POOL_CHUNKS];
+  uint8_t freeMap[BC_POOL_FREE_MAP_SIZE_BYTES(BC_CHUNK_POOL_CHUNKS)];
+};
+
+#endif // #ifndef BERGCLOUDCHUNKPOOL_H
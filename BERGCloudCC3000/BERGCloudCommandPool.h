@@ -0,0 +1,52 @@
+/*
+
+Fixed-block pool for received command payloads
+
+Copyright (c) 2013 Berg Cloud Limited http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDCOMMANDPOOL_H
+#define BERGCLOUDCOMMANDPOOL_H
+
+#include "BERGCloudConfig.h"
+#include "BERGCloudBlockPool.h"
+
+#if (BC_COMMAND_POOL_BLOCKS < 1) || (BC_COMMAND_POOL_BLOCKS > 255)
+#error "BC_COMMAND_POOL_BLOCKS must be between 1 and 255"
+#endif
+
+class BERGCloudCommandPool : public BERGCloudBlockPool
+{
+public:
+  BERGCloudCommandPool(void)
+    : BERGCloudBlockPool(&storage[0][0], freeList, freeMap, BC_COMMAND_POOL_BLOCKS, BC_COMMAND_POOL_BLOCK_SIZE_BYTES)
+  {
+    reset();
+  }
+
+private:
+  uint8_t storage[BC_COMMAND_POOL_BLOCKS][BC_COMMAND_POOL_BLOCK_SIZE_BYTES];
+  uint8_t freeList[BC_COMMAND_POOL_BLOCKS];
+  uint8_t freeMap[BC_POOL_FREE_MAP_SIZE_BYTES(BC_COMMAND_POOL_BLOCKS)];
+};
+
+#endif // #ifndef BERGCLOUDCOMMANDPOOL_H
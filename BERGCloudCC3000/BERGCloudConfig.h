@@ -36,4 +36,80 @@ THE SOFTWARE.
 #define BERGCLOUD_PACK_UNPACK
 #endif
 
+/* Received command payloads are held in a pool of fixed-size blocks; */
+/* a command larger than a block, including its 16-byte header, is rejected, */
+/* as is one received while every block holds an unread command. Both are */
+/* counted by getCommandPoolStats(), and printed if JSON_DEBUG_PRINT is set. */
+/* Two blocks let a command be received while the previous one is unread. */
+#ifndef BC_COMMAND_POOL_BLOCKS
+#define BC_COMMAND_POOL_BLOCKS 2
+#endif
+
+#ifndef BC_COMMAND_POOL_BLOCK_SIZE_BYTES
+#define BC_COMMAND_POOL_BLOCK_SIZE_BYTES 128
+#endif
+
+/* Set to 1 for BERGCloudChunkedMessage, which grows as needed in chunks */
+/* from a pool that the sketch declares, rather than failing once a fixed */
+/* buffer is full. Every message then checks for chunks as it is packed */
+/* and unpacked, which slows those with a single buffer. */
+#ifndef BC_CHUNKED_MESSAGES
+#define BC_CHUNKED_MESSAGES 0
+#endif
+
+/* Each chunk carries a pointer to the next, so holds slightly less data */
+#ifndef BC_CHUNK_POOL_CHUNKS
+#define BC_CHUNK_POOL_CHUNKS 8
+#endif
+
+#ifndef BC_CHUNK_POOL_CHUNK_SIZE_BYTES
+#define BC_CHUNK_POOL_CHUNK_SIZE_BYTES 32
+#endif
+
+/* Set to 1 for every message to pack integers in their smallest */
+/* MessagePack form, e.g. a uint32_t of 5 in one byte rather than five; */
+/* pack_smallest() sets it for a single message. Any MessagePack reader, */
+/* and unpack() into a type wide enough for the value, accepts either. */
+#ifndef BC_PACK_SMALLEST_INTEGERS
+#define BC_PACK_SMALLEST_INTEGERS 0
+#endif
+
+/* Set to 1 to pack strings of 32 to 255 bytes with the 'str 8' header */
+/* of the current MessagePack spec, saving a byte each. MessagePack */
+/* readers older than the 2013 spec revision don't accept it. */
+#ifndef BC_PACK_STR8
+#define BC_PACK_STR8 0
+#endif
+
+/* With an index, unpack_find() and count() note up to this many map keys */
+/* and array items as they search a message, so that later lookups need */
+/* not rescan it until it changes. Each entry is four bytes. */
+#ifndef BC_FIND_INDEX_ENTRIES
+#define BC_FIND_INDEX_ENTRIES 12
+#endif
+
+/* Set to 1 or more to index searches. Indexes are held in a pool, taken */
+/* by a message when it is first searched and returned by clear(), */
+/* unpack_restart() or its destruction; while none is free, searches */
+/* rescan. Each is 18 bytes plus its entries, so two take 132 bytes of */
+/* RAM. The default of 0 leaves every search to rescan, and takes none. */
+#ifndef BC_FIND_INDEX_POOL_INDEXES
+#define BC_FIND_INDEX_POOL_INDEXES 0
+#endif
+
+/* Maps and arrays that a BERGCloudStreamDecoder can have open at once, */
+/* one inside another; each level is four bytes of its working set */
+#ifndef BC_STREAM_DECODER_DEPTH
+#define BC_STREAM_DECODER_DEPTH 8
+#endif
+
+/* Set to 1 to offer the bridge binary WebSocket frames, which carry */
+/* events, commands and command responses as their header followed by */
+/* the MessagePack payload, rather than base64 in a JSON object. JSON is */
+/* still used if the bridge doesn't choose them. The WebSocket library */
+/* must report the protocol chosen, in WebSocketClient::protocolChosen. */
+#ifndef BC_WEBSOCKET_BINARY
+#define BC_WEBSOCKET_BINARY 0
+#endif
+
 #endif // #ifndef BERGCLOUDCONFIG_H
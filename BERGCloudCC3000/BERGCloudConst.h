@@ -36,6 +36,12 @@ THE SOFTWARE.
 #define BC_SECRET_SIZE_BYTES            8
 #define BC_KEY_SIZE_BYTES               16
 #define BC_COMMAND_HEADER_SIZE_BYTES    16
+#define BC_EVENT_HEADER_SIZE_BYTES      10
+#define BC_EVENT_NAME_MAX_SIZE_BYTES    31
+
+/* Space in front of a message's data for sendEvent() to add the event */
+/* header and name in place; see BERGCloudStaticMessage */
+#define BC_EVENT_HEADROOM_BYTES         (BC_EVENT_HEADER_SIZE_BYTES + 1 + BC_EVENT_NAME_MAX_SIZE_BYTES)
 
 /*
  * NVRAM
@@ -61,15 +67,27 @@ THE SOFTWARE.
 #define BC_WEBSOCKET_HOST_IP            INADDR_NONE
 #define BC_WEBSOCKET_PORT               80
 #define BC_WEBSOCKET_PATH               "/api/v1/connection"
-#define BC_WEBSOCKET_PROTOCOL           "bergcloud-bridge-v1"
+#define BC_WEBSOCKET_PROTOCOL_JSON      "bergcloud-bridge-v1"
+#define BC_WEBSOCKET_PROTOCOL_BINARY    "bergcloud-bridge-v1-binary"
+
+/* Offered in order of preference; see BC_WEBSOCKET_BINARY */
+#if BC_WEBSOCKET_BINARY
+#define BC_WEBSOCKET_PROTOCOL           BC_WEBSOCKET_PROTOCOL_BINARY ", " BC_WEBSOCKET_PROTOCOL_JSON
+#else
+#define BC_WEBSOCKET_PROTOCOL           BC_WEBSOCKET_PROTOCOL_JSON
+#endif
 
 /*
  * Network commands
  */
 
 #define BC_EVENT_ANNOUNCE               0xA000
+#define BC_EVENT_COMMAND_RESPONSE       0xA001 /* Binary frames only */
 #define BC_COMMAND_SET_ADDRESS          0xB000
 
+/* Where a binary frame's command header carries the command ID */
+#define BC_COMMAND_ID_OFFSET            4
+
 #define BC_COMMAND_START_RAW            0xC000
 #define BC_COMMAND_START_PACKED         0xC100
 #define BC_COMMAND_NAMED_PACKED         0xC17F
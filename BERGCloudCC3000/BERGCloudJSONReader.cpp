@@ -0,0 +1,509 @@
+/*
+
+BERGCloud streaming JSON reader
+
+Copyright (c) 2014 Berg Cloud Limited http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#define __STDC_LIMIT_MACROS /* Include C99 stdint defines in C++ code */
+#include <string.h> /* For strcmp() */
+#include "BERGCloudJSONReader.h"
+
+/* What the next character is expected to be */
+#define STATE_OBJECT      0 /* The opening brace */
+#define STATE_KEY         1 /* The start of a key, or the closing brace */
+#define STATE_MEMBER      2 /* The start of a key, after a comma */
+#define STATE_STRING      3 /* Part of a key or string value */
+#define STATE_COLON       4 /* The colon after a key */
+#define STATE_VALUE       5 /* The start of a value */
+#define STATE_NUMBER      6 /* Part of a number */
+#define STATE_LITERAL     7 /* Part of true, false or null */
+#define STATE_SKIP        8 /* Part of an object or array value, not kept */
+#define STATE_NEXT        9 /* A comma, or the closing brace */
+#define STATE_DONE        10 /* Nothing but whitespace */
+#define STATE_FAILED      11 /* Nothing more is read */
+
+static bool isSpace(char c)
+{
+  return (c == ' ') || (c == '\t') || (c == '\r') || (c == '\n');
+}
+
+static bool isDigit(char c)
+{
+  return (c >= '0') && (c <= '9');
+}
+
+BERGCloudJSONReader::BERGCloudJSONReader(BC_JSON_MEMBER *members, uint8_t count)
+  : members(members), count(count)
+{
+  uint8_t i;
+
+  for (i = 0; i < count; i++)
+  {
+    members[i].length = 0;
+    members[i].number = 0;
+    members[i].found = false;
+  }
+
+  state = STATE_OBJECT;
+  member = NULL;
+  keyLength = 0;
+  inKey = false;
+  escaped = false;
+  hexLeft = 0;
+  code = 0;
+  depth = 0;
+  skippedString = false;
+  base64Overflow = false;
+}
+
+bool BERGCloudJSONReader::feed(const uint8_t *data, uint16_t size)
+{
+  while ((size-- > 0) && (state != STATE_FAILED))
+  {
+    if (!readChar((char)*data++))
+    {
+      state = STATE_FAILED;
+    }
+  }
+
+  return state != STATE_FAILED;
+}
+
+bool BERGCloudJSONReader::done(void)
+{
+  return state == STATE_DONE;
+}
+
+bool BERGCloudJSONReader::overflowed(void)
+{
+  return base64Overflow;
+}
+
+bool BERGCloudJSONReader::readChar(char c)
+{
+  switch (state)
+  {
+  case STATE_OBJECT:
+    if (isSpace(c))
+    {
+      return true;
+    }
+
+    state = STATE_KEY;
+    return c == '{';
+
+  case STATE_KEY:
+  case STATE_MEMBER:
+    if (isSpace(c))
+    {
+      return true;
+    }
+
+    if ((c == '}') && (state == STATE_KEY))
+    {
+      state = STATE_DONE;
+      return true;
+    }
+
+    if (c != '"')
+    {
+      return false;
+    }
+
+    inKey = true;
+    keyLength = 0;
+    state = STATE_STRING;
+    return true;
+
+  case STATE_STRING:
+    return readString(c);
+
+  case STATE_COLON:
+    if (isSpace(c))
+    {
+      return true;
+    }
+
+    state = STATE_VALUE;
+    return c == ':';
+
+  case STATE_VALUE:
+    if (isSpace(c))
+    {
+      return true;
+    }
+
+    return valueStart(c);
+
+  case STATE_NUMBER:
+    return readNumber(c);
+
+  case STATE_LITERAL:
+    if ((c >= 'a') && (c <= 'z'))
+    {
+      return true;
+    }
+
+    /* The end of the literal; this character follows it */
+    state = STATE_NEXT;
+    return readChar(c);
+
+  case STATE_SKIP:
+    return readSkipped(c);
+
+  case STATE_NEXT:
+    if (isSpace(c))
+    {
+      return true;
+    }
+
+    if (c == ',')
+    {
+      state = STATE_MEMBER;
+      return true;
+    }
+
+    state = STATE_DONE;
+    return c == '}';
+
+  case STATE_DONE:
+    return isSpace(c);
+  }
+
+  return false;
+}
+
+bool BERGCloudJSONReader::valueStart(char c)
+{
+  /* Only keep the value if it is of the type asked for */
+  if (c == '"')
+  {
+    if ((member != NULL) && (member->type != BC_JSON_STRING) && (member->type != BC_JSON_BASE64))
+    {
+      member = NULL;
+    }
+
+    if ((member != NULL) && (member->type == BC_JSON_BASE64))
+    {
+      if (base64Start(member))
+      {
+        base64.begin((uint8_t *)member->data, member->size);
+      }
+      else
+      {
+        member = NULL;
+      }
+    }
+
+    inKey = false;
+    state = STATE_STRING;
+    return true;
+  }
+
+  if (isDigit(c) || (c == '-'))
+  {
+    if ((member != NULL) && ((member->type != BC_JSON_NUMBER) || (c == '-')))
+    {
+      member = NULL;
+    }
+
+    if (member != NULL)
+    {
+      member->number = c - '0';
+    }
+
+    state = STATE_NUMBER;
+    return true;
+  }
+
+  member = NULL;
+
+  if ((c == '{') || (c == '['))
+  {
+    depth = 1;
+    skippedString = false;
+    escaped = false;
+    state = STATE_SKIP;
+    return true;
+  }
+
+  if ((c == 't') || (c == 'f') || (c == 'n'))
+  {
+    state = STATE_LITERAL;
+    return true;
+  }
+
+  return false;
+}
+
+void BERGCloudJSONReader::keyDone(void)
+{
+  /* Find the member with this key, if any */
+  uint8_t i;
+
+  member = NULL;
+
+  if (keyLength > BC_JSON_KEY_MAX_SIZE_BYTES)
+  {
+    /* Too long to match */
+    return;
+  }
+
+  key[keyLength] = '\0';
+
+  for (i = 0; i < count; i++)
+  {
+    if (strcmp(members[i].key, key) == 0)
+    {
+      member = &members[i];
+      member->length = 0;
+      member->found = false;
+      return;
+    }
+  }
+}
+
+bool BERGCloudJSONReader::readString(char c)
+{
+  if (hexLeft > 0)
+  {
+    /* Part of a \u escape */
+    code <<= 4;
+
+    if (isDigit(c))
+    {
+      code |= c - '0';
+    }
+    else if ((c >= 'a') && (c <= 'f'))
+    {
+      code |= c - 'a' + 10;
+    }
+    else if ((c >= 'A') && (c <= 'F'))
+    {
+      code |= c - 'A' + 10;
+    }
+    else
+    {
+      return false;
+    }
+
+    if (--hexLeft > 0)
+    {
+      return true;
+    }
+
+    /* Nothing kept needs more than ASCII */
+    c = ((code > 0) && (code < 0x80)) ? (char)code : '?';
+  }
+  else if (escaped)
+  {
+    escaped = false;
+
+    switch (c)
+    {
+    case '"':
+    case '\\':
+    case '/':
+      break;
+    case 'b':
+      c = '\b';
+      break;
+    case 'f':
+      c = '\f';
+      break;
+    case 'n':
+      c = '\n';
+      break;
+    case 'r':
+      c = '\r';
+      break;
+    case 't':
+      c = '\t';
+      break;
+    case 'u':
+      hexLeft = 4;
+      code = 0;
+      return true;
+    default:
+      return false;
+    }
+  }
+  else if (c == '\\')
+  {
+    escaped = true;
+    return true;
+  }
+  else if (c == '"')
+  {
+    /* The end of the string */
+    if (inKey)
+    {
+      keyDone();
+      state = STATE_COLON;
+      return true;
+    }
+
+    if ((member != NULL) && (member->type == BC_JSON_BASE64))
+    {
+      member->found = base64.end();
+      member->length = base64.used();
+      base64Overflow |= base64.overflowed();
+      member = NULL;
+    }
+
+    if (member != NULL)
+    {
+      member->data[member->length] = '\0';
+      member->found = true;
+      member = NULL;
+    }
+
+    state = STATE_NEXT;
+    return true;
+  }
+
+  /* Keep the character */
+  if (inKey)
+  {
+    if (keyLength < BC_JSON_KEY_MAX_SIZE_BYTES)
+    {
+      key[keyLength] = c;
+    }
+
+    /* Counts past the end to mark a key that is too long */
+    if (keyLength <= BC_JSON_KEY_MAX_SIZE_BYTES)
+    {
+      keyLength++;
+    }
+  }
+  else if ((member != NULL) && (member->type == BC_JSON_BASE64))
+  {
+    if (!base64.feed(c))
+    {
+      /* Not base64, or does not fit; the rest is skipped */
+      base64Overflow |= base64.overflowed();
+      member = NULL;
+    }
+  }
+  else if (member != NULL)
+  {
+    if ((member->length + 1) >= member->size)
+    {
+      /* Does not fit; the rest is skipped */
+      member = NULL;
+    }
+    else
+    {
+      member->data[member->length++] = c;
+    }
+  }
+
+  return true;
+}
+
+bool BERGCloudJSONReader::readNumber(char c)
+{
+  uint8_t digit;
+
+  if (isDigit(c))
+  {
+    digit = c - '0';
+
+    if (member != NULL)
+    {
+      if (member->number > ((UINT32_MAX - digit) / 10))
+      {
+        /* Too large */
+        member = NULL;
+      }
+      else
+      {
+        member->number = (member->number * 10) + digit;
+      }
+    }
+
+    return true;
+  }
+
+  if ((c == '.') || (c == 'e') || (c == 'E') || (c == '+') || (c == '-'))
+  {
+    /* Not an integer */
+    member = NULL;
+    return true;
+  }
+
+  /* The end of the number; this character follows it */
+  if (member != NULL)
+  {
+    member->found = true;
+    member = NULL;
+  }
+
+  state = STATE_NEXT;
+  return readChar(c);
+}
+
+bool BERGCloudJSONReader::readSkipped(char c)
+{
+  if (skippedString)
+  {
+    if (escaped)
+    {
+      escaped = false;
+    }
+    else if (c == '\\')
+    {
+      escaped = true;
+    }
+    else if (c == '"')
+    {
+      skippedString = false;
+    }
+
+    return true;
+  }
+
+  switch (c)
+  {
+  case '"':
+    skippedString = true;
+    break;
+  case '{':
+  case '[':
+    if (++depth == 0)
+    {
+      /* Nested too deeply */
+      return false;
+    }
+    break;
+  case '}':
+  case ']':
+    if (--depth == 0)
+    {
+      state = STATE_NEXT;
+    }
+    break;
+  }
+
+  return true;
+}
@@ -0,0 +1,119 @@
+/*
+
+BERGCloud streaming JSON reader
+
+Copyright (c) 2014 Berg Cloud Limited http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+/*
+  Reads a JSON object a chunk at a time, as it arrives, keeping only the
+  members asked for and skipping the rest without storing them:
+
+    char type[16];
+    uint8_t payload[64];
+    BC_JSON_MEMBER members[] = {
+      {"type", BC_JSON_STRING, type, sizeof(type), 0, 0, false},
+      {"payload", BC_JSON_BASE64, (char *)payload, sizeof(payload), 0, 0, false},
+      {"command_id", BC_JSON_NUMBER, NULL, 0, 0, 0, false}
+    };
+
+    BERGCloudJSONReader json(members, 3);
+
+    json.feed(data, size); ...
+    if (json.done() && members[0].found) ...
+
+  Only members of the outermost object are looked for. Strings are
+  unescaped into the storage given, and null-terminated, or for
+  BC_JSON_BASE64 decoded into it as they arrive; numbers must be
+  integers from 0 to UINT32_MAX. A member is only 'found' if its value is
+  of the type asked for and fits.
+
+  A derived class may give a BC_JSON_BASE64 member its storage only as
+  its value starts, by overriding base64Start(), so that none is taken
+  for an object that turns out not to be wanted.
+*/
+
+#ifndef BERGCLOUDJSONREADER_H
+#define BERGCLOUDJSONREADER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "BERGCloudJSONWriter.h" /* For the field types */
+#include "BERGCloudBase64.h"
+
+/* A string holding base64, kept decoded; read only */
+#define BC_JSON_BASE64  5
+
+/* Longest key that can be matched */
+#define BC_JSON_KEY_MAX_SIZE_BYTES 16
+
+typedef struct {
+  const char *key;
+  uint8_t type;       /* BC_JSON_STRING, BC_JSON_BASE64 or BC_JSON_NUMBER */
+  char *data;         /* Storage for a string... */
+  uint16_t size;      /* ...of this many bytes, including any terminator */
+  uint16_t length;    /* Of the string read, or the bytes decoded */
+  uint32_t number;    /* The number read */
+  bool found;
+} BC_JSON_MEMBER;
+
+class BERGCloudJSONReader
+{
+public:
+  BERGCloudJSONReader(BC_JSON_MEMBER *members, uint8_t count);
+  /* Read the next 'size' bytes; returns false once reading has failed */
+  bool feed(const uint8_t *data, uint16_t size);
+  /* Test if the whole object has been read */
+  bool done(void);
+  /* Test if a BC_JSON_BASE64 value was dropped as too large to fit */
+  bool overflowed(void);
+
+protected:
+  /* Called as the value of a BC_JSON_BASE64 member starts, to set */
+  /* its 'data' and 'size'; returns false to skip the value */
+  virtual bool base64Start(BC_JSON_MEMBER * /* member */) { return true; }
+
+private:
+  bool readChar(char c);
+  bool readString(char c);
+  bool readNumber(char c);
+  bool readSkipped(char c);
+  bool valueStart(char c);
+  void keyDone(void);
+  BC_JSON_MEMBER *members;
+  uint8_t count;
+  uint8_t state;
+  BC_JSON_MEMBER *member;  /* Whose value is being read, or NULL */
+  char key[BC_JSON_KEY_MAX_SIZE_BYTES + 1]; /* +1 for null terminator */
+  uint8_t keyLength;
+  bool inKey;              /* Reading a key rather than a value */
+  bool escaped;            /* The last character was a backslash */
+  uint8_t hexLeft;         /* Digits of a \u escape still to come */
+  uint16_t code;           /* Of the \u escape */
+  uint8_t depth;           /* Of the objects and arrays being skipped */
+  bool skippedString;      /* In a string inside them */
+  BERGCloudBase64Decoder base64; /* For a BC_JSON_BASE64 member */
+  bool base64Overflow;
+};
+
+#endif // #ifndef BERGCLOUDJSONREADER_H
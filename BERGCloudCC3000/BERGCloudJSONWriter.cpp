@@ -0,0 +1,240 @@
+/*
+
+BERGCloud streaming JSON writer
+
+Copyright (c) 2014 Berg Cloud Limited http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <string.h> /* For strlen() */
+#include "BERGCloudJSONWriter.h"
+
+/* Template characters up to this one stand for a field */
+#define LAST_FIELD '\010'
+
+static const char hexDigits[16] = {'0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f'};
+
+BERGCloudJSONWriter::BERGCloudJSONWriter(const char *jsonTemplate, const BC_JSON_FIELD *fields)
+  : jsonTemplate(jsonTemplate), fields(fields)
+{
+  position = jsonTemplate;
+  field = NULL;
+  fieldOffset = 0;
+  pendingSize = 0;
+  pendingUsed = 0;
+}
+
+char BERGCloudJSONWriter::templateChar(const char *position)
+{
+#ifdef __AVR__
+  return (char)pgm_read_byte(position);
+#else
+  return *position;
+#endif
+}
+
+uint8_t BERGCloudJSONWriter::escape(char c, char *escaped)
+{
+  /* Write the escape sequence for 'c', if it needs one; */
+  /* returns its length, or 0 if 'c' is written as it is */
+  if ((c == '"') || (c == '\\'))
+  {
+    escaped[0] = '\\';
+    escaped[1] = c;
+    return 2;
+  }
+
+  if ((uint8_t)c < 0x20)
+  {
+    escaped[0] = '\\';
+    escaped[1] = 'u';
+    escaped[2] = '0';
+    escaped[3] = '0';
+    escaped[4] = hexDigits[(uint8_t)c >> 4];
+    escaped[5] = hexDigits[(uint8_t)c & 0xf];
+    return 6;
+  }
+
+  return 0;
+}
+
+uint8_t BERGCloudJSONWriter::formatNumber(uint32_t number, char *digits)
+{
+  /* Up to 10 digits; returns the number written */
+  uint8_t count = 0;
+  uint8_t i;
+  char c;
+
+  do {
+    digits[count++] = '0' + (number % 10);
+    number /= 10;
+  } while (number > 0);
+
+  /* They were written least significant first */
+  for (i = 0; i < (count / 2); i++)
+  {
+    c = digits[i];
+    digits[i] = digits[count - i - 1];
+    digits[count - i - 1] = c;
+  }
+
+  return count;
+}
+
+uint16_t BERGCloudJSONWriter::fieldSize(const BC_JSON_FIELD *field)
+{
+  char scratch[10];
+  const char *string;
+  uint16_t size = 0;
+  uint8_t escaped;
+
+  switch (field->type)
+  {
+  case BC_JSON_STRING:
+    for (string = (const char *)field->data; *string != '\0'; string++)
+    {
+      escaped = escape(*string, scratch);
+      size += (escaped > 0) ? escaped : 1;
+    }
+    return size;
+
+  case BC_JSON_TEXT:
+    return strlen((const char *)field->data);
+
+  case BC_JSON_NUMBER:
+    return formatNumber(field->number, scratch);
+
+  case BC_JSON_HEX:
+    return field->size * 2;
+  }
+
+  return 0;
+}
+
+uint16_t BERGCloudJSONWriter::size(void)
+{
+  const char *p;
+  uint16_t size = 0;
+  char c;
+
+  for (p = jsonTemplate; (c = templateChar(p)) != '\0'; p++)
+  {
+    if ((uint8_t)c <= LAST_FIELD)
+    {
+      size += fieldSize(&fields[c - 1]);
+    }
+    else
+    {
+      size++;
+    }
+  }
+
+  return size;
+}
+
+uint16_t BERGCloudJSONWriter::read(uint8_t *data, uint16_t size)
+{
+  uint16_t used = 0;
+  uint8_t byte;
+  char c;
+
+  while (used < size)
+  {
+    /* Finish any escape sequence or number first */
+    if (pendingUsed < pendingSize)
+    {
+      data[used++] = pending[pendingUsed++];
+      continue;
+    }
+
+    if (field != NULL)
+    {
+      if (field->type == BC_JSON_HEX)
+      {
+        if (fieldOffset == (field->size * 2))
+        {
+          field = NULL;
+          continue;
+        }
+
+        byte = ((const uint8_t *)field->data)[fieldOffset / 2];
+        data[used++] = hexDigits[(fieldOffset & 1) ? (byte & 0xf) : (byte >> 4)];
+        fieldOffset++;
+        continue;
+      }
+
+      /* A string */
+      c = ((const char *)field->data)[fieldOffset];
+
+      if (c == '\0')
+      {
+        field = NULL;
+        continue;
+      }
+
+      fieldOffset++;
+
+      if (field->type == BC_JSON_STRING)
+      {
+        pendingSize = escape(c, pending);
+        pendingUsed = 0;
+
+        if (pendingSize > 0)
+        {
+          continue;
+        }
+      }
+
+      data[used++] = c;
+      continue;
+    }
+
+    c = templateChar(position);
+
+    if (c == '\0')
+    {
+      /* All read */
+      break;
+    }
+
+    position++;
+
+    if ((uint8_t)c > LAST_FIELD)
+    {
+      data[used++] = c;
+      continue;
+    }
+
+    /* Start a field */
+    if (fields[c - 1].type == BC_JSON_NUMBER)
+    {
+      pendingSize = formatNumber(fields[c - 1].number, pending);
+      pendingUsed = 0;
+    }
+    else
+    {
+      field = &fields[c - 1];
+      fieldOffset = 0;
+    }
+  }
+
+  return used;
+}
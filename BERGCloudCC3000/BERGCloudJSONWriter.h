@@ -0,0 +1,113 @@
+/*
+
+BERGCloud streaming JSON writer
+
+Copyright (c) 2014 Berg Cloud Limited http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+/*
+  The messages sent to the bridge are JSON objects whose keys and layout
+  never change; only a few values do. Each is written from a template, a
+  string kept in program memory on AVR, in which the characters
+  BC_JSON_FIELD_1 to BC_JSON_FIELD_8 stand for the values given in a
+  field array:
+
+    BC_JSON_TEMPLATE(example) =
+      "{\"name\":\"" BC_JSON_FIELD_1 "\",\"count\":" BC_JSON_FIELD_2 "}";
+
+    BC_JSON_FIELD fields[] = {
+      {BC_JSON_STRING, name, 0, 0},
+      {BC_JSON_NUMBER, NULL, 0, count}
+    };
+
+    BERGCloudJSONWriter json(example, fields);
+
+  size() gives the length of the text before any of it is written, for
+  the WebSocket frame header, and read() then hands it out a chunk at a
+  time, so no tree of objects or whole message string is ever built.
+  The fields must stay unchanged until the last chunk has been read.
+*/
+
+#ifndef BERGCLOUDJSONWRITER_H
+#define BERGCLOUDJSONWRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define BC_JSON_TEMPLATE(name) static const char name[] PROGMEM
+#else
+#define BC_JSON_TEMPLATE(name) static const char name[]
+#endif
+
+/* Stand-ins for the fields in a template; octal, so that they */
+/* cannot run into a following character */
+#define BC_JSON_FIELD_1 "\001"
+#define BC_JSON_FIELD_2 "\002"
+#define BC_JSON_FIELD_3 "\003"
+#define BC_JSON_FIELD_4 "\004"
+#define BC_JSON_FIELD_5 "\005"
+#define BC_JSON_FIELD_6 "\006"
+#define BC_JSON_FIELD_7 "\007"
+#define BC_JSON_FIELD_8 "\010"
+
+/* Field types */
+#define BC_JSON_STRING  1 /* 'data' is a null-terminated string, escaped as it is written */
+#define BC_JSON_TEXT    2 /* 'data' is a null-terminated string needing no escapes */
+#define BC_JSON_NUMBER  3 /* 'number' is written in decimal */
+#define BC_JSON_HEX     4 /* 'size' bytes at 'data' are written as lower-case hex */
+
+typedef struct {
+  uint8_t type;       /* One of BC_JSON_STRING etc. */
+  const void *data;
+  uint16_t size;
+  uint32_t number;
+} BC_JSON_FIELD;
+
+class BERGCloudJSONWriter
+{
+public:
+  /* 'jsonTemplate' is in program memory on AVR */
+  BERGCloudJSONWriter(const char *jsonTemplate, const BC_JSON_FIELD *fields);
+  /* The length of the whole text */
+  uint16_t size(void);
+  /* Copy up to 'size' bytes of the text not yet read into 'data'; */
+  /* returns the number copied, 0 once all of it has been read */
+  uint16_t read(uint8_t *data, uint16_t size);
+
+private:
+  char templateChar(const char *position);
+  uint16_t fieldSize(const BC_JSON_FIELD *field);
+  uint8_t escape(char c, char *escaped);
+  uint8_t formatNumber(uint32_t number, char *digits);
+  const char *jsonTemplate;
+  const BC_JSON_FIELD *fields;
+  const char *position;       /* Next template character */
+  const BC_JSON_FIELD *field; /* Being written, or NULL */
+  uint16_t fieldOffset;       /* Next byte of its value */
+  char pending[10];           /* An escape sequence or number, being written */
+  uint8_t pendingSize;
+  uint8_t pendingUsed;
+};
+
+#endif // #ifndef BERGCLOUDJSONWRITER_H
@@ -32,17 +32,94 @@ THE SOFTWARE.
 #include <string.h> /* For memcpy() */
 #include "BERGCloudMessageBase.h"
 
+#if BC_FIND_INDEXED
+/* The indexes, shared by every message rather than allocated by each */
+class BERGCloudFindIndexPool : public BERGCloudBlockPool
+{
+public:
+  BERGCloudFindIndexPool(void)
+    : BERGCloudBlockPool((uint8_t *)storage, freeList, freeMap, BC_FIND_INDEX_POOL_INDEXES, sizeof(BC_FIND_INDEX))
+  {
+    reset();
+  }
+
+private:
+  BC_FIND_INDEX storage[BC_FIND_INDEX_POOL_INDEXES];
+  uint8_t freeList[BC_FIND_INDEX_POOL_INDEXES];
+  uint8_t freeMap[BC_POOL_FREE_MAP_SIZE_BYTES(BC_FIND_INDEX_POOL_INDEXES)];
+};
+
+static BERGCloudFindIndexPool findIndexPool;
+#endif
+
 BERGCloudMessageBase::BERGCloudMessageBase(void)
 {
+  packSmallest = (BC_PACK_SMALLEST_INTEGERS != 0);
+#if BC_FIND_INDEXED
+  findIndex = NULL;
+#endif
+}
+
+BERGCloudMessageBase::BERGCloudMessageBase(uint16_t size, uint16_t headroom)
+  : BERGCloudMessageBuffer(size, headroom)
+{
+  packSmallest = (BC_PACK_SMALLEST_INTEGERS != 0);
+#if BC_FIND_INDEXED
+  findIndex = NULL;
+#endif
+}
+
+BERGCloudMessageBase::BERGCloudMessageBase(uint8_t *storage, uint16_t size, uint16_t headroom)
+  : BERGCloudMessageBuffer(storage, size, headroom)
+{
+  packSmallest = (BC_PACK_SMALLEST_INTEGERS != 0);
+#if BC_FIND_INDEXED
+  findIndex = NULL;
+#endif
+}
+
+#if BC_CHUNKED_MESSAGES
+BERGCloudMessageBase::BERGCloudMessageBase(BERGCloudBlockPool& pool)
+  : BERGCloudMessageBuffer(pool)
+{
+  packSmallest = (BC_PACK_SMALLEST_INTEGERS != 0);
+#if BC_FIND_INDEXED
+  findIndex = NULL;
+#endif
+}
+#endif
+
+BERGCloudMessageBase::BERGCloudMessageBase(const BERGCloudMessageBase& parent)
+  : BERGCloudMessageBuffer(parent)
+{
+  packSmallest = parent.packSmallest;
+
+  /* The index is not shared; the copy builds its own if needed */
+#if BC_FIND_INDEXED
+  findIndex = NULL;
+#endif
 }
 
-BERGCloudMessageBase::BERGCloudMessageBase(uint16_t size)
-  : BERGCloudMessageBuffer(size)
+BERGCloudMessageBase& BERGCloudMessageBase::operator=(const BERGCloudMessageBase& other)
 {
+  BERGCloudMessageBuffer::operator=(other);
+  packSmallest = other.packSmallest;
+  return *this;
 }
 
 BERGCloudMessageBase::~BERGCloudMessageBase(void)
 {
+#if BC_FIND_INDEXED
+  releaseFindIndex();
+#endif
+}
+
+void BERGCloudMessageBase::clear(void)
+{
+  BERGCloudMessageBuffer::clear();
+#if BC_FIND_INDEXED
+  releaseFindIndex();
+#endif
 }
 
 #define _MP_FIXNUM_POS_MIN  0x00
@@ -56,6 +133,12 @@ BERGCloudMessageBase::~BERGCloudMessageBase(void)
 #define _MP_NIL             0xc0
 #define _MP_BOOL_FALSE      0xc2
 #define _MP_BOOL_TRUE       0xc3
+#define _MP_BIN8            0xc4
+#define _MP_BIN16           0xc5
+#define _MP_BIN32           0xc6
+#define _MP_EXT8            0xc7
+#define _MP_EXT16           0xc8
+#define _MP_EXT32           0xc9
 #define _MP_FLOAT           0xca
 #define _MP_DOUBLE          0xcb
 #define _MP_UINT8           0xcc
@@ -66,6 +149,9 @@ BERGCloudMessageBase::~BERGCloudMessageBase(void)
 #define _MP_INT16           0xd1
 #define _MP_INT32           0xd2
 #define _MP_INT64           0xd3
+#define _MP_FIXEXT1         0xd4
+#define _MP_FIXEXT16        0xd8
+#define _MP_STR8            0xd9
 #define _MP_RAW16           0xda
 #define _MP_RAW32           0xdb
 #define _MP_ARRAY16         0xdc
@@ -79,6 +165,136 @@ BERGCloudMessageBase::~BERGCloudMessageBase(void)
 #define _MAX_FIXARRAY       (_MP_FIXARRAY_MAX - _MP_FIXARRAY_MIN)
 #define _MAX_FIXMAP         (_MP_FIXMAP_MAX - _MP_FIXMAP_MIN)
 
+/* Reasons for unpackError() */
+#define UNPACK_ERROR_NO_DATA 0
+#define UNPACK_ERROR_TYPE    1
+#define UNPACK_ERROR_RANGE   2
+
+/* Stack used when packing or unpacking an array of numbers */
+#define ARRAY_BLOCK_SIZE_BYTES 32
+
+static bool isMapType(uint8_t type)
+{
+  return IN_RANGE(type, _MP_FIXMAP_MIN, _MP_FIXMAP_MAX) || (type == _MP_MAP16) || (type == _MP_MAP32);
+}
+
+static bool isArrayType(uint8_t type)
+{
+  return IN_RANGE(type, _MP_FIXARRAY_MIN, _MP_FIXARRAY_MAX) || (type == _MP_ARRAY16) || (type == _MP_ARRAY32);
+}
+
+static bool isRawType(uint8_t type)
+{
+  /* Strings and binary data; both were "raw" before the */
+  /* MessagePack spec split them, so each unpacks as either */
+  return IN_RANGE(type, _MP_FIXRAW_MIN, _MP_FIXRAW_MAX) || (type == _MP_STR8) ||
+    (type == _MP_RAW16) || (type == _MP_RAW32) || IN_RANGE(type, _MP_BIN8, _MP_BIN32);
+}
+
+static bool isPath(const char *key)
+{
+  /* Test for a path to a nested value rather than a single key */
+  while (*key != '\0')
+  {
+    if ((*key == '.') || (*key == '['))
+    {
+      return true;
+    }
+
+    key++;
+  }
+
+  return false;
+}
+
+#if BC_FIND_INDEXED
+/* Index entries for map keys have the top bit set */
+#define FIND_INDEX_KEY_TAG 0x8000
+
+static uint16_t keyHash(const char *key)
+{
+  /* djb2, marked as a key */
+  uint16_t hash = 5381;
+
+  while (*key != '\0')
+  {
+    hash = (hash << 5) + hash + (uint8_t)*key++;
+  }
+
+  return hash | FIND_INDEX_KEY_TAG;
+}
+#endif
+
+float bcDoubleToFloat(uint32_t high, uint32_t low)
+{
+  /* Convert the bits of an 8-byte double to the nearest float */
+  uint64_t data;
+  double d;
+  uint32_t sign = high & 0x80000000UL;
+  uint32_t mantissa;
+  uint32_t dropped;
+  int16_t exponent;
+  uint8_t shift;
+  float f;
+
+  if (sizeof(double) == sizeof(data))
+  {
+    data = ((uint64_t)high << 32) | low;
+    memcpy(&d, &data, sizeof(d));
+    return (float)d;
+  }
+
+  /* Where double is the same size as float, as on 8-bit */
+  /* Arduino platforms, shorten the mantissa and exponent */
+  exponent = (int16_t)((high >> 20) & 0x7ff);
+  mantissa = ((high & 0x000fffffUL) << 3) | (low >> 29);
+  dropped = low & 0x1fffffffUL;
+
+  if (exponent == 0x7ff)
+  {
+    /* Infinity, or not a number */
+    data = sign | 0x7f800000UL | (((mantissa | dropped) != 0) ? 0x00400000UL : 0);
+  }
+  else if ((exponent - 1023 + 127) >= 0xff)
+  {
+    /* Too large; infinity */
+    data = sign | 0x7f800000UL;
+  }
+  else if ((exponent - 1023 + 127) < -24)
+  {
+    /* Too small; zero */
+    data = sign;
+  }
+  else if ((exponent - 1023 + 127) <= 0)
+  {
+    /* Too small for a normal float; shift the mantissa, with */
+    /* its leading one, into a subnormal and round as below */
+    shift = (uint8_t)(1 - (exponent - 1023 + 127));
+    mantissa |= 0x00800000UL;
+    data = sign | (mantissa >> shift);
+    mantissa &= (1UL << shift) - 1;
+    if ((mantissa > (1UL << (shift - 1))) ||
+        ((mantissa == (1UL << (shift - 1))) && ((dropped != 0) || ((data & 1) != 0))))
+    {
+      data++;
+    }
+  }
+  else
+  {
+    /* Round to nearest, ties to even; a carry from the */
+    /* mantissa correctly increments the exponent */
+    data = sign | ((uint32_t)(exponent - 1023 + 127) << 23) | mantissa;
+    if ((dropped > 0x10000000UL) || ((dropped == 0x10000000UL) && ((mantissa & 1) != 0)))
+    {
+      data++;
+    }
+  }
+
+  low = (uint32_t)data;
+  memcpy(&f, &low, sizeof(f));
+  return f;
+}
+
 uint16_t BERGCloudMessageBase::strlen(const char *string)
 {
   uint16_t strLen = 0;
@@ -118,8 +334,8 @@ bool BERGCloudMessageBase::strcompare(const char *s1, const char *s2)
     }
   }
 
-  /* identical */
-  return true;
+  /* identical only if both strings have ended */
+  return *s1 == *s2;
 }
 
 
@@ -127,8 +343,26 @@ bool BERGCloudMessageBase::strcompare(const char *s1, const char *s2)
     Pack methods
 */
 
+void BERGCloudMessageBase::pack_smallest(bool smallest)
+{
+  packSmallest = smallest;
+}
+
 bool BERGCloudMessageBase::pack(uint8_t n)
 {
+  if (packSmallest && (n <= _MP_FIXNUM_POS_MAX))
+  {
+    if (!available(1))
+    {
+      _LOG_PACK_ERROR_NO_SPACE;
+      return false;
+    }
+
+    /* Positive fix num */
+    add(n);
+    return true;
+  }
+
   if (!available(sizeof(n) + 1))
   {
     _LOG_PACK_ERROR_NO_SPACE;
@@ -142,6 +376,11 @@ bool BERGCloudMessageBase::pack(uint8_t n)
 
 bool BERGCloudMessageBase::pack(uint16_t n)
 {
+  if (packSmallest && (n <= UINT8_MAX))
+  {
+    return pack((uint8_t)n);
+  }
+
   if (!available(sizeof(n) + 1))
   {
     _LOG_PACK_ERROR_NO_SPACE;
@@ -156,6 +395,11 @@ bool BERGCloudMessageBase::pack(uint16_t n)
 
 bool BERGCloudMessageBase::pack(uint32_t n)
 {
+  if (packSmallest && (n <= UINT16_MAX))
+  {
+    return pack((uint16_t)n);
+  }
+
   if (!available(sizeof(n) + 1))
   {
     _LOG_PACK_ERROR_NO_SPACE;
@@ -172,6 +416,27 @@ bool BERGCloudMessageBase::pack(uint32_t n)
 
 bool BERGCloudMessageBase::pack(int8_t n)
 {
+  if (packSmallest)
+  {
+    if (n >= 0)
+    {
+      return pack((uint8_t)n);
+    }
+
+    if (n >= (int8_t)_MP_FIXNUM_NEG_MIN)
+    {
+      if (!available(1))
+      {
+        _LOG_PACK_ERROR_NO_SPACE;
+        return false;
+      }
+
+      /* Negative fix num */
+      add((uint8_t)n);
+      return true;
+    }
+  }
+
   if (!available(sizeof(n) + 1))
   {
     _LOG_PACK_ERROR_NO_SPACE;
@@ -185,6 +450,11 @@ bool BERGCloudMessageBase::pack(int8_t n)
 
 bool BERGCloudMessageBase::pack(int16_t n)
 {
+  if (packSmallest && (n >= INT8_MIN))
+  {
+    return (n >= 0) ? pack((uint16_t)n) : pack((int8_t)n);
+  }
+
   if (!available(sizeof(n) + 1))
   {
     _LOG_PACK_ERROR_NO_SPACE;
@@ -199,6 +469,11 @@ bool BERGCloudMessageBase::pack(int16_t n)
 
 bool BERGCloudMessageBase::pack(int32_t n)
 {
+  if (packSmallest && (n >= INT16_MIN))
+  {
+    return (n >= 0) ? pack((uint32_t)n) : pack((int16_t)n);
+  }
+
   if (!available(sizeof(n) + 1))
   {
     _LOG_PACK_ERROR_NO_SPACE;
@@ -213,6 +488,56 @@ bool BERGCloudMessageBase::pack(int32_t n)
   return true;
 }
 
+bool BERGCloudMessageBase::pack(uint64_t n)
+{
+  if (packSmallest && (n <= UINT32_MAX))
+  {
+    return pack((uint32_t)n);
+  }
+
+  if (!available(sizeof(n) + 1))
+  {
+    _LOG_PACK_ERROR_NO_SPACE;
+    return false;
+  }
+
+  add(_MP_UINT64);
+  addUint64((uint32_t)(n >> 32), (uint32_t)n);
+  return true;
+}
+
+bool BERGCloudMessageBase::pack(int64_t n)
+{
+  if (packSmallest && (n >= INT32_MIN))
+  {
+    return (n >= 0) ? pack((uint64_t)n) : pack((int32_t)n);
+  }
+
+  if (!available(sizeof(n) + 1))
+  {
+    _LOG_PACK_ERROR_NO_SPACE;
+    return false;
+  }
+
+  add(_MP_INT64);
+  addUint64((uint32_t)((uint64_t)n >> 32), (uint32_t)n);
+  return true;
+}
+
+void BERGCloudMessageBase::addUint64(uint32_t high, uint32_t low)
+{
+  /* Add a big-endian 64-bit value as two halves, so */
+  /* that 8-bit platforms need not shift it; no checks */
+  add((uint8_t)(high >> 24));
+  add((uint8_t)(high >> 16));
+  add((uint8_t)(high >> 8));
+  add((uint8_t)high);
+  add((uint8_t)(low >> 24));
+  add((uint8_t)(low >> 16));
+  add((uint8_t)(low >> 8));
+  add((uint8_t)low);
+}
+
 bool BERGCloudMessageBase::pack(float n)
 {
   uint32_t data;
@@ -234,6 +559,31 @@ bool BERGCloudMessageBase::pack(float n)
   return true;
 }
 
+bool BERGCloudMessageBase::pack(double n)
+{
+  uint64_t data = 0;
+
+  /* Where double is the same size as float, as on 8-bit */
+  /* Arduino platforms, pack it as a float */
+  if (sizeof(double) == sizeof(float))
+  {
+    return pack((float)n);
+  }
+
+  if (!available(sizeof(data) + 1))
+  {
+    _LOG_PACK_ERROR_NO_SPACE;
+    return false;
+  }
+
+  /* Convert to data */
+  memcpy(&data, &n, sizeof(n));
+
+  add(_MP_DOUBLE);
+  addUint64((uint32_t)(data >> 32), (uint32_t)data);
+  return true;
+}
+
 bool BERGCloudMessageBase::pack(bool n)
 {
   /*
@@ -270,7 +620,7 @@ bool BERGCloudMessageBase::pack_array(uint16_t items)
   if (items <= _MAX_FIXARRAY)
   {
     /* Use fix array */
-    if (!available(items + 1))
+    if (!available(1))
     {
       _LOG_PACK_ERROR_NO_SPACE;
       return false;
@@ -281,7 +631,7 @@ bool BERGCloudMessageBase::pack_array(uint16_t items)
   else
   {
     /* Use array 16 */
-    if (!available(items + 1 + sizeof(uint16_t)))
+    if (!available(1 + sizeof(uint16_t)))
     {
       _LOG_PACK_ERROR_NO_SPACE;
       return false;
@@ -300,7 +650,7 @@ bool BERGCloudMessageBase::pack_map(uint16_t items)
   if (items <= _MAX_FIXMAP)
   {
     /* Use fix map */
-    if (!available(items + 1))
+    if (!available(1))
     {
       _LOG_PACK_ERROR_NO_SPACE;
       return false;
@@ -311,7 +661,7 @@ bool BERGCloudMessageBase::pack_map(uint16_t items)
   else
   {
     /* Use map 16 */
-    if (!available(items + 1 + sizeof(uint16_t)))
+    if (!available(1 + sizeof(uint16_t)))
     {
       _LOG_PACK_ERROR_NO_SPACE;
       return false;
@@ -325,77 +675,630 @@ bool BERGCloudMessageBase::pack_map(uint16_t items)
   return true;
 }
 
-bool BERGCloudMessageBase::pack(uint8_t *data, uint16_t sizeInBytes)
+bool BERGCloudMessageBase::begin_array(void)
 {
-  /* Pack data */
-  if (!pack_raw_header(sizeInBytes))
+  return beginContainer(_MP_ARRAY16);
+}
+
+bool BERGCloudMessageBase::end_array(void)
+{
+  return endContainer(_MP_ARRAY16);
+}
+
+bool BERGCloudMessageBase::begin_map(void)
+{
+  return beginContainer(_MP_MAP16);
+}
+
+bool BERGCloudMessageBase::end_map(void)
+{
+  return endContainer(_MP_MAP16);
+}
+
+bool BERGCloudMessageBase::beginContainer(uint8_t type)
+{
+  /* Reserve a 16-bit header; until the container is ended its */
+  /* count holds the header of the container it is nested in */
+  if (!available(1 + sizeof(uint16_t)))
   {
+    _LOG_PACK_ERROR_NO_SPACE;
     return false;
   }
 
-  return pack_raw_data(data, sizeInBytes);
+  add(type);
+  add((uint8_t)(openContainer >> 8));
+  add((uint8_t)openContainer);
+
+  openContainer = bytesWritten - (1 + sizeof(uint16_t));
+  return true;
 }
 
-bool BERGCloudMessageBase::pack(const char *string)
+bool BERGCloudMessageBase::endContainer(uint8_t type)
 {
-  /* Pack a null-terminated C string */
-  uint16_t strLen;
-
-  strLen = BERGCloudMessageBase::strlen(string);
+  /* Count the items packed since the header, in a single walk */
+  /* that skips over anything nested, then fill in the header */
+  uint16_t header = openContainer;
+  uint16_t last_read;
+  uint16_t items = 0;
+  uint16_t outer;
+  uint32_t nested = 0;
+  uint32_t contents;
+  uint8_t next;
 
-  return pack((uint8_t *)string, strLen);
-}
+  if ((header == BC_NO_OPEN_CONTAINER) || (*dataAt(header) != type))
+  {
+    _LOG("Pack: No map or array of this type to end.");
+    return false;
+  }
 
-/* Separate header and data methods are provided for raw data*/
-/* so that Arduino strings may be packed without having to create */
-/* a temporary buffer first. */
+  /* Remember the current read position in the raw data */
+  last_read = bytesRead;
+  bytesRead = header + 1 + sizeof(uint16_t);
 
-bool BERGCloudMessageBase::pack_raw_header(uint16_t sizeInBytes)
-{
-  if (sizeInBytes <= _MAX_FIXRAW)
+  while (bytesRead < bytesWritten)
   {
-    /* Use fix raw */
-    if (!available(sizeInBytes + 1))
+    /* Items in nested maps and arrays are skipped, not counted */
+    if (nested == 0)
     {
-      _LOG_PACK_ERROR_NO_SPACE;
-      return false;
+      items++;
+    }
+    else
+    {
+      nested--;
     }
 
-    add(_MP_FIXRAW_MIN + sizeInBytes);
+    if (!chunked())
+    {
+      /* Skip the most common keys and values here rather */
+      /* than with a call for each; they contain no items */
+      next = buffer[bytesRead];
+
+      if ((next <= _MP_FIXNUM_POS_MAX) || (next >= _MP_FIXNUM_NEG_MIN))
+      {
+        bytesRead++;
+        continue;
+      }
+
+      if (IN_RANGE(next, _MP_FIXRAW_MIN, _MP_FIXRAW_MAX))
+      {
+        bytesRead += 1 + next - _MP_FIXRAW_MIN;
+        continue;
+      }
+
+      if (IN_RANGE(next, _MP_FLOAT, _MP_INT64))
+      {
+        /* Float, double and integers are 4, 8, 1, 2, 4, 8, 1, 2, 4 and 8 bytes */
+        bytesRead += 1 + (1 << ((next - _MP_FLOAT + 2) & 3));
+        continue;
+      }
+    }
+
+    if (!skipItem(contents))
+    {
+      break;
+    }
+
+    nested += contents;
   }
-  else
+
+  if ((nested != 0) || (bytesRead != bytesWritten))
   {
-    /* Use raw 16 */
-    if (!available(sizeInBytes + 1 + sizeof(uint16_t)))
+    /* An item was only partly packed */
+    _LOG_UNPACK_ERROR_NO_DATA;
+    bytesRead = last_read;
+    return false;
+  }
+
+  bytesRead = last_read;
+
+  if (type == _MP_MAP16)
+  {
+    if ((items & 1) != 0)
     {
-      _LOG_PACK_ERROR_NO_SPACE;
+      _LOG("Pack: Map key has no value.");
       return false;
     }
 
-    add(_MP_RAW16);
-    add((uint8_t)(sizeInBytes >> 8));
-    add((uint8_t)sizeInBytes);
+    /* Key-value pairs */
+    items /= 2;
   }
 
-  return true;
-}
+  /* Reopen the container this one is nested in */
+  outer = *dataAt(header + 1);
+  openContainer = (outer << 8) | *dataAt(header + 2);
 
-bool BERGCloudMessageBase::pack_raw_data(uint8_t *data, uint16_t sizeInBytes)
-{
-  /* Add data */
-  while (sizeInBytes-- > 0)
+  if (items <= _MAX_FIXMAP) /* Same as _MAX_FIXARRAY */
+  {
+    /* Shrink to fix map or fix array */
+    *dataAt(header) = ((type == _MP_MAP16) ? _MP_FIXMAP_MIN : _MP_FIXARRAY_MIN) + items;
+    erase(header + 1, sizeof(uint16_t));
+  }
+  else
   {
-    add(*data++);
+    *dataAt(header + 1) = (uint8_t)(items >> 8);
+    *dataAt(header + 2) = (uint8_t)items;
   }
 
   return true;
 }
 
-/*
-    Unpack methods
-*/
-
-bool BERGCloudMessageBase::unpack_peek(uint8_t& messagePackType)
+bool BERGCloudMessageBase::pack(uint8_t *data, uint16_t sizeInBytes)
+{
+  /* Pack data */
+  if (!pack_raw_header(sizeInBytes))
+  {
+    return false;
+  }
+
+  return pack_raw_data(data, sizeInBytes);
+}
+
+bool BERGCloudMessageBase::pack(const char *string)
+{
+  /* Pack a null-terminated C string */
+  uint16_t strLen;
+
+  strLen = BERGCloudMessageBase::strlen(string);
+
+  return pack((uint8_t *)string, strLen);
+}
+
+/* Separate header and data methods are provided for raw data*/
+/* so that Arduino strings may be packed without having to create */
+/* a temporary buffer first. */
+
+static uint8_t rawHeaderSize(uint16_t sizeInBytes)
+{
+  /* Bytes of the header that pack_raw_header() uses for 'sizeInBytes' */
+  if (sizeInBytes <= _MAX_FIXRAW)
+  {
+    return 1;
+  }
+
+#if (BC_PACK_STR8 == 1)
+  if (sizeInBytes <= UINT8_MAX)
+  {
+    return 1 + sizeof(uint8_t);
+  }
+#endif
+
+  return 1 + sizeof(uint16_t);
+}
+
+static uint8_t binHeaderSize(uint16_t sizeInBytes)
+{
+  /* Bytes of the header that pack_bin_header() uses for 'sizeInBytes' */
+  return (sizeInBytes <= UINT8_MAX) ? 1 + sizeof(uint8_t) : 1 + sizeof(uint16_t);
+}
+
+bool BERGCloudMessageBase::pack_raw_header(uint16_t sizeInBytes)
+{
+  if (!available(sizeInBytes + rawHeaderSize(sizeInBytes)))
+  {
+    _LOG_PACK_ERROR_NO_SPACE;
+    return false;
+  }
+
+  addRawHeader(sizeInBytes);
+  return true;
+}
+
+void BERGCloudMessageBase::addRawHeader(uint16_t sizeInBytes)
+{
+  /* No checks */
+  if (sizeInBytes <= _MAX_FIXRAW)
+  {
+    /* Use fix raw */
+    add(_MP_FIXRAW_MIN + sizeInBytes);
+  }
+#if (BC_PACK_STR8 == 1)
+  else if (sizeInBytes <= UINT8_MAX)
+  {
+    /* Use str 8 */
+    add(_MP_STR8);
+    add((uint8_t)sizeInBytes);
+  }
+#endif
+  else
+  {
+    /* Use raw 16 */
+    add(_MP_RAW16);
+    add((uint8_t)(sizeInBytes >> 8));
+    add((uint8_t)sizeInBytes);
+  }
+}
+
+bool BERGCloudMessageBase::pack_raw_data(uint8_t *data, uint16_t sizeInBytes)
+{
+  /* Add data */
+  return write(data, sizeInBytes);
+}
+
+bool BERGCloudMessageBase::pack_bin(uint8_t *data, uint16_t sizeInBytes)
+{
+  /* Pack data as binary rather than raw, which newer */
+  /* MessagePack readers take to be a string */
+  if (!pack_bin_header(sizeInBytes))
+  {
+    return false;
+  }
+
+  return pack_raw_data(data, sizeInBytes);
+}
+
+bool BERGCloudMessageBase::pack_bin_header(uint16_t sizeInBytes)
+{
+  if (!available(sizeInBytes + binHeaderSize(sizeInBytes)))
+  {
+    _LOG_PACK_ERROR_NO_SPACE;
+    return false;
+  }
+
+  addBinHeader(sizeInBytes);
+  return true;
+}
+
+void BERGCloudMessageBase::addBinHeader(uint16_t sizeInBytes)
+{
+  /* No checks */
+  if (sizeInBytes <= UINT8_MAX)
+  {
+    /* Use bin 8 */
+    add(_MP_BIN8);
+    add((uint8_t)sizeInBytes);
+  }
+  else
+  {
+    /* Use bin 16 */
+    add(_MP_BIN16);
+    add((uint8_t)(sizeInBytes >> 8));
+    add((uint8_t)sizeInBytes);
+  }
+}
+
+static uint8_t extHeaderSize(uint32_t sizeInBytes)
+{
+  /* Bytes of the header that addExtHeader() uses for 'sizeInBytes' */
+  if ((sizeInBytes == 1) || (sizeInBytes == 2) || (sizeInBytes == 4) ||
+    (sizeInBytes == 8) || (sizeInBytes == 16))
+  {
+    return 1 + 1;
+  }
+
+  return (sizeInBytes <= UINT8_MAX) ? 1 + sizeof(uint8_t) + 1 : 1 + sizeof(uint16_t) + 1;
+}
+
+bool BERGCloudMessageBase::pack_array_of(const int16_t *data, uint16_t items, bool delta)
+{
+  return packArrayOf(data, items, delta, BC_EXT_INT16_ARRAY);
+}
+
+bool BERGCloudMessageBase::pack_array_of(const uint16_t *data, uint16_t items, bool delta)
+{
+  return packArrayOf(data, items, delta, BC_EXT_UINT16_ARRAY);
+}
+
+bool BERGCloudMessageBase::pack_array_of(const int32_t *data, uint16_t items, bool delta)
+{
+  return packArrayOf(data, items, delta, BC_EXT_INT32_ARRAY);
+}
+
+template <typename T>
+bool BERGCloudMessageBase::packArrayOf(const T *data, uint16_t items, bool delta, uint8_t extType)
+{
+  /* Values are put together big-endian in a small block on the */
+  /* stack, which is written to the message each time it fills. */
+  /* Differences are worked out modulo 2^32, which suits every type. */
+  uint8_t block[ARRAY_BLOCK_SIZE_BYTES];
+  uint8_t used = 0;
+  uint32_t sizeInBytes;
+  uint32_t change;
+  uint16_t i;
+  uint8_t b;
+
+  if ((data == NULL) && (items > 0))
+  {
+    return false;
+  }
+
+  if (items == 0)
+  {
+    delta = false;
+  }
+
+  /* Use the delta form only if every change fits in a byte */
+  for (i = 1; delta && (i < items); i++)
+  {
+    change = (uint32_t)data[i] - (uint32_t)data[i - 1];
+    delta = ((uint32_t)(change + 128) <= UINT8_MAX);
+  }
+
+  sizeInBytes = delta ? sizeof(T) + (items - 1) : (uint32_t)items * sizeof(T);
+
+  if ((sizeInBytes > (uint32_t)(UINT16_MAX - extHeaderSize(sizeInBytes))) ||
+    !available((uint16_t)(sizeInBytes + extHeaderSize(sizeInBytes))))
+  {
+    _LOG_PACK_ERROR_NO_SPACE;
+    return false;
+  }
+
+  addExtHeader(delta ? extType + 1 : extType, (uint16_t)sizeInBytes);
+
+  for (i = 0; i < items; i++)
+  {
+    if (delta && (i > 0))
+    {
+      block[used++] = (uint8_t)((uint32_t)data[i] - (uint32_t)data[i - 1]);
+    }
+    else
+    {
+      for (b = sizeof(T); b > 0; b--)
+      {
+        block[used++] = (uint8_t)((uint32_t)data[i] >> ((b - 1) * 8));
+      }
+    }
+
+    if (used > (sizeof(block) - sizeof(T)))
+    {
+      write(block, used);
+      used = 0;
+    }
+  }
+
+  write(block, used);
+  return true;
+}
+
+void BERGCloudMessageBase::addExtHeader(uint8_t extType, uint16_t sizeInBytes)
+{
+  /* No checks */
+  switch (sizeInBytes)
+  {
+  case 1:
+    add(_MP_FIXEXT1);
+    break;
+  case 2:
+    add(_MP_FIXEXT1 + 1);
+    break;
+  case 4:
+    add(_MP_FIXEXT1 + 2);
+    break;
+  case 8:
+    add(_MP_FIXEXT1 + 3);
+    break;
+  case 16:
+    add(_MP_FIXEXT16);
+    break;
+  default:
+    if (sizeInBytes <= UINT8_MAX)
+    {
+      add(_MP_EXT8);
+      add((uint8_t)sizeInBytes);
+    }
+    else
+    {
+      add(_MP_EXT16);
+      add((uint8_t)(sizeInBytes >> 8));
+      add((uint8_t)sizeInBytes);
+    }
+    break;
+  }
+
+  add(extType);
+}
+
+/*
+    Schema methods; see BERGCloudSchema.h
+*/
+
+static void getSchemaField(const BC_SCHEMA& schema, uint8_t i, BC_SCHEMA_FIELD& field)
+{
+  /* Copy a field out of the table, which is in program memory on AVR */
+#ifdef __AVR__
+  memcpy_P(&field, &schema.fields[i], sizeof(field));
+#else
+  field = schema.fields[i];
+#endif
+}
+
+static uint16_t schemaStringLength(const char *string, uint16_t size)
+{
+  /* A string member need not be null-terminated if it fills its array */
+  uint16_t length = 0;
+
+  while ((length < size) && (string[length] != '\0'))
+  {
+    length++;
+  }
+
+  return length;
+}
+
+bool BERGCloudMessageBase::pack_schema(const BC_SCHEMA& schema, const void *object)
+{
+  /* Pack the members as a map, checking for space once for the */
+  /* whole map rather than for each key and value */
+  const uint8_t *base = (const uint8_t *)object;
+  const uint8_t *member;
+  BC_SCHEMA_FIELD field;
+  uint32_t required;
+  uint32_t data;
+  uint16_t length;
+  uint8_t i;
+
+  required = (schema.count <= _MAX_FIXMAP) ? 1 : 1 + sizeof(uint16_t);
+
+  for (i = 0; i < schema.count; i++)
+  {
+    getSchemaField(schema, i, field);
+
+    /* Keys are short enough for a fix raw header */
+    required += 1 + field.keyLength;
+
+    switch (field.type)
+    {
+    case BC_SCHEMA_BOOL:
+      required += 1;
+      break;
+    case BC_SCHEMA_STRING:
+      length = schemaStringLength((const char *)&base[field.offset], field.size);
+      required += rawHeaderSize(length) + length;
+      break;
+    case BC_SCHEMA_BIN:
+      required += binHeaderSize(field.size) + field.size;
+      break;
+    default:
+      /* Integers and floats at their full width; */
+      /* pack_smallest() may use fewer bytes */
+      required += 1 + field.size;
+      break;
+    }
+  }
+
+  if ((required > UINT16_MAX) || !available((uint16_t)required))
+  {
+    _LOG_PACK_ERROR_NO_SPACE;
+    return false;
+  }
+
+  if (schema.count <= _MAX_FIXMAP)
+  {
+    add(_MP_FIXMAP_MIN + schema.count);
+  }
+  else
+  {
+    add(_MP_MAP16);
+    add(0);
+    add(schema.count);
+  }
+
+  for (i = 0; i < schema.count; i++)
+  {
+    getSchemaField(schema, i, field);
+    member = &base[field.offset];
+
+    add(_MP_FIXRAW_MIN + field.keyLength);
+    write((const uint8_t *)field.key, field.keyLength);
+
+    switch (field.type)
+    {
+    case BC_SCHEMA_UINT8:
+      addUnsigned(*member, sizeof(uint8_t));
+      break;
+    case BC_SCHEMA_UINT16:
+      addUnsigned(*(const uint16_t *)member, sizeof(uint16_t));
+      break;
+    case BC_SCHEMA_UINT32:
+      addUnsigned(*(const uint32_t *)member, sizeof(uint32_t));
+      break;
+    case BC_SCHEMA_INT8:
+      addSigned(*(const int8_t *)member, sizeof(int8_t));
+      break;
+    case BC_SCHEMA_INT16:
+      addSigned(*(const int16_t *)member, sizeof(int16_t));
+      break;
+    case BC_SCHEMA_INT32:
+      addSigned(*(const int32_t *)member, sizeof(int32_t));
+      break;
+    case BC_SCHEMA_FLOAT:
+      memcpy(&data, member, sizeof(data));
+      add(_MP_FLOAT);
+      add((uint8_t)(data >> 24));
+      add((uint8_t)(data >> 16));
+      add((uint8_t)(data >> 8));
+      add((uint8_t)data);
+      break;
+    case BC_SCHEMA_BOOL:
+      add(*(const bool *)member ? _MP_BOOL_TRUE : _MP_BOOL_FALSE);
+      break;
+    case BC_SCHEMA_STRING:
+      length = schemaStringLength((const char *)member, field.size);
+      addRawHeader(length);
+      write(member, length);
+      break;
+    case BC_SCHEMA_BIN:
+      addBinHeader(field.size);
+      write(member, field.size);
+      break;
+    }
+  }
+
+  return true;
+}
+
+void BERGCloudMessageBase::addUnsigned(uint32_t n, uint8_t size)
+{
+  /* Add an unsigned integer of 'size' bytes in the */
+  /* same form as pack() would; no checks */
+  if (packSmallest)
+  {
+    if (n <= _MP_FIXNUM_POS_MAX)
+    {
+      add((uint8_t)n);
+      return;
+    }
+
+    size = (n <= UINT8_MAX) ? 1 : ((n <= UINT16_MAX) ? 2 : 4);
+  }
+
+  add((size == 1) ? _MP_UINT8 : ((size == 2) ? _MP_UINT16 : _MP_UINT32));
+
+  if (size == 4)
+  {
+    add((uint8_t)(n >> 24));
+    add((uint8_t)(n >> 16));
+  }
+
+  if (size >= 2)
+  {
+    add((uint8_t)(n >> 8));
+  }
+
+  add((uint8_t)n);
+}
+
+void BERGCloudMessageBase::addSigned(int32_t n, uint8_t size)
+{
+  /* Add a signed integer of 'size' bytes in the */
+  /* same form as pack() would; no checks */
+  if (packSmallest)
+  {
+    if (n >= 0)
+    {
+      addUnsigned((uint32_t)n, size);
+      return;
+    }
+
+    if (n >= (int8_t)_MP_FIXNUM_NEG_MIN)
+    {
+      add((uint8_t)n);
+      return;
+    }
+
+    size = (n >= INT8_MIN) ? 1 : ((n >= INT16_MIN) ? 2 : 4);
+  }
+
+  add((size == 1) ? _MP_INT8 : ((size == 2) ? _MP_INT16 : _MP_INT32));
+
+  if (size == 4)
+  {
+    add((uint8_t)(n >> 24));
+    add((uint8_t)(n >> 16));
+  }
+
+  if (size >= 2)
+  {
+    add((uint8_t)(n >> 8));
+  }
+
+  add((uint8_t)n);
+}
+
+/*
+    Unpack methods
+*/
+
+bool BERGCloudMessageBase::unpack_peek(uint8_t& messagePackType)
 {
   return peek(&messagePackType);
 }
@@ -422,19 +1325,25 @@ bool BERGCloudMessageBase::unpack_peek(void)
     return true;
   }
 
-  if ((type == _MP_MAP16) || (type == _MP_MAP32) || IN_RANGE(type, _MP_FIXMAP_MIN, _MP_FIXMAP_MAX))
+  if (isMapType(type))
   {
     _LOG("Map");
     return true;
   }
 
-  if ((type == _MP_ARRAY16) || (type == _MP_ARRAY32) || IN_RANGE(type, _MP_FIXARRAY_MIN, _MP_FIXARRAY_MAX))
+  if (isArrayType(type))
   {
     _LOG("Array");
     return true;
   }
 
-  if ((type == _MP_RAW16) || (type == _MP_RAW32) || IN_RANGE(type, _MP_FIXRAW_MIN, _MP_FIXRAW_MAX))
+  if (IN_RANGE(type, _MP_BIN8, _MP_BIN32))
+  {
+    _LOG("Binary");
+    return true;
+  }
+
+  if (isRawType(type))
   {
     _LOG("Raw");
     return true;
@@ -458,99 +1367,1001 @@ bool BERGCloudMessageBase::unpack_peek(void)
     return true;
   }
 
-  if (type == _MP_BOOL_FALSE)
+  if (type == _MP_BOOL_FALSE)
+  {
+    _LOG("Boolean false");
+    return true;
+  }
+
+  if (type == _MP_BOOL_TRUE)
+  {
+    _LOG("Boolean true");
+    return true;
+  }
+
+  if (type == _MP_FLOAT)
+  {
+    _LOG("Float");
+    return true;
+  }
+
+  if (type == _MP_DOUBLE)
+  {
+    _LOG("Double");
+    return true;
+  }
+
+  if (IN_RANGE(type, _MP_EXT8, _MP_EXT32) || IN_RANGE(type, _MP_FIXEXT1, _MP_FIXEXT16))
+  {
+    _LOG("Extension");
+    return true;
+  }
+
+  _LOG("Unknown type");
+  return false;
+}
+
+void BERGCloudMessageBase::print(void)
+{
+  uint16_t last_read;
+  uint32_t contents;
+
+  /* Remember the current read position in the raw data */
+  last_read = bytesRead;
+
+  /* Start reading from the beginning of the data */
+  restart();
+
+  /* Print all items, including those in maps and arrays */
+  while(unpack_peek())
+  {
+    if (!skipItem(contents))
+    {
+      break;
+    }
+  }
+
+  /* Return to the last position */
+  bytesRead = last_read;
+}
+
+uint16_t BERGCloudMessageBase::count(void)
+{
+#if BC_FIND_INDEXED
+  BC_FIND_INDEX *index = getFindIndex();
+  uint16_t found;
+
+  if (index != NULL)
+  {
+    /* Walk to the end; nothing has tag zero */
+    if (!index->walkedAll)
+    {
+      extendFindIndex(0, NULL, found);
+    }
+
+    if (!index->malformed)
+    {
+      return index->items;
+    }
+  }
+#endif
+
+  return scanCount();
+}
+
+uint16_t BERGCloudMessageBase::scanCount(void)
+{
+  uint16_t last_read;
+  uint16_t items = 0;
+  uint32_t contents;
+  uint8_t type;
+
+  /* Remember the current read position in the raw data */
+  last_read = bytesRead;
+
+  /* Start reading from the beginning of the data */
+  restart();
+
+  /* Count all items, including those in maps and arrays */
+  while(peek(&type))
+  {
+    items++;
+    if (!skipItem(contents))
+    {
+      break;
+    }
+  }
+
+  /* Return to the last position */
+  bytesRead = last_read;
+  
+  return items;
+}
+
+void BERGCloudMessageBase::print_bytes(void)
+{
+  uint16_t offset = 0;
+  uint16_t size;
+  uint8_t *data;
+
+  while (segment(offset, data, size))
+  {
+    offset += size;
+
+    while (size-- > 0)
+    {
+      _LOG_HEX(*data);
+      _LOG(" ");
+      data++;
+    }
+  }
+  _LOG("\r\n");
+}
+#endif
+
+uint16_t BERGCloudMessageBase::readUint16(void)
+{
+  /* Read a big-endian 16-bit value; no checks */
+  uint16_t value;
+
+#ifdef __AVR__
+  if (!chunked() && !inProgmem)
+#else
+  if (!chunked())
+#endif
+  {
+    value = buffer[bytesRead];
+    value = (value << 8) | buffer[bytesRead + 1];
+    bytesRead += sizeof(uint16_t);
+    return value;
+  }
+
+  value = read();
+  value = (value << 8) | read();
+  return value;
+}
+
+uint32_t BERGCloudMessageBase::readUint32(void)
+{
+  /* Read a big-endian 32-bit value; no checks */
+  uint32_t value;
+
+#ifdef __AVR__
+  if (!chunked() && !inProgmem)
+#else
+  if (!chunked())
+#endif
+  {
+    value = buffer[bytesRead];
+    value = (value << 8) | buffer[bytesRead + 1];
+    value = (value << 8) | buffer[bytesRead + 2];
+    value = (value << 8) | buffer[bytesRead + 3];
+    bytesRead += sizeof(uint32_t);
+    return value;
+  }
+
+  value = read();
+  value = (value << 8) | read();
+  value = (value << 8) | read();
+  value = (value << 8) | read();
+  return value;
+}
+
+/* The range of each type that unpackInteger() converts to */
+template <typename T> struct IntegerRange;
+template <> struct IntegerRange<uint8_t>
+  { static const bool isSigned = false; static const int64_t min = 0; static const uint64_t max = UINT8_MAX; };
+template <> struct IntegerRange<uint16_t>
+  { static const bool isSigned = false; static const int64_t min = 0; static const uint64_t max = UINT16_MAX; };
+template <> struct IntegerRange<uint32_t>
+  { static const bool isSigned = false; static const int64_t min = 0; static const uint64_t max = UINT32_MAX; };
+template <> struct IntegerRange<uint64_t>
+  { static const bool isSigned = false; static const int64_t min = 0; static const uint64_t max = UINT64_MAX; };
+template <> struct IntegerRange<int8_t>
+  { static const bool isSigned = true; static const int64_t min = INT8_MIN; static const uint64_t max = INT8_MAX; };
+template <> struct IntegerRange<int16_t>
+  { static const bool isSigned = true; static const int64_t min = INT16_MIN; static const uint64_t max = INT16_MAX; };
+template <> struct IntegerRange<int32_t>
+  { static const bool isSigned = true; static const int64_t min = INT32_MIN; static const uint64_t max = INT32_MAX; };
+template <> struct IntegerRange<int64_t>
+  { static const bool isSigned = true; static const int64_t min = INT64_MIN; static const uint64_t max = INT64_MAX; };
+
+bool BERGCloudMessageBase::unpackError(uint8_t error)
+{
+  /* Log why an item could not be unpacked; shared so that each */
+  /* message is held once however many types use it */
+  if (error == UNPACK_ERROR_NO_DATA)
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+  }
+  else if (error == UNPACK_ERROR_RANGE)
+  {
+    _LOG_UNPACK_ERROR_RANGE;
+  }
+  else
+  {
+    _LOG_UNPACK_ERROR_TYPE;
+  }
+
+  return false;
+}
+
+template <typename T>
+bool BERGCloudMessageBase::unpackInteger(T& n)
+{
+  /* Decode the next item as an integer of type T. Each encoding is read */
+  /* at its own width and checked against the range of T, which is known */
+  /* at compile time, so most checks fold away; a uint8_t is never */
+  /* widened to 32 bits unless it was packed that way. */
+  typedef IntegerRange<T> Range;
+  uint8_t type;
+
+  /* Look at next type */
+  if (!peek(&type))
+  {
+    return unpackError(UNPACK_ERROR_NO_DATA);
+  }
+
+  if (type <= _MP_FIXNUM_POS_MAX)
+  {
+    /* Positive fix num; fits every type */
+    n = (T)read();
+    return true;
+  }
+
+  if (type >= _MP_FIXNUM_NEG_MIN)
+  {
+    /* Negative fix num; fits every signed type */
+    if (!Range::isSigned)
+    {
+      read();
+      return unpackError(UNPACK_ERROR_RANGE);
+    }
+
+    n = (T)(int8_t)read();
+    return true;
+  }
+
+  switch (type)
+  {
+  case _MP_UINT8:
+    {
+      uint8_t value;
+
+      if (!remaining(1 + sizeof(uint8_t)))
+      {
+        break;
+      }
+
+      read();
+      value = read();
+
+      if ((Range::max < UINT8_MAX) && (value > (uint8_t)Range::max))
+      {
+        return unpackError(UNPACK_ERROR_RANGE);
+      }
+
+      n = (T)value;
+      return true;
+    }
+
+  case _MP_UINT16:
+    {
+      uint16_t value;
+
+      if (!remaining(1 + sizeof(uint16_t)))
+      {
+        break;
+      }
+
+      read();
+      value = readUint16();
+
+      if ((Range::max < UINT16_MAX) && (value > (uint16_t)Range::max))
+      {
+        return unpackError(UNPACK_ERROR_RANGE);
+      }
+
+      n = (T)value;
+      return true;
+    }
+
+  case _MP_UINT32:
+    {
+      uint32_t value;
+
+      if (!remaining(1 + sizeof(uint32_t)))
+      {
+        break;
+      }
+
+      read();
+      value = readUint32();
+
+      if ((Range::max < UINT32_MAX) && (value > (uint32_t)Range::max))
+      {
+        return unpackError(UNPACK_ERROR_RANGE);
+      }
+
+      n = (T)value;
+      return true;
+    }
+
+  case _MP_INT8:
+    {
+      int8_t value;
+
+      if (!remaining(1 + sizeof(int8_t)))
+      {
+        break;
+      }
+
+      read();
+      value = (int8_t)read(); /* Convert with sign extension */
+
+      if (!Range::isSigned && (value < 0))
+      {
+        return unpackError(UNPACK_ERROR_RANGE);
+      }
+
+      n = (T)value;
+      return true;
+    }
+
+  case _MP_INT16:
+    {
+      int16_t value;
+
+      if (!remaining(1 + sizeof(int16_t)))
+      {
+        break;
+      }
+
+      read();
+      value = (int16_t)readUint16(); /* Convert with sign extension */
+
+      if ((!Range::isSigned && (value < 0)) ||
+          ((Range::max < INT16_MAX) && (value > (int16_t)Range::max)) ||
+          ((Range::min > INT16_MIN) && (value < (int16_t)Range::min)))
+      {
+        return unpackError(UNPACK_ERROR_RANGE);
+      }
+
+      n = (T)value;
+      return true;
+    }
+
+  case _MP_INT32:
+    {
+      int32_t value;
+
+      if (!remaining(1 + sizeof(int32_t)))
+      {
+        break;
+      }
+
+      read();
+      value = (int32_t)readUint32(); /* Convert */
+
+      if ((!Range::isSigned && (value < 0)) ||
+          ((Range::max < INT32_MAX) && (value > (int32_t)Range::max)) ||
+          ((Range::min > INT32_MIN) && (value < (int32_t)Range::min)))
+      {
+        return unpackError(UNPACK_ERROR_RANGE);
+      }
+
+      n = (T)value;
+      return true;
+    }
+
+  case _MP_UINT64:
+    {
+      uint32_t high;
+      uint32_t low;
+
+      if (!remaining(1 + sizeof(uint64_t)))
+      {
+        break;
+      }
+
+      read();
+      high = readUint32();
+      low = readUint32();
+
+      /* Check the halves, so that only 64-bit types */
+      /* need 64-bit arithmetic */
+      if ((sizeof(T) < sizeof(uint64_t)) ?
+          ((high != 0) || ((Range::max < UINT32_MAX) && (low > (uint32_t)Range::max))) :
+          (Range::isSigned && ((high & 0x80000000UL) != 0)))
+      {
+        return unpackError(UNPACK_ERROR_RANGE);
+      }
+
+      n = (sizeof(T) < sizeof(uint64_t)) ? (T)low : (T)(((uint64_t)high << 32) | low);
+      return true;
+    }
+
+  case _MP_INT64:
+    {
+      uint32_t high;
+      uint32_t low;
+      int32_t value;
+
+      if (!remaining(1 + sizeof(int64_t)))
+      {
+        break;
+      }
+
+      read();
+      high = readUint32();
+      low = readUint32();
+
+      if (sizeof(T) == sizeof(int64_t))
+      {
+        if (!Range::isSigned && ((high & 0x80000000UL) != 0))
+        {
+          return unpackError(UNPACK_ERROR_RANGE);
+        }
+
+        n = (T)(((uint64_t)high << 32) | low);
+        return true;
+      }
+
+      if (!Range::isSigned)
+      {
+        /* Must be positive and fit in 32 bits */
+        if ((high != 0) || ((Range::max < UINT32_MAX) && (low > (uint32_t)Range::max)))
+        {
+          return unpackError(UNPACK_ERROR_RANGE);
+        }
+
+        n = (T)low;
+        return true;
+      }
+
+      /* Must be a 32-bit value with the sign extended */
+      value = (int32_t)low;
+
+      if ((high != ((value < 0) ? UINT32_MAX : 0)) ||
+          ((Range::max < INT32_MAX) && (value > (int32_t)Range::max)) ||
+          ((Range::min > INT32_MIN) && (value < (int32_t)Range::min)))
+      {
+        return unpackError(UNPACK_ERROR_RANGE);
+      }
+
+      n = (T)value;
+      return true;
+    }
+
+  default:
+    /* Can't convert this type */
+    return unpackError(UNPACK_ERROR_TYPE);
+  }
+
+  /* Not enough data for the type */
+  return unpackError(UNPACK_ERROR_NO_DATA);
+}
+
+bool BERGCloudMessageBase::unpack_restart(void)
+{
+  /* Restart unpacking from the beginning; the index is returned */
+  /* to the pool for other messages, and taken again if needed */
+  restart();
+#if BC_FIND_INDEXED
+  releaseFindIndex();
+#endif
+  return true;
+}
+
+bool BERGCloudMessageBase::unpack_skip(void)
+{
+  /* Skip next item, including everything in a map or array */
+  return skipNested(NULL);
+}
+
+bool BERGCloudMessageBase::skipNested(uint16_t *skipped)
+{
+  /* Skip the next item and everything in it; rather than recursing */
+  /* into nested maps and arrays, count the items left to skip. */
+  /* 'skipped' is the number of items, as count() would give. */
+
+  uint16_t last_read;
+  uint16_t total = 0;
+  uint32_t items = 1;
+  uint32_t contents;
+
+  /* Remember the current read position in the raw data */
+  last_read = bytesRead;
+
+  while (items-- > 0)
+  {
+    if (!skipItem(contents))
+    {
+      /* Return to the last position */
+      bytesRead = last_read;
+      return false;
+    }
+
+    /* Every item is at least one byte, so this also */
+    /* rejects a header that claims more items than there is data */
+    if (contents > (uint32_t)remaining() - items)
+    {
+      _LOG_UNPACK_ERROR_NO_DATA;
+      bytesRead = last_read;
+      return false;
+    }
+
+    items += contents;
+    total++;
+  }
+
+  if (skipped != NULL)
+  {
+    *skipped = total;
+  }
+
+  /* Success */
+  return true;
+}
+
+bool BERGCloudMessageBase::skipItem(uint32_t& contents)
+{
+  /* Skip the next item alone; 'contents' is the number */
+  /* of items that follow in a map or array */
+
+  uint8_t type;
+  uint32_t bytesToSkip = 0;
+
+  contents = 0;
+
+  /* Must be at least one byte of data */
+  if (!remaining(sizeof(uint8_t)))
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+    return false;
+  }
+
+  /* Read type */
+  type = read();
+
+  if ((type <= _MP_FIXNUM_POS_MAX) || (type >= _MP_FIXNUM_NEG_MIN))
+  {
+    /* Fix num, the most common item; nothing more to skip */
+    return true;
+  }
+
+  if (IN_RANGE(type, _MP_FIXRAW_MIN, _MP_FIXRAW_MAX))
+  {
+    bytesToSkip = type - _MP_FIXRAW_MIN;
+  }
+  else if ((type == _MP_UINT8) || (type == _MP_INT8))
+  {
+    bytesToSkip = 1;
+  }
+  else if ((type == _MP_UINT16) || (type == _MP_INT16))
+  {
+    bytesToSkip = 2;
+  }
+  else if ((type == _MP_UINT32) || (type == _MP_INT32) || (type == _MP_FLOAT))
+  {
+    bytesToSkip = 4;
+  }
+  else if ((type == _MP_UINT64) || (type == _MP_INT64) || (type == _MP_DOUBLE))
+  {
+    bytesToSkip = 8;
+  }
+  else if (IN_RANGE(type, _MP_FIXEXT1, _MP_FIXEXT16))
+  {
+    /* Extension type, then 1, 2, 4, 8 or 16 bytes of data */
+    bytesToSkip = 1 + (1 << (type - _MP_FIXEXT1));
+  }
+  else if ((type == _MP_STR8) || (type == _MP_BIN8) || (type == _MP_EXT8))
+  {
+    if (!remaining(sizeof(uint8_t)))
+    {
+      _LOG_UNPACK_ERROR_NO_DATA;
+      return false;
+    }
+
+    /* Read 8-bit data size */
+    bytesToSkip = read();
+  }
+  else if (IN_RANGE(type, _MP_FIXARRAY_MIN, _MP_FIXARRAY_MAX))
+  {
+    contents = type - _MP_FIXARRAY_MIN;
+  }
+  else if (IN_RANGE(type, _MP_FIXMAP_MIN, _MP_FIXMAP_MAX))
+  {
+    /* A key and a value for each entry */
+    contents = (uint32_t)(type - _MP_FIXMAP_MIN) * 2;
+  }
+  else if ((type == _MP_ARRAY16) || (type == _MP_MAP16) || (type == _MP_RAW16) ||
+    (type == _MP_BIN16) || (type == _MP_EXT16))
+  {
+    if (!remaining(sizeof(uint16_t)))
+    {
+      _LOG_UNPACK_ERROR_NO_DATA;
+      return false;
+    }
+
+    /* Read 16-bit unsigned integer, number of items or data size */
+    bytesToSkip = read();
+    bytesToSkip = bytesToSkip << 8;
+    bytesToSkip |= read();
+  }
+  else if ((type == _MP_ARRAY32) || (type == _MP_MAP32) || (type == _MP_RAW32) ||
+    (type == _MP_BIN32) || (type == _MP_EXT32))
+  {
+    if (!remaining(sizeof(uint32_t)))
+    {
+      _LOG_UNPACK_ERROR_NO_DATA;
+      return false;
+    }
+
+    /* read 32-bit unsigned integer, number of items or data size */
+    bytesToSkip = read();
+    bytesToSkip = bytesToSkip << 8;
+    bytesToSkip |= read();
+    bytesToSkip = bytesToSkip << 8;
+    bytesToSkip |= read();
+    bytesToSkip = bytesToSkip << 8;
+    bytesToSkip |= read();
+  }
+
+  if ((type == _MP_EXT8) || (type == _MP_EXT16) || (type == _MP_EXT32))
+  {
+    /* Extension type follows the data size; a size */
+    /* larger than the data remaining is rejected below */
+    if (bytesToSkip <= remaining())
+    {
+      bytesToSkip++;
+    }
+  }
+  else if ((type == _MP_ARRAY16) || (type == _MP_ARRAY32))
+  {
+    contents = bytesToSkip;
+    bytesToSkip = 0;
+  }
+  else if ((type == _MP_MAP16) || (type == _MP_MAP32))
+  {
+    /* A key and a value for each entry; too many */
+    /* entries for the data remaining are rejected by the caller */
+    contents = (bytesToSkip > remaining()) ? UINT32_MAX : bytesToSkip * 2;
+    bytesToSkip = 0;
+  }
+
+  if (bytesToSkip > remaining())
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+    return false;
+  }
+
+  /* Discard data */
+  bytesRead += bytesToSkip;
+
+  /* Success */
+  return true;
+}
+
+bool BERGCloudMessageBase::unpack(uint8_t& n)
+{
+  return unpackInteger(n);
+}
+
+bool BERGCloudMessageBase::unpack(uint16_t& n)
+{
+  return unpackInteger(n);
+}
+
+bool BERGCloudMessageBase::unpack(uint32_t& n)
+{
+  return unpackInteger(n);
+}
+
+bool BERGCloudMessageBase::unpack(int8_t& n)
+{
+  return unpackInteger(n);
+}
+
+bool BERGCloudMessageBase::unpack(int16_t& n)
+{
+  return unpackInteger(n);
+}
+
+bool BERGCloudMessageBase::unpack(int32_t& n)
+{
+  return unpackInteger(n);
+}
+
+bool BERGCloudMessageBase::unpack(uint64_t& n)
+{
+  return unpackInteger(n);
+}
+
+bool BERGCloudMessageBase::unpack(int64_t& n)
+{
+  return unpackInteger(n);
+}
+
+bool BERGCloudMessageBase::unpack(float& n)
+{
+  /* Try to decode the next messagePack item as an 4-byte float */
+  uint32_t data;
+  uint8_t type;
+
+  /* Look at next type */
+  if (!peek(&type))
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+    return false;
+  }
+
+  if (type == _MP_FLOAT)
+  {
+    if (!remaining(1 + sizeof(float)))
+    {
+      _LOG_UNPACK_ERROR_NO_DATA;
+      return false;
+    }
+
+    /* Read type */
+    read();
+
+    /* Read 32-bit float */
+    data = readUint32();
+
+    /* Convert to float */
+    memcpy(&n, &data, sizeof(float));
+
+    /* Success */
+    return true;
+  }
+
+  if (type == _MP_DOUBLE)
+  {
+    if (!remaining(1 + sizeof(uint64_t)))
+    {
+      _LOG_UNPACK_ERROR_NO_DATA;
+      return false;
+    }
+
+    /* Read type */
+    read();
+
+    /* Read 64-bit double, and convert to the nearest float */
+    data = readUint32();
+    n = bcDoubleToFloat(data, readUint32());
+
+    /* Success */
+    return true;
+  }
+
+  /* Can't convert this type */
+  _LOG_UNPACK_ERROR_TYPE;
+  return false;
+}
+
+bool BERGCloudMessageBase::unpack(double& n)
+{
+  /* Try to decode the next messagePack item as a double */
+  uint64_t data;
+  float f;
+  uint8_t type;
+
+  /* Look at next type */
+  if (!peek(&type))
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+    return false;
+  }
+
+  if ((type == _MP_DOUBLE) && (sizeof(double) == sizeof(data)))
+  {
+    if (!remaining(1 + sizeof(data)))
+    {
+      _LOG_UNPACK_ERROR_NO_DATA;
+      return false;
+    }
+
+    /* Read type */
+    read();
+
+    /* Read 64-bit double */
+    data = readUint32();
+    data = (data << 32) | readUint32();
+
+    /* Convert to double */
+    memcpy(&n, &data, sizeof(n));
+
+    /* Success */
+    return true;
+  }
+
+  /* A float, or a double where it is the same size as float */
+  if (!unpack(f))
+  {
+    return false;
+  }
+
+  n = f;
+  return true;
+}
+
+bool BERGCloudMessageBase::unpack(bool& n)
+{
+  /* Try to decode the next messagePack item as boolean */
+  uint8_t type;
+
+  /* Look at next type */
+  if (!peek(&type))
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+    return false;
+  }
+
+  if ((type == _MP_BOOL_FALSE) || (type == _MP_BOOL_TRUE))
+  {
+    n = (read() == _MP_BOOL_TRUE);
+
+    /* Success */
+    return true;
+  }
+
+  /* Can't convert this type */
+  _LOG_UNPACK_ERROR_TYPE;
+  return false;
+}
+
+bool BERGCloudMessageBase::unpack_nil(void)
+{
+  /* Try to decode the next messagePack item as nil */
+  uint8_t type;
+
+  /* Look at next type */
+  if (!peek(&type))
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+    return false;
+  }
+
+  if (type == _MP_NIL)
+  {
+    /* Read type */
+    read();
+
+    /* Success */
+    return true;
+  }
+
+  /* Can't convert this type */
+  _LOG_UNPACK_ERROR_TYPE;
+  return false;
+}
+
+bool BERGCloudMessageBase::unpack_array(uint16_t& items)
+{
+  /* Try to decode the next messagePack item as array */
+  uint8_t type;
+
+  /* Look at next type */
+  if (!peek(&type))
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+    return false;
+  }
+
+  if (IN_RANGE(type, _MP_FIXARRAY_MIN, _MP_FIXARRAY_MAX))
+  {
+    /* Read fix num value */
+    items = read() - _MP_FIXARRAY_MIN;
+
+    /* Success */
+    return true;
+  }
+
+  if ((type == _MP_ARRAY16) || (type == _MP_ARRAY32))
   {
-    _LOG("Boolean false");
-    return true;
+    return unpackCount(type, items);
   }
 
-  if (type == _MP_BOOL_TRUE)
+  /* Can't convert this type */
+  _LOG_UNPACK_ERROR_TYPE;
+  return false;
+}
+
+bool BERGCloudMessageBase::unpack_map(uint16_t& items)
+{
+  /* Try to decode the next messagePack item as map */
+  uint8_t type;
+
+  /* Look at next type */
+  if (!peek(&type))
   {
-    _LOG("Boolean true");
-    return true;
+    _LOG_UNPACK_ERROR_NO_DATA;
+    return false;
   }
 
-  if (type == _MP_FLOAT)
+  if (IN_RANGE(type, _MP_FIXMAP_MIN, _MP_FIXMAP_MAX))
   {
-    _LOG("Float");
+    /* Read fix num value */
+    items = read() - _MP_FIXMAP_MIN;
+
+    /* Success */
     return true;
   }
 
-  if (type == _MP_DOUBLE)
+  if ((type == _MP_MAP16) || (type == _MP_MAP32))
   {
-    _LOG("Double");
-    return true;
+    return unpackCount(type, items);
   }
 
-  _LOG("Unknown type");
+  /* Can't convert this type */
+  _LOG_UNPACK_ERROR_TYPE;
   return false;
 }
 
-void BERGCloudMessageBase::print(void)
+bool BERGCloudMessageBase::unpackCount(uint8_t type, uint16_t& items)
 {
+  /* Read the 16 or 32-bit count of the map or array header 'type' */
+  /* at the current position. A message can't hold more than 65535 */
+  /* items, so a larger 32-bit count can't be valid. */
   uint16_t last_read;
+  uint32_t count;
 
-  /* Remember the current read position in the raw data */
-  last_read = bytesRead;
+  if ((type == _MP_ARRAY16) || (type == _MP_MAP16))
+  {
+    if (!remaining(1 + sizeof(uint16_t)))
+    {
+      return unpackError(UNPACK_ERROR_NO_DATA);
+    }
 
-  /* Start reading from the beginning of the data */
-  restart();
+    /* Read type */
+    read();
 
-  /* Print all items */
-  while(unpack_peek())
-  {
-    unpack_skip();
-  }
+    /* Read 16-bit unsigned integer */
+    items = readUint16();
 
-  /* Return to the last position */
-  bytesRead = last_read;
-}
+    /* Success */
+    return true;
+  }
 
-uint16_t BERGCloudMessageBase::count(void)
-{
-  uint16_t last_read;
-  uint16_t items = 0;
-  uint8_t type;
+  if (!remaining(1 + sizeof(uint32_t)))
+  {
+    return unpackError(UNPACK_ERROR_NO_DATA);
+  }
 
   /* Remember the current read position in the raw data */
   last_read = bytesRead;
 
-  /* Start reading from the beginning of the data */
-  restart();
+  /* Read type */
+  read();
 
-  /* Count all items */
-  while(peek(&type))
+  /* Read 32-bit unsigned integer */
+  count = readUint32();
+
+  if (count > UINT16_MAX)
   {
-    items++;
-    unpack_skip();
+    /* Leave the header unread */
+    bytesRead = last_read;
+    return unpackError(UNPACK_ERROR_RANGE);
   }
 
-  /* Return to the last position */
-  bytesRead = last_read;
-  
-  return items;
-}
-
-void BERGCloudMessageBase::print_bytes(void)
-{
-  uint16_t size = used();
-  uint8_t *data = ptr();
+  items = (uint16_t)count;
 
-  while (size-- > 0)
-  {
-    _LOG_HEX(*data);
-    _LOG(" ");
-    data++;
-  }
-  _LOG("\r\n");
+  /* Success */
+  return true;
 }
-#endif
 
-bool BERGCloudMessageBase::getInteger(void *value, bool valueIsSigned, int32_t min, uint32_t max)
+/* Separate header and data methods are provided for raw data*/
+/* so that Arduino strings may be unpacked without having to create */
+/* a temporary buffer first. */
+
+bool BERGCloudMessageBase::unpack_raw_header(uint16_t *sizeInBytes)
 {
+  /* Strings and binary data are both accepted, as */
+  /* each was packed as raw data before the spec split them */
+  uint32_t size;
   uint8_t type;
-  uint32_t unsignedValue;
-  int32_t signedValue;
 
   /* Look at next type */
   if (!peek(&type))
@@ -559,18 +2370,18 @@ bool BERGCloudMessageBase::getInteger(void *value, bool valueIsSigned, int32_t m
     return false;
   }
 
-  /*
-   * Unsigned types
-   */
-
-  if (type <= _MP_FIXNUM_POS_MAX)
+  if (IN_RANGE(type, _MP_FIXRAW_MIN, _MP_FIXRAW_MAX))
   {
-    /* Read positive fix num value */
-    unsignedValue = read();
+    /* Read fix raw value */
+    *sizeInBytes = read() - _MP_FIXRAW_MIN;
+
+    /* Success */
+    return true;
   }
-  else if (type == _MP_UINT8)
+
+  if ((type == _MP_STR8) || (type == _MP_BIN8))
   {
-    if (!remaining(sizeof(uint8_t)))
+    if (!remaining(1 + sizeof(uint8_t)))
     {
       _LOG_UNPACK_ERROR_NO_DATA;
       return false;
@@ -580,11 +2391,15 @@ bool BERGCloudMessageBase::getInteger(void *value, bool valueIsSigned, int32_t m
     read();
 
     /* Read 8-bit unsigned integer */
-    unsignedValue = read();
+    *sizeInBytes = read();
+
+    /* Success */
+    return true;
   }
-  else if (type == _MP_UINT16)
+
+  if ((type == _MP_RAW16) || (type == _MP_BIN16))
   {
-    if (!remaining(sizeof(uint16_t)))
+    if (!remaining(1 + sizeof(uint16_t)))
     {
       _LOG_UNPACK_ERROR_NO_DATA;
       return false;
@@ -594,13 +2409,15 @@ bool BERGCloudMessageBase::getInteger(void *value, bool valueIsSigned, int32_t m
     read();
 
     /* Read 16-bit unsigned integer */
-    unsignedValue = read();
-    unsignedValue <<= 8;
-    unsignedValue |= read();
+    *sizeInBytes = readUint16();
+
+    /* Success */
+    return true;
   }
-  else if (type == _MP_UINT32)
+
+  if ((type == _MP_RAW32) || (type == _MP_BIN32))
   {
-    if (!remaining(sizeof(uint32_t)))
+    if (!remaining(1 + sizeof(uint32_t)))
     {
       _LOG_UNPACK_ERROR_NO_DATA;
       return false;
@@ -609,694 +2426,759 @@ bool BERGCloudMessageBase::getInteger(void *value, bool valueIsSigned, int32_t m
     /* Read type */
     read();
 
-    /* Read 32-bit unsigned integer */
-    unsignedValue = read();
-    unsignedValue <<= 8;
-    unsignedValue |= read();
-    unsignedValue <<= 8;
-    unsignedValue |= read();
-    unsignedValue <<= 8;
-    unsignedValue |= read();
-  }
-  else
-  {
-    /*
-     * Signed values
-     */
-
-    if (IN_RANGE(type, _MP_FIXNUM_NEG_MIN, _MP_FIXNUM_NEG_MAX))
-    {
-      /* Read negative fix num value */
-      uint8_t temp;
-      temp = read();
-      signedValue = (int8_t)temp; /* Convert with sign extension */
-    }
-    else if (type == _MP_INT8)
-    {
-      if (!remaining(sizeof(int8_t)))
-      {
-        _LOG_UNPACK_ERROR_NO_DATA;
-        return false;
-      }
+    /* read 32-bit unsigned integer; a message can't */
+    /* hold more than 65535 bytes of data */
+    size = readUint32();
+    *sizeInBytes = (size > UINT16_MAX) ? UINT16_MAX : (uint16_t)size;
 
-      /* Read type */
-      read();
+    /* Success */
+    return true;
+  }
 
-      /* Read 8-bit signed integer */
-      uint8_t temp;
-      temp = read();
-      signedValue = (int8_t)temp; /* Convert with sign extension */
-    }
-    else if (type == _MP_INT16)
-    {
-      if (!remaining(sizeof(int16_t)))
-      {
-        _LOG_UNPACK_ERROR_NO_DATA;
-        return false;
-      }
+  /* Can't convert this type */
+  _LOG_UNPACK_ERROR_TYPE;
+  return false;
+}
 
-      /* Read type */
-      read();
+bool BERGCloudMessageBase::unpack_raw_data(uint8_t *pData, uint16_t packedSizeInBytes, uint16_t bufferSizeInBytes)
+{
+  /* Only write up to the buffer size */
+  uint16_t copySize = (packedSizeInBytes < bufferSizeInBytes) ? packedSizeInBytes : bufferSizeInBytes;
 
-      /* Read 16-bit signed integer */
-      uint16_t temp;
-      temp = read();
-      temp <<= 8;
-      temp |= read();
-      signedValue = (int16_t)temp; /* Convert with sign extension */
-    }
-    else if (type == _MP_INT32)
-    {
-      if (!remaining(sizeof(int32_t)))
-      {
-        _LOG_UNPACK_ERROR_NO_DATA;
-        return false;
-      }
+  if (!remaining(packedSizeInBytes))
+  {
+    _LOG_UNPACK_ERROR_NO_DATA;
+    return false;
+  }
 
-      /* Read type */
-      read();
+  read(pData, copySize);
 
-      /* Read 32-bit signed integer */
-      uint32_t temp;
-      temp = read();
-      temp <<= 8;
-      temp |= read();
-      temp <<= 8;
-      temp |= read();
-      temp <<= 8;
-      temp |= read();
-      signedValue = (int32_t)temp; /* Convert */
-    }
-    else
-    {
-      /* Can't convert this type */
-      _LOG_UNPACK_ERROR_TYPE;
-      return false;
-    }
+  /* Skip any bytes that did not fit */
+  bytesRead += packedSizeInBytes - copySize;
 
-    /* Signed value decoded check range */
-    if (signedValue > 0)
-    {
-      if ((uint32_t)signedValue > max)
-      {
-        _LOG_UNPACK_ERROR_RANGE;
-        return false;
-      }
-    }
-    else if (signedValue < min)
-    {
-      _LOG_UNPACK_ERROR_RANGE;
-      return false;
-    }
+  return true;
+}
 
-    if (valueIsSigned)
-    {
-      *(int32_t *)value = signedValue;
-    }
-    else
-    {
-      /* Convert to unsigned */
-      *(uint32_t *)value = (uint32_t)signedValue;
-    }
+bool BERGCloudMessageBase::unpack(char *pString, uint32_t maxSizeInBytes)
+{
+  /* Try to decode a null-terminated C string */
+  uint16_t sizeInBytes;
 
-    /* Success */
-    return true;
+  if (!unpack_raw_header(&sizeInBytes))
+  {
+    return false;
   }
 
-  /* Unsigned value decoded; check range */
-  if (unsignedValue > max)
+  if ((pString == NULL) || (maxSizeInBytes == 0))
   {
-    _LOG_UNPACK_ERROR_RANGE;
     return false;
   }
 
-  if (valueIsSigned)
+  if (!unpack_raw_data((uint8_t *)pString, sizeInBytes, maxSizeInBytes - 1)) /* -1 to allow space for null terminator */
   {
-    /* Convert to signed */
-    *(int32_t *)value = (int32_t)unsignedValue;
+    return false;
   }
-  else
+
+  /* Add null terminator, after any truncation */
+  if (sizeInBytes > (maxSizeInBytes - 1))
   {
-    *(uint32_t *)value = unsignedValue;
+    sizeInBytes = maxSizeInBytes - 1;
   }
 
+  pString[sizeInBytes] = '\0';
+
   /* Success */
   return true;
 }
 
-bool BERGCloudMessageBase::unpack_skip(void)
+bool BERGCloudMessageBase::unpack(uint8_t *pData, uint32_t maxSizeInBytes, uint32_t *pSizeInBytes)
 {
-  /* Skip next item */
-
-  uint8_t type;
-  uint32_t bytesToSkip = 0;
+  /* Try to decode a block of raw data */
+  uint16_t sizeInBytes;
 
-  /* Must be at least one byte of data */
-  if (!remaining(sizeof(uint8_t)))
+  if (!unpack_raw_header(&sizeInBytes))
   {
-    _LOG_UNPACK_ERROR_NO_DATA;
     return false;
   }
 
-  /* Read type */
-  type = read();
-
-  if ((type == _MP_UINT8) || (type == _MP_INT8))
-  {
-    bytesToSkip = 1;
-  }
-  else if ((type == _MP_UINT16) || (type == _MP_INT16))
-  {
-    bytesToSkip = 2;
-  }
-  else if ((type == _MP_UINT32) || (type == _MP_INT32) || (type == _MP_FLOAT))
-  {
-    bytesToSkip = 4;
-  }
-  else if ((type == _MP_UINT64) || (type == _MP_INT64) || (type == _MP_DOUBLE))
+  if (pSizeInBytes != NULL)
   {
-    bytesToSkip = 8;
+    *pSizeInBytes = sizeInBytes;
   }
-  else if ((type == _MP_ARRAY16) || (type == _MP_MAP16))
+
+  return unpack_raw_data(pData, sizeInBytes, maxSizeInBytes);
+}
+
+bool BERGCloudMessageBase::unpack_array_of(int16_t *data, uint16_t maxItems, uint16_t& items)
+{
+  return unpackArrayOf(data, maxItems, items, BC_EXT_INT16_ARRAY);
+}
+
+bool BERGCloudMessageBase::unpack_array_of(uint16_t *data, uint16_t maxItems, uint16_t& items)
+{
+  return unpackArrayOf(data, maxItems, items, BC_EXT_UINT16_ARRAY);
+}
+
+bool BERGCloudMessageBase::unpack_array_of(int32_t *data, uint16_t maxItems, uint16_t& items)
+{
+  return unpackArrayOf(data, maxItems, items, BC_EXT_INT32_ARRAY);
+}
+
+template <typename T>
+bool BERGCloudMessageBase::unpackArrayOf(T *data, uint16_t maxItems, uint16_t& items, uint8_t extType)
+{
+  /* The data is read in blocks into the stack and decoded from there, */
+  /* so chunked and program memory messages take the same path */
+  uint8_t block[ARRAY_BLOCK_SIZE_BYTES];
+  uint16_t start = bytesRead;
+  uint16_t sizeInBytes;
+  uint16_t end;
+  uint16_t n;
+  uint16_t i;
+  uint16_t left;
+  uint32_t value = 0;
+  uint8_t found;
+  uint8_t run;
+  uint8_t b;
+  uint8_t type;
+  bool delta;
+
+  if ((data == NULL) && (maxItems > 0))
   {
-    /* TODO: This could skip all of the array/map elements too. */
-    bytesToSkip = 2;
+    return false;
   }
-  else if ((type == _MP_ARRAY32) || (type == _MP_MAP32))
+
+  if (!peek(&type))
   {
-    /* TODO: This could skip all of the array/map elements too. */
-    bytesToSkip = 4;
+    return unpackError(UNPACK_ERROR_NO_DATA);
   }
-  else if (type == _MP_RAW16)
+
+  if (isArrayType(type))
   {
-    if (!remaining(sizeof(uint16_t)))
+    /* A MessagePack array, unpacked an item at a time */
+    if (!unpack_array(items))
     {
-      _LOG_UNPACK_ERROR_NO_DATA;
       return false;
     }
 
-    /* Read 16-bit unsigned integer, data size */
-    bytesToSkip = read();
-    bytesToSkip = bytesToSkip << 8;
-    bytesToSkip |= read();
-  }
-  else if (type == _MP_RAW32)
-  {
-    if (!remaining(sizeof(uint32_t)))
+    for (i = 0; i < items; i++)
     {
-      _LOG_UNPACK_ERROR_NO_DATA;
-      return false;
+      if (!((i < maxItems) ? unpack(data[i]) : unpack_skip()))
+      {
+        /* An item of another type; left unread, as for an extension */
+        bytesRead = start;
+        return false;
+      }
     }
 
-    /* read 32-bit unsigned integer, data size */
-    bytesToSkip = read();
-    bytesToSkip = bytesToSkip << 8;
-    bytesToSkip |= read();
-    bytesToSkip = bytesToSkip << 8;
-    bytesToSkip |= read();
-    bytesToSkip = bytesToSkip << 8;
-    bytesToSkip |= read();
-  }
-  else if (IN_RANGE(type, _MP_FIXRAW_MIN, _MP_FIXRAW_MAX))
-  {
-    bytesToSkip = type - _MP_FIXRAW_MIN;
+    return true;
   }
 
-  if (!remaining(bytesToSkip))
+  if (!unpackExtHeader(found, sizeInBytes))
   {
-    _LOG_UNPACK_ERROR_NO_DATA;
     return false;
   }
 
-  while (bytesToSkip-- > 0)
+  delta = (found == (uint8_t)(extType + 1));
+
+  if (((found != extType) && !delta) ||
+    (!delta && ((sizeInBytes % sizeof(T)) != 0)) ||
+    (delta && (sizeInBytes > 0) && (sizeInBytes < sizeof(T))))
   {
-    /* Discard data */
-    read();
+    /* Another extension, or an array of another type */
+    bytesRead = start;
+    return unpackError(UNPACK_ERROR_TYPE);
   }
 
-  /* Success */
-  return true;
-}
+  if (delta)
+  {
+    items = (sizeInBytes == 0) ? 0 : sizeInBytes - sizeof(T) + 1;
+  }
+  else
+  {
+    items = sizeInBytes / sizeof(T);
+  }
 
-bool BERGCloudMessageBase::unpack(uint8_t& n)
-{
-  uint32_t temp;
+  n = (items < maxItems) ? items : maxItems;
+  end = bytesRead + sizeInBytes;
+  i = 0;
 
-  if (!getInteger(&temp, false, 0, UINT8_MAX))
+  if (delta && (n > 0))
   {
-    return false;
+    /* The first value in full */
+    read(block, sizeof(T));
+    for (b = 0; b < sizeof(T); b++)
+    {
+      value = (value << 8) | block[b];
+    }
+    data[i++] = (T)value;
+  }
+
+  while (i < n)
+  {
+    left = n - i;
+
+    if (delta)
+    {
+      run = (left < sizeof(block)) ? left : sizeof(block);
+    }
+    else
+    {
+      run = (left < (sizeof(block) / sizeof(T))) ? left * sizeof(T) : sizeof(block);
+    }
+
+    read(block, run);
+
+    for (b = 0; b < run; )
+    {
+      if (delta)
+      {
+        value += (uint32_t)(int32_t)(int8_t)block[b++];
+      }
+      else
+      {
+        value = block[b++];
+        if (sizeof(T) > 1)
+        {
+          value = (value << 8) | block[b++];
+        }
+        if (sizeof(T) > 2)
+        {
+          value = (value << 8) | block[b++];
+          value = (value << 8) | block[b++];
+        }
+      }
+
+      data[i++] = (T)value;
+    }
   }
 
-  n = (uint8_t)temp;
+  /* Skip any that did not fit */
+  bytesRead = end;
   return true;
 }
 
-bool BERGCloudMessageBase::unpack(uint16_t& n)
+bool BERGCloudMessageBase::unpackExtHeader(uint8_t& extType, uint16_t& sizeInBytes)
 {
-  uint32_t temp;
+  /* Read the header of an extension type item */
+  uint32_t size;
+  uint8_t type;
 
-  if (!getInteger(&temp, false, 0, UINT16_MAX))
+  if (!peek(&type))
   {
-    return false;
+    return unpackError(UNPACK_ERROR_NO_DATA);
   }
 
-  n = (uint16_t)temp;
-  return true;
-}
+  if (IN_RANGE(type, _MP_FIXEXT1, _MP_FIXEXT16))
+  {
+    if (!remaining(1 + 1))
+    {
+      return unpackError(UNPACK_ERROR_NO_DATA);
+    }
 
-bool BERGCloudMessageBase::unpack(uint32_t& n)
-{
-  uint32_t temp;
+    read();
+    size = 1 << (type - _MP_FIXEXT1);
+  }
+  else if (type == _MP_EXT8)
+  {
+    if (!remaining(1 + sizeof(uint8_t) + 1))
+    {
+      return unpackError(UNPACK_ERROR_NO_DATA);
+    }
 
-  if (!getInteger(&temp, false, 0, UINT32_MAX))
+    read();
+    size = read();
+  }
+  else if (type == _MP_EXT16)
   {
-    return false;
+    if (!remaining(1 + sizeof(uint16_t) + 1))
+    {
+      return unpackError(UNPACK_ERROR_NO_DATA);
+    }
+
+    read();
+    size = readUint16();
   }
+  else if (type == _MP_EXT32)
+  {
+    if (!remaining(1 + sizeof(uint32_t) + 1))
+    {
+      return unpackError(UNPACK_ERROR_NO_DATA);
+    }
 
-  n = temp;
-  return true;
-}
+    read();
+    size = readUint32();
+  }
+  else
+  {
+    return unpackError(UNPACK_ERROR_TYPE);
+  }
 
-bool BERGCloudMessageBase::unpack(int8_t& n)
-{
-  int32_t temp;
+  extType = read();
 
-  if (!getInteger(&temp, true, INT8_MIN, INT8_MAX))
+  if (size > remaining())
   {
-    return false;
+    return unpackError(UNPACK_ERROR_NO_DATA);
   }
 
-  n = (int8_t)temp;
+  sizeInBytes = (uint16_t)size;
   return true;
 }
 
-bool BERGCloudMessageBase::unpack(int16_t& n)
+bool BERGCloudMessageBase::unpack_view(const uint8_t *&data, uint16_t& sizeInBytes)
 {
-  int32_t temp;
+  /* Point at a string or block of raw data in place */
+  uint16_t start = bytesRead;
+  uint16_t size;
+  uint16_t run;
+  uint8_t *p = NULL;
 
-  if (!getInteger(&temp, true, INT16_MIN, INT16_MAX))
+  if (!unpack_raw_header(&size))
   {
     return false;
   }
 
-  n = (uint16_t)temp;
-  return true;
-}
-
-bool BERGCloudMessageBase::unpack(int32_t& n)
-{
-  int32_t temp;
+  if (!remaining(size))
+  {
+    bytesRead = start;
+    return unpackError(UNPACK_ERROR_NO_DATA);
+  }
 
-  if (!getInteger(&temp, true, INT32_MIN, INT32_MAX))
+  if (!chunked())
+  {
+    p = &buffer[bytesRead];
+  }
+  else if ((size > 0) && (!segment(bytesRead, p, run) || (run < size)))
   {
+    _LOG("Unpack: Data is split across chunks.");
+    bytesRead = start;
     return false;
   }
 
-  n = temp;
+  data = p;
+  sizeInBytes = size;
+  bytesRead += size;
   return true;
 }
 
-bool BERGCloudMessageBase::unpack(float& n)
+bool BERGCloudMessageBase::unpack_schema(const BC_SCHEMA& schema, void *object)
 {
-  /* Try to decode the next messagePack item as an 4-byte float */
-  uint32_t data;
+  /* Fill in the members from one walk over the map. Keys are expected */
+  /* in schema order, as pack_schema() writes them, so each is compared */
+  /* in place with the next field first; keys in another order are */
+  /* searched for, and keys not in the schema are skipped with their */
+  /* values. A duplicated key is counted each time it is found. */
+  uint8_t *base = (uint8_t *)object;
+  BC_SCHEMA_FIELD field;
+  uint16_t items;
+  uint16_t keyLength;
+  uint16_t keyStart;
+  uint16_t j;
+  uint8_t next = 0;
+  uint8_t found = 0;
+  uint8_t i;
+  uint8_t n;
   uint8_t type;
+  bool matched;
+  bool ok;
 
-  /* Look at next type */
-  if (!peek(&type))
+  if (!unpack_map(items))
   {
-    _LOG_UNPACK_ERROR_NO_DATA;
     return false;
   }
 
-  if (type == _MP_FLOAT)
+  while (items-- > 0)
   {
-    if (!remaining(sizeof(float)))
+    if (!peek(&type))
     {
-      _LOG_UNPACK_ERROR_NO_DATA;
-      return false;
+      return unpackError(UNPACK_ERROR_NO_DATA);
     }
 
-    /* Read type */
-    read();
+    matched = false;
 
-    /* Read 32-bit float */
-    data = read();
-    data = data << 8;
-    data |= read();
-    data = data << 8;
-    data |= read();
-    data = data << 8;
-    data |= read();
+    if (!isRawType(type))
+    {
+      /* Not a string key; skip it */
+      if (!unpack_skip())
+      {
+        return false;
+      }
+    }
+    else
+    {
+      if (!unpack_raw_header(&keyLength))
+      {
+        return false;
+      }
 
-    /* Convert to float */
-    memcpy(&n, &data, sizeof(float));
+      if (!remaining(keyLength))
+      {
+        return unpackError(UNPACK_ERROR_NO_DATA);
+      }
 
-    /* Success */
-    return true;
-  }
+      keyStart = bytesRead;
+      i = next;
 
-  /* Can't convert this type */
-  _LOG_UNPACK_ERROR_TYPE;
-  return false;
-}
+      for (n = 0; !matched && (n < schema.count); n++)
+      {
+        getSchemaField(schema, i, field);
 
-bool BERGCloudMessageBase::unpack(bool& n)
-{
-  /* Try to decode the next messagePack item as boolean */
-  uint8_t type;
+        if (field.keyLength == keyLength)
+        {
+          bytesRead = keyStart;
+          j = 0;
 
-  /* Look at next type */
-  if (!peek(&type))
-  {
-    _LOG_UNPACK_ERROR_NO_DATA;
-    return false;
-  }
+          while ((j < keyLength) && (read() == (uint8_t)field.key[j]))
+          {
+            j++;
+          }
 
-  if ((type == _MP_BOOL_FALSE) || (type == _MP_BOOL_TRUE))
-  {
-    n = (read() == _MP_BOOL_TRUE);
+          matched = (j == keyLength);
+        }
 
-    /* Success */
-    return true;
-  }
+        if (!matched && (++i == schema.count))
+        {
+          i = 0;
+        }
+      }
 
-  /* Can't convert this type */
-  _LOG_UNPACK_ERROR_TYPE;
-  return false;
-}
+      bytesRead = keyStart + keyLength;
+    }
 
-bool BERGCloudMessageBase::unpack_nil(void)
-{
-  /* Try to decode the next messagePack item as nil */
-  uint8_t type;
+    if (!matched)
+    {
+      /* Skip this value */
+      if (!unpack_skip())
+      {
+        return false;
+      }
 
-  /* Look at next type */
-  if (!peek(&type))
-  {
-    _LOG_UNPACK_ERROR_NO_DATA;
-    return false;
-  }
+      continue;
+    }
 
-  if (type == _MP_NIL)
-  {
-    /* Read type */
-    read();
+    switch (field.type)
+    {
+    case BC_SCHEMA_UINT8:
+      ok = unpack(*(uint8_t *)&base[field.offset]);
+      break;
+    case BC_SCHEMA_UINT16:
+      ok = unpack(*(uint16_t *)&base[field.offset]);
+      break;
+    case BC_SCHEMA_UINT32:
+      ok = unpack(*(uint32_t *)&base[field.offset]);
+      break;
+    case BC_SCHEMA_INT8:
+      ok = unpack(*(int8_t *)&base[field.offset]);
+      break;
+    case BC_SCHEMA_INT16:
+      ok = unpack(*(int16_t *)&base[field.offset]);
+      break;
+    case BC_SCHEMA_INT32:
+      ok = unpack(*(int32_t *)&base[field.offset]);
+      break;
+    case BC_SCHEMA_FLOAT:
+      ok = unpack(*(float *)&base[field.offset]);
+      break;
+    case BC_SCHEMA_BOOL:
+      ok = unpack(*(bool *)&base[field.offset]);
+      break;
+    case BC_SCHEMA_STRING:
+      ok = unpack((char *)&base[field.offset], field.size);
+      break;
+    default:
+      ok = unpack(&base[field.offset], field.size);
+      break;
+    }
 
-    /* Success */
-    return true;
+    if (!ok)
+    {
+      return false;
+    }
+
+    found++;
+    next = (i + 1 == schema.count) ? 0 : i + 1;
   }
 
-  /* Can't convert this type */
-  _LOG_UNPACK_ERROR_TYPE;
-  return false;
+  return found >= schema.count;
 }
 
-bool BERGCloudMessageBase::unpack_array(uint16_t& items)
+bool BERGCloudMessageBase::unpack_find(const char *key)
 {
-  /* Try to decode the next messagePack item as array */
-  uint8_t type;
+  /* Search for a string key in a map */
+#if BC_FIND_INDEXED
+  BC_FIND_INDEX *index;
+  uint16_t last_read;
+  uint16_t found;
+  uint16_t tag;
+  uint8_t i;
+  char keyString[MAX_MAP_KEY_STRING_LENGTH+1]; /* +1 for null terminator */
+#endif
 
-  /* Look at next type */
-  if (!peek(&type))
+  if (key == NULL)
   {
-    _LOG_UNPACK_ERROR_NO_DATA;
-    return false;
+     return false;
   }
 
-  if (IN_RANGE(type, _MP_FIXARRAY_MIN, _MP_FIXARRAY_MAX))
+  if (isPath(key))
   {
-    /* Read fix num value */
-    items = read() - _MP_FIXARRAY_MIN;
+    return findPath(key);
+  }
 
-    /* Success */
-    return true;
+  if (strlen(key) > MAX_MAP_KEY_STRING_LENGTH)
+  {
+    _LOG("Unpack: Key name too long.\r\n");
+    return false;
   }
 
-  if (type == _MP_ARRAY16)
+#if BC_FIND_INDEXED
+  index = getFindIndex();
+
+  if (index != NULL)
   {
-    if (!remaining(sizeof(uint16_t)))
+    last_read = bytesRead;
+    tag = keyHash(key);
+
+    for (i = 0; i < index->entries; i++)
     {
-      _LOG_UNPACK_ERROR_NO_DATA;
-      return false;
+      if (index->entry[i].tag == tag)
+      {
+        /* Check the key itself, in case another has the same hash */
+        bytesRead = index->entry[i].offset;
+        if (unpack(keyString, sizeof(keyString)) && strcompare(keyString, key))
+        {
+          /* Match found */
+          return true;
+        }
+      }
     }
 
-    /* Read type */
-    read();
-
-    /* Read 16-bit unsigned integer */
-    items = read();
-    items = items << 8;
-    items |= read();
+    bytesRead = last_read;
 
-    /* Success */
-    return true;
-  }
+    /* Once an index is incomplete, keys it has passed may be missing */
+    if (index->complete)
+    {
+      if (!index->walkedAll && extendFindIndex(tag, key, found))
+      {
+        /* Match found */
+        bytesRead = found;
+        return true;
+      }
 
-  if (type == _MP_ARRAY32)
-  {
-    /* Not yet supported */
-    _LOG_UNPACK_ERROR_TYPE;
-    return false;
+      if (!index->malformed)
+      {
+        /* Not found */
+        return false;
+      }
+    }
   }
+#endif
 
-  /* Can't convert this type */
-  _LOG_UNPACK_ERROR_TYPE;
-  return false;
+  /* Not indexed */
+  return scanForKey(key);
 }
 
-bool BERGCloudMessageBase::unpack_map(uint16_t& items)
+bool BERGCloudMessageBase::findPath(const char *path)
 {
-  /* Try to decode the next messagePack item as array */
-  uint8_t type;
+  /* Follow a path of map keys and array indexes from the top level, */
+  /* skipping everything that is not on it */
+  uint16_t last_read;
+  uint32_t index;
+  uint8_t n;
+  bool first = true;
+  bool found = true;
+  char key[MAX_MAP_KEY_STRING_LENGTH+1]; /* +1 for null terminator */
 
-  /* Look at next type */
-  if (!peek(&type))
+  /* Remember the current read position in the raw data */
+  last_read = bytesRead;
+
+  while (found && (*path != '\0'))
   {
-    _LOG_UNPACK_ERROR_NO_DATA;
-    return false;
-  }
+    if (*path == '[')
+    {
+      /* Array index, in brackets */
+      path++;
+      index = 0;
+      n = 0;
+
+      while ((*path >= '0') && (*path <= '9') && (index <= UINT16_MAX))
+      {
+        index = (index * 10) + (*path++ - '0');
+        n++;
+      }
+
+      if ((n == 0) || (index > UINT16_MAX) || (*path++ != ']'))
+      {
+        _LOG("Unpack: Invalid path.\r\n");
+        bytesRead = last_read;
+        return false;
+      }
+
+      found = first ? unpack_find((uint16_t)index) : findInArray((uint16_t)index);
+    }
+    else
+    {
+      /* Map key, after a '.' unless it is the first */
+      if (!first && (*path++ != '.'))
+      {
+        _LOG("Unpack: Invalid path.\r\n");
+        bytesRead = last_read;
+        return false;
+      }
 
-  if (IN_RANGE(type, _MP_FIXMAP_MIN, _MP_FIXMAP_MAX))
-  {
-    /* Read fix num value */
-    items = read() - _MP_FIXMAP_MIN;
+      n = 0;
 
-    /* Success */
-    return true;
-  }
+      while ((*path != '\0') && (*path != '.') && (*path != '['))
+      {
+        if (n == MAX_MAP_KEY_STRING_LENGTH)
+        {
+          _LOG("Unpack: Key name too long.\r\n");
+          bytesRead = last_read;
+          return false;
+        }
 
-  if (type == _MP_MAP16)
-  {
-    if (!remaining(sizeof(uint16_t)))
-    {
-      _LOG_UNPACK_ERROR_NO_DATA;
-      return false;
-    }
+        key[n++] = *path++;
+      }
 
-    /* Read type */
-    read();
+      if (n == 0)
+      {
+        _LOG("Unpack: Invalid path.\r\n");
+        bytesRead = last_read;
+        return false;
+      }
 
-    /* Read 16-bit unsigned integer */
-    items = read();
-    items = items << 8;
-    items |= read();
+      key[n] = '\0';
+      found = first ? unpack_find(key) : findInMap(key);
+    }
 
-    /* Success */
-    return true;
+    first = false;
   }
 
-  if (type == _MP_MAP32)
+  if (!found)
   {
-    /* Not yet supported */
-    _LOG_UNPACK_ERROR_TYPE;
-    return true;
+    /* Not found; return to last position */
+    bytesRead = last_read;
   }
 
-  /* Can't convert this type */
-  _LOG_UNPACK_ERROR_TYPE;
-  return false;
+  return found;
 }
 
-/* Separate header and data methods are provided for raw data*/
-/* so that Arduino strings may be unpacked without having to create */
-/* a temporary buffer first. */
-
-bool BERGCloudMessageBase::unpack_raw_header(uint16_t *sizeInBytes)
+bool BERGCloudMessageBase::findInMap(const char *key)
 {
+  /* Search the map at the current position for a string key */
+  uint16_t map_items;
   uint8_t type;
+  char keyString[MAX_MAP_KEY_STRING_LENGTH+1]; /* +1 for null terminator */
 
-  /* Look at next type */
-  if (!peek(&type))
+  if (!peek(&type) || !isMapType(type))
   {
-    _LOG_UNPACK_ERROR_NO_DATA;
+    /* Not a map */
     return false;
   }
 
-  if (IN_RANGE(type, _MP_FIXRAW_MIN, _MP_FIXRAW_MAX))
+  if (!unpack_map(map_items))
   {
-    /* Read fix raw value */
-    *sizeInBytes = read() - _MP_FIXRAW_MIN;
-
-    /* Success */
-    return true;
+    return false;
   }
 
-  if (type == _MP_RAW16)
+  /* Iterate through the key-value pairs */
+  while (map_items-- > 0)
   {
-    if (!remaining(sizeof(uint16_t)))
+    if (!peek(&type))
     {
-      _LOG_UNPACK_ERROR_NO_DATA;
       return false;
     }
 
-    /* Read type */
-    read();
-
-    /* Read 16-bit unsigned integer */
-    *sizeInBytes = read();
-    *sizeInBytes = *sizeInBytes << 8;
-    *sizeInBytes |= read();
-
-    /* Success */
-    return true;
-  }
+    if (isRawType(type))
+    {
+      if (!unpack(keyString, sizeof(keyString)))
+      {
+        return false;
+      }
 
-  if (type == _MP_RAW32)
-  {
-    if (!remaining(sizeof(uint32_t)))
+      if (strcompare(keyString, key))
+      {
+        /* Match found */
+        return true;
+      }
+    }
+    else if (!unpack_skip())
     {
-      _LOG_UNPACK_ERROR_NO_DATA;
+      /* Not a suitable string key, and can't be skipped */
       return false;
     }
 
-    /* Read type */
-    read();
-
-    /* read 32-bit unsigned integer */
-    *sizeInBytes = read();
-    *sizeInBytes = *sizeInBytes << 8;
-    *sizeInBytes |= read();
-    *sizeInBytes = *sizeInBytes << 8;
-    *sizeInBytes |= read();
-    *sizeInBytes = *sizeInBytes << 8;
-    *sizeInBytes |= read();
-
-    /* Success */
-    return true;
-  }
-
-  /* Can't convert this type */
-  _LOG_UNPACK_ERROR_TYPE;
-  return false;
-}
-
-bool BERGCloudMessageBase::unpack_raw_data(uint8_t *pData, uint16_t packedSizeInBytes, uint16_t bufferSizeInBytes)
-{
-  uint8_t data;
-
-  /* Unpack all bytes */
-  while (packedSizeInBytes-- > 0)
-  {
-    data = read();
-    
-    /* Only write up to the buffer size */
-    if (bufferSizeInBytes-- > 0)
+    /* Skip this value */
+    if (!unpack_skip())
     {
-      *pData++ = data;
+      return false;
     }
   }
 
-  return true;
+  return false;
 }
 
-bool BERGCloudMessageBase::unpack(char *pString, uint32_t maxSizeInBytes)
+bool BERGCloudMessageBase::findInArray(uint16_t i)
 {
-  /* Try to decode a null-terminated C string */
-  uint16_t sizeInBytes;
-
-  if (!unpack_raw_header(&sizeInBytes))
-  {
-    return false;
-  }
-
-  if (!remaining(sizeInBytes))
-  {
-    _LOG_UNPACK_ERROR_NO_DATA;
-    return false;
-  }
+  /* Move to index 'i' of the array at the current position */
+  uint16_t array_items;
+  uint8_t type;
 
-  if (!unpack_raw_data((uint8_t *)pString, sizeInBytes, maxSizeInBytes - 1)) /* -1 to allow space for null terminator */
+  if (i == 0)
   {
+    _LOG("Unpack: Array indexes start from 1.\r\n");
     return false;
   }
 
-  /* Add null terminator */
-  pString[sizeInBytes] = '\0';
-
-  /* Success */
-  return true;
-}
-
-bool BERGCloudMessageBase::unpack(uint8_t *pData, uint32_t maxSizeInBytes, uint32_t *pSizeInBytes)
-{
-  /* Try to decode a block of raw data */
-  uint16_t sizeInBytes;
-
-  if (!unpack_raw_header(&sizeInBytes))
+  if (!peek(&type) || !isArrayType(type))
   {
+    /* Not an array */
     return false;
   }
 
-  if (!remaining(sizeInBytes))
+  if (!unpack_array(array_items) || (i > array_items))
   {
-    _LOG_UNPACK_ERROR_NO_DATA;
     return false;
   }
 
-  if (pSizeInBytes != NULL)
+  /* Skip the items before it */
+  while (--i > 0)
   {
-    *pSizeInBytes = sizeInBytes;
+    if (!unpack_skip())
+    {
+      return false;
+    }
   }
 
-  return unpack_raw_data(pData, sizeInBytes, maxSizeInBytes);
+  /* Found it */
+  return true;
 }
 
-bool BERGCloudMessageBase::unpack_find(const char *key)
+bool BERGCloudMessageBase::scanForKey(const char *key)
 {
-  /* Search for a string key in a map; in this simple */
-  /* implementation maps cannot contain maps or arrays */
+  /* Search for a string key in the maps at the top level; */
+  /* values are skipped whole, so may be maps or arrays themselves */
   uint16_t last_read;
   uint16_t map_items;
   uint8_t type;
+  bool ok = true;
   char keyString[MAX_MAP_KEY_STRING_LENGTH+1]; /* +1 for null terminator */
 
-  if (key == NULL)
-  {
-     return false;
-  }
-
-  if (strlen(key) > MAX_MAP_KEY_STRING_LENGTH)
-  {
-    _LOG("Unpack: Key name too long.\r\n");
-    return false;
-  }
-
   /* Remember the current read position in the raw data */
   last_read = bytesRead;
 
   /* Start reading from the beginning of the data */
   restart();
 
-  while(peek(&type))
+  /* Stop at the end, or at data that can't be skipped */
+  while(ok && peek(&type))
   {
-    if (IN_RANGE(type, _MP_FIXMAP_MIN, _MP_FIXMAP_MAX) || (type == _MP_MAP16)) /* _MP_MAP32 not yet supported */
+    if (isMapType(type))
     {
       /* Map found, get number of items */
-      unpack_map(map_items);
+      ok = unpack_map(map_items);
 
       /* Iterate through the key-value pairs */
-      while (map_items-- > 0)
+      while (ok && (map_items-- > 0))
       {
         if (unpack(keyString, sizeof(keyString)))
         {
@@ -1306,24 +3188,21 @@ bool BERGCloudMessageBase::unpack_find(const char *key)
               /* Match found */
               return true;
           }
-          else
-          {
-              /* No match, skip this value */
-              unpack_skip();
-          }
         }
         else
         {
-          /* Not a suitable string key; skip this key and value */
-          unpack_skip();
-          unpack_skip();
+          /* Not a suitable string key; skip it */
+          ok = unpack_skip();
         }
+
+        /* Skip this value */
+        ok = ok && unpack_skip();
       }
     }
     else
     {
       /* Not a map */
-      unpack_skip();
+      ok = unpack_skip();
     }
   }
 
@@ -1334,12 +3213,66 @@ bool BERGCloudMessageBase::unpack_find(const char *key)
 
 bool BERGCloudMessageBase::unpack_find(uint16_t i)
 {
-  /* Search for an index in an array; in this simple */
-  /* implementation arrays cannot contain maps or arrays */
+  /* Search for an index in an array */
+#if BC_FIND_INDEXED
+  BC_FIND_INDEX *index;
+  uint16_t found;
+  uint8_t n;
+#endif
+
+  if (i == 0)
+  {
+    _LOG("Unpack: Array indexes start from 1.\r\n");
+    return false;
+  }
+
+#if BC_FIND_INDEXED
+  index = getFindIndex();
+
+  if (index != NULL)
+  {
+    for (n = 0; n < index->entries; n++)
+    {
+      if (index->entry[n].tag == i)
+      {
+        /* Found it */
+        bytesRead = index->entry[n].offset;
+        return true;
+      }
+    }
+
+    /* Once an index is incomplete, items it has passed may be missing */
+    if (index->complete && (i < FIND_INDEX_KEY_TAG))
+    {
+      if (!index->walkedAll && extendFindIndex(i, NULL, found))
+      {
+        /* Found it */
+        bytesRead = found;
+        return true;
+      }
+
+      if (!index->malformed)
+      {
+        /* Not found */
+        return false;
+      }
+    }
+  }
+#endif
+
+  /* Not indexed */
+  return scanForIndex(i);
+}
+
+bool BERGCloudMessageBase::scanForIndex(uint16_t i)
+{
+  /* Search for an index in the arrays at the top level; */
+  /* items are skipped whole, so may be maps or arrays themselves */
   uint16_t last_read;
   uint16_t array_items;
   uint16_t item;
   uint8_t type;
+  bool ok = true;
 
   /* Remember the current read position in the raw data */
   last_read = bytesRead;
@@ -1347,24 +3280,19 @@ bool BERGCloudMessageBase::unpack_find(uint16_t i)
   /* Start reading from the beginning of the data */
   restart();
 
-  while(peek(&type))
+  /* Stop at the end, or at data that can't be skipped */
+  while(ok && peek(&type))
   {
-    if (IN_RANGE(type, _MP_FIXARRAY_MIN, _MP_FIXARRAY_MAX) || (type == _MP_ARRAY16)) /* _MP_ARRAY32 not yet supported */
+    if (isArrayType(type))
     {
       /* Array found, get number of items */
-      unpack_array(array_items);
+      ok = unpack_array(array_items);
 
       /* Assume items are numbered starting from one */
       item = 1;
 
-      if (i == 0)
-      {
-        _LOG("Unpack: Array indexes start from 1.\r\n");
-        return false;
-      }
-
       /* Iterate through the values in the array */
-      while (array_items-- > 0)
+      while (ok && (array_items-- > 0))
       {
         if (item++ == i)
         {
@@ -1374,14 +3302,14 @@ bool BERGCloudMessageBase::unpack_find(uint16_t i)
         else
         {
           /* Skip this item */
-          unpack_skip();
+          ok = unpack_skip();
         }
       }
     }
     else
     {
       /* Not an array */
-      unpack_skip();
+      ok = unpack_skip();
     }
   }
 
@@ -1389,3 +3317,181 @@ bool BERGCloudMessageBase::unpack_find(uint16_t i)
   bytesRead = last_read;
   return false;
 }
+
+#if BC_FIND_INDEXED
+bool BERGCloudMessageBase::getFindIndexPoolStats(BC_POOL_STATS& stats)
+{
+  findIndexPool.getStats(stats);
+  return true;
+}
+
+BC_FIND_INDEX *BERGCloudMessageBase::getFindIndex(void)
+{
+  /* Get the index, starting it again if the data has changed */
+  if ((findIndex != NULL) && findIndexValid && (findIndex->size == bytesWritten))
+  {
+    return findIndex;
+  }
+
+  if (findIndex == NULL)
+  {
+    findIndex = (BC_FIND_INDEX *)findIndexPool.acquire(sizeof(BC_FIND_INDEX));
+    if (findIndex == NULL)
+    {
+      /* None free; the caller rescans */
+      return NULL;
+    }
+  }
+
+  findIndex->size = bytesWritten;
+  findIndex->walked = 0;
+  findIndex->mapSlots = 0;
+  findIndex->arrayItems = 0;
+  findIndex->arrayIndex = 0;
+  findIndex->items = 0;
+  findIndex->entries = 0;
+  findIndex->complete = true;
+  findIndex->walkedAll = false;
+  findIndex->malformed = false;
+
+  findIndexValid = true;
+  return findIndex;
+}
+
+void BERGCloudMessageBase::releaseFindIndex(void)
+{
+  findIndexPool.release((uint8_t *)findIndex);
+  findIndex = NULL;
+}
+
+bool BERGCloudMessageBase::extendFindIndex(uint16_t tag, const char *key, uint16_t& found)
+{
+  /* Index more of the message, stopping after the map key 'key' or */
+  /* array index 'tag' if it is found; 'found' is then the offset of */
+  /* its value. As for scanForKey() and scanForIndex(), only keys in */
+  /* maps and items in arrays at the top level are indexed. */
+  BC_FIND_INDEX *index = findIndex;
+  uint16_t last_read;
+  uint16_t pairs;
+  uint16_t offset;
+  uint16_t skipped;
+  uint8_t type;
+  bool inMap;
+  bool inArray;
+  bool isKey;
+  bool consumed;
+  bool match = false;
+  char keyString[MAX_MAP_KEY_STRING_LENGTH+1]; /* +1 for null terminator */
+
+  /* Remember the current read position in the raw data */
+  last_read = bytesRead;
+
+  /* Carry on from where the index reached */
+  bytesRead = index->walked;
+
+  while (!match && peek(&type))
+  {
+    offset = bytesRead;
+    inMap = (index->mapSlots > 0);
+    inArray = (index->arrayItems > 0);
+    isKey = false;
+
+    if (inMap)
+    {
+      /* Keys are in the even slots, counting down */
+      isKey = ((index->mapSlots-- & 1) == 0) && isRawType(type);
+    }
+
+    if (inArray)
+    {
+      index->arrayItems--;
+
+      if (index->arrayIndex < FIND_INDEX_KEY_TAG)
+      {
+        addFindIndexEntry(index->arrayIndex, offset);
+      }
+      else
+      {
+        /* Too large to tell from a key hash */
+        index->complete = false;
+      }
+
+      if ((key == NULL) && (index->arrayIndex == tag))
+      {
+        match = true;
+        found = offset;
+      }
+
+      index->arrayIndex++;
+    }
+
+    /* Count items as count() would */
+    skipped = 1;
+
+    if (isKey)
+    {
+      consumed = unpack(keyString, sizeof(keyString));
+      if (consumed)
+      {
+        addFindIndexEntry(keyHash(keyString), offset);
+
+        if ((key != NULL) && strcompare(keyString, key))
+        {
+          match = true;
+          found = bytesRead;
+        }
+      }
+    }
+    else if (!inMap && !inArray && isMapType(type))
+    {
+      /* Map found, get number of items */
+      consumed = unpack_map(pairs);
+      index->mapSlots = (uint32_t)pairs * 2;
+    }
+    else if (!inMap && !inArray && isArrayType(type))
+    {
+      /* Array found, get number of items */
+      consumed = unpack_array(index->arrayItems);
+      index->arrayIndex = 1;
+    }
+    else
+    {
+      /* Skip this item and anything nested in it */
+      consumed = skipNested(&skipped);
+    }
+
+    if (!consumed)
+    {
+      /* Leave the rest to a scan */
+      index->complete = false;
+      index->malformed = true;
+      match = false;
+      break;
+    }
+
+    index->items += skipped;
+  }
+
+  index->walked = bytesRead;
+  index->walkedAll = !match;
+
+  /* Return to the last position */
+  bytesRead = last_read;
+
+  return match;
+}
+
+void BERGCloudMessageBase::addFindIndexEntry(uint16_t tag, uint16_t offset)
+{
+  if (findIndex->entries == BC_FIND_INDEX_ENTRIES)
+  {
+    /* No space; lookups of anything not indexed will scan */
+    findIndex->complete = false;
+    return;
+  }
+
+  findIndex->entry[findIndex->entries].tag = tag;
+  findIndex->entry[findIndex->entries].offset = offset;
+  findIndex->entries++;
+}
+#endif
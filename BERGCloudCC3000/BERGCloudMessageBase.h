@@ -31,6 +31,7 @@ THE SOFTWARE.
 
 #include "BERGCloudConfig.h"
 #include "BERGCloudMessageBuffer.h"
+#include "BERGCloudBlockPool.h"
 #include "BERGCloudLogPrint.h"
 
 #define _LOG_PACK_ERROR_NO_SPACE    _LOG("Pack: Out of space.")
@@ -40,19 +41,81 @@ THE SOFTWARE.
 
 #define IN_RANGE(value, min, max) ((value >= min) && (value <= max))
 
+/* Convert the bits of an 8-byte double to the nearest float */
+float bcDoubleToFloat(uint32_t high, uint32_t low);
+
 #define MAX_MAP_KEY_STRING_LENGTH (16)
 
+#include "BERGCloudSchema.h"
+
+/* MessagePack extension types used by pack_array_of(); each holds the */
+/* values big-endian, or the first value then an 8-bit change to each */
+/* of the rest for the delta form */
+#define BC_EXT_INT16_ARRAY        0x10
+#define BC_EXT_INT16_DELTA_ARRAY  0x11
+#define BC_EXT_UINT16_ARRAY       0x12
+#define BC_EXT_UINT16_DELTA_ARRAY 0x13
+#define BC_EXT_INT32_ARRAY        0x14
+#define BC_EXT_INT32_DELTA_ARRAY  0x15
+
+#if (BC_FIND_INDEX_ENTRIES > 255)
+#error "BC_FIND_INDEX_ENTRIES must be no more than 255"
+#endif
+
+#if (BC_FIND_INDEX_POOL_INDEXES > 255)
+#error "BC_FIND_INDEX_POOL_INDEXES must be no more than 255"
+#endif
+
+/* Searches are indexed only with indexes and entries to hold */
+#if (BC_FIND_INDEX_POOL_INDEXES > 0) && (BC_FIND_INDEX_ENTRIES > 0)
+#define BC_FIND_INDEXED 1
+#else
+#define BC_FIND_INDEXED 0
+#endif
+
+#if BC_FIND_INDEXED
+typedef struct {
+  uint16_t tag;    /* Map key hash with the top bit set, or array index */
+  uint16_t offset; /* Offset of the key, or of the array item */
+} BC_FIND_INDEX_ENTRY;
+
+/* The index is extended by each lookup only as far as it needs to go */
+typedef struct {
+  uint16_t size;       /* Bytes of data when the index was started */
+  uint16_t walked;     /* Offset the index has reached */
+  uint32_t mapSlots;   /* Keys and values left in the current map */
+  uint16_t arrayItems; /* Items left in the current array */
+  uint16_t arrayIndex; /* Index of the next array item */
+  uint16_t items;      /* Items so far, as counted by count() */
+  uint8_t entries;     /* Entries used */
+  bool complete;       /* Every key and array item so far has an entry */
+  bool walkedAll;      /* Reached the end of the data */
+  bool malformed;      /* Stopped at data that could not be skipped */
+  BC_FIND_INDEX_ENTRY entry[BC_FIND_INDEX_ENTRIES];
+} BC_FIND_INDEX;
+#endif
+
 class BERGCloudMessageBase : public BERGCloudMessageBuffer
 {
 public:
   BERGCloudMessageBase(void);
-  BERGCloudMessageBase(uint16_t size);
+  BERGCloudMessageBase(uint16_t size, uint16_t headroom = 0);
+  BERGCloudMessageBase(const BERGCloudMessageBase& parent);
+  BERGCloudMessageBase& operator=(const BERGCloudMessageBase& other);
   ~BERGCloudMessageBase(void);
 
+  /* Empty the message, returning any find index */
+  void clear(void);
+
   /*
    *  Pack methods
    */
 
+  /* Pack integers in the fewest bytes that hold their value, rather */
+  /* than at the width of their type; the default is set by */
+  /* BC_PACK_SMALLEST_INTEGERS */
+  void pack_smallest(bool smallest = true);
+
   /* Pack an unsigned integer */
   bool pack(uint8_t n);
   bool pack(uint16_t n);
@@ -61,8 +124,13 @@ public:
   bool pack(int8_t n);
   bool pack(int16_t n);
   bool pack(int32_t n);
+  /* Pack a 64-bit integer */
+  bool pack(uint64_t n);
+  bool pack(int64_t n);
   /* Pack a float */
   bool pack(float n);
+  /* Pack a double; as a float where double is the same size */
+  bool pack(double n);
   /* Pack a boolean */
   bool pack(bool n);
 
@@ -73,10 +141,30 @@ public:
   /* Pack a map header, giving the number of key-value pairs that will follow */
   bool pack_map(uint16_t items);
 
+  /* Begin an array or map without giving the number of items; it is */
+  /* filled in by the matching end method once they have been packed. */
+  /* These may be nested, and each must be ended before the message is used. */
+  bool begin_array(void);
+  bool end_array(void);
+  bool begin_map(void);
+  bool end_map(void);
+
   /* Pack an array of data */
   bool pack(uint8_t *data, uint16_t sizeInBytes);
+  /* Pack an array of data as binary rather than raw data; */
+  /* readers of the current MessagePack spec take raw to be a string */
+  bool pack_bin(uint8_t *data, uint16_t sizeInBytes);
   /* Pack a null-terminated C string */
   bool pack(const char *string);
+  /* Pack an array of numbers as a single extension type item rather */
+  /* than an item for each; with 'delta', if every number differs from */
+  /* the one before by -128 to 127, each after the first takes one byte */
+  bool pack_array_of(const int16_t *data, uint16_t items, bool delta = false);
+  bool pack_array_of(const uint16_t *data, uint16_t items, bool delta = false);
+  bool pack_array_of(const int32_t *data, uint16_t items, bool delta = false);
+  /* Pack the members of 'object' listed in 'schema' as a map; */
+  /* see BERGCloudSchema.h */
+  bool pack_schema(const BC_SCHEMA& schema, const void *object);
 
   /*
    *  Unpack methods
@@ -90,8 +178,13 @@ public:
   bool unpack(int8_t& n);
   bool unpack(int16_t& n);
   bool unpack(int32_t& n);
-  /* Unpack a float */
+  /* Unpack a 64-bit integer */
+  bool unpack(uint64_t& n);
+  bool unpack(int64_t& n);
+  /* Unpack a float, or a double converted to the nearest float */
   bool unpack(float& n);
+  /* Unpack a double or a float */
+  bool unpack(double& n);
   /* Unpack a boolean */
   bool unpack(bool& n);
 
@@ -117,32 +210,93 @@ public:
   void print_bytes(void);
 #endif
 
-  /* Skip the next item */
+  /* Skip the next item, and everything in it if it is a map or array */
   bool unpack_skip(void);
-  /* Restart unpacking from the beginning */
+  /* Restart unpacking from the beginning, returning any find index */
   bool unpack_restart();
-  /* Moves to the value associated with the map key 'key' */
+  /* Moves to the value associated with the map key 'key'. 'key' may */
+  /* instead be a path through nested maps and arrays: keys separated */
+  /* by '.', and array indexes in brackets. Indexes start from 1, so */
+  /* "config.limits[2]" is the second item of the array "limits". */
   bool unpack_find(const char *key);
-  /* Moves to the value associated with array index 'i' */
+  /* Moves to the value associated with array index 'i'; indexes */
+  /* start from 1 */
   bool unpack_find(uint16_t i);
   
-  /* Get the total number of items */
+  /* Get the total number of items, including those in maps and arrays */
   uint16_t count(void);
+#if BC_FIND_INDEXED
+  /* Get the statistics of the pool of indexes shared by every message */
+  static bool getFindIndexPoolStats(BC_POOL_STATS& stats);
+#endif
 
-  /* Unpack a null-terminated C string */
+  /* Unpack a null-terminated C string; strings and binary data are */
+  /* both accepted by this and the method below */
   bool unpack(char *string, uint32_t maxSizeInBytes);
   /* Unpack an array of data */
   bool unpack(uint8_t *data, uint32_t maxSizeInBytes, uint32_t *sizeInBytes = NULL);
+  /* Unpack an array of numbers packed by pack_array_of(), or as a */
+  /* MessagePack array; 'items' gives the number in the message, of */
+  /* which up to 'maxItems' are unpacked */
+  bool unpack_array_of(int16_t *data, uint16_t maxItems, uint16_t& items);
+  bool unpack_array_of(uint16_t *data, uint16_t maxItems, uint16_t& items);
+  bool unpack_array_of(int32_t *data, uint16_t maxItems, uint16_t& items);
+  /* Get a string or array of data in place rather than copying it: */
+  /* 'data' points into the message, which must outlive its use, and is */
+  /* not null-terminated, and in a view of program memory it is a program */
+  /* memory address. In a chunked message data split across chunks */
+  /* can't be viewed; false is returned without moving on, so that it */
+  /* can be copied out by the methods above instead. */
+  bool unpack_view(const uint8_t *&data, uint16_t& sizeInBytes);
+  /* Unpack a map into the members of 'object' listed in 'schema'; */
+  /* returns false unless every member was found */
+  bool unpack_schema(const BC_SCHEMA& schema, void *object);
 
 protected:
+  BERGCloudMessageBase(uint8_t *storage, uint16_t size, uint16_t headroom = 0);
+#if BC_CHUNKED_MESSAGES
+  BERGCloudMessageBase(BERGCloudBlockPool& pool);
+#endif
   /* Internal methods */
   uint16_t strlen(const char *string);
   bool strcompare(const char *s1, const char *s2);
   bool pack_raw_header(uint16_t sizeInBytes);
   bool pack_raw_data(uint8_t *data, uint16_t sizeInBytes);
+  bool pack_bin_header(uint16_t sizeInBytes);
+  void addRawHeader(uint16_t sizeInBytes);
+  void addBinHeader(uint16_t sizeInBytes);
+  void addUnsigned(uint32_t n, uint8_t size);
+  void addSigned(int32_t n, uint8_t size);
+  void addExtHeader(uint8_t extType, uint16_t sizeInBytes);
+  bool unpackExtHeader(uint8_t& extType, uint16_t& sizeInBytes);
+  template <typename T> bool packArrayOf(const T *data, uint16_t items, bool delta, uint8_t extType);
+  template <typename T> bool unpackArrayOf(T *data, uint16_t maxItems, uint16_t& items, uint8_t extType);
+  bool beginContainer(uint8_t type);
+  bool endContainer(uint8_t type);
+  void addUint64(uint32_t high, uint32_t low);
   bool unpack_raw_header(uint16_t *sizeInBytes);
   bool unpack_raw_data(uint8_t *data, uint16_t packedSizeInBytes, uint16_t bufferSizeInBytes);
-  bool getInteger(void *value, bool valueIsSigned, int32_t min, uint32_t max);
+  uint16_t readUint16(void);
+  uint32_t readUint32(void);
+  template <typename T> bool unpackInteger(T& n);
+  bool unpackError(uint8_t error);
+  bool unpackCount(uint8_t type, uint16_t& items);
+  bool packSmallest;
+  bool skipItem(uint32_t& contents);
+  bool skipNested(uint16_t *skipped);
+  bool findPath(const char *path);
+  bool findInMap(const char *key);
+  bool findInArray(uint16_t i);
+  bool scanForKey(const char *key);
+  bool scanForIndex(uint16_t i);
+  uint16_t scanCount(void);
+#if BC_FIND_INDEXED
+  BC_FIND_INDEX *getFindIndex(void);
+  void releaseFindIndex(void);
+  bool extendFindIndex(uint16_t tag, const char *key, uint16_t& found);
+  void addFindIndexEntry(uint16_t tag, uint16_t offset);
+  BC_FIND_INDEX *findIndex; /* From the pool on first use; see BC_FIND_INDEX_ENTRIES */
+#endif
 };
 
 #endif // #ifndef BERGCLOUDMESSAGEBASE_H
@@ -25,51 +25,434 @@ THE SOFTWARE.
 */
 
 #include "BERGCloudMessageBuffer.h"
-#include "string.h" // For memcpy()
+#include "BERGCloudBlockPool.h"
+#include "string.h" // For memcpy() and memmove()
 
-BERGCloudMessageBuffer::BERGCloudMessageBuffer(uint16_t size)
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#endif
+
+#if BC_CHUNKED_MESSAGES
+/* Each chunk starts with a pointer to the next; memcpy() is used to */
+/* access it as the chunk may not be aligned */
+#define CHUNK_LINK_SIZE_BYTES (sizeof(uint8_t *))
+
+static uint8_t *nextChunk(uint8_t *chunk)
+{
+  uint8_t *next;
+  memcpy(&next, chunk, sizeof(next));
+  return next;
+}
+
+static void linkChunk(uint8_t *chunk, uint8_t *next)
+{
+  memcpy(chunk, &next, sizeof(next));
+}
+#endif
+
+BERGCloudMessageBuffer::BERGCloudMessageBuffer(uint16_t size, uint16_t headroom)
 {
   bufferSize = size;
-  buffer = new uint8_t[bufferSize];
+  headroomSize = headroom;
+  buffer = new uint8_t[headroomSize + bufferSize];
+  ownsBuffer = true;
+  inProgmem = false;
+  findIndexValid = false;
+  blockPool = 0;
+  block = 0;
+#if BC_CHUNKED_MESSAGES
+  chunkPool = 0;
+  firstChunk = 0;
+#endif
   
   if (buffer == 0)
   {
     bufferSize = 0;
+    headroomSize = 0;
+  }
+  else
+  {
+    /* Data follows the headroom */
+    buffer += headroomSize;
   }
   
   clear();
 }
 
+BERGCloudMessageBuffer::BERGCloudMessageBuffer(uint8_t *storage, uint16_t size, uint16_t headroom)
+{
+  bufferSize = size;
+  headroomSize = headroom;
+  buffer = storage + headroomSize;
+  ownsBuffer = false;
+  inProgmem = false;
+  findIndexValid = false;
+  blockPool = 0;
+  block = 0;
+#if BC_CHUNKED_MESSAGES
+  chunkPool = 0;
+  firstChunk = 0;
+#endif
+
+  clear();
+}
+
+#if BC_CHUNKED_MESSAGES
+BERGCloudMessageBuffer::BERGCloudMessageBuffer(BERGCloudBlockPool& pool)
+{
+  /* No chunks until data is written */
+  bufferSize = 0;
+  headroomSize = 0;
+  buffer = 0;
+  ownsBuffer = false;
+  inProgmem = false;
+  findIndexValid = false;
+  blockPool = 0;
+  block = 0;
+  chunkPool = &pool;
+  chunkDataSize = pool.blockSize() - CHUNK_LINK_SIZE_BYTES;
+  firstChunk = 0;
+
+  clear();
+}
+#endif
+
 BERGCloudMessageBuffer::BERGCloudMessageBuffer(const BERGCloudMessageBuffer& parent)
 {
-  bufferSize = parent.bufferSize;
-  bytesWritten = parent.bytesWritten;
-  bytesRead = parent.bytesRead;
+  buffer = 0;
+  bufferSize = 0;
+  headroomSize = 0;
+  ownsBuffer = false;
+  blockPool = 0;
+  block = 0;
+#if BC_CHUNKED_MESSAGES
+  chunkPool = 0;
+  firstChunk = 0;
+#endif
+
+  copyData(parent);
+}
+
+BERGCloudMessageBuffer& BERGCloudMessageBuffer::operator=(const BERGCloudMessageBuffer& other)
+{
+  if (this != &other)
+  {
+    /* Return any block or chunks, then copy as above */
+    releaseStorage();
+    copyData(other);
+  }
+
+  return *this;
+}
+
+BERGCloudMessageBuffer::~BERGCloudMessageBuffer(void)
+{
+  releaseStorage();
+}
+
+void BERGCloudMessageBuffer::releaseStorage(void)
+{
+  /* Free or return to its pool whatever holds the data */
+  releaseBlock();
+#if BC_CHUNKED_MESSAGES
+  releaseChunks();
+  chunkPool = 0;
+#endif
+
+  if ((buffer != 0) && ownsBuffer)
+  {
+    delete [] (buffer - headroomSize);
+  }
+
+  buffer = 0;
+  bufferSize = 0;
+  headroomSize = 0;
+  ownsBuffer = false;
+}
+
+void BERGCloudMessageBuffer::copyData(const BERGCloudMessageBuffer& other)
+{
+  /* Copy the data into a new buffer in RAM, with no headroom; chunks */
+  /* are joined. The buffer is expected to be empty. */
+  inProgmem = false;
+  clear();
+
+  buffer = new uint8_t[other.bufferSize];
+  ownsBuffer = true;
 
-  /* Create a new buffer */
-  buffer = new uint8_t[bufferSize];
-  
   if (buffer == 0)
   {
-    bufferSize = 0;
+    /* Leave it empty */
+    ownsBuffer = false;
+    return;
   }
-  
+
+  bufferSize = other.bufferSize;
+  bytesWritten = other.bytesWritten;
+  bytesRead = other.bytesRead;
+  openContainer = other.openContainer;
+
+#if BC_CHUNKED_MESSAGES
+  if (other.chunkPool != 0)
+  {
+    /* Join the chunks */
+    uint8_t *chunk = other.firstChunk;
+    uint16_t offset = 0;
+    uint16_t size;
+
+    while (offset < bytesWritten)
+    {
+      size = bytesWritten - offset;
+      if (size > other.chunkDataSize)
+      {
+        size = other.chunkDataSize;
+      }
+
+      memcpy(&buffer[offset], chunk + CHUNK_LINK_SIZE_BYTES, size);
+      offset += size;
+      chunk = nextChunk(chunk);
+    }
+    return;
+  }
+#endif
+
+#ifdef __AVR__
+  if (other.inProgmem)
+  {
+    /* Copy out of program memory */
+    memcpy_P(buffer, other.buffer, bytesWritten);
+    return;
+  }
+#endif
+
   /* Copy buffer contents */
-  memcpy(buffer, parent.buffer, bufferSize);
+  memcpy(buffer, other.buffer, bytesWritten);
 }
 
-BERGCloudMessageBuffer::~BERGCloudMessageBuffer(void)
+void BERGCloudMessageBuffer::adoptBlock(BERGCloudBlockPool *pool, uint8_t *data, uint16_t offset, uint16_t size)
+{
+  /* Replace any storage with the block */
+  releaseStorage();
+
+  blockPool = pool;
+  block = data;
+  ownsBuffer = false;
+  inProgmem = false;
+  findIndexValid = false;
+  openContainer = BC_NO_OPEN_CONTAINER;
+
+  /* The block's header in front of the data is no longer needed */
+  buffer = data + offset;
+  bufferSize = size;
+  headroomSize = offset;
+  bytesWritten = size;
+  bytesRead = 0;
+}
+
+void BERGCloudMessageBuffer::releaseBlock(void)
+{
+  if (blockPool == 0)
+  {
+    return;
+  }
+
+  blockPool->release(block);
+  inProgmem = false;
+  blockPool = 0;
+  block = 0;
+
+  buffer = 0;
+  bufferSize = 0;
+  headroomSize = 0;
+  clear();
+}
+
+#if BC_CHUNKED_MESSAGES
+bool BERGCloudMessageBuffer::growChunks(uint16_t required)
+{
+  /* Add chunks from the pool until 'required' more bytes will fit */
+  uint8_t *last = firstChunk;
+  uint8_t *chunk;
+
+  if (last != 0)
+  {
+    while (nextChunk(last) != 0)
+    {
+      last = nextChunk(last);
+    }
+  }
+
+  while ((bufferSize - bytesWritten) < required)
+  {
+    if (bufferSize > (UINT16_MAX - chunkDataSize))
+    {
+      return false;
+    }
+
+    chunk = chunkPool->acquire(chunkDataSize + CHUNK_LINK_SIZE_BYTES);
+    if (chunk == 0)
+    {
+      return false;
+    }
+
+    linkChunk(chunk, 0);
+
+    if (last == 0)
+    {
+      firstChunk = chunk;
+      buffer = chunk + CHUNK_LINK_SIZE_BYTES;
+    }
+    else
+    {
+      linkChunk(last, chunk);
+    }
+
+    last = chunk;
+    bufferSize += chunkDataSize;
+  }
+
+  return true;
+}
+
+void BERGCloudMessageBuffer::releaseChunks(void)
 {
-  if (buffer != 0)
+  uint8_t *chunk = firstChunk;
+  uint8_t *next;
+
+  while (chunk != 0)
   {
-    delete buffer;
+    next = nextChunk(chunk);
+    chunkPool->release(chunk);
+    chunk = next;
+  }
+
+  firstChunk = 0;
+  writeChunk = 0;
+  writeChunkStart = 0;
+  readChunk = 0;
+  readChunkStart = 0;
+
+  if (chunkPool != 0)
+  {
+    buffer = 0;
+    bufferSize = 0;
   }
 }
 
+uint8_t *BERGCloudMessageBuffer::seekChunk(uint16_t offset, uint8_t *&chunk, uint16_t& chunkStart)
+{
+  /* Find the chunk holding 'offset', moving on from 'chunk' where possible */
+  if ((chunk == 0) || (offset < chunkStart))
+  {
+    chunk = firstChunk;
+    chunkStart = 0;
+  }
+
+  while ((offset - chunkStart) >= chunkDataSize)
+  {
+    chunk = nextChunk(chunk);
+    chunkStart += chunkDataSize;
+  }
+
+  return chunk + CHUNK_LINK_SIZE_BYTES + (offset - chunkStart);
+}
+
+void BERGCloudMessageBuffer::writeChunks(const uint8_t *data, uint16_t size)
+{
+  /* Fill each chunk in turn; no checks */
+  uint8_t *dst;
+  uint16_t run;
+
+  while (size > 0)
+  {
+    dst = seekChunk(bytesWritten, writeChunk, writeChunkStart);
+    run = chunkDataSize - (bytesWritten - writeChunkStart);
+    if (run > size)
+    {
+      run = size;
+    }
+
+    memcpy(dst, data, run);
+    data += run;
+    size -= run;
+    bytesWritten += run;
+  }
+}
+
+void BERGCloudMessageBuffer::readChunks(uint8_t *data, uint16_t size)
+{
+  /* Empty each chunk in turn; no checks */
+  uint8_t *src;
+  uint16_t run;
+
+  while (size > 0)
+  {
+    src = seekChunk(bytesRead, readChunk, readChunkStart);
+    run = chunkDataSize - (bytesRead - readChunkStart);
+    if (run > size)
+    {
+      run = size;
+    }
+
+    memcpy(data, src, run);
+    data += run;
+    size -= run;
+    bytesRead += run;
+  }
+}
+#endif
+
+uint8_t *BERGCloudMessageBuffer::dataAt(uint16_t offset)
+{
+  /* Get the byte at 'offset' to read or rewrite in place; no checks */
+#if BC_CHUNKED_MESSAGES
+  if (chunkPool != 0)
+  {
+    return seekChunk(offset, readChunk, readChunkStart);
+  }
+#endif
+
+  return &buffer[offset];
+}
+
+void BERGCloudMessageBuffer::erase(uint16_t offset, uint16_t size)
+{
+  /* Remove 'size' bytes at 'offset', moving the data after them down */
+#if BC_CHUNKED_MESSAGES
+  uint16_t i;
+
+  if (chunkPool != 0)
+  {
+    /* Both positions only move forwards, so each chunk is found once */
+    for (i = offset; i < (bytesWritten - size); i++)
+    {
+      *seekChunk(i, writeChunk, writeChunkStart) = *seekChunk(i + size, readChunk, readChunkStart);
+    }
+  }
+  else
+#endif
+  {
+    memmove(&buffer[offset], &buffer[offset + size], bytesWritten - offset - size);
+  }
+
+  bytesWritten -= size;
+  findIndexValid = false;
+}
+
 void BERGCloudMessageBuffer::clear(void)
 {
   bytesWritten = 0; /* Number of bytes written */
   bytesRead = 0;    /* Number of bytes read */
+  findIndexValid = false;
+  openContainer = BC_NO_OPEN_CONTAINER;
+
+#if BC_CHUNKED_MESSAGES
+  if (chunkPool != 0)
+  {
+    /* Return the chunks to the pool */
+    releaseChunks();
+  }
+#endif
 }
 
 void BERGCloudMessageBuffer::restart(void)
@@ -84,6 +467,12 @@ uint16_t BERGCloudMessageBuffer::size(void)
   return bufferSize;
 }
 
+uint16_t BERGCloudMessageBuffer::headroom(void)
+{
+  /* Get space reserved in front of the data */
+  return headroomSize;
+}
+
 uint16_t BERGCloudMessageBuffer::used(void)
 {
   /* Get number of bytes used in the buffer */
@@ -94,24 +483,78 @@ void BERGCloudMessageBuffer::used(uint16_t used)
 {
   /* Set number of bytes used in the buffer */
   bytesWritten = used;
+  findIndexValid = false;
+  openContainer = BC_NO_OPEN_CONTAINER;
 }
 
 uint16_t BERGCloudMessageBuffer::available(void)
 {
   /* Get space available in the buffer */
+#if BC_CHUNKED_MESSAGES
+  if (chunkPool != 0)
+  {
+    /* Include the chunks free in the pool */
+    uint32_t space = (uint32_t)chunkPool->freeBlocks() * chunkDataSize;
+    space += bufferSize - bytesWritten;
+    return (space > UINT16_MAX) ? UINT16_MAX : space;
+  }
+#endif
+
   return bufferSize - bytesWritten;
 }
 
 bool BERGCloudMessageBuffer::available(uint16_t required)
 {
   /* Test if space is available for the number of bytes required */
-  return (bufferSize - bytesWritten) >= required;
+  if ((bufferSize - bytesWritten) >= required)
+  {
+    return true;
+  }
+
+#if BC_CHUNKED_MESSAGES
+  if (chunkPool != 0)
+  {
+    /* Make space */
+    return growChunks(required);
+  }
+#endif
+
+  return false;
 }
 
 void BERGCloudMessageBuffer::add(uint8_t data)
 {
   /* Write a byte to the buffer; no checks */
-    buffer[bytesWritten++] = data;
+#if BC_CHUNKED_MESSAGES
+  if (chunkPool != 0)
+  {
+    *seekChunk(bytesWritten++, writeChunk, writeChunkStart) = data;
+    return;
+  }
+#endif
+
+  buffer[bytesWritten++] = data;
+}
+
+bool BERGCloudMessageBuffer::write(const uint8_t *data, uint16_t size)
+{
+  /* Write a block of bytes to the buffer */
+  if (!available(size))
+  {
+    return false;
+  }
+
+#if BC_CHUNKED_MESSAGES
+  if (chunkPool != 0)
+  {
+    writeChunks(data, size);
+    return true;
+  }
+#endif
+
+  memcpy(&buffer[bytesWritten], data, size);
+  bytesWritten += size;
+  return true;
 }
 
 bool BERGCloudMessageBuffer::peek(uint8_t *data)
@@ -123,7 +566,22 @@ bool BERGCloudMessageBuffer::peek(uint8_t *data)
     return false;
   }
 
-  
+#if BC_CHUNKED_MESSAGES
+  if (chunkPool != 0)
+  {
+    *data = *seekChunk(bytesRead, readChunk, readChunkStart); /* No increment */
+    return true;
+  }
+#endif
+
+#ifdef __AVR__
+  if (inProgmem)
+  {
+    *data = pgm_read_byte(&buffer[bytesRead]); /* No increment */
+    return true;
+  }
+#endif
+
   *data = buffer[bytesRead]; /* No increment */
   return true;
 }
@@ -131,9 +589,53 @@ bool BERGCloudMessageBuffer::peek(uint8_t *data)
 uint8_t BERGCloudMessageBuffer::read(void)
 {
   /* Read the next byte from the buffer; no checks */
+#if BC_CHUNKED_MESSAGES
+  if (chunkPool != 0)
+  {
+    return *seekChunk(bytesRead++, readChunk, readChunkStart);
+  }
+#endif
+
+#ifdef __AVR__
+  if (inProgmem)
+  {
+    return pgm_read_byte(&buffer[bytesRead++]);
+  }
+#endif
+
   return buffer[bytesRead++];
 }
 
+bool BERGCloudMessageBuffer::read(uint8_t *data, uint16_t size)
+{
+  /* Read a block of bytes from the buffer */
+  if (!remaining(size))
+  {
+    return false;
+  }
+
+#if BC_CHUNKED_MESSAGES
+  if (chunkPool != 0)
+  {
+    readChunks(data, size);
+    return true;
+  }
+#endif
+
+#ifdef __AVR__
+  if (inProgmem)
+  {
+    memcpy_P(data, &buffer[bytesRead], size);
+    bytesRead += size;
+    return true;
+  }
+#endif
+
+  memcpy(data, &buffer[bytesRead], size);
+  bytesRead += size;
+  return true;
+}
+
 uint16_t BERGCloudMessageBuffer::remaining(void)
 {
   /* Returns the number of bytes that have been written but not read */
@@ -150,3 +652,31 @@ uint8_t *BERGCloudMessageBuffer::ptr(void)
 {
   return buffer;
 }
+
+bool BERGCloudMessageBuffer::segment(uint16_t offset, uint8_t *&data, uint16_t& size)
+{
+  if (offset >= bytesWritten)
+  {
+    /* No more data */
+    return false;
+  }
+
+#if BC_CHUNKED_MESSAGES
+  if (chunkPool != 0)
+  {
+    /* Up to the end of the chunk */
+    data = seekChunk(offset, readChunk, readChunkStart);
+    size = chunkDataSize - (offset - readChunkStart);
+    if (size > (bytesWritten - offset))
+    {
+      size = bytesWritten - offset;
+    }
+    return true;
+  }
+#endif
+
+  data = &buffer[offset];
+  size = bytesWritten - offset;
+  return true;
+}
+
@@ -29,21 +29,34 @@ THE SOFTWARE.
 
 #define __STDC_LIMIT_MACROS /* Include C99 stdint defines in C++ code */
 #include <stdint.h>
+#include "BERGCloudConfig.h"
+
+/* Offset of the innermost open container when there is none */
+#define BC_NO_OPEN_CONTAINER 0xffff
 
 /* Default buffer size */
 #ifndef BC_DEFAULT_BUFFER_SIZE_BYTES
 #define BC_DEFAULT_BUFFER_SIZE_BYTES 64
 #endif
 
+class BERGCloudBlockPool;
+
 class BERGCloudMessageBuffer
 {
 public:
-  BERGCloudMessageBuffer(uint16_t size = BC_DEFAULT_BUFFER_SIZE_BYTES);
+  /* 'headroom' bytes are reserved in front of the data; see headroom() */
+  BERGCloudMessageBuffer(uint16_t size = BC_DEFAULT_BUFFER_SIZE_BYTES, uint16_t headroom = 0);
+  /* A copy has a buffer of its own, from the heap; if that can't be */
+  /* allocated its size() is 0 */
   BERGCloudMessageBuffer(const BERGCloudMessageBuffer& parent);
+  BERGCloudMessageBuffer& operator=(const BERGCloudMessageBuffer& other);
   ~BERGCloudMessageBuffer();
   uint16_t size(void);
+  /* In chunked mode this is only the first chunk; see segment() */
   uint8_t *ptr(void);
   void clear(void);
+  /* Bytes free for use immediately before ptr() */
+  uint16_t headroom(void);
 
   /* Methods for writing to the buffer */
   uint16_t used(void);
@@ -51,19 +64,75 @@ public:
   uint16_t available(void);
   bool available(uint16_t required);
   void add(uint8_t data);
+  bool write(const uint8_t *data, uint16_t size);
 
   /* Methods for reading from the buffer */
   bool peek(uint8_t *data);
   uint8_t read(void);
+  bool read(uint8_t *data, uint16_t size);
   uint16_t remaining(void);
   bool remaining(uint16_t required);
   void restart(void);
 
+  /* Get the longest contiguous run of data starting 'offset' bytes in, */
+  /* without copying; returns false once 'offset' reaches used() */
+  bool segment(uint16_t offset, uint8_t *&data, uint16_t& size);
+  /* Test if the buffer grows in chunks from a pool */
+  bool chunked(void)
+  {
+#if BC_CHUNKED_MESSAGES
+    return chunkPool != 0;
+#else
+    return false;
+#endif
+  }
+
 protected:
+  /* Use storage of 'headroom' + 'size' bytes provided by a derived class; */
+  /* it is not freed on destruction */
+  BERGCloudMessageBuffer(uint8_t *storage, uint16_t size, uint16_t headroom = 0);
+#if BC_CHUNKED_MESSAGES
+  /* Grow in chunks from 'pool' as data is written; the chunks are */
+  /* returned to the pool by clear() or on destruction */
+  BERGCloudMessageBuffer(BERGCloudBlockPool& pool);
+#endif
+  /* Read 'size' bytes in place from 'offset' in a command pool block, with */
+  /* the bytes before it as headroom; the block is returned to the pool by */
+  /* releaseBlock() or on destruction */
+  void adoptBlock(BERGCloudBlockPool *pool, uint8_t *data, uint16_t offset, uint16_t size);
+  void releaseBlock(void);
+  void releaseStorage(void);
+  void copyData(const BERGCloudMessageBuffer& other);
+#if BC_CHUNKED_MESSAGES
+  bool growChunks(uint16_t required);
+  void releaseChunks(void);
+  uint8_t *seekChunk(uint16_t offset, uint8_t *&chunk, uint16_t& chunkStart);
+  void writeChunks(const uint8_t *data, uint16_t size);
+  void readChunks(uint8_t *data, uint16_t size);
+#endif
+  uint8_t *dataAt(uint16_t offset);
+  void erase(uint16_t offset, uint16_t size);
+  friend class BERGCloudBase;
   uint8_t *buffer;
   uint16_t bufferSize;
   uint16_t bytesWritten;
   uint16_t bytesRead;
+  uint16_t headroomSize;
+  bool ownsBuffer;
+  bool inProgmem; /* Read with pgm_read_byte() on AVR */
+  bool findIndexValid; /* Cleared when the data is replaced */
+  uint16_t openContainer; /* Header of the innermost map or array begun but not ended */
+  BERGCloudBlockPool *blockPool;
+  uint8_t *block;
+#if BC_CHUNKED_MESSAGES
+  BERGCloudBlockPool *chunkPool;
+  uint16_t chunkDataSize;
+  uint8_t *firstChunk;
+  uint8_t *writeChunk; /* Chunk last written, and its offset in the data */
+  uint16_t writeChunkStart;
+  uint8_t *readChunk;  /* Chunk last read, and its offset in the data */
+  uint16_t readChunkStart;
+#endif
 };
 
 #endif // #ifndef BERGCLOUDMESSAGEBUFFER_H
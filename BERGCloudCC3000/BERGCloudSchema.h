@@ -0,0 +1,120 @@
+/*
+
+BERGCloud message schemas
+
+Copyright (c) 2014 Berg Cloud Limited http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+/*
+  A schema lists the members of a struct that make up an event or command,
+  each with its map key. pack_schema() packs the struct as a map with one
+  space check for the whole message, and unpack_schema() fills it in from
+  a single walk over the map, rather than a pack() or unpack_find() for
+  each member. The table is built at compile time and kept in program
+  memory on AVR:
+
+    struct Reading {
+      uint16_t battery;
+      int16_t temperature;
+      char status[12];
+    };
+
+    BC_SCHEMA_BEGIN(readingSchema)
+      BC_SCHEMA_FIELD(Reading, battery)
+      BC_SCHEMA_FIELD(Reading, temperature)
+      BC_SCHEMA_FIELD_KEY(Reading, status, "state")
+    BC_SCHEMA_END(readingSchema)
+
+    message.pack_schema(readingSchema, &reading);
+
+  Members may be 8, 16 and 32-bit integers, float, bool, char arrays
+  (packed as strings) and uint8_t arrays (packed as binary data). Any
+  other type, or a key longer than MAX_MAP_KEY_STRING_LENGTH, fails to
+  compile. This file is included by BERGCloudMessageBase.h.
+*/
+
+#ifndef BERGCLOUDSCHEMA_H
+#define BERGCLOUDSCHEMA_H
+
+#include <stddef.h> /* For offsetof() and size_t */
+
+#ifdef __AVR__
+#include <avr/pgmspace.h>
+#define BC_SCHEMA_PROGMEM PROGMEM
+#else
+#define BC_SCHEMA_PROGMEM
+#endif
+
+/* Field types */
+#define BC_SCHEMA_UINT8   1
+#define BC_SCHEMA_UINT16  2
+#define BC_SCHEMA_UINT32  3
+#define BC_SCHEMA_INT8    4
+#define BC_SCHEMA_INT16   5
+#define BC_SCHEMA_INT32   6
+#define BC_SCHEMA_FLOAT   7
+#define BC_SCHEMA_BOOL    8
+#define BC_SCHEMA_STRING  9
+#define BC_SCHEMA_BIN     10
+
+typedef struct {
+  char key[MAX_MAP_KEY_STRING_LENGTH + 1]; /* +1 for null terminator */
+  uint8_t keyLength;
+  uint8_t type;    /* One of BC_SCHEMA_UINT8 etc. */
+  uint16_t offset; /* Of the member in the struct */
+  uint16_t size;   /* Of the member, in bytes */
+} BC_SCHEMA_FIELD;
+
+typedef struct {
+  const BC_SCHEMA_FIELD *fields; /* In program memory on AVR */
+  uint8_t count;
+} BC_SCHEMA;
+
+/* Map each member type to its field type, as the size of the */
+/* array returned; these are only used inside sizeof() */
+char (&bcSchemaType(uint8_t&))[BC_SCHEMA_UINT8];
+char (&bcSchemaType(uint16_t&))[BC_SCHEMA_UINT16];
+char (&bcSchemaType(uint32_t&))[BC_SCHEMA_UINT32];
+char (&bcSchemaType(int8_t&))[BC_SCHEMA_INT8];
+char (&bcSchemaType(int16_t&))[BC_SCHEMA_INT16];
+char (&bcSchemaType(int32_t&))[BC_SCHEMA_INT32];
+char (&bcSchemaType(float&))[BC_SCHEMA_FLOAT];
+char (&bcSchemaType(bool&))[BC_SCHEMA_BOOL];
+template <size_t N> char (&bcSchemaType(char (&)[N]))[BC_SCHEMA_STRING];
+template <size_t N> char (&bcSchemaType(uint8_t (&)[N]))[BC_SCHEMA_BIN];
+
+#define BC_SCHEMA_MEMBER(type, member) (((type *)0)->member)
+
+#define BC_SCHEMA_BEGIN(name) \
+  static const BC_SCHEMA_FIELD name##Fields[] BC_SCHEMA_PROGMEM = {
+
+#define BC_SCHEMA_FIELD_KEY(type, member, key) \
+  { key, sizeof(key) - 1, sizeof(bcSchemaType(BC_SCHEMA_MEMBER(type, member))), \
+    offsetof(type, member), sizeof(BC_SCHEMA_MEMBER(type, member)) },
+
+#define BC_SCHEMA_FIELD(type, member) BC_SCHEMA_FIELD_KEY(type, member, #member)
+
+#define BC_SCHEMA_END(name) \
+  }; \
+  static const BC_SCHEMA name = { name##Fields, sizeof(name##Fields) / sizeof(name##Fields[0]) };
+
+#endif // #ifndef BERGCLOUDSCHEMA_H
@@ -0,0 +1,421 @@
+/*
+
+BERGCloud streaming MessagePack decoder
+
+Copyright (c) 2014 Berg Cloud Limited http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <string.h> /* For memcpy() */
+#include "BERGCloudStreamDecoder.h"
+#include "BERGCloudMessageBase.h" /* For bcDoubleToFloat() */
+
+#define _MP_FIXNUM_POS_MAX  0x7f
+#define _MP_FIXMAP_MIN      0x80
+#define _MP_FIXMAP_MAX      0x8f
+#define _MP_FIXARRAY_MIN    0x90
+#define _MP_FIXARRAY_MAX    0x9f
+#define _MP_FIXRAW_MIN      0xa0
+#define _MP_FIXRAW_MAX      0xbf
+#define _MP_NIL             0xc0
+#define _MP_BOOL_FALSE      0xc2
+#define _MP_BOOL_TRUE       0xc3
+#define _MP_BIN8            0xc4
+#define _MP_BIN16           0xc5
+#define _MP_BIN32           0xc6
+#define _MP_EXT8            0xc7
+#define _MP_EXT16           0xc8
+#define _MP_EXT32           0xc9
+#define _MP_FLOAT           0xca
+#define _MP_DOUBLE          0xcb
+#define _MP_UINT8           0xcc
+#define _MP_UINT16          0xcd
+#define _MP_UINT32          0xce
+#define _MP_UINT64          0xcf
+#define _MP_INT8            0xd0
+#define _MP_INT16           0xd1
+#define _MP_INT32           0xd2
+#define _MP_INT64           0xd3
+#define _MP_FIXEXT1         0xd4
+#define _MP_FIXEXT16        0xd8
+#define _MP_STR8            0xd9
+#define _MP_RAW16           0xda
+#define _MP_RAW32           0xdb
+#define _MP_ARRAY16         0xdc
+#define _MP_ARRAY32         0xdd
+#define _MP_MAP16           0xde
+#define _MP_MAP32           0xdf
+#define _MP_FIXNUM_NEG_MIN  0xe0
+
+/* What the next byte fed is */
+#define STATE_TYPE   0 /* The type of an item */
+#define STATE_HEADER 1 /* Part of the value, size or count after the type */
+#define STATE_RAW    2 /* Part of a string or binary data */
+#define STATE_SKIP   3 /* Part of an extension type's data */
+#define STATE_FAILED 4 /* Nothing more is decoded until reset() */
+
+/* Bytes after each type from _MP_BIN8 to _MP_MAP32 that are */
+/* collected before the item can be decoded */
+static const uint8_t headerSizes[_MP_MAP32 - _MP_BIN8 + 1] = {
+  1, 2, 4,          /* bin 8, 16, 32 */
+  2, 3, 5,          /* ext 8, 16, 32: the size, then the extension type */
+  4, 8,             /* float, double */
+  1, 2, 4, 8,       /* uint 8, 16, 32, 64 */
+  1, 2, 4, 8,       /* int 8, 16, 32, 64 */
+  1, 1, 1, 1, 1,    /* fix ext 1 to 16: the extension type */
+  1, 2, 4,          /* str 8, raw 16, raw 32 */
+  2, 4,             /* array 16, 32 */
+  2, 4              /* map 16, 32 */
+};
+
+BERGCloudStreamDecoder::BERGCloudStreamDecoder(BERGCloudStreamHandler& handler)
+  : handler(handler)
+{
+  reset();
+}
+
+void BERGCloudStreamDecoder::reset(void)
+{
+  state = STATE_TYPE;
+  depth = 0;
+  rawLeft = 0;
+  headerUsed = 0;
+  headerSize = 0;
+}
+
+bool BERGCloudStreamDecoder::idle(void)
+{
+  return (state == STATE_TYPE) && (depth == 0);
+}
+
+bool BERGCloudStreamDecoder::failed(void)
+{
+  return state == STATE_FAILED;
+}
+
+bool BERGCloudStreamDecoder::feed(const uint8_t *data, uint16_t size)
+{
+  /* Each byte moves the current item on; strings and data are */
+  /* passed to the handler in place, as much at a time as was fed */
+  uint16_t run;
+  bool ok = true;
+
+  while ((size > 0) && (state != STATE_FAILED))
+  {
+    switch (state)
+    {
+    case STATE_TYPE:
+      type = *data++;
+      size--;
+      ok = decodeType(type);
+      break;
+    case STATE_HEADER:
+      header[headerUsed++] = *data++;
+      size--;
+      if (headerUsed == headerSize)
+      {
+        state = STATE_TYPE;
+        ok = decodeHeader();
+      }
+      break;
+    default:
+      /* A string, binary data or extension */
+      run = (rawLeft < size) ? (uint16_t)rawLeft : size;
+
+      if (state == STATE_RAW)
+      {
+        ok = handler.rawData(data, run);
+      }
+
+      data += run;
+      size -= run;
+      rawLeft -= run;
+
+      if (ok && (rawLeft == 0))
+      {
+        state = STATE_TYPE;
+        ok = itemDone();
+      }
+      break;
+    }
+
+    if (!ok)
+    {
+      state = STATE_FAILED;
+    }
+  }
+
+  return state != STATE_FAILED;
+}
+
+bool BERGCloudStreamDecoder::decodeType(uint8_t type)
+{
+  /* Decode an item held in its type byte, or get ready */
+  /* to collect the bytes that follow it */
+  uint8_t size;
+
+  if (type <= _MP_FIXNUM_POS_MAX)
+  {
+    return handler.integer(type) && itemDone();
+  }
+
+  if (type >= _MP_FIXNUM_NEG_MIN)
+  {
+    return handler.integer((int8_t)type) && itemDone();
+  }
+
+  if (type <= _MP_FIXMAP_MAX)
+  {
+    return openContainer(true, type - _MP_FIXMAP_MIN);
+  }
+
+  if (type <= _MP_FIXARRAY_MAX)
+  {
+    return openContainer(false, type - _MP_FIXARRAY_MIN);
+  }
+
+  if (type <= _MP_FIXRAW_MAX)
+  {
+    size = type - _MP_FIXRAW_MIN;
+
+    if (!handler.rawStart(size, inKey()))
+    {
+      return false;
+    }
+
+    if (size == 0)
+    {
+      return itemDone();
+    }
+
+    rawLeft = size;
+    state = STATE_RAW;
+    return true;
+  }
+
+  switch (type)
+  {
+  case _MP_NIL:
+    return handler.nil() && itemDone();
+  case _MP_BOOL_FALSE:
+    return handler.boolean(false) && itemDone();
+  case _MP_BOOL_TRUE:
+    return handler.boolean(true) && itemDone();
+  case _MP_BOOL_FALSE - 1:
+    /* Never used */
+    _LOG("Stream: Unknown type.");
+    return false;
+  }
+
+  headerSize = headerSizes[type - _MP_BIN8];
+  headerUsed = 0;
+  state = STATE_HEADER;
+  return true;
+}
+
+bool BERGCloudStreamDecoder::decodeHeader(void)
+{
+  /* Decode an item now that the bytes after its type have arrived */
+  uint32_t value = 0;
+  uint32_t low = 0;
+  uint8_t i;
+  float f;
+
+  for (i = 0; (i < headerSize) && (i < sizeof(uint32_t)); i++)
+  {
+    value = (value << 8) | header[i];
+  }
+
+  for (; i < headerSize; i++)
+  {
+    low = (low << 8) | header[i];
+  }
+
+  switch (type)
+  {
+  case _MP_UINT8:
+  case _MP_UINT16:
+  case _MP_UINT32:
+    return ((value <= INT32_MAX) ? handler.integer((int32_t)value) : handler.unsignedInteger(value)) &&
+      itemDone();
+  case _MP_INT8:
+    return handler.integer((int8_t)value) && itemDone();
+  case _MP_INT16:
+    return handler.integer((int16_t)value) && itemDone();
+  case _MP_INT32:
+    return handler.integer((int32_t)value) && itemDone();
+  case _MP_UINT64:
+  case _MP_INT64:
+    /* 'value' is the high half */
+    if ((value == 0) && (low <= INT32_MAX))
+    {
+      return handler.integer((int32_t)low) && itemDone();
+    }
+
+    if (value == 0)
+    {
+      /* As for uint 32; an int 64 may hold the same values */
+      return handler.unsignedInteger(low) && itemDone();
+    }
+
+    if ((value == UINT32_MAX) && (low > INT32_MAX) && (type == _MP_INT64))
+    {
+      return handler.integer((int32_t)low) && itemDone();
+    }
+
+    _LOG("Stream: Integer out of range.");
+    return false;
+  case _MP_FLOAT:
+    memcpy(&f, &value, sizeof(f));
+    return handler.real(f) && itemDone();
+  case _MP_DOUBLE:
+    return handler.real(bcDoubleToFloat(value, low)) && itemDone();
+  case _MP_ARRAY16:
+  case _MP_ARRAY32:
+    return openContainer(false, value);
+  case _MP_MAP16:
+  case _MP_MAP32:
+    return openContainer(true, value);
+  case _MP_EXT8:
+    /* Skip the data; the extension type is the last header byte */
+    rawLeft = header[0];
+    break;
+  case _MP_EXT16:
+    rawLeft = (value >> 8) & 0xffff;
+    break;
+  case _MP_EXT32:
+    rawLeft = value;
+    break;
+  case _MP_STR8:
+  case _MP_BIN8:
+  case _MP_RAW16:
+  case _MP_BIN16:
+  case _MP_RAW32:
+  case _MP_BIN32:
+    if (value > UINT16_MAX)
+    {
+      _LOG("Stream: String or data too long.");
+      return false;
+    }
+
+    if (!handler.rawStart((uint16_t)value, inKey()))
+    {
+      return false;
+    }
+
+    if (value == 0)
+    {
+      return itemDone();
+    }
+
+    rawLeft = value;
+    state = STATE_RAW;
+    return true;
+  default:
+    /* Fix ext */
+    rawLeft = (uint32_t)1 << (type - _MP_FIXEXT1);
+    break;
+  }
+
+  /* An extension, skipped whole */
+  if (rawLeft == 0)
+  {
+    return itemDone();
+  }
+
+  state = STATE_SKIP;
+  return true;
+}
+
+bool BERGCloudStreamDecoder::openContainer(bool map, uint32_t items)
+{
+  if (items > UINT16_MAX)
+  {
+    _LOG("Stream: Map or array too large.");
+    return false;
+  }
+
+  if (!(map ? handler.mapStart((uint16_t)items) : handler.arrayStart((uint16_t)items)))
+  {
+    return false;
+  }
+
+  if (items == 0)
+  {
+    /* Already complete */
+    return handler.end() && itemDone();
+  }
+
+  if (depth == BC_STREAM_DECODER_DEPTH)
+  {
+    _LOG("Stream: Maps and arrays nested too deeply.");
+    return false;
+  }
+
+  /* A key and a value for each entry of a map */
+  slots[depth] = map ? items * 2 : items;
+
+  if (map)
+  {
+    maps[depth / 8] |= (uint8_t)(1 << (depth % 8));
+  }
+  else
+  {
+    maps[depth / 8] &= (uint8_t)~(1 << (depth % 8));
+  }
+
+  depth++;
+  return true;
+}
+
+bool BERGCloudStreamDecoder::itemDone(void)
+{
+  /* Count a complete item against the innermost map or array, */
+  /* ending each that it completes; each is an item of its parent */
+  while (depth > 0)
+  {
+    if (--slots[depth - 1] > 0)
+    {
+      return true;
+    }
+
+    depth--;
+
+    if (!handler.end())
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool BERGCloudStreamDecoder::inKey(void)
+{
+  /* Test if the next item is a map key; a map's slots count */
+  /* down from an even number, keys first */
+  if (depth == 0)
+  {
+    return false;
+  }
+
+  return ((maps[(depth - 1) / 8] & (1 << ((depth - 1) % 8))) != 0) && ((slots[depth - 1] & 1) == 0);
+}
@@ -0,0 +1,98 @@
+/*
+
+BERGCloud streaming MessagePack decoder
+
+Copyright (c) 2014 Berg Cloud Limited http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BERGCLOUDSTREAMDECODER_H
+#define BERGCLOUDSTREAMDECODER_H
+
+#define __STDC_LIMIT_MACROS /* Include C99 stdint defines in C++ code */
+#include <stdint.h>
+#include <stddef.h>
+
+#include "BERGCloudConfig.h"
+
+/* Receives each item as it is decoded; override the methods needed. */
+/* Returning false from any of them stops decoding, see failed(). */
+class BERGCloudStreamHandler
+{
+public:
+  virtual ~BERGCloudStreamHandler() {}
+  /* A map of 'items' key-value pairs, or an array of 'items' items, */
+  /* follows; end() is called after the last of them */
+  virtual bool mapStart(uint16_t /* items */) { return true; }
+  virtual bool arrayStart(uint16_t /* items */) { return true; }
+  virtual bool end(void) { return true; }
+  virtual bool nil(void) { return true; }
+  virtual bool boolean(bool /* value */) { return true; }
+  /* Integers from INT32_MIN to INT32_MAX; larger unsigned values */
+  /* up to UINT32_MAX are given to unsignedInteger() */
+  virtual bool integer(int32_t /* value */) { return true; }
+  virtual bool unsignedInteger(uint32_t /* value */) { return true; }
+  /* A float, or a double converted to the nearest float */
+  virtual bool real(float /* value */) { return true; }
+  /* A string or binary data of 'size' bytes follows, given to */
+  /* rawData() as it arrives; 'key' is true for a map key */
+  virtual bool rawStart(uint16_t /* size */, bool /* key */) { return true; }
+  /* Part of the string or data, pointing into the input given to feed() */
+  virtual bool rawData(const uint8_t * /* data */, uint16_t /* size */) { return true; }
+};
+
+/* Decodes MessagePack a chunk at a time, as it arrives, rather than */
+/* from a whole message in a buffer. Its working set is fixed: a header */
+/* of up to 8 bytes and BC_STREAM_DECODER_DEPTH levels of nesting. */
+/* Extension types are skipped; integers outside the 32-bit range, and */
+/* nesting deeper than BC_STREAM_DECODER_DEPTH, stop decoding. */
+class BERGCloudStreamDecoder
+{
+public:
+  BERGCloudStreamDecoder(BERGCloudStreamHandler& handler);
+  /* Forget any partly decoded item, and start again */
+  void reset(void);
+  /* Decode the next 'size' bytes; returns false once decoding has failed */
+  bool feed(const uint8_t *data, uint16_t size);
+  /* Test if the items fed so far are complete, with nothing part-decoded */
+  bool idle(void);
+  /* Test if decoding stopped on bad data or at the handler's request */
+  bool failed(void);
+
+private:
+  bool decodeType(uint8_t type);
+  bool decodeHeader(void);
+  bool openContainer(bool map, uint32_t items);
+  bool itemDone(void);
+  bool inKey(void);
+  BERGCloudStreamHandler& handler;
+  uint8_t state;
+  uint8_t type;           /* Of the item being decoded */
+  uint8_t header[8];      /* Bytes after the type, collected as they arrive */
+  uint8_t headerSize;
+  uint8_t headerUsed;
+  uint32_t rawLeft;       /* Of the string, data or extension being read */
+  uint8_t depth;          /* Maps and arrays open */
+  uint32_t slots[BC_STREAM_DECODER_DEPTH]; /* Keys and values, or items, left in each */
+  uint8_t maps[(BC_STREAM_DECODER_DEPTH + 7) / 8]; /* A bit set for each that is a map */
+};
+
+#endif // #ifndef BERGCLOUDSTREAMDECODER_H
@@ -37,13 +37,13 @@ CC3000Client::CC3000Client(void)
 #endif
 }
 
-int CC3000Client::connect(IPAddress ip, uint16_t port)
+int CC3000Client::connect(IPAddress /* ip */, uint16_t /* port */)
 {
   // Not implemented
   return false;
 }
 
-int CC3000Client::connect(const char *host, uint16_t port)
+int CC3000Client::connect(const char * /* host */, uint16_t /* port */)
 {
   // Not implemented
   return false;
@@ -26,7 +26,6 @@
 
 #include <EEPROM.h>
 #include <WebSocketClient.h>
-#include <aJSON.h>
 #include <Base64.h>
 #include <SPI.h>
 #include <Adafruit_CC3000.h>
@@ -148,7 +147,8 @@ void loop()
 
       pollTimer=millis();
 
-      BERGCloudMessage command, event;
+      BERGCloudCommand command;
+      BERGCloudStaticMessage<64, BC_EVENT_HEADROOM_BYTES> event;
       String text;
       int number;
       String commandName;
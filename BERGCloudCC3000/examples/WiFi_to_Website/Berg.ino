@@ -76,7 +76,7 @@ void loopBerg(){
     if(millis()>=(pollTimer+pollGap)){
       pollTimer = millis();
 
-      BERGCloudMessage command;
+      BERGCloudCommand command;
       String commandName;
 
       if (BERGCloud.pollForCommand(command, commandName)){
@@ -90,7 +90,7 @@ void loopBerg(){
 }
 
 void sendEventToBerg(String &name, boolean state){
-  BERGCloudMessage m;
+  BERGCloudStaticMessage<8, BC_EVENT_HEADROOM_BYTES> m;
   m.pack(state);
   BERGCloud.sendEvent(name, m);
 }
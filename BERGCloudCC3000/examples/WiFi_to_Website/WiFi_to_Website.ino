@@ -2,7 +2,6 @@
 
 #include <EEPROM.h>
 #include <WebSocketClient.h>
-#include <aJSON.h>
 #include <Base64.h>
 #include <SPI.h>
 #include <Adafruit_CC3000.h>
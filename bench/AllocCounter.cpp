@@ -0,0 +1,112 @@
+/*
+
+Heap allocation counter for the host benchmarks
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <new>
+
+#include "AllocCounter.h"
+
+/* glibc entry points for the real allocator */
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t nmemb, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void __libc_free(void *ptr);
+
+/* Per thread, so that the benchmark thread counts only its own */
+static thread_local uint64_t allocationCount = 0;
+static thread_local uint64_t allocationBytes = 0;
+
+uint64_t AllocCounter::allocations(void)
+{
+  return allocationCount;
+}
+
+uint64_t AllocCounter::bytes(void)
+{
+  return allocationBytes;
+}
+
+extern "C" void *malloc(size_t size)
+{
+  allocationCount++;
+  allocationBytes += size;
+  return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t nmemb, size_t size)
+{
+  allocationCount++;
+  allocationBytes += nmemb * size;
+  return __libc_calloc(nmemb, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+  allocationCount++;
+  allocationBytes += size;
+  return __libc_realloc(ptr, size);
+}
+
+extern "C" void free(void *ptr)
+{
+  __libc_free(ptr);
+}
+
+void *operator new(size_t size)
+{
+  void *p = malloc(size);
+  if (p == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void *operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void *p) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+  free(p);
+}
+
+void operator delete(void *p, size_t) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void *p, size_t) noexcept
+{
+  free(p);
+}
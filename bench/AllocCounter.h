@@ -0,0 +1,43 @@
+/*
+
+Heap allocation counter for the host benchmarks
+
+Interposes malloc(), calloc(), realloc() and the C++ allocation operators
+so a benchmark can report the number of heap allocations per operation.
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef ALLOCCOUNTER_H
+#define ALLOCCOUNTER_H
+
+#include <stdint.h>
+
+namespace AllocCounter
+{
+  /* Number of allocations since the program started */
+  uint64_t allocations(void);
+  /* Number of bytes requested since the program started */
+  uint64_t bytes(void);
+}
+
+#endif // #ifndef ALLOCCOUNTER_H
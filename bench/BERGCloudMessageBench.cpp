@@ -0,0 +1,1238 @@
+/*
+
+Microbenchmarks for the BERGCloud MessagePack codec
+
+Times each pack() and unpack() overload and the map, array, search and skip
+methods over realistic payload shapes. Each benchmark reports the encoded
+bytes handled and the heap allocations made per operation.
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <string.h>
+
+#include "BenchCommon.h"
+
+#define SCRATCH_SIZE_BYTES 2048
+
+/*
+ * Scalar pack
+ */
+
+template <typename T>
+static void BM_pack(benchmark::State& state, T value)
+{
+  BERGCloudMessage msg(16);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.clear();
+    benchmark::DoNotOptimize(msg.pack(value));
+  }
+
+  report.done(msg.used());
+}
+
+BENCHMARK_CAPTURE(BM_pack, uint8_t, (uint8_t)200);
+BENCHMARK_CAPTURE(BM_pack, uint16_t, (uint16_t)50000);
+BENCHMARK_CAPTURE(BM_pack, uint32_t, (uint32_t)3000000000UL);
+BENCHMARK_CAPTURE(BM_pack, int8_t, (int8_t)-100);
+BENCHMARK_CAPTURE(BM_pack, int16_t, (int16_t)-30000);
+BENCHMARK_CAPTURE(BM_pack, int32_t, (int32_t)-2000000000L);
+BENCHMARK_CAPTURE(BM_pack, uint64_t, (uint64_t)10000000000000ULL);
+BENCHMARK_CAPTURE(BM_pack, int64_t, (int64_t)-10000000000000LL);
+BENCHMARK_CAPTURE(BM_pack, float, 3.14159f);
+BENCHMARK_CAPTURE(BM_pack, double, 3.14159);
+BENCHMARK_CAPTURE(BM_pack, bool, true);
+
+static void BM_pack_nil(benchmark::State& state)
+{
+  BERGCloudMessage msg(16);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.clear();
+    benchmark::DoNotOptimize(msg.pack_nil());
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_pack_nil);
+
+static void BM_pack_array(benchmark::State& state)
+{
+  /* Header only; the space check includes the items that will follow */
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.clear();
+    benchmark::DoNotOptimize(msg.pack_array(state.range(0)));
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_pack_array)->Arg(4)->Arg(100);
+
+static void BM_pack_map(benchmark::State& state)
+{
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.clear();
+    benchmark::DoNotOptimize(msg.pack_map(state.range(0)));
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_pack_map)->Arg(4)->Arg(100);
+
+/*
+ * Raw and string pack
+ */
+
+static void BM_pack_data(benchmark::State& state)
+{
+  uint16_t size = state.range(0);
+  uint8_t data[size];
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  BenchReport report(state);
+
+  memset(data, 0x55, size);
+
+  for (auto _ : state)
+  {
+    msg.clear();
+    benchmark::DoNotOptimize(msg.pack(data, size));
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_pack_data)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+
+static void BM_pack_bin(benchmark::State& state)
+{
+  uint16_t size = state.range(0);
+  uint8_t data[size];
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  BenchReport report(state);
+
+  memset(data, 0x55, size);
+
+  for (auto _ : state)
+  {
+    msg.clear();
+    benchmark::DoNotOptimize(msg.pack_bin(data, size));
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_pack_bin)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+
+#if BC_CHUNKED_MESSAGES
+static void BM_pack_chunked_data(benchmark::State& state)
+{
+  uint16_t size = state.range(0);
+  uint8_t data[size];
+  BERGCloudChunkPool pool;
+  BERGCloudChunkedMessage msg(pool);
+  BenchReport report(state);
+
+  memset(data, 0x55, size);
+
+  for (auto _ : state)
+  {
+    /* Chunks are returned to the pool and taken again each time */
+    msg.clear();
+    benchmark::DoNotOptimize(msg.pack(data, size));
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_pack_chunked_data)->Arg(16)->Arg(64)->Arg(128);
+#endif
+
+static void BM_pack_cstring(benchmark::State& state)
+{
+  BERGCloudMessage msg(64);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.clear();
+    benchmark::DoNotOptimize(msg.pack("temperature"));
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_pack_cstring);
+
+static void BM_pack_String(benchmark::State& state)
+{
+  String s;
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+
+  for (int64_t i = 0; i < state.range(0); i++)
+  {
+    s += (char)('a' + (i % 26));
+  }
+
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.clear();
+    benchmark::DoNotOptimize(msg.pack(s));
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_pack_String)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+
+/*
+ * Payload shapes
+ */
+
+static void BM_pack_flat_map(benchmark::State& state)
+{
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.clear();
+    benchmark::DoNotOptimize(packFlatMap(msg, state.range(0)));
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_pack_flat_map)->Arg(4)->Arg(12);
+
+static void BM_pack_long_array(benchmark::State& state)
+{
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.clear();
+    benchmark::DoNotOptimize(packLongArray(msg, state.range(0)));
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_pack_long_array)->Arg(16)->Arg(100);
+
+/*
+ * Maps whose size is not known until they have been packed
+ */
+
+enum { TABLE_COUNT_FIRST, TABLE_SCRATCH, TABLE_BEGIN_END };
+
+static bool sensorEnabled(uint16_t i)
+{
+  return (i % 3) != 1;
+}
+
+static bool packSensor(BERGCloudMessageBase& msg, uint16_t i)
+{
+  return msg.pack(sensorKeys[i % SENSOR_KEY_COUNT]) && msg.pack((int16_t)(i * 37 - 200));
+}
+
+static bool packSensorTable(BERGCloudMessage& msg, BERGCloudMessage& scratch, uint16_t sensors, int method)
+{
+  /* Pack the sensors that are enabled, a number only known */
+  /* by walking the table */
+  uint16_t items = 0;
+
+  switch (method)
+  {
+  case TABLE_COUNT_FIRST:
+    for (uint16_t i = 0; i < sensors; i++)
+    {
+      items += sensorEnabled(i) ? 1 : 0;
+    }
+    if (!msg.pack_map(items))
+    {
+      return false;
+    }
+    for (uint16_t i = 0; i < sensors; i++)
+    {
+      if (sensorEnabled(i) && !packSensor(msg, i))
+      {
+        return false;
+      }
+    }
+    return true;
+  case TABLE_SCRATCH:
+    scratch.clear();
+    for (uint16_t i = 0; i < sensors; i++)
+    {
+      if (sensorEnabled(i))
+      {
+        if (!packSensor(scratch, i))
+        {
+          return false;
+        }
+        items++;
+      }
+    }
+    return msg.pack_map(items) && msg.write(scratch.ptr(), scratch.used());
+  default:
+    if (!msg.begin_map())
+    {
+      return false;
+    }
+    for (uint16_t i = 0; i < sensors; i++)
+    {
+      if (sensorEnabled(i) && !packSensor(msg, i))
+      {
+        return false;
+      }
+    }
+    return msg.end_map();
+  }
+}
+
+static void BM_pack_sensor_table(benchmark::State& state)
+{
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  BERGCloudMessage scratch(SCRATCH_SIZE_BYTES);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.clear();
+    benchmark::DoNotOptimize(packSensorTable(msg, scratch, state.range(0), state.range(1)));
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_pack_sensor_table)->ArgNames({"sensors", "method"})
+  ->ArgsProduct({{12, 48}, {TABLE_COUNT_FIRST, TABLE_SCRATCH, TABLE_BEGIN_END}});
+
+/*
+ * Integer encoding: the width of each type versus pack_smallest()
+ */
+
+enum { EVENT_STATUS, EVENT_DELTAS, EVENT_READINGS };
+
+static bool packEvent(BERGCloudMessageBase& msg, int shape)
+{
+  switch (shape)
+  {
+  case EVENT_STATUS:
+    /* Sequence number, battery millivolts, temperature in */
+    /* hundredths of a degree and flags */
+    return msg.pack_array(4) && msg.pack((uint32_t)1234) && msg.pack((uint16_t)3300) &&
+      msg.pack((int16_t)2150) && msg.pack((uint8_t)1);
+  case EVENT_DELTAS:
+    /* Sixteen small changes since the last reading */
+    if (!msg.pack_array(16))
+    {
+      return false;
+    }
+    for (int i = 0; i < 16; i++)
+    {
+      if (!msg.pack((int16_t)((i * 7) % 41 - 20)))
+      {
+        return false;
+      }
+    }
+    return true;
+  default:
+    /* Twelve named readings */
+    return packFlatMap(msg, SENSOR_KEY_COUNT);
+  }
+}
+
+static void BM_pack_event(benchmark::State& state)
+{
+  /* Bytes per event are reported as bytes/op, and after */
+  /* base64 encoding for the WebSocket as base64/op */
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  msg.pack_smallest(state.range(1) != 0);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.clear();
+    benchmark::DoNotOptimize(packEvent(msg, state.range(0)));
+  }
+
+  report.done(msg.used());
+  state.counters["base64/op"] = ((msg.used() + 2) / 3) * 4;
+}
+BENCHMARK(BM_pack_event)->ArgNames({"shape", "smallest"})
+  ->Args({EVENT_STATUS, 0})->Args({EVENT_STATUS, 1})
+  ->Args({EVENT_DELTAS, 0})->Args({EVENT_DELTAS, 1})
+  ->Args({EVENT_READINGS, 0})->Args({EVENT_READINGS, 1});
+
+/*
+ * Scalar unpack
+ */
+
+template <typename T>
+static void BM_unpack(benchmark::State& state, T packed)
+{
+  BERGCloudMessage msg(16);
+  T value;
+
+  msg.pack(packed);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.restart();
+    benchmark::DoNotOptimize(msg.unpack(value));
+    benchmark::DoNotOptimize(value);
+  }
+
+  report.done(msg.used());
+}
+
+BENCHMARK_CAPTURE(BM_unpack, uint8_t, (uint8_t)200);
+BENCHMARK_CAPTURE(BM_unpack, uint16_t, (uint16_t)50000);
+BENCHMARK_CAPTURE(BM_unpack, uint32_t, (uint32_t)3000000000UL);
+BENCHMARK_CAPTURE(BM_unpack, int8_t, (int8_t)-100);
+BENCHMARK_CAPTURE(BM_unpack, int16_t, (int16_t)-30000);
+BENCHMARK_CAPTURE(BM_unpack, int32_t, (int32_t)-2000000000L);
+BENCHMARK_CAPTURE(BM_unpack, uint64_t, (uint64_t)10000000000000ULL);
+BENCHMARK_CAPTURE(BM_unpack, int64_t, (int64_t)-10000000000000LL);
+BENCHMARK_CAPTURE(BM_unpack, float, 3.14159f);
+BENCHMARK_CAPTURE(BM_unpack, double, 3.14159);
+BENCHMARK_CAPTURE(BM_unpack, bool, true);
+
+static void BM_unpack_uint8_t_from_uint32(benchmark::State& state)
+{
+  /* Narrowing conversion, range checked */
+  BERGCloudMessage msg(16);
+  uint8_t value;
+
+  msg.pack((uint32_t)200);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.restart();
+    benchmark::DoNotOptimize(msg.unpack(value));
+    benchmark::DoNotOptimize(value);
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_unpack_uint8_t_from_uint32);
+
+template <typename T>
+static void BM_unpack_fixnum(benchmark::State& state, uint8_t fixnum)
+{
+  /* pack() never emits fixnums, but the bridge does */
+  BERGCloudMessage msg(16);
+  T value;
+
+  msg.add(fixnum);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.restart();
+    benchmark::DoNotOptimize(msg.unpack(value));
+    benchmark::DoNotOptimize(value);
+  }
+
+  report.done(msg.used());
+}
+
+static void BM_unpack_fixnum_uint8_t(benchmark::State& state)
+{
+  BM_unpack_fixnum<uint8_t>(state, 0x05);
+}
+BENCHMARK(BM_unpack_fixnum_uint8_t);
+
+static void BM_unpack_fixnum_int8_t(benchmark::State& state)
+{
+  BM_unpack_fixnum<int8_t>(state, 0xfb);
+}
+BENCHMARK(BM_unpack_fixnum_int8_t);
+
+static void BM_unpack_fixnum_int32_t(benchmark::State& state)
+{
+  BM_unpack_fixnum<int32_t>(state, 0x05);
+}
+BENCHMARK(BM_unpack_fixnum_int32_t);
+
+static void BM_unpack_nil(benchmark::State& state)
+{
+  BERGCloudMessage msg(16);
+
+  msg.pack_nil();
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.restart();
+    benchmark::DoNotOptimize(msg.unpack_nil());
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_unpack_nil);
+
+static void BM_unpack_array(benchmark::State& state)
+{
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  uint16_t items;
+
+  msg.pack_array(state.range(0));
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.restart();
+    benchmark::DoNotOptimize(msg.unpack_array(items));
+    benchmark::DoNotOptimize(items);
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_unpack_array)->Arg(4)->Arg(100);
+
+static void BM_unpack_map(benchmark::State& state)
+{
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  uint16_t items;
+
+  msg.pack_map(state.range(0));
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.restart();
+    benchmark::DoNotOptimize(msg.unpack_map(items));
+    benchmark::DoNotOptimize(items);
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_unpack_map)->Arg(4)->Arg(100);
+
+/*
+ * Raw and string unpack
+ */
+
+static void BM_unpack_data(benchmark::State& state)
+{
+  uint16_t size = state.range(0);
+  uint8_t data[size];
+  uint32_t sizeInBytes;
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+
+  packRaw16(msg, size);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.restart();
+    benchmark::DoNotOptimize(msg.unpack(data, sizeof(data), &sizeInBytes));
+    benchmark::ClobberMemory();
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_unpack_data)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+
+static void BM_unpack_view(benchmark::State& state)
+{
+  /* The same data pointed to in place */
+  const uint8_t *data;
+  uint16_t sizeInBytes;
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+
+  packRaw16(msg, state.range(0));
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.restart();
+    benchmark::DoNotOptimize(msg.unpack_view(data, sizeInBytes));
+    benchmark::DoNotOptimize(data);
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_unpack_view)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+
+static void BM_unpack_cstring(benchmark::State& state)
+{
+  uint16_t size = state.range(0);
+  char string[size + 1];
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+
+  packRaw16(msg, size);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.restart();
+    benchmark::DoNotOptimize(msg.unpack(string, sizeof(string)));
+    benchmark::ClobberMemory();
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_unpack_cstring)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+
+static void BM_unpack_String(benchmark::State& state)
+{
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+
+  packRaw16(msg, state.range(0));
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    /* A new String each time, as in a sketch's loop() */
+    String s;
+    msg.restart();
+    benchmark::DoNotOptimize(msg.unpack(s));
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_unpack_String)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+
+/*
+ * Search, skip and count
+ */
+
+static void BM_unpack_find_key(benchmark::State& state)
+{
+  /* Look up the Nth key of a 12-item flat map */
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  const char *key = sensorKeys[state.range(0)];
+
+  packFlatMap(msg, SENSOR_KEY_COUNT);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(msg.unpack_find(key));
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_unpack_find_key)->Arg(0)->Arg(SENSOR_KEY_COUNT / 2)->Arg(SENSOR_KEY_COUNT - 1);
+
+static void BM_unpack_find_all_keys(benchmark::State& state)
+{
+  /* A command handler reading every field of a flat map by name */
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  int16_t value;
+
+  packFlatMap(msg, SENSOR_KEY_COUNT);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    for (uint16_t i = 0; i < SENSOR_KEY_COUNT; i++)
+    {
+      msg.unpack_find(sensorKeys[i]);
+      msg.unpack(value);
+      benchmark::DoNotOptimize(value);
+    }
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_unpack_find_all_keys);
+
+static void BM_unpack_find_key_copied(benchmark::State& state)
+{
+  /* A received block copied into a message before it is read */
+  BERGCloudMessage packed(SCRATCH_SIZE_BYTES);
+  int16_t value;
+
+  packFlatMap(packed, SENSOR_KEY_COUNT);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    BERGCloudMessage msg(packed.used());
+    memcpy(msg.ptr(), packed.ptr(), packed.used());
+    msg.used(packed.used());
+    msg.unpack_find(sensorKeys[SENSOR_KEY_COUNT - 1]);
+    msg.unpack(value);
+    benchmark::DoNotOptimize(value);
+  }
+
+  report.done(packed.used());
+}
+BENCHMARK(BM_unpack_find_key_copied);
+
+static void BM_unpack_find_key_view(benchmark::State& state)
+{
+  /* The same block read in place */
+  BERGCloudMessage packed(SCRATCH_SIZE_BYTES);
+  int16_t value;
+
+  packFlatMap(packed, SENSOR_KEY_COUNT);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    BERGCloudMessageView msg(packed.ptr(), packed.used());
+    msg.unpack_find(sensorKeys[SENSOR_KEY_COUNT - 1]);
+    msg.unpack(value);
+    benchmark::DoNotOptimize(value);
+  }
+
+  report.done(packed.used());
+}
+BENCHMARK(BM_unpack_find_key_view);
+
+static void BM_unpack_find_index(benchmark::State& state)
+{
+  /* Look up an index of a 100-item array; indexes start from 1 */
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+
+  packLongArray(msg, 100);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(msg.unpack_find((uint16_t)state.range(0)));
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_unpack_find_index)->Arg(1)->Arg(50)->Arg(100);
+
+static void BM_unpack_find_path(benchmark::State& state)
+{
+  /* Look up an item of an array nested two maps down */
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  char path[32];
+
+  packNestedConfig(msg, 16);
+  snprintf(path, sizeof(path), "config.thresholds[%d]", (int)state.range(0));
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(msg.unpack_find(path));
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_unpack_find_path)->Arg(1)->Arg(16);
+
+static void skipAll(benchmark::State& state, BERGCloudMessage& msg)
+{
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.restart();
+    while (msg.remaining() > 0)
+    {
+      benchmark::DoNotOptimize(msg.unpack_skip());
+    }
+  }
+
+  report.done(msg.used());
+}
+
+static void BM_unpack_skip_flat_map(benchmark::State& state)
+{
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  packFlatMap(msg, state.range(0));
+  skipAll(state, msg);
+}
+BENCHMARK(BM_unpack_skip_flat_map)->Arg(4)->Arg(12);
+
+static void BM_unpack_skip_long_array(benchmark::State& state)
+{
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  packLongArray(msg, state.range(0));
+  skipAll(state, msg);
+}
+BENCHMARK(BM_unpack_skip_long_array)->Arg(16)->Arg(100);
+
+static void BM_unpack_skip_raw16(benchmark::State& state)
+{
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  packRaw16(msg, state.range(0));
+  skipAll(state, msg);
+}
+BENCHMARK(BM_unpack_skip_raw16)->Arg(64)->Arg(1024);
+
+static void BM_unpack_skip_nested(benchmark::State& state)
+{
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  packNestedConfig(msg, state.range(0));
+  skipAll(state, msg);
+}
+BENCHMARK(BM_unpack_skip_nested)->Arg(16)->Arg(100);
+
+static void countAll(benchmark::State& state, BERGCloudMessage& msg)
+{
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(msg.count());
+  }
+
+  report.done(msg.used());
+}
+
+static void BM_count_flat_map(benchmark::State& state)
+{
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  packFlatMap(msg, state.range(0));
+  countAll(state, msg);
+}
+BENCHMARK(BM_count_flat_map)->Arg(4)->Arg(12);
+
+static void BM_count_long_array(benchmark::State& state)
+{
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  packLongArray(msg, state.range(0));
+  countAll(state, msg);
+}
+BENCHMARK(BM_count_long_array)->Arg(16)->Arg(100);
+
+/*
+ * Sensor samples packed an item at a time versus in bulk
+ */
+
+enum { SAMPLES_ITEMS, SAMPLES_BULK, SAMPLES_DELTA };
+
+static void makeSamples(int16_t *samples, uint16_t items)
+{
+  /* An accelerometer axis: a slow swing with a little noise */
+  for (uint16_t i = 0; i < items; i++)
+  {
+    samples[i] = (int16_t)(((i % 64) < 32 ? (i % 32) : 32 - (i % 32)) * 40 + (i * 7) % 13 - 600);
+  }
+}
+
+static bool packSamples(BERGCloudMessage& msg, const int16_t *samples, uint16_t items, int method)
+{
+  if (method != SAMPLES_ITEMS)
+  {
+    return msg.pack_array_of(samples, items, method == SAMPLES_DELTA);
+  }
+
+  if (!msg.pack_array(items))
+  {
+    return false;
+  }
+
+  for (uint16_t i = 0; i < items; i++)
+  {
+    if (!msg.pack(samples[i]))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void BM_pack_samples(benchmark::State& state)
+{
+  uint16_t items = state.range(0);
+  int16_t samples[items];
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  BenchReport report(state);
+
+  makeSamples(samples, items);
+
+  for (auto _ : state)
+  {
+    msg.clear();
+    benchmark::DoNotOptimize(packSamples(msg, samples, items, state.range(1)));
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_pack_samples)->ArgNames({"samples", "method"})
+  ->ArgsProduct({{100, 500}, {SAMPLES_ITEMS, SAMPLES_BULK, SAMPLES_DELTA}});
+
+static void BM_unpack_samples(benchmark::State& state)
+{
+  uint16_t items = state.range(0);
+  int16_t samples[items];
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  uint16_t unpacked;
+
+  makeSamples(samples, items);
+  packSamples(msg, samples, items, state.range(1));
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.restart();
+    benchmark::DoNotOptimize(msg.unpack_array_of(samples, items, unpacked));
+    benchmark::ClobberMemory();
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_unpack_samples)->ArgNames({"samples", "method"})
+  ->ArgsProduct({{100, 500}, {SAMPLES_ITEMS, SAMPLES_BULK, SAMPLES_DELTA}});
+
+/*
+ * Structs packed by hand versus from a schema
+ */
+
+enum { STRUCT_BY_HAND, STRUCT_SCHEMA };
+
+struct StatusEvent {
+  uint32_t sequence;
+  uint16_t battery;
+  int16_t temperature;
+  uint8_t humidity;
+  int32_t pressure;
+  float light;
+  bool door;
+  char status[12];
+};
+
+BC_SCHEMA_BEGIN(statusSchema)
+  BC_SCHEMA_FIELD(StatusEvent, sequence)
+  BC_SCHEMA_FIELD(StatusEvent, battery)
+  BC_SCHEMA_FIELD(StatusEvent, temperature)
+  BC_SCHEMA_FIELD(StatusEvent, humidity)
+  BC_SCHEMA_FIELD(StatusEvent, pressure)
+  BC_SCHEMA_FIELD(StatusEvent, light)
+  BC_SCHEMA_FIELD(StatusEvent, door)
+  BC_SCHEMA_FIELD(StatusEvent, status)
+BC_SCHEMA_END(statusSchema)
+
+static const StatusEvent statusEvent = { 1234, 3300, 2150, 45, 101325, 312.5f, true, "charging" };
+
+static bool packStatus(BERGCloudMessage& msg, const StatusEvent& e, int method)
+{
+  if (method == STRUCT_SCHEMA)
+  {
+    return msg.pack_schema(statusSchema, &e);
+  }
+
+  return msg.pack_map(8) &&
+    msg.pack("sequence") && msg.pack(e.sequence) &&
+    msg.pack("battery") && msg.pack(e.battery) &&
+    msg.pack("temperature") && msg.pack(e.temperature) &&
+    msg.pack("humidity") && msg.pack(e.humidity) &&
+    msg.pack("pressure") && msg.pack(e.pressure) &&
+    msg.pack("light") && msg.pack(e.light) &&
+    msg.pack("door") && msg.pack(e.door) &&
+    msg.pack("status") && msg.pack(e.status);
+}
+
+static bool unpackStatus(BERGCloudMessageView& msg, StatusEvent& e, int method)
+{
+  if (method == STRUCT_SCHEMA)
+  {
+    return msg.unpack_schema(statusSchema, &e);
+  }
+
+  return msg.unpack_find("sequence") && msg.unpack(e.sequence) &&
+    msg.unpack_find("battery") && msg.unpack(e.battery) &&
+    msg.unpack_find("temperature") && msg.unpack(e.temperature) &&
+    msg.unpack_find("humidity") && msg.unpack(e.humidity) &&
+    msg.unpack_find("pressure") && msg.unpack(e.pressure) &&
+    msg.unpack_find("light") && msg.unpack(e.light) &&
+    msg.unpack_find("door") && msg.unpack(e.door) &&
+    msg.unpack_find("status") && msg.unpack(e.status, sizeof(e.status));
+}
+
+static void BM_pack_struct(benchmark::State& state)
+{
+  BERGCloudMessage msg(SCRATCH_SIZE_BYTES);
+  msg.pack_smallest(state.range(1) != 0);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    msg.clear();
+    benchmark::DoNotOptimize(packStatus(msg, statusEvent, state.range(0)));
+  }
+
+  report.done(msg.used());
+}
+BENCHMARK(BM_pack_struct)->ArgNames({"method", "smallest"})
+  ->ArgsProduct({{STRUCT_BY_HAND, STRUCT_SCHEMA}, {0, 1}});
+
+static void BM_unpack_struct(benchmark::State& state)
+{
+  /* A new view each time, as for each received command, */
+  /* so unpack_find() builds its index again */
+  BERGCloudMessage packed(SCRATCH_SIZE_BYTES);
+  StatusEvent e;
+
+  packStatus(packed, statusEvent, STRUCT_BY_HAND);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    BERGCloudMessageView msg(packed.ptr(), packed.used());
+    benchmark::DoNotOptimize(unpackStatus(msg, e, state.range(0)));
+    benchmark::ClobberMemory();
+  }
+
+  report.done(packed.used());
+}
+BENCHMARK(BM_unpack_struct)->ArgNames({"method"})->Arg(STRUCT_BY_HAND)->Arg(STRUCT_SCHEMA);
+
+/*
+ * Commands decoded as they arrive versus buffered then unpacked
+ */
+
+enum { ARRIVAL_BUFFERED, ARRIVAL_STREAMED };
+
+class StatusHandler : public BERGCloudStreamHandler
+{
+public:
+  StatusHandler(StatusEvent& e) : e(e), keyLength(0), valueLength(0), inKey(false) {}
+  bool rawStart(uint16_t /* size */, bool key)
+  {
+    inKey = key;
+    if (key)
+    {
+      keyLength = 0;
+    }
+    valueLength = 0;
+    return true;
+  }
+  bool rawData(const uint8_t *data, uint16_t size)
+  {
+    char *to = inKey ? key : e.status;
+    uint8_t& length = inKey ? keyLength : valueLength;
+    uint8_t limit = inKey ? sizeof(key) - 1 : sizeof(e.status) - 1;
+
+    while ((size-- > 0) && (length < limit))
+    {
+      to[length++] = *data++;
+    }
+    to[length] = '\0';
+    return true;
+  }
+  bool integer(int32_t value)
+  {
+    if (strcmp(key, "sequence") == 0) e.sequence = value;
+    else if (strcmp(key, "battery") == 0) e.battery = value;
+    else if (strcmp(key, "temperature") == 0) e.temperature = value;
+    else if (strcmp(key, "humidity") == 0) e.humidity = value;
+    else if (strcmp(key, "pressure") == 0) e.pressure = value;
+    return true;
+  }
+  bool real(float value) { e.light = value; return true; }
+  bool boolean(bool value) { e.door = value; return true; }
+
+private:
+  StatusEvent& e;
+  char key[MAX_MAP_KEY_STRING_LENGTH + 1];
+  uint8_t keyLength;
+  uint8_t valueLength;
+  bool inKey;
+};
+
+static void BM_unpack_arriving(benchmark::State& state)
+{
+  /* The status event arrives 'chunk' bytes at a time; it is either */
+  /* collected in a buffer and unpacked once whole, or decoded as */
+  /* each chunk arrives. Bytes held between chunks are workset/op. */
+  uint16_t chunk = state.range(0);
+  BERGCloudMessage packed(SCRATCH_SIZE_BYTES);
+  BERGCloudMessage buffer(SCRATCH_SIZE_BYTES);
+  StatusEvent e;
+  StatusHandler handler(e);
+  BERGCloudStreamDecoder decoder(handler);
+  uint16_t offset;
+  uint16_t size;
+
+  packStatus(packed, statusEvent, STRUCT_BY_HAND);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    buffer.clear();
+    decoder.reset();
+    for (offset = 0; offset < packed.used(); offset += size)
+    {
+      size = (packed.used() - offset < chunk) ? packed.used() - offset : chunk;
+      if (state.range(1) == ARRIVAL_STREAMED)
+      {
+        decoder.feed(packed.ptr() + offset, size);
+      }
+      else
+      {
+        buffer.write(packed.ptr() + offset, size);
+      }
+    }
+    if (state.range(1) == ARRIVAL_BUFFERED)
+    {
+      benchmark::DoNotOptimize(buffer.unpack_schema(statusSchema, &e));
+    }
+    benchmark::ClobberMemory();
+  }
+
+  report.done(packed.used());
+  state.counters["workset/op"] = (state.range(1) == ARRIVAL_STREAMED) ?
+    sizeof(decoder) : packed.used();
+}
+BENCHMARK(BM_unpack_arriving)->ArgNames({"chunk", "method"})
+  ->ArgsProduct({{1, 16, 64}, {ARRIVAL_BUFFERED, ARRIVAL_STREAMED}});
+
+/*
+ * Buffer copy, a byte at a time versus in bulk
+ */
+
+static void BM_buffer_write_bytes(benchmark::State& state)
+{
+  uint16_t size = state.range(0);
+  uint8_t data[size];
+  BERGCloudMessageBuffer buffer(SCRATCH_SIZE_BYTES);
+  BenchReport report(state);
+
+  memset(data, 0x55, size);
+
+  for (auto _ : state)
+  {
+    buffer.clear();
+    for (uint16_t i = 0; i < size; i++)
+    {
+      buffer.add(data[i]);
+    }
+    benchmark::ClobberMemory();
+  }
+
+  report.done(size);
+}
+BENCHMARK(BM_buffer_write_bytes)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+
+static void BM_buffer_write_bulk(benchmark::State& state)
+{
+  uint16_t size = state.range(0);
+  uint8_t data[size];
+  BERGCloudMessageBuffer buffer(SCRATCH_SIZE_BYTES);
+  BenchReport report(state);
+
+  memset(data, 0x55, size);
+
+  for (auto _ : state)
+  {
+    buffer.clear();
+    benchmark::DoNotOptimize(buffer.write(data, size));
+    benchmark::ClobberMemory();
+  }
+
+  report.done(size);
+}
+BENCHMARK(BM_buffer_write_bulk)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+
+static void BM_buffer_read_bytes(benchmark::State& state)
+{
+  uint16_t size = state.range(0);
+  uint8_t data[size];
+  BERGCloudMessageBuffer buffer(SCRATCH_SIZE_BYTES);
+
+  memset(data, 0x55, size);
+  buffer.write(data, size);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    buffer.restart();
+    for (uint16_t i = 0; i < size; i++)
+    {
+      data[i] = buffer.read();
+    }
+    benchmark::ClobberMemory();
+  }
+
+  report.done(size);
+}
+BENCHMARK(BM_buffer_read_bytes)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+
+static void BM_buffer_read_bulk(benchmark::State& state)
+{
+  uint16_t size = state.range(0);
+  uint8_t data[size];
+  BERGCloudMessageBuffer buffer(SCRATCH_SIZE_BYTES);
+
+  memset(data, 0x55, size);
+  buffer.write(data, size);
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    buffer.restart();
+    benchmark::DoNotOptimize(buffer.read(data, size));
+    benchmark::ClobberMemory();
+  }
+
+  report.done(size);
+}
+BENCHMARK(BM_buffer_read_bulk)->Arg(16)->Arg(64)->Arg(256)->Arg(1024);
+
+/*
+ * Construction, as done for each poll and event
+ */
+
+static void BM_construct_message(benchmark::State& state)
+{
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    BERGCloudMessage msg;
+    benchmark::DoNotOptimize(msg.pack((uint8_t)1));
+  }
+
+  report.done(BC_DEFAULT_BUFFER_SIZE_BYTES);
+}
+BENCHMARK(BM_construct_message);
+
+static void BM_construct_static_message(benchmark::State& state)
+{
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    BERGCloudStaticMessage<BC_DEFAULT_BUFFER_SIZE_BYTES> msg;
+    benchmark::DoNotOptimize(msg.pack((uint8_t)1));
+  }
+
+  report.done(BC_DEFAULT_BUFFER_SIZE_BYTES);
+}
+BENCHMARK(BM_construct_static_message);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,628 @@
+/*
+
+Benchmarks for the BERGCloud JSON and binary WebSocket transports
+
+Connects a device to an in-process HostBridge over the loopback interface,
+once with JSON text frames and once with binary frames, and times sending
+an event and receiving a command on the device. Each benchmark reports the
+bytes on the wire, including WebSocket framing, and the heap allocations
+made per operation.
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+
+#include "BenchCommon.h"
+#include "HostBridge.h"
+#include "aJSON.h"
+
+#define RECEIVE_TIMEOUT_MS 5000
+#define EVENT_ITEMS        8
+
+#define TRANSPORT_JSON     0
+#define TRANSPORT_BINARY   1
+
+/* Gives the benchmarks the device's own command polling */
+class TransportDevice : public BERGCloudCC3000
+{
+public:
+  using BERGCloudCC3000::pollForDeviceCommand;
+};
+
+/* A device connected to its own bridge */
+struct TransportLink
+{
+  HostBridge bridge;
+  TransportDevice device;
+  bool ready;
+};
+
+static TransportLink links[2];
+
+/* Device ID given during setup */
+static const uint8_t deviceID[BC_DEVICE_ID_SIZE_BYTES] = {8, 7, 6, 5, 4, 3, 2, 1};
+
+static bool receiveType(HostBridge& bridge, uint8_t type)
+{
+  static BRIDGE_MESSAGE message;
+  return bridge.receive(message, RECEIVE_TIMEOUT_MS) == type;
+}
+
+/* Wait for a command to arrive at the device */
+static bool pollUntilReceived(TransportDevice& device)
+{
+  uint32_t start = millis();
+
+  while ((millis() - start) < RECEIVE_TIMEOUT_MS)
+  {
+    if (device.pollForDeviceCommand())
+    {
+      /* Polling again sends anything the device left in its buffer */
+      device.pollForDeviceCommand();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+static bool setUp(TransportLink& link, bool binary)
+{
+  BERGCloudWLANConfig WLANConfig;
+  char port[8];
+  bool accepted = false;
+
+  if (!link.bridge.listen())
+  {
+    return false;
+  }
+
+  /* The host CC3000 stand-in connects wherever these point */
+  snprintf(port, sizeof(port), "%u", link.bridge.port());
+  setenv("CC3000_HOST", "127.0.0.1", 1);
+  setenv("CC3000_PORT", port, 1);
+
+  std::thread handshake([&] { accepted = link.bridge.accept(binary); });
+
+  WLANConfig.ssid = "host";
+  WLANConfig.pass = "";
+  link.device.begin(WLANConfig);
+
+  if (!link.device.connect("00000000000000000000000000000000", 1))
+  {
+    handshake.join();
+    return false;
+  }
+
+  handshake.join();
+
+  /* Send the rest of the connect event */
+  link.device.pollForDeviceCommand();
+
+  if (!accepted || (link.bridge.binary() != binary) ||
+      !receiveType(link.bridge, BRIDGE_CONNECT))
+  {
+    return false;
+  }
+
+  /* Claim the device so that it takes named commands */
+  uint8_t data[BC_DEVICE_ID_SIZE_BYTES];
+
+  for (uint8_t i = 0; i < sizeof(data); i++)
+  {
+    data[i] = deviceID[sizeof(data) - i - 1];
+  }
+
+  if (!link.bridge.sendCommand(BC_COMMAND_SET_ADDRESS, 1, data, sizeof(data)) ||
+      !pollUntilReceived(link.device) ||
+      !receiveType(link.bridge, BRIDGE_RESPONSE))
+  {
+    return false;
+  }
+
+  return true;
+}
+
+static TransportLink *connectedLink(benchmark::State& state)
+{
+  int transport = state.range(0);
+  TransportLink& link = links[transport];
+
+  if (!link.ready)
+  {
+    setenv("BC_HOST_EEPROM", "bergcloud_transport_bench.eeprom", 1);
+    link.ready = setUp(link, transport == TRANSPORT_BINARY);
+  }
+
+  if (!link.ready)
+  {
+    state.SkipWithError("Unable to connect to the bridge");
+    return NULL;
+  }
+
+  return &link;
+}
+
+/*
+ * Events
+ */
+
+static void BM_send_event(benchmark::State& state)
+{
+  TransportLink *link = connectedLink(state);
+  BERGCloudMessage msg(128, BC_EVENT_HEADROOM_BYTES);
+  std::atomic<bool> draining(true);
+  uint32_t mark;
+
+  if (link == NULL)
+  {
+    return;
+  }
+
+  if (!packFlatMap(msg, EVENT_ITEMS))
+  {
+    state.SkipWithError("Unable to pack the event");
+    return;
+  }
+
+  /* Measure one event on the wire; polling flushes the client's buffer */
+  mark = link->bridge.bytesReceived;
+  link->device.sendEvent("sensors", msg);
+  link->device.pollForDeviceCommand();
+
+  if (!receiveType(link->bridge, BRIDGE_EVENT))
+  {
+    state.SkipWithError("The bridge did not receive the event");
+    return;
+  }
+
+  mark = link->bridge.bytesReceived - mark;
+
+  /* Keep the socket drained while the device sends */
+  std::thread drain([&] {
+    static BRIDGE_MESSAGE message;
+    while (draining)
+    {
+      link->bridge.receive(message, 100);
+    }
+    while (link->bridge.receive(message, 100) != BRIDGE_NONE)
+    {
+    }
+  });
+
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    if (!link->device.sendEvent("sensors", msg))
+    {
+      state.SkipWithError("sendEvent() failed");
+      break;
+    }
+  }
+
+  report.done(mark);
+  link->device.pollForDeviceCommand();
+  draining = false;
+  drain.join();
+}
+BENCHMARK(BM_send_event)->ArgName("binary")->Arg(TRANSPORT_JSON)->Arg(TRANSPORT_BINARY);
+
+/*
+ * Envelopes
+ */
+
+#define ENVELOPE_AJSON     0
+#define ENVELOPE_STREAMED  1
+
+BC_JSON_TEMPLATE(eventTemplate) =
+  "{\"type\":\"DeviceEvent\",\"bridge_address\":\"" BC_JSON_FIELD_1 "\","
+  "\"device_address\":\"" BC_JSON_FIELD_1 "\",\"binary_payload\":\"" BC_JSON_FIELD_2 "\","
+  "\"timestamp\":0}";
+
+/* The JSON around an event's base64 payload, built as an aJson tree */
+/* and printed, as it used to be, or written from a template */
+static void BM_event_envelope(benchmark::State& state)
+{
+  static const uint8_t address[BC_DEVICE_ID_SIZE_BYTES] = {8, 7, 6, 5, 4, 3, 2, 1};
+  uint8_t payload[64];
+  char encoded[base64_enc_len(sizeof(payload)) + 1];
+  char text[512];
+  uint16_t size = 0;
+
+  for (uint8_t i = 0; i < sizeof(payload); i++)
+  {
+    payload[i] = i * 7;
+  }
+
+  base64_encode(encoded, (char *)payload, sizeof(payload));
+
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    if (state.range(0) == ENVELOPE_AJSON)
+    {
+      String addressString;
+
+      for (uint8_t i = 0; i < sizeof(address); i++)
+      {
+        addressString += "0123456789abcdef"[address[i] >> 4];
+        addressString += "0123456789abcdef"[address[i] & 0xf];
+      }
+
+      aJsonObject *root = aJson.createObject();
+      aJson.addItemToObject(root, "type", aJson.createItem("DeviceEvent"));
+      aJson.addItemToObject(root, "bridge_address", aJson.createItem(addressString.c_str()));
+      aJson.addItemToObject(root, "device_address", aJson.createItem(addressString.c_str()));
+      aJson.addItemToObject(root, "binary_payload", aJson.createItem(encoded));
+      aJson.addItemToObject(root, "timestamp", aJson.createItem((uint32_t)0));
+
+      char *printed = aJson.print(root);
+      size = strlen(printed);
+      memcpy(text, printed, size);
+      free(printed);
+      aJson.deleteItem(root);
+    }
+    else
+    {
+      BC_JSON_FIELD fields[] = {
+        {BC_JSON_HEX, address, sizeof(address), 0},
+        {BC_JSON_TEXT, encoded, 0, 0}
+      };
+      BERGCloudJSONWriter json(eventTemplate, fields);
+      uint16_t chunkSize;
+
+      size = 0;
+      json.size();
+
+      /* In chunks, as sendJSON() does */
+      while ((chunkSize = json.read((uint8_t *)&text[size], 16)) > 0)
+      {
+        size += chunkSize;
+      }
+    }
+
+    benchmark::DoNotOptimize(text);
+  }
+
+  report.done(size);
+}
+BENCHMARK(BM_event_envelope)->ArgName("template")->Arg(ENVELOPE_AJSON)->Arg(ENVELOPE_STREAMED);
+
+/* An event header and payload base64 encoded as it used to be, copied */
+/* together and encoded into buffers the size of the event, or encoded */
+/* a segment at a time in chunks, as sendDeviceEvent() does now. The */
+/* 'stack' counter is the bytes of buffer each needs */
+static void BM_event_payload(benchmark::State& state)
+{
+  uint16_t dataSize = state.range(1);
+  uint8_t header[BC_EVENT_HEADER_SIZE_BYTES];
+  uint8_t *data = (uint8_t *)malloc(dataSize);
+  char *text = (char *)malloc(BC_BASE64_SIZE(sizeof(header) + dataSize) + 1);
+  uint16_t textSize = 0;
+  uint32_t stack = 0;
+
+  for (uint8_t i = 0; i < sizeof(header); i++)
+  {
+    header[i] = i;
+  }
+
+  for (uint16_t i = 0; i < dataSize; i++)
+  {
+    data[i] = i * 7;
+  }
+
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    if (state.range(0) == ENVELOPE_AJSON)
+    {
+      uint8_t binaryData[sizeof(header) + dataSize];
+      int8_t encodedData[base64_enc_len(sizeof(binaryData)) + 1];
+
+      memcpy(&binaryData[0], header, sizeof(header));
+      memcpy(&binaryData[sizeof(header)], data, dataSize);
+      textSize = base64_encode((char *)encodedData, (char *)binaryData, sizeof(binaryData));
+
+      /* Then written out */
+      memcpy(text, encodedData, textSize);
+      stack = sizeof(binaryData) + sizeof(encodedData);
+    }
+    else
+    {
+      BERGCloudBase64Encoder base64;
+      const uint8_t *segments[] = {header, data};
+      uint16_t sizes[] = {sizeof(header), dataSize};
+      char chunk[16];
+
+      textSize = 0;
+
+      for (uint8_t i = 0; i < 2; i++)
+      {
+        const uint8_t *next = segments[i];
+        uint16_t size = sizes[i];
+
+        while (size > 0)
+        {
+          uint16_t chunkSize = base64.encode(next, size, chunk, sizeof(chunk));
+          memcpy(&text[textSize], chunk, chunkSize);
+          textSize += chunkSize;
+        }
+      }
+
+      textSize += base64.end(&text[textSize]);
+      stack = sizeof(chunk) + sizeof(base64);
+    }
+
+    benchmark::DoNotOptimize(text);
+  }
+
+  text[textSize] = '\0';
+  state.counters["stack"] = stack;
+
+  if (textSize != BC_BASE64_SIZE(sizeof(header) + dataSize))
+  {
+    state.SkipWithError("The payload was not encoded");
+  }
+
+  report.done(textSize);
+  free(text);
+  free(data);
+}
+BENCHMARK(BM_event_payload)->ArgNames({"streamed", "bytes"})
+  ->Args({ENVELOPE_AJSON, 64})->Args({ENVELOPE_STREAMED, 64})
+  ->Args({ENVELOPE_AJSON, 1024})->Args({ENVELOPE_STREAMED, 1024});
+
+/* The payload of a DeviceCommand decoded as it used to be: line */
+/* breaks stripped, the size worked out, then the base64 decoded */
+static uint16_t decodeInPasses(uint8_t *binary, char *text)
+{
+  char *in, *out;
+  in = out = text;
+
+  do {
+    if (*in != '\n')
+    {
+      *out++ = *in;
+    }
+  } while (*in++ != '\0');
+
+  uint16_t size = base64_dec_len(text, strlen(text));
+  base64_decode((char *)binary, text, strlen(text));
+  return size;
+}
+
+/* A DeviceCommand, as the bridge sends it, parsed into an aJson tree */
+/* from a String and its payload decoded, as it used to be, or read a */
+/* chunk at a time with the payload decoded as it arrives */
+static void BM_command_envelope(benchmark::State& state)
+{
+  uint8_t command[48];
+  char encoded[base64_enc_len(sizeof(command)) + 1];
+  char text[256];
+  uint8_t binary[BC_COMMAND_POOL_BLOCK_SIZE_BYTES];
+  uint32_t commandID = 0;
+
+  for (uint8_t i = 0; i < sizeof(command); i++)
+  {
+    command[i] = i * 7;
+  }
+
+  base64_encode(encoded, (char *)command, sizeof(command));
+  snprintf(text, sizeof(text),
+    "{\"type\":\"DeviceCommand\",\"bridge_address\":\"0807060504030201\","
+    "\"device_address\":\"0807060504030201\",\"command_id\":123456,"
+    "\"binary_payload\":\"%s\",\"timestamp\":1400000000}", encoded);
+
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    if (state.range(0) == ENVELOPE_AJSON)
+    {
+      /* getData() grew the String a byte at a time */
+      String received;
+
+      for (const char *c = text; *c != '\0'; c++)
+      {
+        received += *c;
+      }
+
+      aJsonObject *root = aJson.parse((char *)received.c_str());
+      aJsonObject *type = aJson.getObjectItem(root, "type");
+      aJsonObject *payload = aJson.getObjectItem(root, "binary_payload");
+      aJsonObject *id = aJson.getObjectItem(root, "command_id");
+
+      if ((type != NULL) && (payload != NULL) && (id != NULL))
+      {
+        commandID = id->valueint;
+        benchmark::DoNotOptimize(decodeInPasses(binary, payload->valuestring));
+      }
+
+      aJson.deleteItem(root);
+    }
+    else
+    {
+      char type[sizeof("DeviceCommand")];
+      BC_JSON_MEMBER members[] = {
+        {"type", BC_JSON_STRING, type, sizeof(type), 0, 0, false},
+        {"binary_payload", BC_JSON_BASE64, (char *)binary, sizeof(binary), 0, 0, false},
+        {"command_id", BC_JSON_NUMBER, NULL, 0, 0, 0, false}
+      };
+      BERGCloudJSONReader json(members, 3);
+      uint16_t size = strlen(text);
+
+      /* In chunks, as receiveJSON() does */
+      for (uint16_t offset = 0; offset < size; offset += 16)
+      {
+        json.feed((uint8_t *)&text[offset], ((size - offset) < 16) ? (size - offset) : 16);
+      }
+
+      if (json.done() && members[1].found && members[2].found)
+      {
+        commandID = members[2].number;
+        benchmark::DoNotOptimize(binary);
+      }
+    }
+  }
+
+  if (commandID != 123456)
+  {
+    state.SkipWithError("The command was not read");
+  }
+
+  report.done(strlen(text));
+}
+BENCHMARK(BM_command_envelope)->ArgName("reader")->Arg(ENVELOPE_AJSON)->Arg(ENVELOPE_STREAMED);
+
+/* A command pool block's worth of payload, in base64 with a line */
+/* break every 76 characters, decoded in passes over a copy of the */
+/* text or as it arrives in chunks */
+static void BM_command_payload(benchmark::State& state)
+{
+  uint8_t command[BC_COMMAND_POOL_BLOCK_SIZE_BYTES];
+  char encoded[base64_enc_len(sizeof(command)) + 1];
+  char text[sizeof(encoded) + (sizeof(encoded) / 76) + 1];
+  char copy[sizeof(text)];
+  uint8_t binary[BC_COMMAND_POOL_BLOCK_SIZE_BYTES];
+  uint16_t textSize = 0;
+  uint16_t size = 0;
+
+  for (uint16_t i = 0; i < sizeof(command); i++)
+  {
+    command[i] = i * 7;
+  }
+
+  base64_encode(encoded, (char *)command, sizeof(command));
+
+  for (uint16_t i = 0; encoded[i] != '\0'; i++)
+  {
+    if ((i > 0) && ((i % 76) == 0))
+    {
+      text[textSize++] = '\n';
+    }
+
+    text[textSize++] = encoded[i];
+  }
+
+  text[textSize] = '\0';
+
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    if (state.range(0) == ENVELOPE_AJSON)
+    {
+      /* The reader kept the text, then it was decoded from there */
+      memcpy(copy, text, textSize + 1);
+      size = decodeInPasses(binary, copy);
+    }
+    else
+    {
+      BERGCloudBase64Decoder base64;
+
+      base64.begin(binary, sizeof(binary));
+
+      for (uint16_t offset = 0; offset < textSize; offset += 16)
+      {
+        base64.feed(&text[offset], ((textSize - offset) < 16) ? (textSize - offset) : 16);
+      }
+
+      size = base64.end() ? base64.used() : 0;
+    }
+
+    benchmark::DoNotOptimize(binary);
+  }
+
+  if ((size != sizeof(command)) || (memcmp(binary, command, sizeof(command)) != 0))
+  {
+    state.SkipWithError("The payload was not decoded");
+  }
+
+  report.done(textSize);
+}
+BENCHMARK(BM_command_payload)->ArgName("streamed")->Arg(ENVELOPE_AJSON)->Arg(ENVELOPE_STREAMED);
+
+/*
+ * Commands
+ */
+
+static void BM_receive_command(benchmark::State& state)
+{
+  TransportLink *link = connectedLink(state);
+  BERGCloudMessage command;
+  uint32_t commandID = 2;
+  uint32_t mark;
+
+  if (link == NULL)
+  {
+    return;
+  }
+
+  /* A named command with a small map as its payload */
+  if (!command.pack("led") || !command.pack_map(2) ||
+      !command.pack("colour") || !command.pack((uint32_t)0xff8000) ||
+      !command.pack("duration") || !command.pack((uint16_t)500))
+  {
+    state.SkipWithError("Unable to pack the command");
+    return;
+  }
+
+  mark = link->bridge.bytesSent;
+  link->bridge.sendCommand(BC_COMMAND_NAMED_PACKED, commandID++, command.ptr(), command.used());
+  mark = link->bridge.bytesSent - mark;
+
+  if (!pollUntilReceived(link->device))
+  {
+    state.SkipWithError("The device did not receive the command");
+    return;
+  }
+
+  BenchReport report(state);
+
+  for (auto _ : state)
+  {
+    /* The command is on the loopback socket before timing resumes; */
+    /* the device releases the last one, unread, as it takes the next */
+    state.PauseTiming();
+    link->bridge.sendCommand(BC_COMMAND_NAMED_PACKED, commandID++, command.ptr(), command.used());
+    state.ResumeTiming();
+
+    if (!link->device.pollForDeviceCommand())
+    {
+      state.SkipWithError("pollForDeviceCommand() failed");
+      break;
+    }
+  }
+
+  report.done(mark);
+}
+BENCHMARK(BM_receive_command)->ArgName("binary")->Arg(TRANSPORT_JSON)->Arg(TRANSPORT_BINARY);
+
+BENCHMARK_MAIN();
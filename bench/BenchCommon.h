@@ -0,0 +1,130 @@
+/*
+
+Shared helpers for the host benchmarks
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BENCHCOMMON_H
+#define BENCHCOMMON_H
+
+#include <benchmark/benchmark.h>
+
+#include "BERGCloudCC3000.h"
+#include "AllocCounter.h"
+
+/* Sensor names used as map keys; all fit MAX_MAP_KEY_STRING_LENGTH */
+static const char *const sensorKeys[] = {
+  "temperature", "humidity", "battery", "rssi", "uptime", "light",
+  "pressure", "co2", "noise", "motion", "door", "voltage"
+};
+
+#define SENSOR_KEY_COUNT (sizeof(sensorKeys) / sizeof(sensorKeys[0]))
+
+/* Record allocations made inside the timed loop, and bytes handled per operation */
+class BenchReport
+{
+public:
+  BenchReport(benchmark::State& state) : _state(state), _allocations(AllocCounter::allocations()) {}
+  void done(uint32_t bytesPerOp)
+  {
+    _state.counters["allocs/op"] = benchmark::Counter(
+      (double)(AllocCounter::allocations() - _allocations), benchmark::Counter::kAvgIterations);
+    _state.counters["bytes/op"] = bytesPerOp;
+  }
+private:
+  benchmark::State& _state;
+  uint64_t _allocations;
+};
+
+/* A flat map of sensor name to 16-bit reading */
+static inline bool packFlatMap(BERGCloudMessageBase& msg, uint16_t items)
+{
+  if (!msg.pack_map(items))
+  {
+    return false;
+  }
+
+  for (uint16_t i = 0; i < items; i++)
+  {
+    if (!msg.pack(sensorKeys[i % SENSOR_KEY_COUNT]) || !msg.pack((int16_t)(i * 37 - 200)))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/* An array of 16-bit samples */
+static inline bool packLongArray(BERGCloudMessageBase& msg, uint16_t items)
+{
+  if (!msg.pack_array(items))
+  {
+    return false;
+  }
+
+  for (uint16_t i = 0; i < items; i++)
+  {
+    if (!msg.pack((int16_t)(i * 311 - 15000)))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/* A device configuration: a map holding a flat map of readings, */
+/* then a map of settings that holds an array of 'thresholds' */
+static inline bool packNestedConfig(BERGCloudMessageBase& msg, uint16_t thresholds)
+{
+  if (!msg.pack_map(2) || !msg.pack("readings") || !packFlatMap(msg, SENSOR_KEY_COUNT))
+  {
+    return false;
+  }
+
+  if (!msg.pack("config") || !msg.pack_map(3) ||
+      !msg.pack("interval") || !msg.pack((uint16_t)300) ||
+      !msg.pack("enabled") || !msg.pack(true) ||
+      !msg.pack("thresholds") || !packLongArray(msg, thresholds))
+  {
+    return false;
+  }
+
+  return true;
+}
+
+/* A block of raw data long enough to use the 16-bit raw header */
+static inline bool packRaw16(BERGCloudMessageBase& msg, uint16_t sizeInBytes)
+{
+  uint8_t data[sizeInBytes];
+
+  for (uint16_t i = 0; i < sizeInBytes; i++)
+  {
+    data[i] = (uint8_t)(i * 7);
+  }
+
+  return msg.pack(data, sizeInBytes);
+}
+
+#endif // #ifndef BENCHCOMMON_H
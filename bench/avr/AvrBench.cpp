@@ -0,0 +1,391 @@
+/*
+
+On-target benchmark of the BERGCloud library for the ATmega2560
+
+Runs each scenario once in simavr and prints the CPU cycles taken, the peak
+stack depth below the caller and the heap high-water mark. The WLAN and
+WebSocket server are scripted; see AvrNetwork.cpp.
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <stdio.h>
+
+#include "Arduino.h"
+#include "BERGCloudCC3000.h"
+#include "AvrBench.h"
+
+#define PROJECT_KEY "00000000000000000000000000000000"
+#define VERSION     1
+
+#define EVENT_FIELDS 10
+
+/* Painted below the stack to find its low-water mark */
+#define STACK_PAINT       0xC5
+#define STACK_PAINT_GUARD 64
+
+#define JSON_FRAME_MAX_BYTES 384
+
+extern "C" {
+extern char *__brkval;
+extern char __heap_start;
+}
+
+/* Exposes the device-side internals measured here */
+class BenchDevice : public BERGCloudCC3000
+{
+public:
+  using BERGCloudCC3000::pollForDeviceCommand;
+};
+
+/* A friend of BERGCloudBase, as readNVData() is private */
+class BERGCloudNVBench
+{
+public:
+  static bool readNVData(BERGCloudBase& base)
+  {
+    return base.readNVData();
+  }
+};
+
+static BenchDevice device;
+
+static const char *const eventKeys[EVENT_FIELDS] = {
+  "temperature", "humidity", "battery", "rssi", "uptime",
+  "light", "pressure", "co2", "noise", "motion"
+};
+
+/* Device ID sent by the scripted server */
+static const uint8_t deviceID[BC_DEVICE_ID_SIZE_BYTES] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+static uint32_t cycleOverhead;
+static uint32_t commandID = 1;
+
+/*
+ *  Scripted server
+ */
+
+static bool queueHandshake(void)
+{
+  static const char response[] =
+    "HTTP/1.1 101 Switching Protocols\r\n"
+    "Upgrade: websocket\r\n"
+    "Connection: Upgrade\r\n"
+    "\r\n";
+
+  return networkQueue((const uint8_t *)response, sizeof(response) - 1);
+}
+
+/* Queue a DeviceCommand with a binary payload as an unmasked text frame */
+static bool queueDeviceCommand(uint16_t cmd, const uint8_t *data, uint16_t dataSize)
+{
+  uint8_t binary[BC_COMMAND_HEADER_SIZE_BYTES + 64];
+  char encoded[((sizeof(binary) + 2) / 3) * 4 + 1];
+  char json[JSON_FRAME_MAX_BYTES];
+  uint8_t header[4];
+  uint8_t headerSize;
+  int jsonSize;
+
+  if (dataSize > (sizeof(binary) - BC_COMMAND_HEADER_SIZE_BYTES))
+  {
+    return false;
+  }
+
+  memset(binary, 0x00, BC_COMMAND_HEADER_SIZE_BYTES);
+  binary[2] = (uint8_t)cmd;
+  binary[3] = (uint8_t)(cmd >> 8);
+  memcpy(&binary[BC_COMMAND_HEADER_SIZE_BYTES], data, dataSize);
+
+  base64_encode(encoded, (char *)binary, BC_COMMAND_HEADER_SIZE_BYTES + dataSize);
+
+  jsonSize = snprintf(json, sizeof(json),
+    "{\"type\":\"DeviceCommand\",\"command_id\":%lu,\"binary_payload\":\"%s\"}",
+    (unsigned long)commandID++, encoded);
+
+  if ((jsonSize < 0) || (jsonSize >= (int)sizeof(json)))
+  {
+    return false;
+  }
+
+  header[0] = WS_FIN | WS_OPCODE_TEXT;
+
+  if (jsonSize > 125)
+  {
+    header[1] = WS_SIZE16;
+    header[2] = (uint8_t)(jsonSize >> 8);
+    header[3] = (uint8_t)jsonSize;
+    headerSize = 4;
+  }
+  else
+  {
+    header[1] = (uint8_t)jsonSize;
+    headerSize = 2;
+  }
+
+  return networkQueue(header, headerSize) && networkQueue((const uint8_t *)json, jsonSize);
+}
+
+static bool queueSetAddress(void)
+{
+  uint8_t data[BC_DEVICE_ID_SIZE_BYTES];
+  uint8_t i;
+
+  /* Sent least significant byte first */
+  for (i = 0; i < sizeof(data); i++)
+  {
+    data[i] = deviceID[sizeof(data) - i - 1];
+  }
+
+  return queueDeviceCommand(BC_COMMAND_SET_ADDRESS, data, sizeof(data));
+}
+
+/* A named command, "led", with a small map as its payload */
+static bool queueNamedCommand(void)
+{
+  BERGCloudMessage msg;
+
+  if (!msg.pack("led") || !msg.pack_map(2) ||
+      !msg.pack("colour") || !msg.pack((uint32_t)0xff8000) ||
+      !msg.pack("duration") || !msg.pack((uint16_t)500))
+  {
+    return false;
+  }
+
+  return queueDeviceCommand(BC_COMMAND_NAMED_PACKED, msg.ptr(), msg.used());
+}
+
+/*
+ *  Measurement
+ */
+
+static char *heapTop(void)
+{
+  return (__brkval != NULL) ? __brkval : &__heap_start;
+}
+
+/* Fill the free space between the heap and the stack */
+static void __attribute__((noinline)) stackPaint(void)
+{
+  uint8_t *p = (uint8_t *)heapTop() + STACK_PAINT_GUARD;
+  uint8_t *end = (uint8_t *)SP - STACK_PAINT_GUARD;
+
+  while (p < end)
+  {
+    *p++ = STACK_PAINT;
+  }
+}
+
+/* Lowest address written since stackPaint(), above the heap's highest break */
+static uint8_t *stackLowWater(uint8_t *paintStart)
+{
+  uint8_t *p = paintStart + heapBreakBytes();
+  uint8_t *end = (uint8_t *)SP - STACK_PAINT_GUARD;
+
+  while ((p < end) && (*p == STACK_PAINT))
+  {
+    p++;
+  }
+
+  return p;
+}
+
+typedef bool (*Scenario)(void);
+
+static void __attribute__((noinline)) run(const __FlashStringHelper *name, Scenario scenario)
+{
+  uint8_t *stackTop = (uint8_t *)SP;
+  uint8_t *paintStart = (uint8_t *)heapTop() + STACK_PAINT_GUARD;
+  uint32_t sent = networkBytesSent();
+  uint32_t start;
+  uint32_t cycles;
+  bool result;
+
+  heapTrackReset();
+  stackPaint();
+
+  start = cycleCount();
+  result = scenario();
+  cycles = cycleCount() - start - cycleOverhead;
+
+  Serial.print(name);
+  Serial.print(result ? F(": ") : F(": FAILED "));
+  Serial.print(F("cycles="));
+  Serial.print(cycles);
+  Serial.print(F(" us="));
+  Serial.print(cycles / (F_CPU / 1000000UL));
+  Serial.print(F(" stack="));
+  Serial.print((uint16_t)(stackTop - stackLowWater(paintStart)));
+  Serial.print(F(" heap_peak="));
+  Serial.print(heapPeakBytes());
+  Serial.print(F(" heap_leak="));
+  Serial.print(heapLiveBytes());
+  Serial.print(F(" brk+="));
+  Serial.print(heapBreakBytes());
+  Serial.print(F(" tx="));
+  Serial.println(networkBytesSent() - sent);
+}
+
+static void calibrate(void)
+{
+  uint32_t start = cycleCount();
+  cycleOverhead = cycleCount() - start;
+}
+
+/*
+ *  Scenarios
+ */
+
+static bool packEvent(void)
+{
+  BERGCloudMessage msg;
+  uint8_t i;
+
+  if (!msg.pack_map(EVENT_FIELDS))
+  {
+    return false;
+  }
+
+  for (i = 0; i < EVENT_FIELDS; i++)
+  {
+    if (!msg.pack(eventKeys[i]) || !msg.pack((int16_t)(i * 37 - 200)))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool packEventInto(BERGCloudMessage& msg)
+{
+  uint8_t i;
+
+  if (!msg.pack_map(EVENT_FIELDS))
+  {
+    return false;
+  }
+
+  for (i = 0; i < EVENT_FIELDS; i++)
+  {
+    if (!msg.pack(eventKeys[i]) || !msg.pack((int16_t)(i * 37 - 200)))
+    {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static bool sendEvent(void)
+{
+  BERGCloudMessage msg;
+
+  return packEventInto(msg) && device.sendEvent("sensors", msg);
+}
+
+static bool sendEventInPlace(void)
+{
+  BERGCloudStaticMessage<BC_DEFAULT_BUFFER_SIZE_BYTES, BC_EVENT_HEADROOM_BYTES> msg;
+
+  return packEventInto(msg) && device.sendEvent("sensors", msg);
+}
+
+static bool pollForDeviceCommand(void)
+{
+  return device.pollForDeviceCommand();
+}
+
+static bool pollForCommand(void)
+{
+  BERGCloudMessage msg;
+  String name;
+
+  return device.pollForCommand(msg, name) && (name == "led");
+}
+
+static bool pollForCommandInPlace(void)
+{
+  BERGCloudCommand command;
+  String name;
+
+  return device.pollForCommand(command, name) && (name == "led");
+}
+
+static bool readNVData(void)
+{
+  return BERGCloudNVBench::readNVData(device);
+}
+
+int main(void)
+{
+  BERGCloudWLANConfig WLANConfig;
+  uint8_t state;
+
+  cycleCounterStart();
+  Serial.begin(UART_BAUD);
+  Serial.println(F("BERGCloud ATmega2560 benchmark"));
+
+  calibrate();
+
+  /* Connect and be given a device ID by the scripted server */
+  WLANConfig.ssid = "simavr";
+  WLANConfig.pass = "";
+  device.begin(WLANConfig);
+
+  if (!queueHandshake() || !device.connect(PROJECT_KEY, VERSION))
+  {
+    Serial.println(F("connect() returned false."));
+    benchExit();
+  }
+
+  if (!queueSetAddress() || !device.pollForDeviceCommand() ||
+      !device.getConnectionState(state) || (state != BC_CONNECT_STATE_CONNECTED))
+  {
+    Serial.println(F("Not connected."));
+    benchExit();
+  }
+
+  run(F("pack_event"), packEvent);
+  run(F("send_event"), sendEvent);
+  run(F("send_event_in_place"), sendEventInPlace);
+
+  if (!queueNamedCommand())
+  {
+    Serial.println(F("Unable to queue command."));
+    benchExit();
+  }
+
+  run(F("poll_device_command"), pollForDeviceCommand);
+  run(F("poll_for_command"), pollForCommand);
+
+  if (!queueNamedCommand() || !device.pollForDeviceCommand())
+  {
+    Serial.println(F("Unable to queue command."));
+    benchExit();
+  }
+
+  run(F("poll_for_command_in_place"), pollForCommandInPlace);
+  run(F("read_nv_data"), readNVData);
+
+  benchExit();
+  return 0;
+}
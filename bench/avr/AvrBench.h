@@ -0,0 +1,53 @@
+/*
+
+Measurement helpers for the ATmega2560 benchmark
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef AVRBENCH_H
+#define AVRBENCH_H
+
+#include <stdint.h>
+
+#define UART_BAUD 115200
+
+/* Cycle counter, from Timer1 running at the CPU clock */
+void cycleCounterStart(void);
+uint32_t cycleCount(void);
+
+/* Heap tracking, from the malloc(), free() and realloc() wrappers */
+void heapTrackReset(void);
+uint16_t heapLiveBytes(void);
+uint16_t heapPeakBytes(void);
+/* Growth of the heap break since heapTrackReset(), at its highest */
+uint16_t heapBreakBytes(void);
+
+/* Scripted network; data queued here is read by the CC3000 client */
+bool networkQueue(const uint8_t *data, uint16_t size);
+void networkFlush(void);
+uint32_t networkBytesSent(void);
+
+/* Stop the simulator */
+void benchExit(void);
+
+#endif // #ifndef AVRBENCH_H
@@ -0,0 +1,392 @@
+/*
+
+Arduino core stand-in for the ATmega2560 simulator
+
+Timer1 runs at the CPU clock and, with its overflow count, gives a 32-bit
+cycle counter from which millis() and micros() are derived. Serial output
+goes to UART0, which simavr copies to the console. malloc(), free() and
+realloc() are wrapped at link time to track the live heap size.
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <stdlib.h>
+#include <avr/sleep.h>
+
+#include "Arduino.h"
+#include "EEPROM.h"
+#include "AvrBench.h"
+
+#ifdef HAVE_SIMAVR_MCU_SECTION
+#include <avr/avr_mcu_section.h>
+AVR_MCU(F_CPU, "atmega2560");
+#endif
+
+#define CYCLES_PER_MS (F_CPU / 1000UL)
+#define CYCLES_PER_US (F_CPU / 1000000UL)
+
+HardwareSerial Serial;
+EEPROMClass EEPROM;
+
+/*
+ *  Cycle counter
+ */
+
+static volatile uint16_t timer1Overflows;
+
+ISR(TIMER1_OVF_vect)
+{
+  timer1Overflows++;
+}
+
+void cycleCounterStart(void)
+{
+  TCCR1A = 0;
+  TCCR1B = 0;
+  TCNT1 = 0;
+  timer1Overflows = 0;
+  TIFR1 = _BV(TOV1);
+  TIMSK1 = _BV(TOIE1);
+  TCCR1B = _BV(CS10); /* No prescaler */
+  sei();
+}
+
+uint32_t cycleCount(void)
+{
+  uint8_t sreg = SREG;
+  uint16_t overflows;
+  uint16_t count;
+
+  cli();
+  count = TCNT1;
+  overflows = timer1Overflows;
+
+  /* Overflowed since interrupts were disabled, but not yet counted */
+  if ((TIFR1 & _BV(TOV1)) && (count < 0x8000))
+  {
+    overflows++;
+  }
+
+  SREG = sreg;
+
+  return ((uint32_t)overflows << 16) | count;
+}
+
+/*
+ *  Timing; the cycle counter wraps after about 268 seconds
+ */
+
+uint32_t millis(void)
+{
+  return cycleCount() / CYCLES_PER_MS;
+}
+
+uint32_t micros(void)
+{
+  return cycleCount() / CYCLES_PER_US;
+}
+
+void delay(uint32_t ms)
+{
+  uint32_t start = cycleCount();
+
+  while ((cycleCount() - start) < (ms * CYCLES_PER_MS))
+  {
+  }
+}
+
+void delayMicroseconds(uint16_t us)
+{
+  uint32_t start = cycleCount();
+
+  while ((cycleCount() - start) < ((uint32_t)us * CYCLES_PER_US))
+  {
+  }
+}
+
+/*
+ *  PRNG, from avr-libc
+ */
+
+void randomSeed(uint32_t seed)
+{
+  if (seed != 0)
+  {
+    srandom(seed);
+  }
+}
+
+long random(long howbig)
+{
+  if (howbig == 0)
+  {
+    return 0;
+  }
+
+  return random() % howbig;
+}
+
+long random(long howsmall, long howbig)
+{
+  if (howsmall >= howbig)
+  {
+    return howsmall;
+  }
+
+  return random(howbig - howsmall) + howsmall;
+}
+
+/*
+ *  Digital and analogue I/O
+ */
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  (void)pin;
+  (void)value;
+}
+
+int digitalRead(uint8_t pin)
+{
+  (void)pin;
+  return HIGH;
+}
+
+int analogRead(uint8_t pin)
+{
+  (void)pin;
+  return (int)(TCNT1 & 0x3ff);
+}
+
+/*
+ *  Serial port on UART0, transmit only
+ */
+
+void HardwareSerial::begin(unsigned long baud)
+{
+  uint16_t ubrr = (uint16_t)((F_CPU / (8UL * baud)) - 1);
+
+  UCSR0A = _BV(U2X0);
+  UBRR0H = (uint8_t)(ubrr >> 8);
+  UBRR0L = (uint8_t)ubrr;
+  UCSR0C = _BV(UCSZ01) | _BV(UCSZ00); /* 8N1 */
+  UCSR0B = _BV(TXEN0);
+}
+
+void HardwareSerial::end(void)
+{
+  flush();
+  UCSR0B = 0;
+}
+
+int HardwareSerial::available(void)
+{
+  return 0;
+}
+
+int HardwareSerial::peek(void)
+{
+  return -1;
+}
+
+int HardwareSerial::read(void)
+{
+  return -1;
+}
+
+void HardwareSerial::flush(void)
+{
+  if (UCSR0B & _BV(TXEN0))
+  {
+    while (!(UCSR0A & _BV(UDRE0)))
+    {
+    }
+  }
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  if (c == '\n')
+  {
+    write((uint8_t)'\r');
+  }
+
+  while (!(UCSR0A & _BV(UDRE0)))
+  {
+  }
+
+  UDR0 = c;
+  return 1;
+}
+
+/*
+ *  Heap tracking
+ */
+
+extern "C" {
+
+extern char *__brkval;
+extern char __heap_start;
+
+void *__real_malloc(size_t size);
+void __real_free(void *ptr);
+void *__real_realloc(void *ptr, size_t size);
+
+}
+
+static uint16_t liveBytes;
+static uint16_t peakBytes;
+static char *baseBreak;
+static char *maxBreak;
+
+/* avr-libc keeps the chunk size in the two bytes before each allocation */
+static uint16_t chunkSize(void *ptr)
+{
+  return (ptr != NULL) ? *((size_t *)ptr - 1) : 0;
+}
+
+static void heapTrackAdd(uint16_t size)
+{
+  liveBytes += size;
+
+  if (__brkval > maxBreak)
+  {
+    maxBreak = __brkval;
+  }
+
+  if (liveBytes > peakBytes)
+  {
+    peakBytes = liveBytes;
+  }
+}
+
+extern "C" void *__wrap_malloc(size_t size)
+{
+  void *ptr = __real_malloc(size);
+  heapTrackAdd(chunkSize(ptr));
+  return ptr;
+}
+
+extern "C" void __wrap_free(void *ptr)
+{
+  liveBytes -= chunkSize(ptr);
+  __real_free(ptr);
+}
+
+extern "C" void *__wrap_realloc(void *ptr, size_t size)
+{
+  uint16_t oldSize = chunkSize(ptr);
+  void *newPtr = __real_realloc(ptr, size);
+
+  if ((newPtr != NULL) || (size == 0))
+  {
+    liveBytes -= oldSize;
+    heapTrackAdd(chunkSize(newPtr));
+  }
+
+  return newPtr;
+}
+
+void heapTrackReset(void)
+{
+  peakBytes = liveBytes = 0;
+  baseBreak = maxBreak = (__brkval != NULL) ? __brkval : &__heap_start;
+}
+
+uint16_t heapLiveBytes(void)
+{
+  return liveBytes;
+}
+
+uint16_t heapPeakBytes(void)
+{
+  return peakBytes;
+}
+
+uint16_t heapBreakBytes(void)
+{
+  return (uint16_t)(maxBreak - baseBreak);
+}
+
+/*
+ *  C++ runtime support, as provided by the Arduino core
+ */
+
+void *operator new(size_t size)
+{
+  return malloc(size);
+}
+
+void *operator new[](size_t size)
+{
+  return malloc(size);
+}
+
+void operator delete(void *ptr)
+{
+  free(ptr);
+}
+
+void operator delete[](void *ptr)
+{
+  free(ptr);
+}
+
+void operator delete(void *ptr, size_t size)
+{
+  (void)size;
+  free(ptr);
+}
+
+void operator delete[](void *ptr, size_t size)
+{
+  (void)size;
+  free(ptr);
+}
+
+extern "C" void __cxa_pure_virtual(void)
+{
+  benchExit();
+}
+
+/*
+ *  Exit; simavr stops when the CPU sleeps with interrupts disabled
+ */
+
+void benchExit(void)
+{
+  Serial.flush();
+  cli();
+  set_sleep_mode(SLEEP_MODE_PWR_DOWN);
+  sleep_enable();
+
+  for (;;)
+  {
+    sleep_cpu();
+  }
+}
@@ -0,0 +1,267 @@
+/*
+
+Scripted Adafruit CC3000 stand-in for the ATmega2560 simulator
+
+The WLAN is always up and every connection succeeds. Data read by the client
+comes from a queue filled by the benchmark with networkQueue(); data written
+is counted and discarded.
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include "Adafruit_CC3000.h"
+#include "utility/socket.h"
+#include "AvrBench.h"
+
+#define RX_QUEUE_SIZE_BYTES 1024
+
+/* TI OUI */
+static const uint8_t simMacAddress[6] = {0x08, 0x00, 0x28, 0x00, 0x00, 0x02};
+
+static uint8_t rxQueue[RX_QUEUE_SIZE_BYTES];
+static uint16_t rxHead;
+static uint16_t rxTail;
+static uint16_t rxCount;
+static uint32_t txCount;
+
+bool networkQueue(const uint8_t *data, uint16_t size)
+{
+  if (size > (RX_QUEUE_SIZE_BYTES - rxCount))
+  {
+    return false;
+  }
+
+  while (size-- > 0)
+  {
+    rxQueue[rxTail] = *data++;
+    rxTail = (rxTail + 1) % RX_QUEUE_SIZE_BYTES;
+    rxCount++;
+  }
+
+  return true;
+}
+
+void networkFlush(void)
+{
+  rxHead = rxTail = rxCount = 0;
+}
+
+uint32_t networkBytesSent(void)
+{
+  return txCount;
+}
+
+Adafruit_CC3000_Client::Adafruit_CC3000_Client(void)
+{
+  _socket = -1;
+}
+
+Adafruit_CC3000_Client::Adafruit_CC3000_Client(int fd)
+{
+  _socket = fd;
+}
+
+bool Adafruit_CC3000_Client::connected(void)
+{
+  return _socket >= 0;
+}
+
+int16_t Adafruit_CC3000_Client::close(void)
+{
+  _socket = -1;
+  return 0;
+}
+
+int Adafruit_CC3000_Client::write(const void *buf, uint16_t len, uint32_t flags)
+{
+  (void)buf;
+  (void)flags;
+
+  if (_socket < 0)
+  {
+    return -1;
+  }
+
+  txCount += len;
+  return len;
+}
+
+size_t Adafruit_CC3000_Client::write(uint8_t c)
+{
+  int result = write(&c, 1, 0);
+  return (result > 0) ? 1 : 0;
+}
+
+int Adafruit_CC3000_Client::read(void *buf, uint16_t len, uint32_t flags)
+{
+  uint8_t *p = (uint8_t *)buf;
+  int result = 0;
+
+  (void)flags;
+
+  if (_socket < 0)
+  {
+    return -1;
+  }
+
+  while ((len-- > 0) && (rxCount > 0))
+  {
+    *p++ = rxQueue[rxHead];
+    rxHead = (rxHead + 1) % RX_QUEUE_SIZE_BYTES;
+    rxCount--;
+    result++;
+  }
+
+  return result;
+}
+
+uint8_t Adafruit_CC3000_Client::read(void)
+{
+  uint8_t c = 0;
+
+  if (read(&c, 1, 0) != 1)
+  {
+    return 0;
+  }
+
+  return c;
+}
+
+uint8_t Adafruit_CC3000_Client::available(void)
+{
+  if (_socket < 0)
+  {
+    return 0;
+  }
+
+  return (rxCount > UINT8_MAX) ? UINT8_MAX : (uint8_t)rxCount;
+}
+
+Adafruit_CC3000::Adafruit_CC3000(uint8_t csPin, uint8_t irqPin, uint8_t vbatPin, uint8_t spispeed)
+{
+  (void)csPin;
+  (void)irqPin;
+  (void)vbatPin;
+  (void)spispeed;
+}
+
+bool Adafruit_CC3000::begin(uint8_t patchReq, bool useSmartConfigData)
+{
+  (void)patchReq;
+  (void)useSmartConfigData;
+  return true;
+}
+
+void Adafruit_CC3000::reboot(uint8_t patchReq)
+{
+  (void)patchReq;
+}
+
+void Adafruit_CC3000::stop(void)
+{
+}
+
+bool Adafruit_CC3000::disconnect(void)
+{
+  return true;
+}
+
+bool Adafruit_CC3000::checkConnected(void)
+{
+  return true;
+}
+
+bool Adafruit_CC3000::checkDHCP(void)
+{
+  return true;
+}
+
+bool Adafruit_CC3000::getFirmwareVersion(uint8_t *major, uint8_t *minor)
+{
+  *major = 1;
+  *minor = 24;
+  return true;
+}
+
+bool Adafruit_CC3000::getMacAddress(uint8_t address[6])
+{
+  memcpy(address, simMacAddress, sizeof(simMacAddress));
+  return true;
+}
+
+bool Adafruit_CC3000::getIPAddress(uint32_t *retip, uint32_t *netmask, uint32_t *gateway, uint32_t *dhcpserv, uint32_t *dnsserv)
+{
+  *retip = 0x7f000001;
+  *netmask = 0xff000000;
+  *gateway = *retip;
+  *dhcpserv = *retip;
+  *dnsserv = *retip;
+  return true;
+}
+
+void Adafruit_CC3000::printIPdotsRev(uint32_t ip)
+{
+  Serial.print((uint8_t)(ip >> 24));
+  Serial.print('.');
+  Serial.print((uint8_t)(ip >> 16));
+  Serial.print('.');
+  Serial.print((uint8_t)(ip >> 8));
+  Serial.print('.');
+  Serial.print((uint8_t)(ip));
+}
+
+bool Adafruit_CC3000::connectToAP(const char *ssid, const char *key, uint8_t secmode)
+{
+  (void)ssid;
+  (void)key;
+  (void)secmode;
+  return true;
+}
+
+bool Adafruit_CC3000::startSmartConfig(const char *_deviceName, const char *smartConfigKey)
+{
+  (void)_deviceName;
+  (void)smartConfigKey;
+  return true;
+}
+
+int16_t Adafruit_CC3000::getHostByName(char *hostname, uint32_t *ip)
+{
+  (void)hostname;
+  *ip = 0x7f000001;
+  return 1;
+}
+
+Adafruit_CC3000_Client Adafruit_CC3000::connectTCP(uint32_t destIP, uint16_t destPort)
+{
+  (void)destIP;
+  (void)destPort;
+  return Adafruit_CC3000_Client(0);
+}
+
+int mdnsAdvertiser(uint16_t mdnsEnabled, char *deviceServiceName, uint16_t deviceServiceNameLength)
+{
+  (void)mdnsEnabled;
+  (void)deviceServiceName;
+  (void)deviceServiceNameLength;
+  return 0;
+}
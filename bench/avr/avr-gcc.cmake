@@ -0,0 +1,20 @@
+#
+# Toolchain file for avr-gcc
+#
+
+set(CMAKE_SYSTEM_NAME Generic)
+set(CMAKE_SYSTEM_PROCESSOR avr)
+
+find_program(AVR_GCC avr-gcc REQUIRED)
+find_program(AVR_GXX avr-g++ REQUIRED)
+find_program(AVR_SIZE avr-size)
+
+set(CMAKE_C_COMPILER ${AVR_GCC})
+set(CMAKE_CXX_COMPILER ${AVR_GXX})
+
+# No hosted runtime to link a test program against
+set(CMAKE_TRY_COMPILE_TARGET_TYPE STATIC_LIBRARY)
+
+set(CMAKE_FIND_ROOT_PATH_MODE_PROGRAM NEVER)
+set(CMAKE_FIND_ROOT_PATH_MODE_LIBRARY ONLY)
+set(CMAKE_FIND_ROOT_PATH_MODE_INCLUDE ONLY)
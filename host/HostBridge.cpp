@@ -0,0 +1,509 @@
+/*
+
+Local stand-in for the BERGCloud bridge
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+/* System headers first; <netinet/in.h> defines INADDR_NONE as a macro */
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#undef INADDR_NONE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HostBridge.h"
+#include "WebSocketClient.h" /* For the WS_ defines */
+#include "Base64.h"
+#include "aJSON.h"
+#include "BERGCloudConfig.h"
+#include "BERGCloudConst.h"
+
+#define REQUEST_MAX_BYTES 1024
+#define JSON_MAX_BYTES    (((BRIDGE_PAYLOAD_MAX_BYTES + 2) / 3) * 4 + 128)
+
+HostBridge::HostBridge()
+{
+  listener = -1;
+  device = -1;
+  binaryFrames = false;
+  bytesSent = 0;
+  bytesReceived = 0;
+}
+
+HostBridge::~HostBridge()
+{
+  close();
+
+  if (listener >= 0)
+  {
+    ::close(listener);
+  }
+}
+
+bool HostBridge::listen(uint16_t port)
+{
+  struct sockaddr_in address;
+  int one = 1;
+
+  listener = socket(AF_INET, SOCK_STREAM, 0);
+  if (listener < 0)
+  {
+    return false;
+  }
+
+  setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+  memset(&address, 0x00, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(port);
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  if ((bind(listener, (struct sockaddr *)&address, sizeof(address)) < 0) || (::listen(listener, 1) < 0))
+  {
+    ::close(listener);
+    listener = -1;
+    return false;
+  }
+
+  return true;
+}
+
+uint16_t HostBridge::port(void)
+{
+  struct sockaddr_in address;
+  socklen_t size = sizeof(address);
+
+  if ((listener < 0) || (getsockname(listener, (struct sockaddr *)&address, &size) < 0))
+  {
+    return 0;
+  }
+
+  return ntohs(address.sin_port);
+}
+
+bool HostBridge::accept(bool binary)
+{
+  int one = 1;
+
+  close();
+
+  device = ::accept(listener, NULL, NULL);
+  if (device < 0)
+  {
+    return false;
+  }
+
+  /* As the device does */
+  setsockopt(device, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  if (!handshake(binary))
+  {
+    close();
+    return false;
+  }
+
+  bytesSent = 0;
+  bytesReceived = 0;
+  return true;
+}
+
+bool HostBridge::binary(void)
+{
+  return binaryFrames;
+}
+
+bool HostBridge::handshake(bool binary)
+{
+  char request[REQUEST_MAX_BYTES];
+  char response[256];
+  const char *protocol;
+  uint16_t used = 0;
+  int length;
+
+  /* Read the request up to the blank line that ends it */
+  while ((used < (sizeof(request) - 1)) &&
+         ((used < 4) || (memcmp(&request[used - 4], "\r\n\r\n", 4) != 0)))
+  {
+    if (!readAll((uint8_t *)&request[used], 1))
+    {
+      return false;
+    }
+    used++;
+  }
+  request[used] = '\0';
+
+  protocol = strstr(request, "Sec-WebSocket-Protocol: ");
+  binaryFrames = binary && (protocol != NULL) && (strstr(protocol, BC_WEBSOCKET_PROTOCOL_BINARY) != NULL);
+
+  /* The accept value is that for the fixed key the device sends */
+  length = snprintf(response, sizeof(response),
+    "HTTP/1.1 101 Switching Protocols\r\n"
+    "Upgrade: websocket\r\n"
+    "Connection: Upgrade\r\n"
+    "Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=\r\n"
+    "Sec-WebSocket-Protocol: %s\r\n"
+    "\r\n",
+    binaryFrames ? BC_WEBSOCKET_PROTOCOL_BINARY : BC_WEBSOCKET_PROTOCOL_JSON);
+
+  return writeAll((const uint8_t *)response, length);
+}
+
+bool HostBridge::sendCommand(uint16_t cmd, uint32_t commandID, const uint8_t *data, uint16_t size)
+{
+  uint8_t binary[BC_COMMAND_HEADER_SIZE_BYTES + BRIDGE_PAYLOAD_MAX_BYTES];
+  char encoded[((sizeof(binary) + 2) / 3) * 4 + 1];
+  char json[JSON_MAX_BYTES];
+  int jsonSize;
+  uint8_t i;
+
+  if (size > BRIDGE_PAYLOAD_MAX_BYTES)
+  {
+    return false;
+  }
+
+  memset(binary, 0x00, BC_COMMAND_HEADER_SIZE_BYTES);
+  binary[2] = (uint8_t)cmd;
+  binary[3] = (uint8_t)(cmd >> 8);
+  memcpy(&binary[BC_COMMAND_HEADER_SIZE_BYTES], data, size);
+
+  if (binaryFrames)
+  {
+    for (i = 0; i < sizeof(commandID); i++)
+    {
+      binary[BC_COMMAND_ID_OFFSET + i] = (uint8_t)(commandID >> (i * 8));
+    }
+
+    return sendFrame(WS_OPCODE_BINARY, binary, BC_COMMAND_HEADER_SIZE_BYTES + size);
+  }
+
+  base64_encode(encoded, (char *)binary, BC_COMMAND_HEADER_SIZE_BYTES + size);
+
+  jsonSize = snprintf(json, sizeof(json),
+    "{\"type\":\"DeviceCommand\",\"command_id\":%lu,\"binary_payload\":\"%s\"}",
+    (unsigned long)commandID, encoded);
+
+  if ((jsonSize < 0) || (jsonSize >= (int)sizeof(json)))
+  {
+    return false;
+  }
+
+  return sendFrame(WS_OPCODE_TEXT, (const uint8_t *)json, jsonSize);
+}
+
+bool HostBridge::sendPing(void)
+{
+  static const uint8_t ping[] = {'b', 'r', 'i', 'd', 'g', 'e'};
+
+  return sendFrame(WS_OPCODE_PING, ping, sizeof(ping));
+}
+
+bool HostBridge::sendRaw(const uint8_t *data, uint32_t size)
+{
+  return writeAll(data, size);
+}
+
+bool HostBridge::receiveRaw(uint8_t *data, uint32_t size, uint32_t timeout_mS)
+{
+  struct pollfd wait;
+
+  wait.fd = device;
+  wait.events = POLLIN;
+  wait.revents = 0;
+
+  if (poll(&wait, 1, timeout_mS) <= 0)
+  {
+    return false;
+  }
+
+  return readAll(data, size);
+}
+
+bool HostBridge::sendFrame(uint8_t opcode, const uint8_t *data, uint16_t size)
+{
+  /* Frames sent by a server are not masked */
+  uint8_t header[4];
+  uint8_t headerSize;
+
+  header[0] = WS_FIN | opcode;
+
+  if (size > 125)
+  {
+    header[1] = WS_SIZE16;
+    header[2] = (uint8_t)(size >> 8);
+    header[3] = (uint8_t)size;
+    headerSize = 4;
+  }
+  else
+  {
+    header[1] = (uint8_t)size;
+    headerSize = 2;
+  }
+
+  return writeAll(header, headerSize) && writeAll(data, size);
+}
+
+uint8_t HostBridge::receive(BRIDGE_MESSAGE& message, uint32_t timeout_mS)
+{
+  static uint8_t data[JSON_MAX_BYTES + 1]; /* +1 for null terminator */
+  struct pollfd wait;
+  uint8_t header[2];
+  uint8_t extended[8];
+  uint8_t mask[4];
+  uint8_t opcode;
+  uint32_t size;
+  uint32_t i;
+
+  message.type = BRIDGE_NONE;
+
+  while (true)
+  {
+    wait.fd = device;
+    wait.events = POLLIN;
+    wait.revents = 0;
+
+    if (poll(&wait, 1, timeout_mS) <= 0)
+    {
+      return BRIDGE_NONE;
+    }
+
+    if (!readAll(header, sizeof(header)))
+    {
+      return message.type = BRIDGE_CLOSED;
+    }
+
+    opcode = header[0] & ~WS_FIN;
+    size = header[1] & ~WS_MASK;
+
+    if (size == WS_SIZE16)
+    {
+      if (!readAll(extended, 2))
+      {
+        return message.type = BRIDGE_CLOSED;
+      }
+      size = ((uint32_t)extended[0] << 8) | extended[1];
+    }
+    else if (size == WS_SIZE64)
+    {
+      if (!readAll(extended, 8))
+      {
+        return message.type = BRIDGE_CLOSED;
+      }
+      size = 0;
+      for (i = 4; i < 8; i++)
+      {
+        size = (size << 8) | extended[i];
+      }
+    }
+
+    memset(mask, 0x00, sizeof(mask));
+    if ((header[1] & WS_MASK) && !readAll(mask, sizeof(mask)))
+    {
+      return message.type = BRIDGE_CLOSED;
+    }
+
+    if ((size > (sizeof(data) - 1)) || !readAll(data, size))
+    {
+      return message.type = BRIDGE_CLOSED;
+    }
+
+    for (i = 0; i < size; i++)
+    {
+      data[i] ^= mask[i % 4];
+    }
+
+    switch (opcode)
+    {
+    case WS_OPCODE_TEXT:
+      data[size] = '\0';
+      return message.type = parseJSON(message, (char *)data);
+    case WS_OPCODE_BINARY:
+      return message.type = parseBinary(message, data, size);
+    case WS_OPCODE_CLOSE:
+      return message.type = BRIDGE_CLOSED;
+    default:
+      /* Pong; wait for the next frame */
+      break;
+    }
+  }
+}
+
+uint8_t HostBridge::parseJSON(BRIDGE_MESSAGE& message, char *json)
+{
+  aJsonObject *root = aJson.parse(json);
+  aJsonObject *type;
+  aJsonObject *item;
+  uint8_t result = BRIDGE_CLOSED;
+  int size;
+
+  if (root == NULL)
+  {
+    return BRIDGE_CLOSED;
+  }
+
+  type = aJson.getObjectItem(root, "type");
+
+  if ((type == NULL) || (type->type != aJson_String))
+  {
+    aJson.deleteItem(root);
+    return BRIDGE_CLOSED;
+  }
+
+  if (strcmp(type->valuestring, "WifiEvent") == 0)
+  {
+    result = BRIDGE_CONNECT;
+  }
+  else if (strcmp(type->valuestring, "DeviceEvent") == 0)
+  {
+    item = aJson.getObjectItem(root, "binary_payload");
+
+    if ((item != NULL) && (item->type == aJson_String))
+    {
+      size = base64_dec_len(item->valuestring, strlen(item->valuestring));
+
+      if (size <= BRIDGE_PAYLOAD_MAX_BYTES)
+      {
+        base64_decode((char *)message.payload, item->valuestring, strlen(item->valuestring));
+        message.payloadSize = size;
+        result = BRIDGE_EVENT;
+      }
+    }
+  }
+  else if (strcmp(type->valuestring, "DeviceCommandResponse") == 0)
+  {
+    item = aJson.getObjectItem(root, "command_id");
+    message.commandID = (item != NULL) ? item->valueint : 0;
+    item = aJson.getObjectItem(root, "return_code");
+    message.returnCode = (item != NULL) ? item->valueint : 0xff;
+    result = BRIDGE_RESPONSE;
+  }
+
+  aJson.deleteItem(root);
+  return result;
+}
+
+uint8_t HostBridge::parseBinary(BRIDGE_MESSAGE& message, uint8_t *data, uint32_t size)
+{
+  uint16_t eventCode;
+  uint8_t i;
+
+  if ((size < BC_EVENT_HEADER_SIZE_BYTES) || (size > BRIDGE_PAYLOAD_MAX_BYTES))
+  {
+    return BRIDGE_CLOSED;
+  }
+
+  eventCode = data[0] | ((uint16_t)data[1] << 8);
+
+  if (eventCode == BC_EVENT_COMMAND_RESPONSE)
+  {
+    if (size < (BC_EVENT_HEADER_SIZE_BYTES + 1))
+    {
+      return BRIDGE_CLOSED;
+    }
+
+    /* The invocation ID is the command ID */
+    message.commandID = 0;
+    for (i = 0; i < sizeof(message.commandID); i++)
+    {
+      message.commandID |= (uint32_t)data[2 + i] << (i * 8);
+    }
+
+    message.returnCode = data[BC_EVENT_HEADER_SIZE_BYTES];
+    return BRIDGE_RESPONSE;
+  }
+
+  memcpy(message.payload, data, size);
+  message.payloadSize = size;
+  return BRIDGE_EVENT;
+}
+
+bool HostBridge::readAll(uint8_t *data, uint32_t size)
+{
+  ssize_t received;
+
+  while (size > 0)
+  {
+    received = recv(device, data, size, 0);
+
+    if (received < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+
+    if (received == 0)
+    {
+      /* Closed by the device */
+      return false;
+    }
+
+    data += received;
+    size -= received;
+    bytesReceived += received;
+  }
+
+  return true;
+}
+
+bool HostBridge::writeAll(const uint8_t *data, uint32_t size)
+{
+  ssize_t sent;
+
+  while (size > 0)
+  {
+    sent = send(device, data, size, MSG_NOSIGNAL);
+
+    if (sent < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+
+    data += sent;
+    size -= sent;
+    bytesSent += sent;
+  }
+
+  return true;
+}
+
+void HostBridge::close(void)
+{
+  if (device >= 0)
+  {
+    ::close(device);
+    device = -1;
+  }
+}
@@ -0,0 +1,96 @@
+/*
+
+Local stand-in for the BERGCloud bridge
+
+Accepts a single device connection on the loopback interface, completes
+the WebSocket handshake, choosing binary frames if the device offers them
+and the bridge is asked to, and then exchanges events, commands and
+command responses with the device in either JSON or binary frames. The
+bytes sent and received, including WebSocket framing, are counted so that
+the two protocols can be compared.
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef HOSTBRIDGE_H
+#define HOSTBRIDGE_H
+
+#include <stdint.h>
+
+#define BRIDGE_PAYLOAD_MAX_BYTES 1024
+
+/* What the device sent */
+#define BRIDGE_NONE             0 /* Nothing before the timeout */
+#define BRIDGE_CONNECT          1 /* The connect event */
+#define BRIDGE_EVENT            2 /* An event; 'payload' holds its header and data */
+#define BRIDGE_RESPONSE         3 /* A command response */
+#define BRIDGE_CLOSED           4 /* The connection was closed, or was unreadable */
+
+typedef struct {
+  uint8_t type;
+  uint8_t payload[BRIDGE_PAYLOAD_MAX_BYTES];
+  uint16_t payloadSize;
+  uint32_t commandID;
+  uint8_t returnCode;
+} BRIDGE_MESSAGE;
+
+class HostBridge
+{
+public:
+  HostBridge();
+  ~HostBridge();
+  /* Listen on the loopback interface; 0 picks a free port, see port() */
+  bool listen(uint16_t port = 0);
+  uint16_t port(void);
+  /* Accept a device and complete the handshake; binary frames are */
+  /* used if 'binary' is true and the device offers them */
+  bool accept(bool binary);
+  bool binary(void);
+  /* Send a command with a 16-byte header of 'cmd' and 'commandID' */
+  bool sendCommand(uint16_t cmd, uint32_t commandID, const uint8_t *data, uint16_t size);
+  bool sendPing(void);
+
+  /* Send bytes as they are, or wait up to 'timeout_mS' for 'size' */
+  /* bytes, so that tests can frame what they send and read */
+  bool sendRaw(const uint8_t *data, uint32_t size);
+  bool receiveRaw(uint8_t *data, uint32_t size, uint32_t timeout_mS);
+  /* Wait up to 'timeout_mS' for the next message from the device; */
+  /* pongs are skipped */
+  uint8_t receive(BRIDGE_MESSAGE& message, uint32_t timeout_mS);
+  void close(void);
+  /* Including WebSocket framing, but not the handshake */
+  uint32_t bytesSent;
+  uint32_t bytesReceived;
+
+private:
+  bool handshake(bool binary);
+  bool sendFrame(uint8_t opcode, const uint8_t *data, uint16_t size);
+  bool readAll(uint8_t *data, uint32_t size);
+  bool writeAll(const uint8_t *data, uint32_t size);
+  uint8_t parseJSON(BRIDGE_MESSAGE& message, char *json);
+  uint8_t parseBinary(BRIDGE_MESSAGE& message, uint8_t *data, uint32_t size);
+  int listener;
+  int device;
+  bool binaryFrames;
+};
+
+#endif // #ifndef HOSTBRIDGE_H
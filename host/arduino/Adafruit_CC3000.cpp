@@ -0,0 +1,344 @@
+/*
+
+Host stand-in for the Adafruit CC3000 library
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+/* System headers first; <netinet/in.h> defines INADDR_NONE as a macro */
+#include <errno.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#undef INADDR_NONE
+
+#include "Adafruit_CC3000.h"
+#include "utility/socket.h"
+
+/* TI OUI */
+static const uint8_t hostMacAddress[6] = {0x08, 0x00, 0x28, 0x00, 0x00, 0x01};
+
+/* Addresses are held with the first octet in the most significant byte */
+static uint32_t toCC3000Address(in_addr_t address)
+{
+  return ntohl(address);
+}
+
+Adafruit_CC3000_Client::Adafruit_CC3000_Client(void)
+{
+  _socket = -1;
+}
+
+Adafruit_CC3000_Client::Adafruit_CC3000_Client(int fd)
+{
+  _socket = fd;
+}
+
+bool Adafruit_CC3000_Client::connected(void)
+{
+  uint8_t c;
+  ssize_t result;
+
+  if (_socket < 0)
+  {
+    return false;
+  }
+
+  result = recv(_socket, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+
+  if (result == 0)
+  {
+    /* Closed by peer */
+    return false;
+  }
+
+  if ((result < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK))
+  {
+    return false;
+  }
+
+  return true;
+}
+
+int16_t Adafruit_CC3000_Client::close(void)
+{
+  int16_t result = 0;
+
+  if (_socket >= 0)
+  {
+    result = ::close(_socket);
+    _socket = -1;
+  }
+
+  return result;
+}
+
+int Adafruit_CC3000_Client::write(const void *buf, uint16_t len, uint32_t flags)
+{
+  const uint8_t *p = (const uint8_t *)buf;
+  uint16_t remaining = len;
+  ssize_t sent;
+
+  (void)flags;
+
+  if (_socket < 0)
+  {
+    return -1;
+  }
+
+  while (remaining > 0)
+  {
+    sent = send(_socket, p, remaining, MSG_NOSIGNAL);
+    if (sent < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return -1;
+    }
+    p += sent;
+    remaining -= sent;
+  }
+
+  return len;
+}
+
+size_t Adafruit_CC3000_Client::write(uint8_t c)
+{
+  int result = write(&c, 1, 0);
+  return (result > 0) ? 1 : 0;
+}
+
+int Adafruit_CC3000_Client::read(void *buf, uint16_t len, uint32_t flags)
+{
+  ssize_t result;
+
+  (void)flags;
+
+  if (_socket < 0)
+  {
+    return -1;
+  }
+
+  do {
+    result = recv(_socket, buf, len, 0);
+  } while ((result < 0) && (errno == EINTR));
+
+  return (int)result;
+}
+
+uint8_t Adafruit_CC3000_Client::read(void)
+{
+  uint8_t c = 0;
+
+  if (read(&c, 1, 0) != 1)
+  {
+    return 0;
+  }
+
+  return c;
+}
+
+uint8_t Adafruit_CC3000_Client::available(void)
+{
+  int bytes = 0;
+
+  if (_socket < 0)
+  {
+    return 0;
+  }
+
+  if (ioctl(_socket, FIONREAD, &bytes) < 0)
+  {
+    return 0;
+  }
+
+  /* The CC3000 library reports at most one receive buffer's worth */
+  return (bytes > UINT8_MAX) ? UINT8_MAX : (uint8_t)bytes;
+}
+
+Adafruit_CC3000::Adafruit_CC3000(uint8_t csPin, uint8_t irqPin, uint8_t vbatPin, uint8_t spispeed)
+{
+  (void)csPin;
+  (void)irqPin;
+  (void)vbatPin;
+  (void)spispeed;
+}
+
+bool Adafruit_CC3000::begin(uint8_t patchReq, bool useSmartConfigData)
+{
+  (void)patchReq;
+  (void)useSmartConfigData;
+  return true;
+}
+
+void Adafruit_CC3000::reboot(uint8_t patchReq)
+{
+  (void)patchReq;
+}
+
+void Adafruit_CC3000::stop(void)
+{
+}
+
+bool Adafruit_CC3000::disconnect(void)
+{
+  return true;
+}
+
+bool Adafruit_CC3000::checkConnected(void)
+{
+  return true;
+}
+
+bool Adafruit_CC3000::checkDHCP(void)
+{
+  return true;
+}
+
+bool Adafruit_CC3000::getFirmwareVersion(uint8_t *major, uint8_t *minor)
+{
+  *major = 1;
+  *minor = 24;
+  return true;
+}
+
+bool Adafruit_CC3000::getMacAddress(uint8_t address[6])
+{
+  memcpy(address, hostMacAddress, sizeof(hostMacAddress));
+  return true;
+}
+
+bool Adafruit_CC3000::getIPAddress(uint32_t *retip, uint32_t *netmask, uint32_t *gateway, uint32_t *dhcpserv, uint32_t *dnsserv)
+{
+  *retip = toCC3000Address(htonl(INADDR_LOOPBACK));
+  *netmask = 0xff000000;
+  *gateway = *retip;
+  *dhcpserv = *retip;
+  *dnsserv = *retip;
+  return true;
+}
+
+void Adafruit_CC3000::printIPdotsRev(uint32_t ip)
+{
+  Serial.print((uint8_t)(ip >> 24));
+  Serial.print('.');
+  Serial.print((uint8_t)(ip >> 16));
+  Serial.print('.');
+  Serial.print((uint8_t)(ip >> 8));
+  Serial.print('.');
+  Serial.print((uint8_t)(ip));
+}
+
+bool Adafruit_CC3000::connectToAP(const char *ssid, const char *key, uint8_t secmode)
+{
+  (void)ssid;
+  (void)key;
+  (void)secmode;
+  return true;
+}
+
+bool Adafruit_CC3000::startSmartConfig(const char *_deviceName, const char *smartConfigKey)
+{
+  (void)_deviceName;
+  (void)smartConfigKey;
+  return true;
+}
+
+int16_t Adafruit_CC3000::getHostByName(char *hostname, uint32_t *ip)
+{
+  struct addrinfo hints;
+  struct addrinfo *res = NULL;
+  const char *override = getenv("CC3000_HOST");
+  struct in_addr address;
+
+  if (override != NULL)
+  {
+    if (inet_pton(AF_INET, override, &address) != 1)
+    {
+      return 0;
+    }
+    *ip = toCC3000Address(address.s_addr);
+    return 1;
+  }
+
+  memset(&hints, 0x00, sizeof(hints));
+  hints.ai_family = AF_INET;
+  hints.ai_socktype = SOCK_STREAM;
+
+  if (getaddrinfo(hostname, NULL, &hints, &res) != 0)
+  {
+    return 0;
+  }
+
+  *ip = toCC3000Address(((struct sockaddr_in *)res->ai_addr)->sin_addr.s_addr);
+  freeaddrinfo(res);
+  return 1;
+}
+
+Adafruit_CC3000_Client Adafruit_CC3000::connectTCP(uint32_t destIP, uint16_t destPort)
+{
+  struct sockaddr_in address;
+  const char *override = getenv("CC3000_PORT");
+  int fd;
+  int one = 1;
+
+  if (override != NULL)
+  {
+    destPort = (uint16_t)atoi(override);
+  }
+
+  fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0)
+  {
+    return Adafruit_CC3000_Client();
+  }
+
+  /* The CC3000 sends each write() as its own segment */
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  memset(&address, 0x00, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_port = htons(destPort);
+  address.sin_addr.s_addr = htonl(destIP);
+
+  if (connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+  {
+    ::close(fd);
+    return Adafruit_CC3000_Client();
+  }
+
+  return Adafruit_CC3000_Client(fd);
+}
+
+int mdnsAdvertiser(uint16_t mdnsEnabled, char *deviceServiceName, uint16_t deviceServiceNameLength)
+{
+  (void)mdnsEnabled;
+  (void)deviceServiceName;
+  (void)deviceServiceNameLength;
+  return 0;
+}
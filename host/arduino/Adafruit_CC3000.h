@@ -0,0 +1,88 @@
+/*
+
+Host stand-in for the Adafruit CC3000 library
+
+The WLAN is always up and the client is backed by a BSD socket. Two
+environment variables redirect connections so that the library can be
+pointed at a local bridge without editing BERGCloudConst.h:
+
+  CC3000_HOST  IPv4 address returned for every getHostByName() lookup
+  CC3000_PORT  TCP port used by connectTCP() in place of the one given
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef ADAFRUIT_CC3000_H
+#define ADAFRUIT_CC3000_H
+
+#include "Arduino.h"
+
+#define WLAN_SEC_UNSEC (0)
+#define WLAN_SEC_WEP   (1)
+#define WLAN_SEC_WPA   (2)
+#define WLAN_SEC_WPA2  (3)
+
+#define SPI_CLOCK_DIV2    4
+#define SPI_CLOCK_DIVIDER SPI_CLOCK_DIV2
+
+class Adafruit_CC3000_Client : public Print
+{
+public:
+  Adafruit_CC3000_Client(void);
+  Adafruit_CC3000_Client(int fd);
+
+  bool connected(void);
+  int16_t close(void);
+
+  int write(const void *buf, uint16_t len, uint32_t flags = 0);
+  size_t write(uint8_t c);
+  using Print::write;
+
+  int read(void *buf, uint16_t len, uint32_t flags = 0);
+  uint8_t read(void);
+  uint8_t available(void);
+
+private:
+  int _socket;
+};
+
+class Adafruit_CC3000
+{
+public:
+  Adafruit_CC3000(uint8_t csPin, uint8_t irqPin, uint8_t vbatPin, uint8_t spispeed = SPI_CLOCK_DIVIDER);
+  bool begin(uint8_t patchReq = 0, bool useSmartConfigData = false);
+  void reboot(uint8_t patchReq = 0);
+  void stop(void);
+  bool disconnect(void);
+  bool checkConnected(void);
+  bool checkDHCP(void);
+  bool getFirmwareVersion(uint8_t *major, uint8_t *minor);
+  bool getMacAddress(uint8_t address[6]);
+  bool getIPAddress(uint32_t *retip, uint32_t *netmask, uint32_t *gateway, uint32_t *dhcpserv, uint32_t *dnsserv);
+  void printIPdotsRev(uint32_t ip);
+  bool connectToAP(const char *ssid, const char *key, uint8_t secmode);
+  bool startSmartConfig(const char *_deviceName = NULL, const char *smartConfigKey = NULL);
+  int16_t getHostByName(char *hostname, uint32_t *ip);
+  Adafruit_CC3000_Client connectTCP(uint32_t destIP, uint16_t destPort);
+};
+
+#endif // #ifndef ADAFRUIT_CC3000_H
@@ -0,0 +1,168 @@
+/*
+
+Host stand-in for the Arduino core: clock shim, PRNG, pins and Serial
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "Arduino.h"
+
+HardwareSerial Serial;
+
+/* Power-on reset */
+uint8_t MCUSR = 0x01;
+
+static uint64_t monotonic_uS(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000) + (ts.tv_nsec / 1000);
+}
+
+static uint64_t start_uS(void)
+{
+  /* Time zero is the first call, as at reset on the target */
+  static uint64_t start = monotonic_uS();
+  return start;
+}
+
+uint32_t millis(void)
+{
+  uint64_t start = start_uS();
+  return (uint32_t)((monotonic_uS() - start) / 1000);
+}
+
+uint32_t micros(void)
+{
+  uint64_t start = start_uS();
+  return (uint32_t)(monotonic_uS() - start);
+}
+
+void delay(uint32_t ms)
+{
+  struct timespec ts;
+  ts.tv_sec = ms / 1000;
+  ts.tv_nsec = (ms % 1000) * 1000000L;
+  nanosleep(&ts, NULL);
+}
+
+void delayMicroseconds(uint16_t us)
+{
+  struct timespec ts;
+  ts.tv_sec = 0;
+  ts.tv_nsec = us * 1000L;
+  nanosleep(&ts, NULL);
+}
+
+void randomSeed(uint32_t seed)
+{
+  if (seed != 0)
+  {
+    srandom(seed);
+  }
+}
+
+long random(long howbig)
+{
+  if (howbig == 0)
+  {
+    return 0;
+  }
+
+  return ::random() % howbig;
+}
+
+long random(long howsmall, long howbig)
+{
+  if (howsmall >= howbig)
+  {
+    return howsmall;
+  }
+
+  return random(howbig - howsmall) + howsmall;
+}
+
+void pinMode(uint8_t pin, uint8_t mode)
+{
+  (void)pin;
+  (void)mode;
+}
+
+void digitalWrite(uint8_t pin, uint8_t value)
+{
+  (void)pin;
+  (void)value;
+}
+
+int digitalRead(uint8_t pin)
+{
+  /* Inputs idle high, as with INPUT_PULLUP */
+  (void)pin;
+  return HIGH;
+}
+
+int analogRead(uint8_t pin)
+{
+  /* Floating input; use the clock as a source of noise */
+  (void)pin;
+  return (int)(micros() & 0x3ff);
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+  (void)baud;
+}
+
+void HardwareSerial::end(void)
+{
+}
+
+int HardwareSerial::available(void)
+{
+  return 0;
+}
+
+int HardwareSerial::peek(void)
+{
+  return -1;
+}
+
+int HardwareSerial::read(void)
+{
+  return -1;
+}
+
+void HardwareSerial::flush(void)
+{
+  fflush(stdout);
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+  putchar(c);
+  return 1;
+}
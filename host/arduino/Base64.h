@@ -0,0 +1,44 @@
+/*
+
+Host stand-in for the Arduino Base64 library bundled with Arduino-Websocket
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef BASE64_H
+#define BASE64_H
+
+/* Encode 'inputLen' bytes from 'input' as a null-terminated string in 'output'; */
+/* returns the number of characters written, excluding the terminator */
+int base64_encode(char *output, char *input, int inputLen);
+
+/* Decode 'inputLen' characters from 'input' into 'output'; */
+/* returns the number of bytes written */
+int base64_decode(char *output, char *input, int inputLen);
+
+/* Length of the encoded form of 'inputLen' bytes, excluding the terminator */
+int base64_enc_len(int inputLen);
+
+/* Length of the decoded form of 'inputLen' characters of 'input' */
+int base64_dec_len(char *input, int inputLen);
+
+#endif // #ifndef BASE64_H
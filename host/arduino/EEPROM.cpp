@@ -0,0 +1,118 @@
+/*
+
+Host stand-in for the Arduino EEPROM library
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "EEPROM.h"
+
+EEPROMClass EEPROM;
+
+EEPROMClass::EEPROMClass()
+{
+  loaded = false;
+}
+
+const char *EEPROMClass::fileName(void)
+{
+  const char *name = getenv("BC_HOST_EEPROM");
+  return (name != NULL) ? name : "eeprom.bin";
+}
+
+void EEPROMClass::load(void)
+{
+  FILE *f;
+
+  if (loaded)
+  {
+    return;
+  }
+
+  /* Erased EEPROM reads as 0xff */
+  memset(data, 0xff, sizeof(data));
+
+  f = fopen(fileName(), "rb");
+  if (f != NULL)
+  {
+    if (fread(data, 1, sizeof(data), f) != sizeof(data))
+    {
+      /* Short file; remainder stays erased */
+    }
+    fclose(f);
+  }
+
+  loaded = true;
+}
+
+uint8_t EEPROMClass::read(int address)
+{
+  load();
+
+  if ((address < 0) || (address >= HOST_EEPROM_SIZE_BYTES))
+  {
+    return 0xff;
+  }
+
+  return data[address];
+}
+
+void EEPROMClass::write(int address, uint8_t value)
+{
+  FILE *f;
+
+  load();
+
+  if ((address < 0) || (address >= HOST_EEPROM_SIZE_BYTES))
+  {
+    return;
+  }
+
+  if (data[address] == value)
+  {
+    return;
+  }
+
+  data[address] = value;
+
+  /* Write through so the file is valid if the process is killed */
+  f = fopen(fileName(), "r+b");
+  if (f == NULL)
+  {
+    f = fopen(fileName(), "w+b");
+    if (f == NULL)
+    {
+      return;
+    }
+    fwrite(data, 1, sizeof(data), f);
+  }
+  else
+  {
+    fseek(f, address, SEEK_SET);
+    fputc(value, f);
+  }
+  fclose(f);
+}
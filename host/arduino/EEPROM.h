@@ -0,0 +1,56 @@
+/*
+
+Host stand-in for the Arduino EEPROM library
+
+The EEPROM contents are kept in a file so that they persist between runs
+like the real part. The file name is taken from the BC_HOST_EEPROM
+environment variable, defaulting to 'eeprom.bin' in the working directory.
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef EEPROM_H
+#define EEPROM_H
+
+#include <stdint.h>
+
+#ifndef HOST_EEPROM_SIZE_BYTES
+#define HOST_EEPROM_SIZE_BYTES (4*1024) // Arduino Mega 2560
+#endif
+
+class EEPROMClass
+{
+public:
+  EEPROMClass();
+  uint8_t read(int address);
+  void write(int address, uint8_t value);
+
+private:
+  void load(void);
+  const char *fileName(void);
+  uint8_t data[HOST_EEPROM_SIZE_BYTES];
+  bool loaded;
+};
+
+extern EEPROMClass EEPROM;
+
+#endif // #ifndef EEPROM_H
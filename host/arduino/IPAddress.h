@@ -0,0 +1,51 @@
+/*
+
+Host stand-in for the Arduino IPAddress class
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef IPADDRESS_H
+#define IPADDRESS_H
+
+#include <stdint.h>
+
+class IPAddress
+{
+public:
+  IPAddress();
+  IPAddress(uint8_t first_octet, uint8_t second_octet, uint8_t third_octet, uint8_t fourth_octet);
+  IPAddress(uint32_t address);
+
+  operator uint32_t() const;
+  bool operator == (const IPAddress &addr) const;
+  bool operator != (const IPAddress &addr) const { return !(*this == addr); }
+  uint8_t operator [] (int index) const { return _address[index]; }
+  uint8_t & operator [] (int index) { return _address[index]; }
+
+private:
+  uint8_t _address[4];
+};
+
+extern const IPAddress INADDR_NONE;
+
+#endif // #ifndef IPADDRESS_H
@@ -0,0 +1,257 @@
+/*
+
+Host stand-in for the Arduino Print class
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <string.h>
+
+#include "Arduino.h"
+#include "Print.h"
+
+size_t Print::write(const char *str)
+{
+  if (str == NULL)
+  {
+    return 0;
+  }
+
+  return write((const uint8_t *)str, strlen(str));
+}
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+  size_t n = 0;
+
+  while (size-- > 0)
+  {
+    n += write(*buffer++);
+  }
+
+  return n;
+}
+
+size_t Print::print(const __FlashStringHelper *ifsh)
+{
+  const char *p = reinterpret_cast<const char *>(ifsh);
+  size_t n = 0;
+  uint8_t c;
+
+  while ((c = pgm_read_byte(p++)) != 0)
+  {
+    n += write(c);
+  }
+
+  return n;
+}
+
+size_t Print::print(const String &s)
+{
+  return write((const uint8_t *)s.c_str(), s.length());
+}
+
+size_t Print::print(const char str[])
+{
+  return write(str);
+}
+
+size_t Print::print(char c)
+{
+  return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char b, int base)
+{
+  return print((unsigned long)b, base);
+}
+
+size_t Print::print(int n, int base)
+{
+  return print((long)n, base);
+}
+
+size_t Print::print(unsigned int n, int base)
+{
+  return print((unsigned long)n, base);
+}
+
+size_t Print::print(long n, int base)
+{
+  if (base == 0)
+  {
+    return write((uint8_t)n);
+  }
+
+  if ((base == DEC) && (n < 0))
+  {
+    size_t t = print('-');
+    return t + printNumber((unsigned long)-n, DEC);
+  }
+
+  return printNumber((unsigned long)n, base);
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+  if (base == 0)
+  {
+    return write((uint8_t)n);
+  }
+
+  return printNumber(n, base);
+}
+
+size_t Print::print(double n, int digits)
+{
+  return printFloat(n, digits);
+}
+
+size_t Print::println(const __FlashStringHelper *ifsh)
+{
+  size_t n = print(ifsh);
+  return n + println();
+}
+
+size_t Print::println(const String &s)
+{
+  size_t n = print(s);
+  return n + println();
+}
+
+size_t Print::println(const char str[])
+{
+  size_t n = print(str);
+  return n + println();
+}
+
+size_t Print::println(char c)
+{
+  size_t n = print(c);
+  return n + println();
+}
+
+size_t Print::println(unsigned char b, int base)
+{
+  size_t n = print(b, base);
+  return n + println();
+}
+
+size_t Print::println(int num, int base)
+{
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(unsigned int num, int base)
+{
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(long num, int base)
+{
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(unsigned long num, int base)
+{
+  size_t n = print(num, base);
+  return n + println();
+}
+
+size_t Print::println(double num, int digits)
+{
+  size_t n = print(num, digits);
+  return n + println();
+}
+
+size_t Print::println(void)
+{
+  size_t n = print('\r');
+  return n + print('\n');
+}
+
+size_t Print::printNumber(unsigned long n, uint8_t base)
+{
+  char buf[8 * sizeof(long) + 1]; /* Enough for base 2 */
+  char *str = &buf[sizeof(buf) - 1];
+
+  *str = '\0';
+
+  if (base < 2)
+  {
+    base = 10;
+  }
+
+  do {
+    unsigned long m = n;
+    n /= base;
+    char c = m - base * n;
+    *--str = c < 10 ? c + '0' : c + 'A' - 10;
+  } while (n);
+
+  return write(str);
+}
+
+size_t Print::printFloat(double number, uint8_t digits)
+{
+  size_t n = 0;
+  double rounding = 0.5;
+  uint8_t i;
+
+  if (isnan(number)) return print("nan");
+  if (isinf(number)) return print("inf");
+
+  if (number < 0.0)
+  {
+    n += print('-');
+    number = -number;
+  }
+
+  for (i = 0; i < digits; ++i)
+  {
+    rounding /= 10.0;
+  }
+
+  number += rounding;
+
+  unsigned long int_part = (unsigned long)number;
+  double remainder = number - (double)int_part;
+  n += print(int_part);
+
+  if (digits > 0)
+  {
+    n += print('.');
+  }
+
+  while (digits-- > 0)
+  {
+    remainder *= 10.0;
+    int toPrint = int(remainder);
+    n += print(toPrint);
+    remainder -= toPrint;
+  }
+
+  return n;
+}
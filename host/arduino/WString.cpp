@@ -0,0 +1,363 @@
+/*
+
+Host stand-in for the Arduino String class
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "WString.h"
+
+String::String(const char *cstr)
+{
+  buffer = NULL;
+  capacity = 0;
+  len = 0;
+
+  if (cstr != NULL)
+  {
+    copy(cstr, strlen(cstr));
+  }
+}
+
+String::String(const String &str)
+{
+  buffer = NULL;
+  capacity = 0;
+  len = 0;
+  *this = str;
+}
+
+String::String(char c)
+{
+  char buf[2] = {c, '\0'};
+  buffer = NULL;
+  capacity = 0;
+  len = 0;
+  *this = buf;
+}
+
+static const char *formatNumber(char *buf, size_t size, unsigned long value, bool negative, unsigned char base)
+{
+  char *str = &buf[size - 1];
+
+  *str = '\0';
+
+  if (base < 2)
+  {
+    base = 10;
+  }
+
+  do {
+    char c = value % base;
+    value /= base;
+    *--str = c < 10 ? c + '0' : c + 'a' - 10;
+  } while (value);
+
+  if (negative)
+  {
+    *--str = '-';
+  }
+
+  return str;
+}
+
+String::String(unsigned char value, unsigned char base)
+{
+  char buf[8 * sizeof(value) + 1];
+  buffer = NULL;
+  capacity = 0;
+  len = 0;
+  *this = formatNumber(buf, sizeof(buf), value, false, base);
+}
+
+String::String(int value, unsigned char base)
+{
+  char buf[8 * sizeof(value) + 2];
+  bool negative = (value < 0) && (base == 10);
+  buffer = NULL;
+  capacity = 0;
+  len = 0;
+  *this = formatNumber(buf, sizeof(buf), negative ? -(long)value : (unsigned int)value, negative, base);
+}
+
+String::String(unsigned int value, unsigned char base)
+{
+  char buf[8 * sizeof(value) + 1];
+  buffer = NULL;
+  capacity = 0;
+  len = 0;
+  *this = formatNumber(buf, sizeof(buf), value, false, base);
+}
+
+String::String(long value, unsigned char base)
+{
+  char buf[8 * sizeof(value) + 2];
+  bool negative = (value < 0) && (base == 10);
+  buffer = NULL;
+  capacity = 0;
+  len = 0;
+  *this = formatNumber(buf, sizeof(buf), negative ? -(unsigned long)value : (unsigned long)value, negative, base);
+}
+
+String::String(unsigned long value, unsigned char base)
+{
+  char buf[8 * sizeof(value) + 1];
+  buffer = NULL;
+  capacity = 0;
+  len = 0;
+  *this = formatNumber(buf, sizeof(buf), value, false, base);
+}
+
+String::~String(void)
+{
+  free(buffer);
+}
+
+void String::invalidate(void)
+{
+  free(buffer);
+  buffer = NULL;
+  capacity = len = 0;
+}
+
+bool String::reserve(unsigned int size)
+{
+  if ((buffer != NULL) && (capacity >= size))
+  {
+    return true;
+  }
+
+  if (changeBuffer(size))
+  {
+    if (len == 0)
+    {
+      buffer[0] = '\0';
+    }
+    return true;
+  }
+
+  return false;
+}
+
+bool String::changeBuffer(unsigned int maxStrLen)
+{
+  /* Grow to exactly the size required, as the Arduino core does */
+  char *newbuffer = (char *)realloc(buffer, maxStrLen + 1);
+
+  if (newbuffer != NULL)
+  {
+    buffer = newbuffer;
+    capacity = maxStrLen;
+    return true;
+  }
+
+  return false;
+}
+
+String & String::copy(const char *cstr, unsigned int length)
+{
+  if (!reserve(length))
+  {
+    invalidate();
+    return *this;
+  }
+
+  len = length;
+  memcpy(buffer, cstr, length);
+  buffer[len] = '\0';
+  return *this;
+}
+
+String & String::operator = (const String &rhs)
+{
+  if (this == &rhs)
+  {
+    return *this;
+  }
+
+  if (rhs.buffer != NULL)
+  {
+    copy(rhs.buffer, rhs.len);
+  }
+  else
+  {
+    invalidate();
+  }
+
+  return *this;
+}
+
+String & String::operator = (const char *cstr)
+{
+  if (cstr != NULL)
+  {
+    copy(cstr, strlen(cstr));
+  }
+  else
+  {
+    invalidate();
+  }
+
+  return *this;
+}
+
+bool String::concat(const String &s)
+{
+  return concat(s.c_str(), s.len);
+}
+
+bool String::concat(const char *cstr, unsigned int length)
+{
+  unsigned int newlen = len + length;
+
+  if (cstr == NULL)
+  {
+    return false;
+  }
+
+  if (length == 0)
+  {
+    return true;
+  }
+
+  if (!reserve(newlen))
+  {
+    return false;
+  }
+
+  memmove(buffer + len, cstr, length);
+  len = newlen;
+  buffer[len] = '\0';
+  return true;
+}
+
+bool String::concat(const char *cstr)
+{
+  if (cstr == NULL)
+  {
+    return false;
+  }
+
+  return concat(cstr, strlen(cstr));
+}
+
+bool String::concat(char c)
+{
+  char buf[2] = {c, '\0'};
+  return concat(buf, 1);
+}
+
+bool String::concat(unsigned long num)
+{
+  String s(num);
+  return concat(s);
+}
+
+String operator + (const String &lhs, const String &rhs)
+{
+  String a(lhs);
+  a.concat(rhs);
+  return a;
+}
+
+String operator + (const String &lhs, const char *cstr)
+{
+  String a(lhs);
+  a.concat(cstr);
+  return a;
+}
+
+String operator + (const char *cstr, const String &rhs)
+{
+  String a(cstr);
+  a.concat(rhs);
+  return a;
+}
+
+int String::compareTo(const String &s) const
+{
+  return strcmp(c_str(), s.c_str());
+}
+
+bool String::equals(const String &s) const
+{
+  return (len == s.len) && (compareTo(s) == 0);
+}
+
+bool String::equals(const char *cstr) const
+{
+  if (cstr == NULL)
+  {
+    return len == 0;
+  }
+
+  return strcmp(c_str(), cstr) == 0;
+}
+
+char String::charAt(unsigned int index) const
+{
+  return operator[](index);
+}
+
+char String::operator [] (unsigned int index) const
+{
+  if ((index >= len) || (buffer == NULL))
+  {
+    return 0;
+  }
+
+  return buffer[index];
+}
+
+void String::getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index) const
+{
+  unsigned int n;
+
+  if ((bufsize == 0) || (buf == NULL))
+  {
+    return;
+  }
+
+  if (index >= len)
+  {
+    buf[0] = 0;
+    return;
+  }
+
+  n = bufsize - 1;
+  if (n > len - index)
+  {
+    n = len - index;
+  }
+
+  strncpy((char *)buf, buffer + index, n);
+  buf[n] = 0;
+}
+
+long String::toInt(void) const
+{
+  return (buffer != NULL) ? atol(buffer) : 0;
+}
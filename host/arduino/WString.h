@@ -0,0 +1,94 @@
+/*
+
+Host stand-in for the Arduino String class
+
+Storage is grown with realloc() to the exact length required, as the
+Arduino core does, so heap behaviour on the host matches the target.
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef WSTRING_H
+#define WSTRING_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+class String
+{
+public:
+  String(const char *cstr = "");
+  String(const String &str);
+  explicit String(char c);
+  explicit String(unsigned char value, unsigned char base = 10);
+  explicit String(int value, unsigned char base = 10);
+  explicit String(unsigned int value, unsigned char base = 10);
+  explicit String(long value, unsigned char base = 10);
+  explicit String(unsigned long value, unsigned char base = 10);
+  ~String(void);
+
+  String & operator = (const String &rhs);
+  String & operator = (const char *cstr);
+
+  bool reserve(unsigned int size);
+  unsigned int length(void) const { return len; }
+
+  bool concat(const String &str);
+  bool concat(const char *cstr);
+  bool concat(const char *cstr, unsigned int length);
+  bool concat(char c);
+  bool concat(unsigned long num);
+  String & operator += (const String &rhs) { concat(rhs); return (*this); }
+  String & operator += (const char *cstr) { concat(cstr); return (*this); }
+  String & operator += (char c) { concat(c); return (*this); }
+
+  friend String operator + (const String &lhs, const String &rhs);
+  friend String operator + (const String &lhs, const char *cstr);
+  friend String operator + (const char *cstr, const String &rhs);
+
+  int compareTo(const String &s) const;
+  bool equals(const String &s) const;
+  bool equals(const char *cstr) const;
+  bool operator == (const String &rhs) const { return equals(rhs); }
+  bool operator == (const char *cstr) const { return equals(cstr); }
+  bool operator != (const String &rhs) const { return !equals(rhs); }
+  bool operator != (const char *cstr) const { return !equals(cstr); }
+
+  char charAt(unsigned int index) const;
+  char operator [] (unsigned int index) const;
+  void getBytes(unsigned char *buf, unsigned int bufsize, unsigned int index = 0) const;
+  void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const
+    { getBytes((unsigned char *)buf, bufsize, index); }
+  const char *c_str(void) const { return buffer ? buffer : ""; }
+  long toInt(void) const;
+
+protected:
+  char *buffer;
+  unsigned int capacity;
+  unsigned int len;
+
+  void invalidate(void);
+  bool changeBuffer(unsigned int maxStrLen);
+  String & copy(const char *cstr, unsigned int length);
+};
+
+#endif // #ifndef WSTRING_H
@@ -0,0 +1,324 @@
+/*
+
+Host stand-in for the Arduino-Websocket client library
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <string.h>
+
+#include "WebSocketClient.h"
+
+#define HANDSHAKE_ATTEMPTS_100MS 50
+
+WebSocketClient::WebSocketClient()
+{
+  socket_client = NULL;
+  path = NULL;
+  host = NULL;
+  protocol = NULL;
+  protocolChosen = -1;
+}
+
+bool WebSocketClient::handshake(Client &client)
+{
+  socket_client = &client;
+
+  if (!socket_client->connected())
+  {
+    return false;
+  }
+
+  if (!analyzeRequest())
+  {
+    disconnectStream();
+    return false;
+  }
+
+  return true;
+}
+
+bool WebSocketClient::analyzeRequest(void)
+{
+  String temp;
+  int bite;
+  bool upgraded = false;
+  bool switching = false;
+  uint8_t attempts = HANDSHAKE_ATTEMPTS_100MS;
+
+  protocolChosen = -1;
+
+  /* Fixed key; the client is not required to verify the accept value */
+  socket_client->print(F("GET "));
+  socket_client->print(path);
+  socket_client->print(F(" HTTP/1.1\r\n"));
+  socket_client->print(F("Upgrade: websocket\r\n"));
+  socket_client->print(F("Connection: Upgrade\r\n"));
+  socket_client->print(F("Host: "));
+  socket_client->print(host);
+  socket_client->print(F("\r\n"));
+  socket_client->print(F("Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\n"));
+  if (protocol != NULL)
+  {
+    socket_client->print(F("Sec-WebSocket-Protocol: "));
+    socket_client->print(protocol);
+    socket_client->print(F("\r\n"));
+  }
+  socket_client->print(F("Sec-WebSocket-Version: 13\r\n\r\n"));
+
+  while (socket_client->connected() && !socket_client->available())
+  {
+    delay(100);
+
+    if (--attempts == 0)
+    {
+      return false;
+    }
+  }
+
+  /* Read the response header line by line */
+  while ((bite = timedRead()) != -1)
+  {
+    temp += (char)bite;
+
+    if ((char)bite == '\n')
+    {
+      if (temp.length() <= 2)
+      {
+        /* Blank line; end of header */
+        break;
+      }
+
+      if (strncmp(temp.c_str(), "HTTP/1.1 101", 12) == 0)
+      {
+        switching = true;
+      }
+
+      if ((strncmp(temp.c_str(), "Upgrade: websocket", 18) == 0) ||
+          (strncmp(temp.c_str(), "Upgrade: WebSocket", 18) == 0))
+      {
+        upgraded = true;
+      }
+
+      if (strncmp(temp.c_str(), "Sec-WebSocket-Protocol: ", 24) == 0)
+      {
+        protocolChosen = findProtocol(temp.c_str() + 24, temp.length() - 24);
+      }
+
+      temp = "";
+    }
+  }
+
+  return switching && upgraded;
+}
+
+int8_t WebSocketClient::findProtocol(const char *name, uint8_t length)
+{
+  const char *offered = protocol;
+  const char *end;
+  int8_t index = 0;
+
+  /* Less the line ending */
+  while ((length > 0) && ((name[length - 1] == '\r') || (name[length - 1] == '\n')))
+  {
+    length--;
+  }
+
+  while (offered != NULL)
+  {
+    end = strchr(offered, ',');
+    if (end == NULL)
+    {
+      end = offered + strlen(offered);
+    }
+
+    if (((uint8_t)(end - offered) == length) && (strncmp(offered, name, length) == 0))
+    {
+      return index;
+    }
+
+    if (*end == '\0')
+    {
+      break;
+    }
+
+    /* Skip the ", " */
+    offered = end + 1;
+    while (*offered == ' ')
+    {
+      offered++;
+    }
+    index++;
+  }
+
+  return -1;
+}
+
+bool WebSocketClient::handleStream(String& data, uint8_t *opcode)
+{
+  uint8_t msgtype;
+  uint8_t bite;
+  uint64_t length;
+  uint8_t mask[4];
+  uint8_t index;
+  bool hasMask;
+
+  if ((socket_client == NULL) || !socket_client->connected() || !socket_client->available())
+  {
+    return false;
+  }
+
+  msgtype = timedRead();
+  if (!socket_client->connected())
+  {
+    return false;
+  }
+
+  length = timedRead();
+  hasMask = (length & WS_MASK) != 0;
+  length &= 0x7f;
+
+  if (length == WS_SIZE16)
+  {
+    length = timedRead() << 8;
+    length |= timedRead();
+  }
+  else if (length == WS_SIZE64)
+  {
+    length = 0;
+    for (index = 0; index < 8; index++)
+    {
+      length = (length << 8) | (uint8_t)timedRead();
+    }
+  }
+
+  if (hasMask)
+  {
+    for (index = 0; index < 4; index++)
+    {
+      mask[index] = timedRead();
+    }
+  }
+
+  data = "";
+
+  if (opcode != NULL)
+  {
+    *opcode = msgtype & ~WS_FIN;
+  }
+
+  for (uint64_t i = 0; i < length; i++)
+  {
+    bite = timedRead();
+    if (hasMask)
+    {
+      bite ^= mask[i % 4];
+    }
+    data += (char)bite;
+  }
+
+  return true;
+}
+
+void WebSocketClient::disconnectStream(void)
+{
+  if (socket_client == NULL)
+  {
+    return;
+  }
+
+  /* Close frame with no payload, masked */
+  socket_client->write((uint8_t)(WS_FIN | WS_OPCODE_CLOSE));
+  socket_client->write((uint8_t)WS_MASK);
+  socket_client->write((uint8_t)0x00);
+  socket_client->write((uint8_t)0x00);
+  socket_client->write((uint8_t)0x00);
+  socket_client->write((uint8_t)0x00);
+  socket_client->flush();
+  delay(10);
+  socket_client->stop();
+}
+
+bool WebSocketClient::getData(String& data, uint8_t *opcode)
+{
+  return handleStream(data, opcode);
+}
+
+void WebSocketClient::sendData(const char *str, uint8_t opcode)
+{
+  if ((socket_client != NULL) && socket_client->connected())
+  {
+    sendEncodedData(str, strlen(str), opcode);
+  }
+}
+
+void WebSocketClient::sendData(String str, uint8_t opcode)
+{
+  if ((socket_client != NULL) && socket_client->connected())
+  {
+    sendEncodedData(str.c_str(), str.length(), opcode);
+  }
+}
+
+int WebSocketClient::timedRead(void)
+{
+  while (!socket_client->available())
+  {
+    if (!socket_client->connected())
+    {
+      return -1;
+    }
+    delay(1);
+  }
+
+  return socket_client->read();
+}
+
+void WebSocketClient::sendEncodedData(const char *str, uint16_t size, uint8_t opcode)
+{
+  uint8_t mask[4];
+  uint16_t i;
+
+  socket_client->write((uint8_t)(opcode | WS_FIN));
+
+  if (size > 125)
+  {
+    socket_client->write((uint8_t)(WS_SIZE16 | WS_MASK));
+    socket_client->write((uint8_t)(size >> 8));
+    socket_client->write((uint8_t)(size & 0xff));
+  }
+  else
+  {
+    socket_client->write((uint8_t)(size | WS_MASK));
+  }
+
+  for (i = 0; i < 4; i++)
+  {
+    mask[i] = random(0, 256);
+    socket_client->write(mask[i]);
+  }
+
+  for (i = 0; i < size; i++)
+  {
+    socket_client->write((uint8_t)(str[i] ^ mask[i % 4]));
+  }
+}
@@ -0,0 +1,83 @@
+/*
+
+Host stand-in for the Arduino-Websocket client library
+
+Mirrors the behaviour of the BERG fork: frames are received one byte at a
+time into an Arduino String and sent one byte at a time through the
+Client, so the cost of the transport on the host resembles the target.
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef WEBSOCKETCLIENT_H
+#define WEBSOCKETCLIENT_H
+
+#include "Arduino.h"
+#include "Client.h"
+
+#define WS_OPCODE_CONTINUATION  0x00
+#define WS_OPCODE_TEXT          0x01
+#define WS_OPCODE_BINARY        0x02
+#define WS_OPCODE_CLOSE         0x08
+#define WS_OPCODE_PING          0x09
+#define WS_OPCODE_PONG          0x0a
+
+#define WS_FIN                  0x80
+#define WS_MASK                 0x80
+#define WS_SIZE16               126
+#define WS_SIZE64               127
+
+class WebSocketClient
+{
+public:
+  WebSocketClient();
+
+  /* Perform the opening handshake on an already-connected client */
+  bool handshake(Client &client);
+
+  /* Get the next frame; returns false if no data is waiting */
+  bool getData(String& data, uint8_t *opcode = NULL);
+
+  /* Send a frame */
+  void sendData(const char *str, uint8_t opcode = WS_OPCODE_TEXT);
+  void sendData(String str, uint8_t opcode = WS_OPCODE_TEXT);
+
+  char *path;
+  char *host;
+  /* One protocol, or several separated by ", " in order of preference */
+  char *protocol;
+  /* After handshake(), the position in 'protocol' of the one the */
+  /* server chose, or -1 if it did not choose one */
+  int8_t protocolChosen;
+
+private:
+  Client *socket_client;
+
+  bool analyzeRequest(void);
+  int8_t findProtocol(const char *name, uint8_t length);
+  bool handleStream(String& data, uint8_t *opcode);
+  void disconnectStream(void);
+  int timedRead(void);
+  void sendEncodedData(const char *str, uint16_t size, uint8_t opcode);
+};
+
+#endif // #ifndef WEBSOCKETCLIENT_H
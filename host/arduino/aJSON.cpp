@@ -0,0 +1,623 @@
+/*
+
+Host stand-in for the aJson library
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "aJSON.h"
+
+aJsonClass aJson;
+
+/*
+ * Output buffer, grown as required
+ */
+
+typedef struct {
+  char *string;
+  size_t used;
+  size_t size;
+} printBuffer;
+
+static bool bufferAppend(printBuffer *b, const char *s, size_t n)
+{
+  if (b->used + n + 1 > b->size)
+  {
+    size_t newSize = (b->size == 0) ? 64 : b->size;
+    while (b->used + n + 1 > newSize)
+    {
+      newSize *= 2;
+    }
+
+    char *p = (char *)realloc(b->string, newSize);
+    if (p == NULL)
+    {
+      return false;
+    }
+    b->string = p;
+    b->size = newSize;
+  }
+
+  memcpy(b->string + b->used, s, n);
+  b->used += n;
+  b->string[b->used] = '\0';
+  return true;
+}
+
+static bool bufferAppend(printBuffer *b, const char *s)
+{
+  return bufferAppend(b, s, strlen(s));
+}
+
+/*
+ * Items
+ */
+
+static aJsonObject *newItem(char type)
+{
+  aJsonObject *node = (aJsonObject *)malloc(sizeof(aJsonObject));
+
+  if (node != NULL)
+  {
+    memset(node, 0x00, sizeof(aJsonObject));
+    node->type = type;
+  }
+
+  return node;
+}
+
+void aJsonClass::deleteItem(aJsonObject *c)
+{
+  aJsonObject *next;
+
+  while (c != NULL)
+  {
+    next = c->next;
+
+    if (c->child != NULL)
+    {
+      deleteItem(c->child);
+    }
+
+    if (c->type == aJson_String)
+    {
+      free(c->valuestring);
+    }
+
+    free(c->name);
+    free(c);
+    c = next;
+  }
+}
+
+aJsonObject *aJsonClass::createNull(void)
+{
+  return newItem(aJson_NULL);
+}
+
+aJsonObject *aJsonClass::createItem(bool b)
+{
+  aJsonObject *item = newItem(b ? aJson_True : aJson_False);
+  if (item != NULL)
+  {
+    item->valuebool = b;
+  }
+  return item;
+}
+
+aJsonObject *aJsonClass::createItem(char b)
+{
+  return createItem((bool)(b != 0));
+}
+
+aJsonObject *aJsonClass::createItem(int num)
+{
+  aJsonObject *item = newItem(aJson_Int);
+  if (item != NULL)
+  {
+    item->valueint = num;
+  }
+  return item;
+}
+
+aJsonObject *aJsonClass::createItem(uint32_t num)
+{
+  aJsonObject *item = newItem(aJson_Int);
+  if (item != NULL)
+  {
+    item->valueint = (long)num;
+  }
+  return item;
+}
+
+aJsonObject *aJsonClass::createItem(double num)
+{
+  aJsonObject *item = newItem(aJson_Float);
+  if (item != NULL)
+  {
+    item->valuefloat = num;
+  }
+  return item;
+}
+
+aJsonObject *aJsonClass::createItem(const char *string)
+{
+  aJsonObject *item = newItem(aJson_String);
+  if (item != NULL)
+  {
+    item->valuestring = strdup(string);
+    if (item->valuestring == NULL)
+    {
+      free(item);
+      return NULL;
+    }
+  }
+  return item;
+}
+
+aJsonObject *aJsonClass::createArray(void)
+{
+  return newItem(aJson_Array);
+}
+
+aJsonObject *aJsonClass::createObject(void)
+{
+  return newItem(aJson_Object);
+}
+
+void aJsonClass::addItemToArray(aJsonObject *array, aJsonObject *item)
+{
+  aJsonObject *c;
+
+  if ((array == NULL) || (item == NULL))
+  {
+    return;
+  }
+
+  c = array->child;
+  if (c == NULL)
+  {
+    array->child = item;
+    return;
+  }
+
+  while (c->next != NULL)
+  {
+    c = c->next;
+  }
+  c->next = item;
+}
+
+void aJsonClass::addItemToObject(aJsonObject *object, const char *string, aJsonObject *item)
+{
+  if (item == NULL)
+  {
+    return;
+  }
+
+  free(item->name);
+  item->name = strdup(string);
+  addItemToArray(object, item);
+}
+
+aJsonObject *aJsonClass::getArrayItem(aJsonObject *array, unsigned char item)
+{
+  aJsonObject *c = (array != NULL) ? array->child : NULL;
+
+  while ((c != NULL) && (item > 0))
+  {
+    item--;
+    c = c->next;
+  }
+
+  return c;
+}
+
+aJsonObject *aJsonClass::getObjectItem(aJsonObject *object, const char *string)
+{
+  aJsonObject *c = (object != NULL) ? object->child : NULL;
+
+  while ((c != NULL) && ((c->name == NULL) || (strcasecmp(c->name, string) != 0)))
+  {
+    c = c->next;
+  }
+
+  return c;
+}
+
+/*
+ * Printing
+ */
+
+static bool printString(printBuffer *b, const char *s)
+{
+  char escape[8];
+
+  if (!bufferAppend(b, "\""))
+  {
+    return false;
+  }
+
+  while (*s != '\0')
+  {
+    const char *start = s;
+
+    /* Copy runs of characters that need no escaping in one go */
+    while ((*s != '\0') && (*s != '"') && (*s != '\\') && ((unsigned char)*s >= 0x20))
+    {
+      s++;
+    }
+
+    if ((s > start) && !bufferAppend(b, start, s - start))
+    {
+      return false;
+    }
+
+    if (*s == '\0')
+    {
+      break;
+    }
+
+    switch (*s)
+    {
+      case '"':  strcpy(escape, "\\\""); break;
+      case '\\': strcpy(escape, "\\\\"); break;
+      case '\b': strcpy(escape, "\\b"); break;
+      case '\f': strcpy(escape, "\\f"); break;
+      case '\n': strcpy(escape, "\\n"); break;
+      case '\r': strcpy(escape, "\\r"); break;
+      case '\t': strcpy(escape, "\\t"); break;
+      default:   snprintf(escape, sizeof(escape), "\\u%04x", (unsigned char)*s); break;
+    }
+
+    if (!bufferAppend(b, escape))
+    {
+      return false;
+    }
+    s++;
+  }
+
+  return bufferAppend(b, "\"");
+}
+
+static bool printValue(printBuffer *b, aJsonObject *item)
+{
+  char number[32];
+  aJsonObject *c;
+
+  switch (item->type)
+  {
+    case aJson_NULL:
+      return bufferAppend(b, "null");
+    case aJson_False:
+      return bufferAppend(b, "false");
+    case aJson_True:
+      return bufferAppend(b, "true");
+    case aJson_Int:
+      snprintf(number, sizeof(number), "%ld", item->valueint);
+      return bufferAppend(b, number);
+    case aJson_Float:
+      snprintf(number, sizeof(number), "%g", item->valuefloat);
+      return bufferAppend(b, number);
+    case aJson_String:
+      return printString(b, item->valuestring);
+    case aJson_Array:
+    case aJson_Object:
+      if (!bufferAppend(b, (item->type == aJson_Array) ? "[" : "{"))
+      {
+        return false;
+      }
+      for (c = item->child; c != NULL; c = c->next)
+      {
+        if (item->type == aJson_Object)
+        {
+          if (!printString(b, (c->name != NULL) ? c->name : "") || !bufferAppend(b, ":"))
+          {
+            return false;
+          }
+        }
+        if (!printValue(b, c))
+        {
+          return false;
+        }
+        if ((c->next != NULL) && !bufferAppend(b, ","))
+        {
+          return false;
+        }
+      }
+      return bufferAppend(b, (item->type == aJson_Array) ? "]" : "}");
+  }
+
+  return false;
+}
+
+char *aJsonClass::print(aJsonObject *item)
+{
+  printBuffer b = {NULL, 0, 0};
+
+  if (item == NULL)
+  {
+    return NULL;
+  }
+
+  if (!printValue(&b, item))
+  {
+    free(b.string);
+    return NULL;
+  }
+
+  return b.string;
+}
+
+/*
+ * Parsing
+ */
+
+static const char *skip(const char *in)
+{
+  while ((in != NULL) && (*in != '\0') && ((unsigned char)*in <= ' '))
+  {
+    in++;
+  }
+  return in;
+}
+
+static const char *parseValue(aJsonObject *item, const char *value);
+
+static const char *parseString(char **out, const char *str)
+{
+  const char *ptr = str + 1;
+  char *ptr2;
+  size_t len = 0;
+
+  if (*str != '"')
+  {
+    return NULL;
+  }
+
+  /* Upper bound on the unescaped length */
+  while ((*ptr != '"') && (*ptr != '\0'))
+  {
+    if (*ptr++ == '\\')
+    {
+      if (*ptr == '\0')
+      {
+        return NULL;
+      }
+      ptr++;
+    }
+    len++;
+  }
+
+  if (*ptr != '"')
+  {
+    return NULL;
+  }
+
+  *out = (char *)malloc(len + 1);
+  if (*out == NULL)
+  {
+    return NULL;
+  }
+
+  ptr = str + 1;
+  ptr2 = *out;
+
+  while (*ptr != '"')
+  {
+    if (*ptr != '\\')
+    {
+      *ptr2++ = *ptr++;
+      continue;
+    }
+
+    ptr++;
+    switch (*ptr)
+    {
+      case 'b': *ptr2++ = '\b'; break;
+      case 'f': *ptr2++ = '\f'; break;
+      case 'n': *ptr2++ = '\n'; break;
+      case 'r': *ptr2++ = '\r'; break;
+      case 't': *ptr2++ = '\t'; break;
+      case 'u':
+      {
+        /* Only the basic latin range is supported */
+        unsigned int uc = 0;
+        if (sscanf(ptr + 1, "%4x", &uc) == 1)
+        {
+          ptr += 4;
+        }
+        *ptr2++ = (char)uc;
+        break;
+      }
+      default: *ptr2++ = *ptr; break;
+    }
+    ptr++;
+  }
+
+  *ptr2 = '\0';
+  return ptr + 1;
+}
+
+static const char *parseNumber(aJsonObject *item, const char *num)
+{
+  char *end;
+  double d;
+  long l;
+
+  l = strtol(num, &end, 10);
+  if ((*end == '.') || (*end == 'e') || (*end == 'E'))
+  {
+    d = strtod(num, &end);
+    item->type = aJson_Float;
+    item->valuefloat = d;
+  }
+  else
+  {
+    item->type = aJson_Int;
+    item->valueint = l;
+  }
+
+  return (end == num) ? NULL : end;
+}
+
+static const char *parseList(aJsonObject *item, const char *value, bool isObject)
+{
+  aJsonObject *child;
+  aJsonObject *last = NULL;
+
+  item->type = isObject ? aJson_Object : aJson_Array;
+  value = skip(value + 1);
+
+  if (*value == (isObject ? '}' : ']'))
+  {
+    return value + 1;
+  }
+
+  for (;;)
+  {
+    child = newItem(aJson_NULL);
+    if (child == NULL)
+    {
+      return NULL;
+    }
+
+    if (last == NULL)
+    {
+      item->child = child;
+    }
+    else
+    {
+      last->next = child;
+    }
+    last = child;
+
+    if (isObject)
+    {
+      value = parseString(&child->name, skip(value));
+      if (value == NULL)
+      {
+        return NULL;
+      }
+
+      value = skip(value);
+      if (*value != ':')
+      {
+        return NULL;
+      }
+      value++;
+    }
+
+    value = skip(parseValue(child, skip(value)));
+    if (value == NULL)
+    {
+      return NULL;
+    }
+
+    if (*value == ',')
+    {
+      value++;
+      continue;
+    }
+
+    if (*value == (isObject ? '}' : ']'))
+    {
+      return value + 1;
+    }
+
+    return NULL;
+  }
+}
+
+static const char *parseValue(aJsonObject *item, const char *value)
+{
+  if (value == NULL)
+  {
+    return NULL;
+  }
+
+  if (strncmp(value, "null", 4) == 0)
+  {
+    item->type = aJson_NULL;
+    return value + 4;
+  }
+
+  if (strncmp(value, "false", 5) == 0)
+  {
+    item->type = aJson_False;
+    item->valuebool = 0;
+    return value + 5;
+  }
+
+  if (strncmp(value, "true", 4) == 0)
+  {
+    item->type = aJson_True;
+    item->valuebool = 1;
+    return value + 4;
+  }
+
+  if (*value == '"')
+  {
+    item->type = aJson_String;
+    return parseString(&item->valuestring, value);
+  }
+
+  if ((*value == '-') || isdigit((unsigned char)*value))
+  {
+    return parseNumber(item, value);
+  }
+
+  if (*value == '[')
+  {
+    return parseList(item, value, false);
+  }
+
+  if (*value == '{')
+  {
+    return parseList(item, value, true);
+  }
+
+  return NULL;
+}
+
+aJsonObject *aJsonClass::parse(char *value)
+{
+  aJsonObject *c = newItem(aJson_NULL);
+
+  if (c == NULL)
+  {
+    return NULL;
+  }
+
+  if (parseValue(c, skip(value)) == NULL)
+  {
+    deleteItem(c);
+    return NULL;
+  }
+
+  return c;
+}
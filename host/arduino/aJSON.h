@@ -0,0 +1,83 @@
+/*
+
+Host stand-in for the aJson library
+
+One heap node per item and malloc()'d names and strings, as in aJson, so
+allocation counts on the host match those on the target.
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef AJSON_H
+#define AJSON_H
+
+#include <stdint.h>
+
+#define aJson_NULL    0
+#define aJson_False   1
+#define aJson_True    2
+#define aJson_Int     3
+#define aJson_Float   4
+#define aJson_String  5
+#define aJson_Array   6
+#define aJson_Object  7
+
+typedef struct aJsonObject {
+  char *name;
+  struct aJsonObject *next;
+  struct aJsonObject *child;
+  char type;
+  union {
+    char *valuestring;
+    char valuebool;
+    long valueint;
+    double valuefloat;
+  };
+} aJsonObject;
+
+class aJsonClass
+{
+public:
+  aJsonObject *parse(char *value);
+  char *print(aJsonObject *item);
+  void deleteItem(aJsonObject *c);
+
+  aJsonObject *getArrayItem(aJsonObject *array, unsigned char item);
+  aJsonObject *getObjectItem(aJsonObject *object, const char *string);
+
+  aJsonObject *createNull(void);
+  aJsonObject *createItem(bool b);
+  aJsonObject *createItem(char b);
+  aJsonObject *createItem(int num);
+  aJsonObject *createItem(uint32_t num);
+  aJsonObject *createItem(double num);
+  aJsonObject *createItem(const char *string);
+  aJsonObject *createArray(void);
+  aJsonObject *createObject(void);
+
+  void addItemToArray(aJsonObject *array, aJsonObject *item);
+  void addItemToObject(aJsonObject *object, const char *string, aJsonObject *item);
+};
+
+extern aJsonClass aJson;
+
+#endif // #ifndef AJSON_H
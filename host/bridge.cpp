@@ -0,0 +1,188 @@
+/*
+
+Local bridge for the host runner
+
+Waits for bergcloud_host to connect, gives it a device ID, then sends it
+BC_BRIDGE_COMMANDS named commands (default 100) and checks that each is
+acknowledged and echoed back as an event. It reports the protocol used
+and the bytes on the wire for each command, response and event, so that
+JSON and binary frames can be compared:
+
+  BC_BRIDGE_PORT=8080 BC_BRIDGE_BINARY=1 ./build/bergcloud_bridge &
+  CC3000_HOST=127.0.0.1 CC3000_PORT=8080 ./build/bergcloud_host
+
+BC_BRIDGE_BINARY=0 keeps to JSON even if the device offers binary frames.
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "HostBridge.h"
+#include "BERGCloudCC3000.h"
+
+#define RECEIVE_TIMEOUT_MS 5000
+#define PING_INTERVAL      50 /* Commands */
+
+/* Device ID given to the runner */
+static const uint8_t deviceID[BC_DEVICE_ID_SIZE_BYTES] = {1, 2, 3, 4, 5, 6, 7, 8};
+
+static long envNumber(const char *name, long fallback)
+{
+  const char *value = getenv(name);
+  return (value != NULL) ? atol(value) : fallback;
+}
+
+static bool fail(const char *reason)
+{
+  fprintf(stderr, "bergcloud_bridge: %s\n", reason);
+  return false;
+}
+
+static bool setAddress(HostBridge& bridge, BRIDGE_MESSAGE& message)
+{
+  uint8_t data[BC_DEVICE_ID_SIZE_BYTES];
+  uint8_t i;
+
+  /* Sent least significant byte first */
+  for (i = 0; i < sizeof(data); i++)
+  {
+    data[i] = deviceID[sizeof(data) - i - 1];
+  }
+
+  if (!bridge.sendCommand(BC_COMMAND_SET_ADDRESS, 1, data, sizeof(data)))
+  {
+    return fail("Unable to send the device ID.");
+  }
+
+  if ((bridge.receive(message, RECEIVE_TIMEOUT_MS) != BRIDGE_RESPONSE) ||
+      (message.commandID != 1) || (message.returnCode != 0))
+  {
+    return fail("The device ID was not accepted.");
+  }
+
+  return true;
+}
+
+static bool run(HostBridge& bridge, uint32_t commands)
+{
+  static BRIDGE_MESSAGE message;
+  BERGCloudMessage command;
+  uint32_t commandBytes = 0;
+  uint32_t responseBytes = 0;
+  uint32_t eventBytes = 0;
+  uint32_t mark;
+  uint32_t i;
+
+  /* A named command, "led", with a small map as its payload */
+  if (!command.pack("led") || !command.pack_map(2) ||
+      !command.pack("colour") || !command.pack((uint32_t)0xff8000) ||
+      !command.pack("duration") || !command.pack((uint16_t)500))
+  {
+    return fail("Unable to pack the command.");
+  }
+
+  if (bridge.receive(message, RECEIVE_TIMEOUT_MS) != BRIDGE_CONNECT)
+  {
+    return fail("No connect event.");
+  }
+
+  if (!setAddress(bridge, message))
+  {
+    return false;
+  }
+
+  for (i = 0; i < commands; i++)
+  {
+    if (((i % PING_INTERVAL) == 0) && !bridge.sendPing())
+    {
+      return fail("Unable to send a ping.");
+    }
+
+    mark = bridge.bytesSent;
+    if (!bridge.sendCommand(BC_COMMAND_NAMED_PACKED, i + 2, command.ptr(), command.used()))
+    {
+      return fail("Unable to send a command.");
+    }
+    commandBytes += bridge.bytesSent - mark;
+
+    /* The command is acknowledged as the runner takes it... */
+    mark = bridge.bytesReceived;
+    if ((bridge.receive(message, RECEIVE_TIMEOUT_MS) != BRIDGE_RESPONSE) ||
+        (message.commandID != (i + 2)) || (message.returnCode != 0))
+    {
+      return fail("No response to a command.");
+    }
+    responseBytes += bridge.bytesReceived - mark;
+
+    /* ...and echoed back as an event of the same name */
+    mark = bridge.bytesReceived;
+    if (bridge.receive(message, RECEIVE_TIMEOUT_MS) != BRIDGE_EVENT)
+    {
+      return fail("No event in reply to a command.");
+    }
+    eventBytes += bridge.bytesReceived - mark;
+
+    if ((message.payloadSize != (BC_EVENT_HEADER_SIZE_BYTES + command.used())) ||
+        (memcmp(&message.payload[BC_EVENT_HEADER_SIZE_BYTES], command.ptr(), command.used()) != 0))
+    {
+      return fail("The event does not match the command.");
+    }
+  }
+
+  printf("Protocol: %s\n", bridge.binary() ? BC_WEBSOCKET_PROTOCOL_BINARY : BC_WEBSOCKET_PROTOCOL_JSON);
+  printf("Commands: %lu, payload %u bytes\n", (unsigned long)commands, command.used());
+  printf("Bytes on the wire per command: %lu\n", (unsigned long)(commandBytes / commands));
+  printf("Bytes on the wire per command response: %lu\n", (unsigned long)(responseBytes / commands));
+  printf("Bytes on the wire per event: %lu\n", (unsigned long)(eventBytes / commands));
+  return true;
+}
+
+int main(void)
+{
+  HostBridge bridge;
+  long commands = envNumber("BC_BRIDGE_COMMANDS", 100);
+
+  if (commands <= 0)
+  {
+    commands = 1;
+  }
+
+  if (!bridge.listen((uint16_t)envNumber("BC_BRIDGE_PORT", 8080)))
+  {
+    fail("Unable to listen.");
+    return EXIT_FAILURE;
+  }
+
+  printf("Listening on port %u\n", bridge.port());
+  fflush(stdout);
+
+  if (!bridge.accept(envNumber("BC_BRIDGE_BINARY", 1) != 0))
+  {
+    fail("Handshake failed.");
+    return EXIT_FAILURE;
+  }
+
+  return run(bridge, (uint32_t)commands) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
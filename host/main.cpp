@@ -0,0 +1,119 @@
+/*
+
+Host runner for the BERGCloud CC3000 library
+
+Connects to the bridge through the host stand-ins, echoes each command it
+receives back as an event, and exits after BC_HOST_RUN_SECONDS seconds
+(default: run forever). Set CC3000_HOST and CC3000_PORT to use a local
+bridge; see host/arduino/Adafruit_CC3000.h.
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Arduino.h"
+#include "BERGCloudCC3000.h"
+
+#define PROJECT_KEY "00000000000000000000000000000000"
+#define VERSION     1
+
+#define POLL_INTERVAL_MS 100
+
+static const char *projectKey(void)
+{
+  const char *key = getenv("BC_HOST_PROJECT_KEY");
+  return (key != NULL) ? key : PROJECT_KEY;
+}
+
+static uint32_t runTime_mS(void)
+{
+  const char *seconds = getenv("BC_HOST_RUN_SECONDS");
+  return (seconds != NULL) ? (uint32_t)atol(seconds) * 1000 : 0;
+}
+
+int main(void)
+{
+  BERGCloudWLANConfig WLANConfig;
+  uint32_t runTime = runTime_mS();
+  uint32_t pollTimer = 0;
+  uint32_t commands = 0;
+  BC_POOL_STATS poolStats;
+
+  WLANConfig.ssid = "host";
+  WLANConfig.pass = "";
+
+  BERGCloud.begin(WLANConfig);
+
+  if (!BERGCloud.connect(projectKey(), VERSION))
+  {
+    Serial.println(F("connect() returned false."));
+    return EXIT_FAILURE;
+  }
+
+  while ((runTime == 0) || (millis() < runTime))
+  {
+    BERGCloud.loop();
+
+    if ((millis() - pollTimer) < POLL_INTERVAL_MS)
+    {
+      delay(1);
+      continue;
+    }
+
+    pollTimer = millis();
+
+    BERGCloudCommand command;
+    String commandName;
+
+    if (BERGCloud.pollForCommand(command, commandName))
+    {
+      commands++;
+
+      /* Echo the command payload back as an event of the same name */
+      if (!BERGCloud.sendEvent(commandName, command))
+      {
+        Serial.println(F("sendEvent() returned false."));
+      }
+    }
+  }
+
+  Serial.print(F("Commands received: "));
+  Serial.println(commands);
+
+  if (BERGCloud.getCommandPoolStats(poolStats))
+  {
+    Serial.print(F("Command pool: lowest free "));
+    Serial.print(poolStats.lowestFree);
+    Serial.print(F(" of "));
+    Serial.print(poolStats.blocks);
+    Serial.print(F(", exhausted "));
+    Serial.print(poolStats.exhausted);
+    Serial.print(F(", oversize "));
+    Serial.print(poolStats.oversize);
+    Serial.print(F(", invalid releases "));
+    Serial.println(poolStats.invalid);
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,226 @@
+/*
+
+Tests for pack_array_of() and unpack_array_of()
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <string.h>
+
+#include "TestCommon.h"
+
+#define SAMPLES 100
+
+static void testDeltaInt16(void)
+{
+  BERGCloudMessage msg(256);
+  int16_t in[SAMPLES];
+  int16_t out[SAMPLES];
+  uint16_t items = 0;
+  uint16_t i;
+
+  /* A slowly changing signal, either side of zero */
+  for (i = 0; i < SAMPLES; i++)
+  {
+    in[i] = (int16_t)(-3000 + (i * 37) - ((i % 2) * 80));
+  }
+
+  CHECK(msg.pack_array_of(in, SAMPLES, true));
+
+  /* ext 8 header, the first value in full, then a byte for each change */
+  CHECK_EQUAL(3 + sizeof(int16_t) + (SAMPLES - 1), msg.used());
+  CHECK_EQUAL(BC_EXT_INT16_DELTA_ARRAY, msg.ptr()[2]);
+
+  memset(out, 0x00, sizeof(out));
+  CHECK(msg.unpack_array_of(out, SAMPLES, items));
+  CHECK_EQUAL(SAMPLES, items);
+  CHECK(memcmp(in, out, sizeof(in)) == 0);
+  CHECK_EQUAL(0, msg.remaining());
+}
+
+static void testDeltaUint16(void)
+{
+  BERGCloudMessage msg(256);
+  uint16_t in[SAMPLES];
+  uint16_t out[SAMPLES];
+  uint16_t items = 0;
+  uint16_t i;
+
+  /* Changes of exactly -128 and 127 still take a byte */
+  for (i = 0; i < SAMPLES; i++)
+  {
+    in[i] = (uint16_t)(40000 + ((i % 2) ? 127 : 0) - ((i / 2) * 1));
+  }
+  in[SAMPLES - 1] = in[SAMPLES - 2] - 128;
+
+  CHECK(msg.pack_array_of(in, SAMPLES, true));
+  CHECK_EQUAL(BC_EXT_UINT16_DELTA_ARRAY, msg.ptr()[2]);
+
+  memset(out, 0x00, sizeof(out));
+  CHECK(msg.unpack_array_of(out, SAMPLES, items));
+  CHECK_EQUAL(SAMPLES, items);
+  CHECK(memcmp(in, out, sizeof(in)) == 0);
+}
+
+static void testDeltaInt32(void)
+{
+  BERGCloudMessage msg(256);
+  int32_t in[SAMPLES];
+  int32_t out[SAMPLES];
+  uint16_t items = 0;
+  uint16_t i;
+
+  /* Across zero and the 16-bit range */
+  for (i = 0; i < SAMPLES; i++)
+  {
+    in[i] = 32700 + (int32_t)(i * 100) - 5000;
+  }
+
+  CHECK(msg.pack_array_of(in, SAMPLES, true));
+  CHECK_EQUAL(3 + sizeof(int32_t) + (SAMPLES - 1), msg.used());
+
+  memset(out, 0x00, sizeof(out));
+  CHECK(msg.unpack_array_of(out, SAMPLES, items));
+  CHECK_EQUAL(SAMPLES, items);
+  CHECK(memcmp(in, out, sizeof(in)) == 0);
+}
+
+static void testDeltaTooLarge(void)
+{
+  BERGCloudMessage msg(64);
+  int16_t in[] = {100, 200, 328, 329};
+  int16_t out[4];
+  uint16_t items = 0;
+
+  /* A change of 128 doesn't fit a byte, so every value is in full */
+  CHECK(msg.pack_array_of(in, 4, true));
+  CHECK_EQUAL(2 + (4 * sizeof(int16_t)), msg.used()); /* fixext 8 */
+  CHECK_EQUAL(BC_EXT_INT16_ARRAY, msg.ptr()[1]);
+
+  CHECK(msg.unpack_array_of(out, 4, items));
+  CHECK_EQUAL(4, items);
+  CHECK(memcmp(in, out, sizeof(in)) == 0);
+}
+
+static void testMaxItems(void)
+{
+  BERGCloudMessage msg(256);
+  int16_t in[SAMPLES];
+  int16_t out[10];
+  uint16_t items = 0;
+  uint16_t after = 0;
+  uint16_t i;
+
+  for (i = 0; i < SAMPLES; i++)
+  {
+    in[i] = (int16_t)(i * 3);
+  }
+
+  msg.pack_array_of(in, SAMPLES, true);
+  msg.pack((uint16_t)1234);
+
+  /* The count is of every item, but only 'maxItems' are unpacked, */
+  /* and the rest are skipped */
+  CHECK(msg.unpack_array_of(out, 10, items));
+  CHECK_EQUAL(SAMPLES, items);
+  CHECK(memcmp(in, out, sizeof(out)) == 0);
+  CHECK(msg.unpack(after));
+  CHECK_EQUAL(1234, after);
+}
+
+static void testEmpty(void)
+{
+  BERGCloudMessage msg(16);
+  int32_t out[1];
+  uint16_t items = 1;
+
+  CHECK(msg.pack_array_of((const int32_t *)NULL, 0, true));
+  CHECK(msg.unpack_array_of(out, 1, items));
+  CHECK_EQUAL(0, items);
+}
+
+static void testPlainArray(void)
+{
+  BERGCloudMessage msg(64);
+  int32_t out[3];
+  uint16_t items = 0;
+
+  /* An ordinary MessagePack array is accepted too */
+  msg.pack_array(3);
+  msg.pack((int32_t)-70000);
+  msg.pack((int32_t)0);
+  msg.pack((int32_t)70000);
+
+  CHECK(msg.unpack_array_of(out, 3, items));
+  CHECK_EQUAL(3, items);
+  CHECK_EQUAL(-70000, out[0]);
+  CHECK_EQUAL(0, out[1]);
+  CHECK_EQUAL(70000, out[2]);
+}
+
+static void testWrongType(void)
+{
+  BERGCloudMessage msg(64);
+  int16_t in[] = {1, 2, 3};
+  int32_t wide[3];
+  int16_t out[3];
+  uint16_t items = 0;
+
+  /* An array of another type is refused without moving on */
+  msg.pack_array_of(in, 3, true);
+  CHECK(!msg.unpack_array_of(wide, 3, items));
+  CHECK(msg.unpack_array_of(out, 3, items));
+  CHECK_EQUAL(3, items);
+  CHECK(memcmp(in, out, sizeof(in)) == 0);
+
+  /* As is a MessagePack array with an item of another type, or out of range */
+  msg.clear();
+  msg.pack_array(3);
+  msg.pack((int16_t)1);
+  msg.pack("x");
+  msg.pack((int16_t)3);
+  CHECK(!msg.unpack_array_of(out, 3, items));
+  CHECK(msg.unpack_array(items));
+  CHECK_EQUAL(3, items);
+
+  msg.clear();
+  msg.pack_array(2);
+  msg.pack((int16_t)1);
+  msg.pack((int32_t)70000);
+  CHECK(!msg.unpack_array_of(out, 3, items));
+  CHECK(msg.unpack_array_of(wide, 3, items));
+  CHECK_EQUAL(2, items);
+  CHECK_EQUAL(70000, wide[1]);
+}
+
+int main(void)
+{
+  RUN_TEST(testDeltaInt16);
+  RUN_TEST(testDeltaUint16);
+  RUN_TEST(testDeltaInt32);
+  RUN_TEST(testDeltaTooLarge);
+  RUN_TEST(testMaxItems);
+  RUN_TEST(testEmpty);
+  RUN_TEST(testPlainArray);
+  RUN_TEST(testWrongType);
+  return testResult();
+}
@@ -0,0 +1,372 @@
+/*
+
+Tests for base64 encoding and decoding a piece at a time
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <string.h>
+
+#include "TestCommon.h"
+#include "BERGCloudBase64.h"
+
+/* Encode the 'count' segments of 'segments' into 'text', 'chunkSize' */
+/* characters at most at a time, then end; returns the text length */
+static uint16_t encode(const uint8_t **segments, const uint16_t *sizes, uint8_t count, char *text, uint16_t chunkSize)
+{
+  BERGCloudBase64Encoder base64;
+  const uint8_t *data;
+  uint16_t size;
+  uint16_t used = 0;
+  uint16_t encoded;
+  uint8_t i;
+
+  for (i = 0; i < count; i++)
+  {
+    data = segments[i];
+    size = sizes[i];
+
+    while (size > 0)
+    {
+      encoded = base64.encode(data, size, &text[used], chunkSize);
+      used += encoded;
+
+      if ((encoded == 0) && (size >= 3))
+      {
+        /* No room for a whole group */
+        return 0;
+      }
+
+      if ((encoded % 4) != 0)
+      {
+        return 0;
+      }
+    }
+  }
+
+  used += base64.end(&text[used]);
+  text[used] = '\0';
+  return used;
+}
+
+/* Check that 'size' bytes of 'data', split into segments of every */
+/* size, encode to 'expected' */
+static void checkEncode(const uint8_t *data, uint16_t size, const char *expected)
+{
+  static const uint16_t chunkSizes[] = {4, 8, 12, 256};
+  const uint8_t *segments[3];
+  uint16_t sizes[3];
+  char text[256];
+  uint16_t first, second;
+  uint8_t i;
+
+  for (i = 0; i < (sizeof(chunkSizes) / sizeof(chunkSizes[0])); i++)
+  {
+    for (first = 0; first <= size; first++)
+    {
+      for (second = first; second <= size; second++)
+      {
+        segments[0] = data;
+        sizes[0] = first;
+        segments[1] = &data[first];
+        sizes[1] = second - first;
+        segments[2] = &data[second];
+        sizes[2] = size - second;
+
+        memset(text, 0x00, sizeof(text));
+        CHECK_EQUAL(strlen(expected), encode(segments, sizes, 3, text, chunkSizes[i]));
+        if (!CHECK(strcmp(text, expected) == 0))
+        {
+          fprintf(stderr, "  segments of %u, %u and %u bytes, chunks of %u\n",
+            first, second - first, size - second, chunkSizes[i]);
+          return;
+        }
+      }
+    }
+  }
+}
+
+static void testEncode(void)
+{
+  static const uint8_t data[] = {0x00, 0x10, 0x83, 0x10, 0x51, 0x87, 0x20, 0x92, 0x8b, 0xff, 0xfe};
+
+  checkEncode(data, 0, "");
+  checkEncode(data, sizeof(data), "ABCDEFGHIJKL//4=");
+  checkEncode((const uint8_t *)"\xfb\xff\xbf", 3, "+/+/");
+}
+
+static void testEncodePadding(void)
+{
+  checkEncode((const uint8_t *)"a", 1, "YQ==");
+  checkEncode((const uint8_t *)"ab", 2, "YWI=");
+  checkEncode((const uint8_t *)"abc", 3, "YWJj");
+  checkEncode((const uint8_t *)"abcd", 4, "YWJjZA==");
+  checkEncode((const uint8_t *)"abcdefg", 7, "YWJjZGVmZw==");
+}
+
+static void testEncodeSize(void)
+{
+  uint8_t data[64];
+  char text[BC_BASE64_SIZE(sizeof(data)) + 1];
+  const uint8_t *segments[1];
+  uint16_t sizes[1];
+  uint16_t size;
+
+  for (size = 0; size <= sizeof(data); size++)
+  {
+    memset(data, size, size);
+    segments[0] = data;
+    sizes[0] = size;
+    CHECK_EQUAL(BC_BASE64_SIZE(size), encode(segments, sizes, 1, text, sizeof(text)));
+  }
+}
+
+static void testEncodeChunks(void)
+{
+  BERGCloudBase64Encoder base64;
+  const uint8_t *data = (const uint8_t *)"abcdefgh";
+  uint16_t size = 8;
+  char text[16];
+
+  /* Only whole groups that fit are written, and the rest left */
+  CHECK_EQUAL(0, base64.encode(data, size, text, 3));
+  CHECK_EQUAL(8, size);
+
+  CHECK_EQUAL(4, base64.encode(data, size, text, 7));
+  CHECK_EQUAL(5, size);
+  CHECK(memcmp(text, "YWJj", 4) == 0);
+
+  /* The two bytes left over are kept */
+  CHECK_EQUAL(4, base64.encode(data, size, text, sizeof(text)));
+  CHECK_EQUAL(0, size);
+  CHECK(memcmp(text, "ZGVm", 4) == 0);
+
+  CHECK_EQUAL(4, base64.end(text));
+  CHECK(memcmp(text, "Z2g=", 4) == 0);
+
+  /* Nothing is kept once ended, or after begin() */
+  CHECK_EQUAL(0, base64.end(text));
+
+  data = (const uint8_t *)"a";
+  size = 1;
+  CHECK_EQUAL(0, base64.encode(data, size, text, sizeof(text)));
+  base64.begin();
+  CHECK_EQUAL(0, base64.end(text));
+}
+
+/* Decode 'text' into 'size' bytes of 'data', 'chunkSize' characters */
+/* at a time; returns the result of end(), or false if a feed failed */
+static bool decode(BERGCloudBase64Decoder& base64, const char *text, uint8_t *data, uint16_t size, uint16_t chunkSize)
+{
+  uint16_t textSize = strlen(text);
+  uint16_t offset = 0;
+  uint16_t chunk;
+  bool fed;
+
+  base64.begin(data, size);
+
+  while (offset < textSize)
+  {
+    chunk = ((textSize - offset) < chunkSize) ? (textSize - offset) : chunkSize;
+    fed = (chunk == 1) ? base64.feed(text[offset]) : base64.feed(&text[offset], chunk);
+    offset += chunk;
+
+    if (!fed)
+    {
+      return false;
+    }
+  }
+
+  return base64.end();
+}
+
+/* Check that 'text' decodes to the 'size' bytes of 'expected', */
+/* whether fed a character at a time or in chunks */
+static void checkDecode(const char *text, const uint8_t *expected, uint16_t size)
+{
+  static const uint16_t chunkSizes[] = {1, 3, 5, 0xffff};
+  BERGCloudBase64Decoder base64;
+  uint8_t data[64];
+  uint8_t i;
+
+  for (i = 0; i < (sizeof(chunkSizes) / sizeof(chunkSizes[0])); i++)
+  {
+    memset(data, 0xff, sizeof(data));
+    CHECK(decode(base64, text, data, sizeof(data), chunkSizes[i]));
+    CHECK_EQUAL(size, base64.used());
+    CHECK(memcmp(data, expected, size) == 0);
+    CHECK(!base64.overflowed());
+  }
+}
+
+/* Check that 'text' is refused, however it is fed */
+static void checkRefused(const char *text)
+{
+  static const uint16_t chunkSizes[] = {1, 0xffff};
+  BERGCloudBase64Decoder base64;
+  uint8_t data[64];
+  uint8_t i;
+
+  for (i = 0; i < (sizeof(chunkSizes) / sizeof(chunkSizes[0])); i++)
+  {
+    if (!CHECK(!decode(base64, text, data, sizeof(data), chunkSizes[i])))
+    {
+      fprintf(stderr, "  decoding \"%s\"\n", text);
+    }
+    CHECK(!base64.overflowed());
+  }
+}
+
+static void testDecode(void)
+{
+  static const uint8_t data[] = {0x00, 0x10, 0x83, 0x10, 0x51, 0x87, 0x20, 0x92, 0x8b, 0xff, 0xfe};
+
+  checkDecode("", data, 0);
+  checkDecode("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/",
+    (const uint8_t *)"\x00\x10\x83\x10\x51\x87\x20\x92\x8b\x30\xd3\x8f\x41\x14\x93\x51"
+    "\x55\x97\x61\x96\x9b\x71\xd7\x9f\x82\x18\xa3\x92\x59\xa7\xa2\x9a\xab\xb2\xdb\xaf"
+    "\xc3\x1c\xb3\xd3\x5d\xb7\xe3\x9e\xbb\xf3\xdf\xbf", 48);
+  checkDecode("ABCDEFGHIJKL//4=", data, sizeof(data));
+}
+
+static void testPadding(void)
+{
+  static const uint8_t data[] = {'a', 'b', 'c'};
+
+  /* Padded, or with it left out */
+  checkDecode("YQ==", data, 1);
+  checkDecode("YQ", data, 1);
+  checkDecode("YWI=", data, 2);
+  checkDecode("YWI", data, 2);
+  checkDecode("YWJj", data, 3);
+
+  /* A single character is not a whole byte */
+  checkRefused("Y");
+  checkRefused("YWJjZ");
+
+  /* Padding must fill the group, and end the text */
+  checkRefused("YQ=");
+  checkRefused("Y===");
+  checkRefused("====");
+  checkRefused("YWJj=");
+  checkRefused("YQ==YQ==");
+  checkRefused("YQ=A");
+}
+
+static void testWhitespace(void)
+{
+  static const uint8_t data[] = {'a', 'b', 'c', 'd', 'e', 'f', 'g'};
+
+  /* Line breaks as some encoders add them, and anywhere else */
+  checkDecode("YWJj\r\nZGVm\r\nZw==\r\n", data, sizeof(data));
+  checkDecode(" Y W\tJ j Z\nG V m Z w = = ", data, sizeof(data));
+  checkDecode("\r\n", data, 0);
+}
+
+static void testBadCharacters(void)
+{
+  checkRefused("YW*j");
+  checkRefused("YWJj-A==");
+  checkRefused("YWJj_A==");
+  checkRefused("YW.j");
+  checkRefused("YWJj\x01");
+}
+
+static void testOverflow(void)
+{
+  BERGCloudBase64Decoder base64;
+  uint8_t data[8];
+
+  /* Exactly full */
+  memset(data, 0x00, sizeof(data));
+  CHECK(decode(base64, "YWJjZGVmZ2g=", data, 8, 0xffff));
+  CHECK_EQUAL(8, base64.used());
+  CHECK(!base64.overflowed());
+
+  /* One byte too many, in a whole group or in the last part group, */
+  /* fed in one go or a character at a time */
+  CHECK(!decode(base64, "YWJjZGVm", data, 5, 0xffff));
+  CHECK(base64.overflowed());
+  CHECK_EQUAL(3, base64.used());
+
+  CHECK(!decode(base64, "YWJjZGVm", data, 5, 1));
+  CHECK(base64.overflowed());
+
+  CHECK(!decode(base64, "YWJjZGVmZ2g=", data, 7, 0xffff));
+  CHECK(base64.overflowed());
+  CHECK_EQUAL(6, base64.used());
+
+  CHECK(!decode(base64, "YWJjZGVmZ2g", data, 7, 1));
+  CHECK(base64.overflowed());
+
+  /* Nothing is written past the end */
+  memset(data, 0x00, sizeof(data));
+  CHECK(!decode(base64, "YWJjZGVm", data, 4, 0xffff));
+  CHECK_EQUAL(0x00, data[4]);
+
+  /* No storage at all */
+  CHECK(!decode(base64, "YWJj", NULL, 0, 0xffff));
+  CHECK(base64.overflowed());
+
+  /* begin() starts again */
+  CHECK(decode(base64, "YWJj", data, sizeof(data), 0xffff));
+  CHECK(!base64.overflowed());
+}
+
+static void testRoundTrip(void)
+{
+  BERGCloudBase64Decoder decoder;
+  uint8_t data[200];
+  uint8_t decoded[200];
+  char text[BC_BASE64_SIZE(sizeof(data)) + 1];
+  const uint8_t *segments[1];
+  uint16_t sizes[1];
+  uint16_t i;
+
+  for (i = 0; i < sizeof(data); i++)
+  {
+    data[i] = (uint8_t)((i * 131) + 7);
+  }
+
+  segments[0] = data;
+  sizes[0] = sizeof(data);
+  CHECK_EQUAL(BC_BASE64_SIZE(sizeof(data)), encode(segments, sizes, 1, text, 16));
+
+  CHECK(decode(decoder, text, decoded, sizeof(decoded), 7));
+  CHECK_EQUAL(sizeof(data), decoder.used());
+  CHECK(memcmp(data, decoded, sizeof(data)) == 0);
+}
+
+int main(void)
+{
+  RUN_TEST(testEncode);
+  RUN_TEST(testEncodePadding);
+  RUN_TEST(testEncodeSize);
+  RUN_TEST(testEncodeChunks);
+  RUN_TEST(testDecode);
+  RUN_TEST(testPadding);
+  RUN_TEST(testWhitespace);
+  RUN_TEST(testBadCharacters);
+  RUN_TEST(testOverflow);
+  RUN_TEST(testRoundTrip);
+  return testResult();
+}
@@ -0,0 +1,153 @@
+/*
+
+Tests for BERGCloudBlockPool, through the command and chunk pools
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include "TestCommon.h"
+
+static void testAcquireRelease(void)
+{
+  BERGCloudCommandPool pool;
+  BC_POOL_STATS stats;
+  uint8_t *blocks[BC_COMMAND_POOL_BLOCKS];
+  uint8_t i;
+
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCK_SIZE_BYTES, pool.blockSize());
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, pool.freeBlocks());
+
+  for (i = 0; i < BC_COMMAND_POOL_BLOCKS; i++)
+  {
+    blocks[i] = pool.acquire(BC_COMMAND_POOL_BLOCK_SIZE_BYTES);
+    CHECK(blocks[i] != NULL);
+  }
+
+  CHECK(blocks[0] != blocks[1]);
+  CHECK_EQUAL(0, pool.freeBlocks());
+  CHECK(pool.acquire(1) == NULL);
+
+  pool.release(blocks[1]);
+  CHECK_EQUAL(1, pool.freeBlocks());
+
+  /* The block released is handed out again */
+  CHECK(pool.acquire(1) == blocks[1]);
+
+  for (i = 0; i < BC_COMMAND_POOL_BLOCKS; i++)
+  {
+    pool.release(blocks[i]);
+  }
+
+  pool.getStats(stats);
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, stats.blocks);
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, stats.free);
+  CHECK_EQUAL(0, stats.lowestFree);
+  CHECK_EQUAL(1, stats.exhausted);
+  CHECK_EQUAL(0, stats.oversize);
+  CHECK_EQUAL(0, stats.invalid);
+}
+
+static void testOversize(void)
+{
+  BERGCloudCommandPool pool;
+  BC_POOL_STATS stats;
+
+  CHECK(pool.acquire(BC_COMMAND_POOL_BLOCK_SIZE_BYTES + 1) == NULL);
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, pool.freeBlocks());
+
+  pool.getStats(stats);
+  CHECK_EQUAL(1, stats.oversize);
+  CHECK_EQUAL(0, stats.exhausted);
+}
+
+static void testDoubleRelease(void)
+{
+  BERGCloudCommandPool pool;
+  BC_POOL_STATS stats;
+  uint8_t *first = pool.acquire(1);
+  uint8_t *second = pool.acquire(1);
+
+  /* Released twice while another block is in use */
+  pool.release(first);
+  pool.release(first);
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS - 1, pool.freeBlocks());
+
+  /* So the block is handed out once, not twice */
+  CHECK(pool.acquire(1) == first);
+  CHECK(pool.acquire(1) == NULL);
+
+  pool.release(first);
+  pool.release(second);
+  pool.release(second);
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, pool.freeBlocks());
+
+  pool.getStats(stats);
+  CHECK_EQUAL(2, stats.invalid);
+}
+
+static void testInvalidRelease(void)
+{
+  BERGCloudCommandPool pool;
+  BC_POOL_STATS stats;
+  uint8_t other[4];
+  uint8_t *block = pool.acquire(1);
+
+  /* Not on a block boundary, not from this pool, and NULL */
+  pool.release(block + 1);
+  pool.release(other);
+  pool.release(NULL);
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS - 1, pool.freeBlocks());
+
+  pool.getStats(stats);
+  CHECK_EQUAL(2, stats.invalid);
+
+  pool.release(block);
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, pool.freeBlocks());
+}
+
+static void testReset(void)
+{
+  BERGCloudChunkPool pool;
+  BC_POOL_STATS stats;
+  uint8_t *chunk = pool.acquire(BC_CHUNK_POOL_CHUNK_SIZE_BYTES);
+
+  CHECK(chunk != NULL);
+  pool.reset();
+  CHECK_EQUAL(BC_CHUNK_POOL_CHUNKS, pool.freeBlocks());
+
+  pool.getStats(stats);
+  CHECK_EQUAL(BC_CHUNK_POOL_CHUNKS, stats.lowestFree);
+
+  /* Every chunk is free again, so a release of one is refused */
+  pool.release(chunk);
+  CHECK_EQUAL(BC_CHUNK_POOL_CHUNKS, pool.freeBlocks());
+}
+
+int main(void)
+{
+  RUN_TEST(testAcquireRelease);
+  RUN_TEST(testOversize);
+  RUN_TEST(testDoubleRelease);
+  RUN_TEST(testInvalidRelease);
+  RUN_TEST(testReset);
+  return testResult();
+}
@@ -0,0 +1,201 @@
+/*
+
+Tests for BERGCloudChunkedMessage
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <string.h>
+
+#include "TestCommon.h"
+
+/* Data held by each chunk, after its link to the next */
+#define CHUNK_DATA_SIZE (BC_CHUNK_POOL_CHUNK_SIZE_BYTES - sizeof(uint8_t *))
+
+static void testGrow(void)
+{
+  BERGCloudChunkPool pool;
+  BERGCloudChunkedMessage msg(pool);
+  uint8_t data[CHUNK_DATA_SIZE * 2];
+  uint8_t out[sizeof(data)];
+  uint16_t i;
+
+  for (i = 0; i < sizeof(data); i++)
+  {
+    data[i] = (uint8_t)i;
+  }
+
+  /* No chunks until data is written */
+  CHECK(msg.chunked());
+  CHECK_EQUAL(0, msg.size());
+  CHECK_EQUAL(BC_CHUNK_POOL_CHUNKS, pool.freeBlocks());
+
+  /* raw 16 header and data, split over three chunks */
+  CHECK(msg.pack(data, sizeof(data)));
+  CHECK_EQUAL(3 + sizeof(data), msg.used());
+  CHECK_EQUAL(BC_CHUNK_POOL_CHUNKS - 3, pool.freeBlocks());
+
+  CHECK(msg.unpack(out, sizeof(out)));
+  CHECK(memcmp(out, data, sizeof(data)) == 0);
+
+  /* The chunks are returned to the pool */
+  msg.clear();
+  CHECK_EQUAL(0, msg.size());
+  CHECK_EQUAL(BC_CHUNK_POOL_CHUNKS, pool.freeBlocks());
+}
+
+static void testSegments(void)
+{
+  BERGCloudChunkPool pool;
+  BERGCloudChunkedMessage msg(pool);
+  uint8_t *data;
+  uint16_t size;
+  uint16_t offset = 0;
+  uint16_t segments = 0;
+  uint16_t i;
+
+  for (i = 0; i < 40; i++)
+  {
+    uint8_t byte = (uint8_t)i;
+    CHECK(msg.write(&byte, 1));
+  }
+
+  /* Each segment is a chunk, but for the last */
+  while (msg.segment(offset, data, size))
+  {
+    CHECK_EQUAL(offset, data[0]);
+    offset += size;
+    segments++;
+  }
+
+  CHECK_EQUAL(40, offset);
+  CHECK_EQUAL((40 + CHUNK_DATA_SIZE - 1) / CHUNK_DATA_SIZE, segments);
+}
+
+static void testExhausted(void)
+{
+  BERGCloudChunkPool pool;
+  BERGCloudChunkedMessage msg(pool);
+  uint32_t value;
+  uint16_t packed = 0;
+
+  /* Packing fails once the pool is empty, and not before */
+  while (msg.pack((uint32_t)0x12345678))
+  {
+    packed++;
+  }
+
+  CHECK_EQUAL(0, pool.freeBlocks());
+  CHECK_EQUAL((BC_CHUNK_POOL_CHUNKS * CHUNK_DATA_SIZE) / 5, packed);
+  CHECK_EQUAL(packed * 5, msg.used());
+
+  while (packed-- > 0)
+  {
+    CHECK(msg.unpack(value));
+    CHECK_EQUAL(0x12345678, value);
+  }
+
+  msg.clear();
+  CHECK_EQUAL(BC_CHUNK_POOL_CHUNKS, pool.freeBlocks());
+}
+
+static void testArrayHeader(void)
+{
+  BERGCloudChunkPool pool;
+  BERGCloudChunkedMessage msg(pool);
+  uint16_t items = 0;
+
+  /* Only the header is reserved, not a byte for each item */
+  CHECK(msg.pack_array(1000));
+  CHECK_EQUAL(3, msg.used());
+  CHECK_EQUAL(BC_CHUNK_POOL_CHUNKS - 1, pool.freeBlocks());
+
+  CHECK(msg.pack_map(100));
+  CHECK_EQUAL(6, msg.used());
+  CHECK_EQUAL(BC_CHUNK_POOL_CHUNKS - 1, pool.freeBlocks());
+
+  CHECK(msg.unpack_array(items));
+  CHECK_EQUAL(1000, items);
+  CHECK(msg.unpack_map(items));
+  CHECK_EQUAL(100, items);
+}
+
+static void testContainer(void)
+{
+  BERGCloudChunkPool pool;
+  BERGCloudChunkedMessage msg(pool);
+  uint16_t items = 0;
+  uint16_t value = 0;
+  uint16_t i;
+
+  /* The header is filled in when the items span several chunks */
+  CHECK(msg.begin_array());
+  for (i = 0; i < 20; i++)
+  {
+    CHECK(msg.pack((uint16_t)(i * 1000)));
+  }
+  CHECK(msg.end_array());
+
+  CHECK(msg.unpack_array(items));
+  CHECK_EQUAL(20, items);
+  for (i = 0; i < 20; i++)
+  {
+    CHECK(msg.unpack(value));
+    CHECK_EQUAL(i * 1000, value);
+  }
+}
+
+static void testCopy(void)
+{
+  BERGCloudChunkPool pool;
+  BERGCloudChunkedMessage msg(pool);
+  char text[48];
+  uint16_t i;
+
+  for (i = 0; i < (sizeof(text) - 1); i++)
+  {
+    text[i] = 'a' + (i % 26);
+  }
+  text[sizeof(text) - 1] = '\0';
+
+  CHECK(msg.pack(text));
+
+  /* A copy joins the chunks into a single buffer */
+  BERGCloudMessage copy(msg);
+  char out[sizeof(text)];
+
+  CHECK(!copy.chunked());
+  CHECK_EQUAL(msg.used(), copy.used());
+  CHECK(copy.unpack(out, sizeof(out)));
+  CHECK(strcmp(out, text) == 0);
+}
+
+int main(void)
+{
+  RUN_TEST(testGrow);
+  RUN_TEST(testSegments);
+  RUN_TEST(testExhausted);
+  RUN_TEST(testArrayHeader);
+  RUN_TEST(testContainer);
+  RUN_TEST(testCopy);
+  return testResult();
+}
@@ -0,0 +1,242 @@
+/*
+
+Tests for handing commands from the command pool to the application
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <string.h>
+
+#include "TestCommon.h"
+
+#define COMMAND_ID 1234
+
+/* Gives the tests the device's command hand-off, and records the */
+/* responses that would be sent to the bridge */
+class CommandDevice : public BERGCloudCC3000
+{
+public:
+  CommandDevice() : responses(0), returnCode(0), responseID(0)
+  {
+  }
+  bool receive(uint16_t cmd, const uint8_t *data, uint16_t size, uint8_t state = BC_CONNECT_STATE_CONNECTED)
+  {
+    uint8_t *block = commandPool.acquire(BC_COMMAND_HEADER_SIZE_BYTES + size);
+
+    if (block == NULL)
+    {
+      return false;
+    }
+
+    memset(block, 0x00, BC_COMMAND_HEADER_SIZE_BYTES);
+    block[2] = (uint8_t)cmd;
+    block[3] = (uint8_t)(cmd >> 8);
+    memcpy(block + BC_COMMAND_HEADER_SIZE_BYTES, data, size);
+
+    return deviceCommandReceived(block, BC_COMMAND_HEADER_SIZE_BYTES + size, COMMAND_ID, state);
+  }
+  uint8_t freeBlocks(void)
+  {
+    return commandPool.freeBlocks();
+  }
+  uint8_t responses;
+  uint8_t returnCode;
+  uint32_t responseID;
+protected:
+  virtual bool sendDeviceCommandResponse(uint32_t command_id, uint8_t code)
+  {
+    responses++;
+    responseID = command_id;
+    returnCode = code;
+    return true;
+  }
+};
+
+/* fixstr "led", positive fixint 42, uint16 500 */
+static const uint8_t namedCommand[] = {0xa3, 'l', 'e', 'd', 0x2a, 0xcd, 0x01, 0xf4};
+
+static void testTakeCommand(void)
+{
+  CommandDevice device;
+  BERGCloudCommand command;
+  char name[16];
+  uint32_t id = 0;
+  uint8_t a = 0;
+  uint16_t b = 0;
+
+  CHECK(device.receive(BC_COMMAND_NAMED_PACKED, namedCommand, sizeof(namedCommand)));
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS - 1, device.freeBlocks());
+
+  CHECK(device.pollForCommand(command, name, sizeof(name), &id));
+  CHECK(strcmp(name, "led") == 0);
+  CHECK_EQUAL(COMMAND_ID, id);
+  CHECK_EQUAL(1, device.responses);
+  CHECK_EQUAL(COMMAND_ID, device.responseID);
+  CHECK_EQUAL(0x00, device.returnCode);
+
+  /* Read in place; the block is held until released */
+  CHECK_EQUAL(4, command.used());
+  CHECK(command.unpack(a));
+  CHECK_EQUAL(42, a);
+  CHECK(command.unpack(b));
+  CHECK_EQUAL(500, b);
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS - 1, device.freeBlocks());
+
+  command.release();
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, device.freeBlocks());
+
+  /* Taken once only */
+  CHECK(!device.pollForCommand(command, name, sizeof(name), &id));
+  CHECK_EQUAL(1, device.responses);
+}
+
+static void testCopyCommand(void)
+{
+  CommandDevice device;
+  BERGCloudStaticMessage<16> msg;
+  char name[16];
+  uint32_t id = 0;
+  uint8_t a = 0;
+  uint16_t b = 0;
+
+  CHECK(device.receive(BC_COMMAND_NAMED_PACKED, namedCommand, sizeof(namedCommand)));
+  CHECK(device.pollForCommand(msg, name, sizeof(name), &id));
+  CHECK(strcmp(name, "led") == 0);
+  CHECK_EQUAL(COMMAND_ID, id);
+  CHECK_EQUAL(0x00, device.returnCode);
+
+  /* Copied, so the block is released straight away */
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, device.freeBlocks());
+  CHECK_EQUAL(4, msg.used());
+  CHECK(msg.unpack(a));
+  CHECK_EQUAL(42, a);
+  CHECK(msg.unpack(b));
+  CHECK_EQUAL(500, b);
+}
+
+static void testShortName(void)
+{
+  CommandDevice device;
+  BERGCloudCommand command;
+  char name[3];
+
+  /* The name is cut to fit, the data is unaffected */
+  CHECK(device.receive(BC_COMMAND_NAMED_PACKED, namedCommand, sizeof(namedCommand)));
+  CHECK(device.pollForCommand(command, name, sizeof(name)));
+  CHECK(strcmp(name, "le") == 0);
+  CHECK_EQUAL(4, command.used());
+
+  command.release();
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, device.freeBlocks());
+}
+
+static void testInvalidName(void)
+{
+  CommandDevice device;
+  BERGCloudCommand command;
+  char name[16];
+  const uint8_t unnamed[] = {0x2a, 0x2b};
+
+  /* Not a fixstr name; refused and released */
+  CHECK(device.receive(BC_COMMAND_NAMED_PACKED, unnamed, sizeof(unnamed)));
+  CHECK(!device.pollForCommand(command, name, sizeof(name)));
+  CHECK_EQUAL('\0', name[0]);
+  CHECK_EQUAL(1, device.responses);
+  CHECK_EQUAL(0xff, device.returnCode);
+  CHECK_EQUAL(0, command.used());
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, device.freeBlocks());
+}
+
+static void testNotConnected(void)
+{
+  CommandDevice device;
+
+  /* Commands are refused until the device is claimed */
+  CHECK(!device.receive(BC_COMMAND_NAMED_PACKED, namedCommand, sizeof(namedCommand), BC_CONNECT_STATE_CONNECTING));
+  CHECK_EQUAL(1, device.responses);
+  CHECK_EQUAL(0xff, device.returnCode);
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, device.freeBlocks());
+}
+
+static void testUnreadCommand(void)
+{
+  CommandDevice device;
+  BERGCloudCommand command;
+  char name[16];
+  const uint8_t second[] = {0xa3, 'f', 'a', 'n', 0x01};
+
+  /* A command not yet polled for is replaced by the next */
+  CHECK(device.receive(BC_COMMAND_NAMED_PACKED, namedCommand, sizeof(namedCommand)));
+  CHECK(device.receive(BC_COMMAND_NAMED_PACKED, second, sizeof(second)));
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS - 1, device.freeBlocks());
+
+  CHECK(device.pollForCommand(command, name, sizeof(name)));
+  CHECK(strcmp(name, "fan") == 0);
+  CHECK_EQUAL(1, command.used());
+
+  command.release();
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, device.freeBlocks());
+}
+
+static void testTakeThenCopy(void)
+{
+  CommandDevice device;
+  BERGCloudCommand command;
+  BERGCloudMessageBuffer& buffer = command;
+  char name[16];
+  uint8_t a = 0;
+
+  /* A block taken for one command is released when the same message */
+  /* is then polled for a copy, rather than held and written into */
+  CHECK(device.receive(BC_COMMAND_NAMED_PACKED, namedCommand, sizeof(namedCommand)));
+  CHECK(device.pollForCommand(command, name, sizeof(name)));
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS - 1, device.freeBlocks());
+
+  /* A BERGCloudCommand has no buffer of its own to copy into */
+  CHECK(device.receive(BC_COMMAND_NAMED_PACKED, namedCommand, sizeof(namedCommand)));
+  CHECK(!device.pollForCommand(buffer, name, sizeof(name)));
+  CHECK_EQUAL(0xff, device.returnCode);
+  CHECK_EQUAL(0, command.used());
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, device.freeBlocks());
+
+  /* And can take the next */
+  CHECK(device.receive(BC_COMMAND_NAMED_PACKED, namedCommand, sizeof(namedCommand)));
+  CHECK(device.pollForCommand(command, name, sizeof(name)));
+  CHECK(strcmp(name, "led") == 0);
+  CHECK(command.unpack(a));
+  CHECK_EQUAL(42, a);
+
+  command.release();
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, device.freeBlocks());
+}
+
+int main(void)
+{
+  RUN_TEST(testTakeCommand);
+  RUN_TEST(testCopyCommand);
+  RUN_TEST(testShortName);
+  RUN_TEST(testInvalidName);
+  RUN_TEST(testNotConnected);
+  RUN_TEST(testUnreadCommand);
+  RUN_TEST(testTakeThenCopy);
+  return testResult();
+}
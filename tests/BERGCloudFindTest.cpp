@@ -0,0 +1,352 @@
+/*
+
+Tests for unpack_find(), unpack_skip() and count()
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <string.h>
+
+#include "TestCommon.h"
+
+/* A map of 'keys' keys "k0", "k1"..., each with its number as the value */
+static void packMap(BERGCloudMessage& msg, uint8_t keys)
+{
+  char key[4];
+  uint8_t i;
+
+  msg.clear();
+  msg.pack_map(keys);
+
+  for (i = 0; i < keys; i++)
+  {
+    key[0] = 'k';
+    key[1] = '0' + (i / 10);
+    key[2] = '0' + (i % 10);
+    key[3] = '\0';
+    msg.pack(key);
+    msg.pack((uint16_t)(i * 100));
+  }
+}
+
+static bool findValue(BERGCloudMessage& msg, const char *key, uint16_t expected)
+{
+  uint16_t value = 0;
+
+  return msg.unpack_find(key) && msg.unpack(value) && (value == expected);
+}
+
+static void testFindKey(void)
+{
+  BERGCloudMessage msg(256);
+
+  packMap(msg, 20);
+
+  /* In any order, and again once indexed */
+  CHECK(findValue(msg, "k05", 500));
+  CHECK(findValue(msg, "k01", 100));
+  CHECK(findValue(msg, "k19", 1900));
+  CHECK(findValue(msg, "k05", 500));
+  CHECK(findValue(msg, "k00", 0));
+  CHECK(!msg.unpack_find("k20"));
+  CHECK(!msg.unpack_find("k5"));
+
+  /* More keys than the index holds are found by rescanning */
+  CHECK(BC_FIND_INDEX_ENTRIES < 20);
+  CHECK(findValue(msg, "k18", 1800));
+  CHECK(findValue(msg, "k02", 200));
+}
+
+static void testFindIndex(void)
+{
+  BERGCloudMessage msg(64);
+  uint16_t value = 0;
+  uint16_t i;
+
+  msg.pack_array(10);
+  for (i = 1; i <= 10; i++)
+  {
+    msg.pack((uint16_t)(i * 3));
+  }
+
+  CHECK(!msg.unpack_find((uint16_t)0));
+  CHECK(msg.unpack_find((uint16_t)7));
+  CHECK(msg.unpack(value));
+  CHECK_EQUAL(21, value);
+  CHECK(msg.unpack_find((uint16_t)2));
+  CHECK(msg.unpack(value));
+  CHECK_EQUAL(6, value);
+  CHECK(msg.unpack_find((uint16_t)10));
+  CHECK(msg.unpack(value));
+  CHECK_EQUAL(30, value);
+  CHECK(!msg.unpack_find((uint16_t)11));
+}
+
+static void testChanged(void)
+{
+  BERGCloudMessage msg(256);
+
+  /* The index is started again when the message changes */
+  packMap(msg, 4);
+  CHECK(findValue(msg, "k03", 300));
+  CHECK_EQUAL(9, msg.count());
+
+  packMap(msg, 6);
+  CHECK(findValue(msg, "k05", 500));
+  CHECK(findValue(msg, "k03", 300));
+  CHECK_EQUAL(13, msg.count());
+
+  msg.clear();
+  CHECK(!msg.unpack_find("k03"));
+  CHECK_EQUAL(0, msg.count());
+}
+
+#if BC_FIND_INDEXED
+static void testIndexPool(void)
+{
+  BC_POOL_STATS stats;
+  BERGCloudMessage *msgs[BC_FIND_INDEX_POOL_INDEXES + 1];
+  uint8_t i;
+
+  BERGCloudMessageBase::getFindIndexPoolStats(stats);
+  CHECK_EQUAL(BC_FIND_INDEX_POOL_INDEXES, stats.free);
+
+  /* Each message searched takes an index; once there are none left */
+  /* the rest still find keys by scanning */
+  for (i = 0; i < (BC_FIND_INDEX_POOL_INDEXES + 1); i++)
+  {
+    msgs[i] = new BERGCloudMessage(256);
+    packMap(*msgs[i], 8);
+    CHECK(findValue(*msgs[i], "k06", 600));
+    CHECK(findValue(*msgs[i], "k02", 200));
+    CHECK_EQUAL(17, msgs[i]->count());
+  }
+
+  BERGCloudMessageBase::getFindIndexPoolStats(stats);
+  CHECK_EQUAL(0, stats.free);
+  CHECK(stats.exhausted > 0);
+
+  /* Returned when the messages are destroyed */
+  for (i = 0; i < (BC_FIND_INDEX_POOL_INDEXES + 1); i++)
+  {
+    delete msgs[i];
+  }
+
+  BERGCloudMessageBase::getFindIndexPoolStats(stats);
+  CHECK_EQUAL(BC_FIND_INDEX_POOL_INDEXES, stats.free);
+  CHECK_EQUAL(0, stats.invalid);
+}
+
+static void testCopyIndex(void)
+{
+  BC_POOL_STATS stats;
+  BERGCloudMessage msg(256);
+
+  packMap(msg, 8);
+  CHECK(findValue(msg, "k07", 700));
+
+  {
+    /* Neither a copy nor an assigned message shares the index */
+    BERGCloudMessage copy(msg);
+    BERGCloudMessage assigned(16);
+
+    assigned = msg;
+    CHECK(findValue(copy, "k04", 400));
+    CHECK(findValue(assigned, "k01", 100));
+
+    BERGCloudMessageBase::getFindIndexPoolStats(stats);
+    CHECK_EQUAL(0, stats.free);
+  }
+
+  BERGCloudMessageBase::getFindIndexPoolStats(stats);
+  CHECK_EQUAL(BC_FIND_INDEX_POOL_INDEXES - 1, stats.free);
+  CHECK_EQUAL(0, stats.invalid);
+}
+
+static void testIndexReleased(void)
+{
+  BC_POOL_STATS stats;
+  BERGCloudMessage msg(256);
+
+  /* The index is returned once the message is emptied */
+  packMap(msg, 8);
+  CHECK(findValue(msg, "k07", 700));
+  BERGCloudMessageBase::getFindIndexPoolStats(stats);
+  CHECK_EQUAL(BC_FIND_INDEX_POOL_INDEXES - 1, stats.free);
+
+  msg.clear();
+  BERGCloudMessageBase::getFindIndexPoolStats(stats);
+  CHECK_EQUAL(BC_FIND_INDEX_POOL_INDEXES, stats.free);
+
+  /* Or restarted, and taken again by the next search */
+  packMap(msg, 8);
+  CHECK(findValue(msg, "k03", 300));
+  CHECK(msg.unpack_restart());
+  BERGCloudMessageBase::getFindIndexPoolStats(stats);
+  CHECK_EQUAL(BC_FIND_INDEX_POOL_INDEXES, stats.free);
+
+  CHECK(findValue(msg, "k05", 500));
+  BERGCloudMessageBase::getFindIndexPoolStats(stats);
+  CHECK_EQUAL(BC_FIND_INDEX_POOL_INDEXES - 1, stats.free);
+  CHECK_EQUAL(0, stats.invalid);
+}
+#endif
+
+/* {"name": "hall", "config": {"mode": 2, "limits": [10, 20, 30]}, */
+/*  "sensors": [{"id": 7}, {"id": 8, "on": true}], "last": 99} */
+static void packNested(BERGCloudMessage& msg)
+{
+  msg.clear();
+  msg.pack_map(4);
+  msg.pack("name");
+  msg.pack("hall");
+  msg.pack("config");
+  msg.pack_map(2);
+  msg.pack("mode");
+  msg.pack((uint16_t)2);
+  msg.pack("limits");
+  msg.pack_array(3);
+  msg.pack((uint16_t)10);
+  msg.pack((uint16_t)20);
+  msg.pack((uint16_t)30);
+  msg.pack("sensors");
+  msg.pack_array(2);
+  msg.pack_map(1);
+  msg.pack("id");
+  msg.pack((uint16_t)7);
+  msg.pack_map(2);
+  msg.pack("id");
+  msg.pack((uint16_t)8);
+  msg.pack("on");
+  msg.pack(true);
+  msg.pack("last");
+  msg.pack((uint16_t)99);
+}
+
+static void testPath(void)
+{
+  BERGCloudMessage msg(128);
+  uint16_t items = 0;
+  bool on = false;
+
+  packNested(msg);
+
+  CHECK(findValue(msg, "config.mode", 2));
+  CHECK(findValue(msg, "config.limits[1]", 10));
+  CHECK(findValue(msg, "config.limits[3]", 30));
+  CHECK(findValue(msg, "sensors[2].id", 8));
+  CHECK(findValue(msg, "sensors[1].id", 7));
+  CHECK(findValue(msg, "last", 99));
+
+  CHECK(msg.unpack_find("sensors[2].on"));
+  CHECK(msg.unpack(on));
+  CHECK(on);
+
+  CHECK(msg.unpack_find("config.limits"));
+  CHECK(msg.unpack_array(items));
+  CHECK_EQUAL(3, items);
+
+  /* Not found, or not a valid path; the position is kept */
+  msg.restart();
+  CHECK(!msg.unpack_find("config.limits[4]"));
+  CHECK(!msg.unpack_find("config.limits[0]"));
+  CHECK(!msg.unpack_find("sensors[1].on"));
+  CHECK(!msg.unpack_find("config.missing"));
+  CHECK(!msg.unpack_find("config.limits[x]"));
+  CHECK(!msg.unpack_find("config..mode"));
+  CHECK(msg.unpack_map(items));
+  CHECK_EQUAL(4, items);
+}
+
+static void testTopLevelOnly(void)
+{
+  BERGCloudMessage msg(128);
+
+  /* Keys inside nested maps are only found by a path */
+  packNested(msg);
+  CHECK(!msg.unpack_find("mode"));
+  CHECK(!msg.unpack_find("id"));
+  CHECK(findValue(msg, "last", 99));
+}
+
+static void testSkip(void)
+{
+  BERGCloudMessage msg(128);
+  uint16_t items = 0;
+  char text[8];
+
+  packNested(msg);
+
+  CHECK(msg.unpack_map(items));
+  CHECK(msg.unpack_skip()); /* "name" */
+  CHECK(msg.unpack_skip()); /* "hall" */
+  CHECK(msg.unpack(text, sizeof(text)));
+  CHECK(strcmp(text, "config") == 0);
+
+  /* The whole map, and the array in it */
+  CHECK(msg.unpack_skip());
+  CHECK(msg.unpack(text, sizeof(text)));
+  CHECK(strcmp(text, "sensors") == 0);
+
+  /* The array of maps */
+  CHECK(msg.unpack_skip());
+  CHECK(msg.unpack(text, sizeof(text)));
+  CHECK(strcmp(text, "last") == 0);
+  CHECK(msg.unpack_skip());
+
+  /* Nothing left */
+  CHECK(!msg.unpack_skip());
+  CHECK_EQUAL(0, msg.remaining());
+
+  /* Everything, counted */
+  CHECK_EQUAL(24, msg.count());
+}
+
+static void testSkipTruncated(void)
+{
+  BERGCloudMessage msg(128);
+  BERGCloudMessage truncated(128);
+
+  /* A map missing part of its last value can't be skipped, or read */
+  packNested(msg);
+  truncated.write(msg.ptr(), msg.used() - 1);
+  CHECK(!truncated.unpack_skip());
+  CHECK_EQUAL(msg.used() - 1, truncated.remaining());
+  CHECK(!findValue(truncated, "last", 99));
+}
+
+int main(void)
+{
+  RUN_TEST(testFindKey);
+  RUN_TEST(testFindIndex);
+  RUN_TEST(testChanged);
+#if BC_FIND_INDEXED
+  RUN_TEST(testIndexPool);
+  RUN_TEST(testCopyIndex);
+  RUN_TEST(testIndexReleased);
+#endif
+  RUN_TEST(testPath);
+  RUN_TEST(testTopLevelOnly);
+  RUN_TEST(testSkip);
+  RUN_TEST(testSkipTruncated);
+  return testResult();
+}
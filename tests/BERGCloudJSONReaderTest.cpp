@@ -0,0 +1,345 @@
+/*
+
+Tests for reading JSON objects as they arrive
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <string.h>
+
+#include "TestCommon.h"
+#include "BERGCloudJSONReader.h"
+
+#define MEMBER_TYPE     0
+#define MEMBER_ID       1
+#define MEMBER_PAYLOAD  2
+
+static char type[16];
+static uint8_t payload[16];
+
+static BC_JSON_MEMBER members[] = {
+  {"type", BC_JSON_STRING, type, sizeof(type), 0, 0, false},
+  {"command_id", BC_JSON_NUMBER, NULL, 0, 0, 0, false},
+  {"binary_payload", BC_JSON_BASE64, (char *)payload, sizeof(payload), 0, 0, false}
+};
+
+#define MEMBER_COUNT (sizeof(::members) / sizeof(::members[0]))
+
+/* Read 'json', 'chunkSize' bytes at a time; returns the result of the */
+/* last feed(), and whether the whole object was read in 'done' */
+static bool readText(const char *json, uint16_t chunkSize, bool& done)
+{
+  BERGCloudJSONReader reader(members, MEMBER_COUNT);
+  uint16_t size = strlen(json);
+  uint16_t offset = 0;
+  uint16_t chunk;
+  bool fed = true;
+
+  memset(type, 0xff, sizeof(type));
+  memset(payload, 0xff, sizeof(payload));
+
+  while (fed && (offset < size))
+  {
+    chunk = ((size - offset) < chunkSize) ? (size - offset) : chunkSize;
+    fed = reader.feed((const uint8_t *)&json[offset], chunk);
+    offset += chunk;
+  }
+
+  done = reader.done();
+  return fed;
+}
+
+static bool readText(const char *json)
+{
+  bool done;
+
+  return readText(json, 0xffff, done) && done;
+}
+
+static void testDeviceCommand(void)
+{
+  static const char json[] =
+    "{\"type\":\"DeviceCommand\",\"command_id\":1234,\"binary_payload\":\"AAECAwQ=\"}";
+  static const uint16_t chunkSizes[] = {1, 2, 7, 0xffff};
+  static const uint8_t expected[] = {0, 1, 2, 3, 4};
+  bool done;
+  uint8_t i;
+
+  for (i = 0; i < (sizeof(chunkSizes) / sizeof(chunkSizes[0])); i++)
+  {
+    CHECK(readText(json, chunkSizes[i], done));
+    CHECK(done);
+
+    CHECK(members[MEMBER_TYPE].found);
+    CHECK(strcmp(type, "DeviceCommand") == 0);
+    CHECK_EQUAL(strlen("DeviceCommand"), members[MEMBER_TYPE].length);
+
+    CHECK(members[MEMBER_ID].found);
+    CHECK_EQUAL(1234, members[MEMBER_ID].number);
+
+    CHECK(members[MEMBER_PAYLOAD].found);
+    CHECK_EQUAL(sizeof(expected), members[MEMBER_PAYLOAD].length);
+    CHECK(memcmp(payload, expected, sizeof(expected)) == 0);
+  }
+}
+
+static void testWhitespace(void)
+{
+  CHECK(readText(" \r\n{ \"type\" :\t\"Ping\" ,\n \"command_id\" : 7 } \r\n"));
+  CHECK(members[MEMBER_TYPE].found);
+  CHECK(strcmp(type, "Ping") == 0);
+  CHECK(members[MEMBER_ID].found);
+  CHECK_EQUAL(7, members[MEMBER_ID].number);
+}
+
+static void testOtherMembersSkipped(void)
+{
+  /* Objects, arrays, literals and strings holding brackets, quotes */
+  /* and the keys looked for, none of which are kept */
+  CHECK(readText(
+    "{\"nested\":{\"type\":\"Inner\",\"list\":[1,[2,{\"a\":\"]}\"}],\"b\\\"]\"]},"
+    "\"yes\":true,\"no\":false,\"nothing\":null,\"float\":-1.5e3,"
+    "\"text\":\"\\\"command_id\\\":1\",\"type\":\"Outer\"}"));
+
+  CHECK(members[MEMBER_TYPE].found);
+  CHECK(strcmp(type, "Outer") == 0);
+  CHECK(!members[MEMBER_ID].found);
+  CHECK(!members[MEMBER_PAYLOAD].found);
+}
+
+static void testEscapes(void)
+{
+  CHECK(readText("{\"type\":\"\\\"\\\\\\/\\n\\t\\u0041\\u00e9\"}"));
+  CHECK(members[MEMBER_TYPE].found);
+  CHECK(strcmp(type, "\"\\/\n\tA?") == 0);
+
+  /* Not an escape */
+  CHECK(!readText("{\"type\":\"\\x\"}"));
+  CHECK(!readText("{\"type\":\"\\u00g0\"}"));
+}
+
+static void testWrongType(void)
+{
+  CHECK(readText("{\"type\":1,\"command_id\":\"1\",\"binary_payload\":[]}"));
+  CHECK(!members[MEMBER_TYPE].found);
+  CHECK(!members[MEMBER_ID].found);
+  CHECK(!members[MEMBER_PAYLOAD].found);
+}
+
+static void testNumbers(void)
+{
+  CHECK(readText("{\"command_id\":0}"));
+  CHECK(members[MEMBER_ID].found);
+  CHECK_EQUAL(0, members[MEMBER_ID].number);
+
+  CHECK(readText("{\"command_id\":4294967295}"));
+  CHECK(members[MEMBER_ID].found);
+  CHECK_EQUAL(4294967295UL, members[MEMBER_ID].number);
+
+  /* Too large, negative and not integers */
+  CHECK(readText("{\"command_id\":4294967296}"));
+  CHECK(!members[MEMBER_ID].found);
+
+  CHECK(readText("{\"command_id\":-1}"));
+  CHECK(!members[MEMBER_ID].found);
+
+  CHECK(readText("{\"command_id\":1.5}"));
+  CHECK(!members[MEMBER_ID].found);
+
+  CHECK(readText("{\"command_id\":1e3}"));
+  CHECK(!members[MEMBER_ID].found);
+}
+
+static void testDoesNotFit(void)
+{
+  /* 15 characters and the terminator fit; 16 do not */
+  CHECK(readText("{\"type\":\"123456789012345\"}"));
+  CHECK(members[MEMBER_TYPE].found);
+  CHECK(strcmp(type, "123456789012345") == 0);
+
+  CHECK(readText("{\"type\":\"1234567890123456\"}"));
+  CHECK(!members[MEMBER_TYPE].found);
+
+  /* 16 bytes fit; 17 do not */
+  CHECK(readText("{\"binary_payload\":\"AAECAwQFBgcICQoLDA0ODw==\"}"));
+  CHECK(members[MEMBER_PAYLOAD].found);
+  CHECK_EQUAL(16, members[MEMBER_PAYLOAD].length);
+
+  CHECK(readText("{\"binary_payload\":\"AAECAwQFBgcICQoLDA0ODxA=\"}"));
+  CHECK(!members[MEMBER_PAYLOAD].found);
+
+  /* Not base64 */
+  CHECK(readText("{\"binary_payload\":\"AA*C\"}"));
+  CHECK(!members[MEMBER_PAYLOAD].found);
+}
+
+static void testKeys(void)
+{
+  /* Only whole keys match, and keys too long to keep match nothing */
+  CHECK(readText("{\"typ\":\"a\",\"types\":\"b\",\"binary_payload_and_more\":\"AAAA\"}"));
+  CHECK(!members[MEMBER_TYPE].found);
+  CHECK(!members[MEMBER_PAYLOAD].found);
+
+  /* The last of a repeated key is kept */
+  CHECK(readText("{\"type\":\"first\",\"type\":\"second\"}"));
+  CHECK(members[MEMBER_TYPE].found);
+  CHECK(strcmp(type, "second") == 0);
+
+  CHECK(readText("{\"type\":\"first\",\"type\":2}"));
+  CHECK(!members[MEMBER_TYPE].found);
+}
+
+/* Gives the payload storage as it starts, unless the type has */
+/* already been read as something else */
+class LateReader : public BERGCloudJSONReader
+{
+public:
+  LateReader() : BERGCloudJSONReader(::members, MEMBER_COUNT), starts(0)
+  {
+    ::members[MEMBER_PAYLOAD].data = NULL;
+    ::members[MEMBER_PAYLOAD].size = 0;
+  }
+  uint8_t starts;
+
+protected:
+  virtual bool base64Start(BC_JSON_MEMBER *member)
+  {
+    starts++;
+
+    if (::members[MEMBER_TYPE].found && (strcmp(type, "DeviceCommand") != 0))
+    {
+      return false;
+    }
+
+    member->data = (char *)payload;
+    member->size = 4;
+    return true;
+  }
+};
+
+static void feed(BERGCloudJSONReader& reader, const char *json)
+{
+  CHECK(reader.feed((const uint8_t *)json, strlen(json)));
+  CHECK(reader.done());
+}
+
+static void testLateStorage(void)
+{
+  {
+    LateReader reader;
+
+    feed(reader, "{\"type\":\"DeviceCommand\",\"binary_payload\":\"AAECAw==\"}");
+    CHECK_EQUAL(1, reader.starts);
+    CHECK(members[MEMBER_PAYLOAD].found);
+    CHECK_EQUAL(4, members[MEMBER_PAYLOAD].length);
+    CHECK(!reader.overflowed());
+  }
+
+  {
+    /* Skipped, and not counted as too large */
+    LateReader reader;
+
+    feed(reader, "{\"type\":\"DeviceEvent\",\"binary_payload\":\"AAECAw==\"}");
+    CHECK_EQUAL(1, reader.starts);
+    CHECK(!members[MEMBER_PAYLOAD].found);
+    CHECK(!reader.overflowed());
+  }
+
+  {
+    /* Members may come in any order */
+    LateReader reader;
+
+    feed(reader, "{\"binary_payload\":\"AAECAw==\",\"type\":\"DeviceCommand\"}");
+    CHECK_EQUAL(1, reader.starts);
+    CHECK(members[MEMBER_PAYLOAD].found);
+    CHECK_EQUAL(4, members[MEMBER_PAYLOAD].length);
+    CHECK(members[MEMBER_TYPE].found);
+    CHECK(strcmp(type, "DeviceCommand") == 0);
+    CHECK(!reader.overflowed());
+  }
+
+  {
+    /* Too large for the storage given */
+    LateReader reader;
+
+    feed(reader, "{\"type\":\"DeviceCommand\",\"binary_payload\":\"AAECAwQ=\"}");
+    CHECK(!members[MEMBER_PAYLOAD].found);
+    CHECK(reader.overflowed());
+  }
+
+  {
+    /* Not base64, which is not too large */
+    LateReader reader;
+
+    feed(reader, "{\"type\":\"DeviceCommand\",\"binary_payload\":\"AA*C\"}");
+    CHECK(!members[MEMBER_PAYLOAD].found);
+    CHECK(!reader.overflowed());
+  }
+
+  members[MEMBER_PAYLOAD].data = (char *)payload;
+  members[MEMBER_PAYLOAD].size = sizeof(payload);
+}
+
+static void testMalformed(void)
+{
+  bool done;
+
+  CHECK(readText("{}"));
+
+  /* Not an object */
+  CHECK(!readText("[1]"));
+  CHECK(!readText("\"type\""));
+
+  /* Missing or extra punctuation */
+  CHECK(!readText("{\"type\" \"Ping\"}"));
+  CHECK(!readText("{\"type\":\"Ping\",}"));
+  CHECK(!readText("{\"type\":\"Ping\" \"command_id\":1}"));
+  CHECK(!readText("{\"type\":}"));
+  CHECK(!readText("{type:\"Ping\"}"));
+
+  /* Anything but whitespace after the object */
+  CHECK(!readText("{}{}"));
+
+  /* Cut short, so read without error but not done */
+  CHECK(readText("{\"type\":\"Pi", 0xffff, done));
+  CHECK(!done);
+  CHECK(!members[MEMBER_TYPE].found);
+
+  CHECK(readText("{\"command_id\":12", 0xffff, done));
+  CHECK(!done);
+  CHECK(!members[MEMBER_ID].found);
+}
+
+int main(void)
+{
+  RUN_TEST(testDeviceCommand);
+  RUN_TEST(testWhitespace);
+  RUN_TEST(testOtherMembersSkipped);
+  RUN_TEST(testEscapes);
+  RUN_TEST(testWrongType);
+  RUN_TEST(testNumbers);
+  RUN_TEST(testDoesNotFit);
+  RUN_TEST(testKeys);
+  RUN_TEST(testLateStorage);
+  RUN_TEST(testMalformed);
+  return testResult();
+}
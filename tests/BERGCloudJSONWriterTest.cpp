@@ -0,0 +1,172 @@
+/*
+
+Tests for writing JSON from templates
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <string.h>
+
+#include "TestCommon.h"
+#include "BERGCloudJSONWriter.h"
+
+BC_JSON_TEMPLATE(allFields) =
+  "{\"string\":\"" BC_JSON_FIELD_1 "\",\"text\":\"" BC_JSON_FIELD_2 "\","
+  "\"number\":" BC_JSON_FIELD_3 ",\"hex\":\"" BC_JSON_FIELD_4 "\"}";
+
+BC_JSON_TEMPLATE(oneField) = "[" BC_JSON_FIELD_1 "]";
+
+BC_JSON_TEMPLATE(noFields) = "{\"type\":\"Ping\"}";
+
+/* Read the whole text, 'chunkSize' bytes at a time */
+static uint16_t readAll(BERGCloudJSONWriter& json, char *text, uint16_t maxSize, uint16_t chunkSize)
+{
+  uint16_t used = 0;
+  uint16_t received;
+
+  while ((maxSize - used) > 0)
+  {
+    received = json.read((uint8_t *)&text[used], ((maxSize - used) < chunkSize) ? (maxSize - used) : chunkSize);
+
+    if (received == 0)
+    {
+      break;
+    }
+
+    used += received;
+  }
+
+  text[used] = '\0';
+  return used;
+}
+
+/* Check that 'fields' in 'jsonTemplate' give 'expected', however it is read */
+static void checkText(const char *jsonTemplate, const BC_JSON_FIELD *fields, const char *expected)
+{
+  static const uint16_t chunkSizes[] = {1, 3, 16, 512};
+  char text[512];
+  uint8_t i;
+
+  for (i = 0; i < (sizeof(chunkSizes) / sizeof(chunkSizes[0])); i++)
+  {
+    BERGCloudJSONWriter json(jsonTemplate, fields);
+
+    CHECK_EQUAL(strlen(expected), json.size());
+    CHECK_EQUAL(strlen(expected), readAll(json, text, sizeof(text) - 1, chunkSizes[i]));
+    CHECK(strcmp(text, expected) == 0);
+  }
+}
+
+static void testAllFields(void)
+{
+  static const uint8_t address[] = {0x00, 0x1f, 0xa0, 0xff};
+  BC_JSON_FIELD fields[] = {
+    {BC_JSON_STRING, "name", 0, 0},
+    {BC_JSON_TEXT, "text", 0, 0},
+    {BC_JSON_NUMBER, NULL, 0, 1234},
+    {BC_JSON_HEX, address, sizeof(address), 0}
+  };
+
+  checkText(allFields, fields,
+    "{\"string\":\"name\",\"text\":\"text\",\"number\":1234,\"hex\":\"001fa0ff\"}");
+}
+
+static void testNoFields(void)
+{
+  checkText(noFields, NULL, "{\"type\":\"Ping\"}");
+}
+
+static void testEscapes(void)
+{
+  BC_JSON_FIELD fields[] = {
+    {BC_JSON_STRING, "a\"b\\c\nd\001", 0, 0}
+  };
+
+  checkText(oneField, fields, "[a\\\"b\\\\c\\u000ad\\u0001]");
+}
+
+static void testTextNotEscaped(void)
+{
+  BC_JSON_FIELD fields[] = {
+    {BC_JSON_TEXT, "\"quoted\"", 0, 0}
+  };
+
+  checkText(oneField, fields, "[\"quoted\"]");
+}
+
+static void testNumbers(void)
+{
+  BC_JSON_FIELD fields[] = {
+    {BC_JSON_NUMBER, NULL, 0, 0}
+  };
+
+  checkText(oneField, fields, "[0]");
+
+  fields[0].number = 7;
+  checkText(oneField, fields, "[7]");
+
+  fields[0].number = 1000000000;
+  checkText(oneField, fields, "[1000000000]");
+
+  fields[0].number = 0xffffffff;
+  checkText(oneField, fields, "[4294967295]");
+}
+
+static void testEmptyFields(void)
+{
+  BC_JSON_FIELD fields[] = {
+    {BC_JSON_STRING, "", 0, 0},
+    {BC_JSON_TEXT, "", 0, 0},
+    {BC_JSON_NUMBER, NULL, 0, 0},
+    {BC_JSON_HEX, NULL, 0, 0}
+  };
+
+  checkText(allFields, fields,
+    "{\"string\":\"\",\"text\":\"\",\"number\":0,\"hex\":\"\"}");
+}
+
+static void testReadAfterEnd(void)
+{
+  BC_JSON_FIELD fields[] = {
+    {BC_JSON_NUMBER, NULL, 0, 42}
+  };
+  BERGCloudJSONWriter json(oneField, fields);
+  char text[16];
+
+  CHECK_EQUAL(4, readAll(json, text, sizeof(text) - 1, sizeof(text)));
+  CHECK_EQUAL(0, json.read((uint8_t *)text, sizeof(text)));
+
+  /* The size does not change once read */
+  CHECK_EQUAL(4, json.size());
+}
+
+int main(void)
+{
+  RUN_TEST(testAllFields);
+  RUN_TEST(testNoFields);
+  RUN_TEST(testEscapes);
+  RUN_TEST(testTextNotEscaped);
+  RUN_TEST(testNumbers);
+  RUN_TEST(testEmptyFields);
+  RUN_TEST(testReadAfterEnd);
+  return testResult();
+}
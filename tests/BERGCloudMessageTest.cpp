@@ -0,0 +1,636 @@
+/*
+
+Tests for copying and assigning BERGCloudMessage
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <string.h>
+
+#include "TestCommon.h"
+
+/* Gives the tests a message reading a pool block in place */
+class BlockMessage : public BERGCloudMessage
+{
+public:
+  BlockMessage() : BERGCloudMessage((uint8_t *)NULL, 0)
+  {
+  }
+  void adopt(BERGCloudBlockPool& pool, const uint8_t *data, uint16_t size)
+  {
+    uint8_t *block = pool.acquire(size);
+
+    if (block != NULL)
+    {
+      memcpy(block, data, size);
+      adoptBlock(&pool, block, 0, size);
+    }
+  }
+};
+
+/* Gives the tests a message over data in program memory, as a view is */
+class ProgmemMessage : public BERGCloudMessage
+{
+public:
+  ProgmemMessage(const uint8_t *data, uint16_t size) : BERGCloudMessage((uint8_t *)data, size)
+  {
+    bytesWritten = size;
+    inProgmem = true;
+  }
+};
+
+static bool packed(BERGCloudMessage& msg, uint16_t expected)
+{
+  /* Read back what fill() packed */
+  uint16_t value = 0;
+
+  msg.restart();
+  return msg.unpack(value) && (value == expected);
+}
+
+static void fill(BERGCloudMessage& msg, uint16_t value)
+{
+  msg.clear();
+  msg.pack(value);
+}
+
+/* Pack 'value' at the width of its type, then unpack it as T */
+template <typename P, typename T>
+static bool repack(P value, T& n)
+{
+  BERGCloudMessage msg(16);
+
+  return msg.pack(value) && msg.unpack(n);
+}
+
+/* Test if 'msg' holds exactly the bytes 'expected' */
+static bool bytesAre(BERGCloudMessage& msg, const uint8_t *expected, uint16_t size)
+{
+  return (msg.used() == size) && (memcmp(msg.ptr(), expected, size) == 0);
+}
+
+static void testCopy(void)
+{
+  BERGCloudMessage msg(16);
+
+  fill(msg, 1000);
+
+  BERGCloudMessage copy(msg);
+
+  CHECK(copy.ptr() != msg.ptr());
+  CHECK_EQUAL(16, copy.size());
+  CHECK_EQUAL(msg.used(), copy.used());
+  CHECK(packed(copy, 1000));
+
+  /* The copy is independent */
+  fill(msg, 2000);
+  CHECK(packed(copy, 1000));
+}
+
+static void testAssign(void)
+{
+  BERGCloudMessage a(16);
+  BERGCloudMessage b(32);
+
+  fill(a, 1000);
+  fill(b, 2000);
+
+  a = b;
+  CHECK(a.ptr() != b.ptr());
+  CHECK_EQUAL(32, a.size());
+  CHECK(packed(a, 2000));
+
+  /* Each frees its own buffer on destruction */
+  fill(b, 3000);
+  CHECK(packed(a, 2000));
+}
+
+static void testSelfAssign(void)
+{
+  BERGCloudMessage a(16);
+  BERGCloudMessage& same = a;
+  uint8_t *buffer = a.ptr();
+
+  fill(a, 1000);
+  a = same;
+  CHECK(a.ptr() == buffer);
+  CHECK(packed(a, 1000));
+}
+
+static void testAssignFromStatic(void)
+{
+  BERGCloudStaticMessage<8, BC_EVENT_HEADROOM_BYTES> source;
+  BERGCloudMessage msg(16);
+
+  fill(source, 1000);
+  msg = source;
+
+  /* The headroom is not copied */
+  CHECK_EQUAL(0, msg.headroom());
+  CHECK_EQUAL(8, msg.size());
+  CHECK(packed(msg, 1000));
+}
+
+static void testCopyProgmem(void)
+{
+  static const uint8_t data[] PROGMEM = {0xcd, 0x03, 0xe8};
+  ProgmemMessage progmem(data, sizeof(data));
+  BERGCloudMessage assigned(16);
+
+  /* Copied out of program memory into RAM */
+  BERGCloudMessage copy(progmem);
+  CHECK(copy.ptr() != data);
+  CHECK_EQUAL(sizeof(data), copy.used());
+  CHECK(packed(copy, 1000));
+
+  assigned = progmem;
+  CHECK(assigned.ptr() != data);
+  CHECK(packed(assigned, 1000));
+}
+
+static void testAssignBlock(void)
+{
+  BERGCloudCommandPool pool;
+  BlockMessage block;
+  BERGCloudMessage msg(16);
+  BERGCloudMessage& target = block;
+  const uint8_t data[] = {0xcd, 0x03, 0xe8}; /* uint16 1000 */
+
+  /* Copying a block leaves it held by its message */
+  block.adopt(pool, data, sizeof(data));
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS - 1, pool.freeBlocks());
+  msg = block;
+  CHECK(packed(msg, 1000));
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS - 1, pool.freeBlocks());
+
+  /* Assigning over a block returns it to the pool, once */
+  fill(msg, 2000);
+  target = msg;
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, pool.freeBlocks());
+  CHECK(packed(block, 2000));
+}
+
+#if BC_CHUNKED_MESSAGES
+static void testAssignChunks(void)
+{
+  BERGCloudChunkPool pool;
+  BERGCloudChunkedMessage chunked(pool);
+  BERGCloudMessage msg(16);
+  BERGCloudMessage& target = chunked;
+  uint8_t data[BC_CHUNK_POOL_CHUNK_SIZE_BYTES * 2];
+  uint8_t out[sizeof(data)];
+
+  memset(data, 0x55, sizeof(data));
+
+  /* The chunks are joined */
+  CHECK(chunked.pack(data, sizeof(data)));
+  msg = chunked;
+  CHECK(!msg.chunked());
+  CHECK_EQUAL(chunked.used(), msg.used());
+  CHECK(msg.unpack(out, sizeof(out)));
+  CHECK(memcmp(out, data, sizeof(data)) == 0);
+
+  /* Assigning over chunks returns them to the pool */
+  fill(msg, 1000);
+  target = msg;
+  CHECK_EQUAL(BC_CHUNK_POOL_CHUNKS, pool.freeBlocks());
+  CHECK(packed(chunked, 1000));
+}
+#endif
+
+static void testIntegerRange(void)
+{
+  BERGCloudMessage msg(16);
+  uint8_t u8 = 0;
+  uint16_t u16 = 0;
+  uint32_t u32 = 0;
+  uint64_t u64 = 0;
+  int8_t s8 = 0;
+  int16_t s16 = 0;
+  int32_t s32 = 0;
+  int64_t s64 = 0;
+  float f = 0.0f;
+
+  /* Each encoding is accepted by a narrower type if its value fits */
+  CHECK(repack((uint16_t)UINT8_MAX, u8) && (u8 == UINT8_MAX));
+  CHECK(!repack((uint16_t)(UINT8_MAX + 1), u8));
+  CHECK(repack((int8_t)INT8_MAX, u8) && (u8 == INT8_MAX));
+  CHECK(!repack((int8_t)-1, u8));
+  CHECK(!repack((int64_t)-1, u8));
+
+  CHECK(repack((uint32_t)UINT16_MAX, u16) && (u16 == UINT16_MAX));
+  CHECK(!repack((uint32_t)UINT16_MAX + 1, u16));
+  CHECK(!repack((int32_t)-1, u16));
+
+  CHECK(repack((uint64_t)UINT32_MAX, u32) && (u32 == UINT32_MAX));
+  CHECK(!repack((uint64_t)UINT32_MAX + 1, u32));
+  CHECK(repack((int64_t)UINT32_MAX, u32) && (u32 == UINT32_MAX));
+  CHECK(!repack((int64_t)-1, u32));
+
+  CHECK(repack((uint64_t)UINT64_MAX, u64) && (u64 == UINT64_MAX));
+  CHECK(repack((int64_t)INT64_MAX, u64) && (u64 == INT64_MAX));
+  CHECK(!repack((int64_t)-1, u64));
+
+  CHECK(repack((uint8_t)INT8_MAX, s8) && (s8 == INT8_MAX));
+  CHECK(!repack((uint8_t)(INT8_MAX + 1), s8));
+  CHECK(repack((int16_t)INT8_MIN, s8) && (s8 == INT8_MIN));
+  CHECK(!repack((int16_t)(INT8_MIN - 1), s8));
+
+  CHECK(repack((uint16_t)INT16_MAX, s16) && (s16 == INT16_MAX));
+  CHECK(!repack((uint16_t)(INT16_MAX + 1), s16));
+  CHECK(repack((int32_t)INT16_MIN, s16) && (s16 == INT16_MIN));
+  CHECK(!repack((int32_t)(INT16_MIN - 1), s16));
+
+  CHECK(repack((uint32_t)INT32_MAX, s32) && (s32 == INT32_MAX));
+  CHECK(!repack((uint32_t)INT32_MAX + 1, s32));
+  CHECK(repack((int64_t)INT32_MIN, s32) && (s32 == INT32_MIN));
+  CHECK(!repack((int64_t)INT32_MIN - 1, s32));
+  CHECK(!repack((int64_t)INT32_MAX + 1, s32));
+  CHECK(!repack((uint64_t)1 << 32, s32));
+
+  CHECK(repack((uint64_t)INT64_MAX, s64) && (s64 == INT64_MAX));
+  CHECK(!repack((uint64_t)INT64_MAX + 1, s64));
+  CHECK(repack((int64_t)INT64_MIN, s64) && (s64 == INT64_MIN));
+  CHECK(repack((uint8_t)200, s64) && (s64 == 200));
+
+  /* Negative fix nums fit every signed type and no unsigned one */
+  msg.pack_smallest();
+  CHECK(msg.pack((int8_t)-32));
+  CHECK_EQUAL(1, msg.used());
+  CHECK(msg.unpack(s8));
+  CHECK_EQUAL(-32, s8);
+  msg.restart();
+  CHECK(msg.unpack(s64));
+  CHECK_EQUAL(-32, s64);
+  msg.restart();
+  CHECK(!msg.unpack(u32));
+
+  /* Other types are refused, as is an item cut short */
+  CHECK(!repack(1.0f, u8));
+  CHECK(!repack((uint8_t)1, f));
+  msg.clear();
+  CHECK(msg.pack((uint16_t)1000));
+  msg.used(2);
+  CHECK(!msg.unpack(u16));
+}
+
+static void testPackSmallest(void)
+{
+  static const uint8_t smallest[] = {
+    0x05,                                           /* uint8 5 */
+    0xcc, 0xc8,                                     /* uint8 200 */
+    0x05,                                           /* uint16 5 */
+    0xcc, 0xc8,                                     /* uint16 200 */
+    0xcd, 0x03, 0xe8,                               /* uint32 1000 */
+    0xce, 0x00, 0x01, 0x11, 0x70,                   /* uint32 70000 */
+    0xfb,                                           /* int8 -5 */
+    0xd0, 0x9c,                                     /* int16 -100 */
+    0xcd, 0x01, 0x2c,                               /* int16 300 */
+    0xd1, 0xfc, 0x18,                               /* int32 -1000 */
+    0xd2, 0xff, 0xff, 0x63, 0xc0,                   /* int32 -40000 */
+    0x05,                                           /* uint64 5 */
+    0xcf, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, /* uint64 1 << 32 */
+    0xfb,                                           /* int64 -5 */
+    0xd3, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00  /* int64 -(1 << 32) */
+  };
+  static const uint8_t full[] = {
+    0xcc, 0x05,                                     /* uint8 5 */
+    0xd0, 0xfb,                                     /* int8 -5 */
+    0xd3, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfb  /* int64 -5 */
+  };
+  BERGCloudMessage msg(64);
+  uint32_t u32 = 0;
+  int64_t s64 = 0;
+  int16_t s16 = 0;
+
+  /* Each integer takes the fewest bytes that hold its value */
+  msg.pack_smallest();
+  CHECK(msg.pack((uint8_t)5));
+  CHECK(msg.pack((uint8_t)200));
+  CHECK(msg.pack((uint16_t)5));
+  CHECK(msg.pack((uint16_t)200));
+  CHECK(msg.pack((uint32_t)1000));
+  CHECK(msg.pack((uint32_t)70000));
+  CHECK(msg.pack((int8_t)-5));
+  CHECK(msg.pack((int16_t)-100));
+  CHECK(msg.pack((int16_t)300));
+  CHECK(msg.pack((int32_t)-1000));
+  CHECK(msg.pack((int32_t)-40000));
+  CHECK(msg.pack((uint64_t)5));
+  CHECK(msg.pack((uint64_t)1 << 32));
+  CHECK(msg.pack((int64_t)-5));
+  CHECK(msg.pack(-((int64_t)1 << 32)));
+  CHECK(bytesAre(msg, smallest, sizeof(smallest)));
+
+  /* And unpacks to the same values */
+  msg.restart();
+  CHECK(msg.unpack_skip() && msg.unpack_skip() && msg.unpack_skip() && msg.unpack_skip());
+  CHECK(msg.unpack_skip());
+  CHECK(msg.unpack(u32));
+  CHECK_EQUAL(70000, u32);
+  CHECK(msg.unpack_skip() && msg.unpack_skip());
+  CHECK(msg.unpack(s16));
+  CHECK_EQUAL(300, s16);
+  CHECK(msg.unpack_skip() && msg.unpack_skip() && msg.unpack_skip() && msg.unpack_skip());
+  CHECK(msg.unpack(s64));
+  CHECK_EQUAL(-5, s64);
+  CHECK(msg.unpack(s64));
+  CHECK_EQUAL(-((int64_t)1 << 32), s64);
+
+  /* Otherwise each takes the width of its type */
+  msg.clear();
+  msg.pack_smallest(false);
+  CHECK(msg.pack((uint8_t)5));
+  CHECK(msg.pack((int8_t)-5));
+  CHECK(msg.pack((int64_t)-5));
+  CHECK(bytesAre(msg, full, sizeof(full)));
+}
+
+static void testWideEncodings(void)
+{
+  static const uint8_t data[] = {
+    0xd9, 0x03, 'a', 'b', 'c',                      /* str 8 */
+    0xc4, 0x02, 0x01, 0x02,                         /* bin 8 */
+    0xc5, 0x00, 0x02, 0x03, 0x04,                   /* bin 16 */
+    0xc6, 0x00, 0x00, 0x00, 0x02, 0x05, 0x06,       /* bin 32 */
+    0xdb, 0x00, 0x00, 0x00, 0x02, 'x', 'y',         /* raw 32 */
+    0xcf, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, /* uint 64 */
+    0xd3, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xfe, /* int 64 -2 */
+    0xcb, 0x3f, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, /* double 1.5 */
+    0xdd, 0x00, 0x00, 0x00, 0x02, 0x01, 0x02,       /* array 32 */
+    0xdf, 0x00, 0x00, 0x00, 0x01, 0xa1, 'k', 0x03,  /* map 32 */
+    0xdd, 0x00, 0x01, 0x00, 0x00                    /* array 32, too many items */
+  };
+  BERGCloudMessageView view(data, sizeof(data));
+  BERGCloudMessage msg(512);
+  uint8_t bin[300];
+  char str[8];
+  uint32_t size = 0;
+  uint64_t u64 = 0;
+  int64_t s64 = 0;
+  uint16_t items = 0;
+  double d = 0.0;
+  float f = 0.0f;
+
+  CHECK(view.unpack(str, sizeof(str)));
+  CHECK(strcmp(str, "abc") == 0);
+  CHECK(view.unpack(bin, sizeof(bin), &size));
+  CHECK_EQUAL(2, size);
+  CHECK_EQUAL(0x02, bin[1]);
+  CHECK(view.unpack(bin, sizeof(bin), &size));
+  CHECK_EQUAL(2, size);
+  CHECK_EQUAL(0x04, bin[1]);
+  CHECK(view.unpack(bin, sizeof(bin), &size));
+  CHECK_EQUAL(2, size);
+  CHECK_EQUAL(0x06, bin[1]);
+  CHECK(view.unpack(str, sizeof(str)));
+  CHECK(strcmp(str, "xy") == 0);
+  CHECK(view.unpack(u64));
+  CHECK(u64 == 0x0102030405060708ULL);
+  CHECK(view.unpack(s64));
+  CHECK_EQUAL(-2, s64);
+  CHECK(view.unpack(d));
+  CHECK(d == 1.5);
+  CHECK(view.unpack_array(items));
+  CHECK_EQUAL(2, items);
+  CHECK(view.unpack_skip() && view.unpack_skip());
+  CHECK(view.unpack_map(items));
+  CHECK_EQUAL(1, items);
+  CHECK(view.unpack(str, sizeof(str)));
+  CHECK(view.unpack_skip());
+
+  /* A 32-bit count that no message can hold is refused, and left unread */
+  CHECK(!view.unpack_array(items));
+  CHECK_EQUAL(5, view.remaining());
+
+  /* Binary data takes the bin 8 or bin 16 header that fits */
+  memset(bin, 0x55, sizeof(bin));
+  CHECK(msg.pack_bin(bin, 2));
+  CHECK_EQUAL(0xc4, msg.ptr()[0]);
+  CHECK_EQUAL(4, msg.used());
+  msg.clear();
+  CHECK(msg.pack_bin(bin, sizeof(bin)));
+  CHECK_EQUAL(0xc5, msg.ptr()[0]);
+  CHECK_EQUAL(3 + sizeof(bin), msg.used());
+  memset(bin, 0x00, sizeof(bin));
+  CHECK(msg.unpack(bin, sizeof(bin), &size));
+  CHECK_EQUAL(sizeof(bin), size);
+  CHECK_EQUAL(0x55, bin[sizeof(bin) - 1]);
+
+  /* A double is packed at full width, and unpacks to a float too */
+  msg.clear();
+  CHECK(msg.pack(1.5));
+  CHECK_EQUAL(0xcb, msg.ptr()[0]);
+  CHECK_EQUAL(9, msg.used());
+  CHECK(msg.unpack(f));
+  CHECK(f == 1.5f);
+
+  /* 64-bit integers are packed at full width */
+  msg.clear();
+  CHECK(msg.pack((uint64_t)0x0102030405060708ULL));
+  CHECK(bytesAre(msg, &data[28], 9));
+  msg.clear();
+  CHECK(msg.pack((int64_t)-2));
+  CHECK(bytesAre(msg, &data[37], 9));
+}
+
+static void testBeginEnd(void)
+{
+  static const uint8_t nested[] = {
+    0x83,                                           /* fix map, 3 pairs */
+    0xa1, 'a', 0x93,                                /* "a": fix array, 3 items */
+    0x01,                                           /* 1 */
+    0xce, 0x00, 0x01, 0x11, 0x70,                   /* 70000 */
+    0xca, 0x3f, 0xc0, 0x00, 0x00,                   /* 1.5 */
+    0xa1, 'b', 0x81, 0xa1, 'c', 0xc0,               /* "b": {"c": nil} */
+    0xa1, 'd', 0x80                                 /* "d": {} */
+  };
+  BERGCloudMessage msg(128);
+  uint16_t items = 0;
+  uint8_t i;
+
+  /* Nested maps and arrays shrink to the fix forms once ended */
+  msg.pack_smallest();
+  CHECK(msg.begin_map());
+  CHECK(msg.pack("a"));
+  CHECK(msg.begin_array());
+  CHECK(msg.pack((uint8_t)1));
+  CHECK(msg.pack((uint32_t)70000));
+  CHECK(msg.pack(1.5f));
+  CHECK(msg.end_array());
+  CHECK(msg.pack("b"));
+  CHECK(msg.begin_map());
+  CHECK(msg.pack("c"));
+  CHECK(msg.pack_nil());
+  CHECK(msg.end_map());
+  CHECK(msg.pack("d"));
+  CHECK(msg.begin_map());
+  CHECK(msg.end_map());
+  CHECK(msg.end_map());
+  CHECK(bytesAre(msg, nested, sizeof(nested)));
+
+  /* Sixteen items or more keep the 16-bit header */
+  msg.clear();
+  CHECK(msg.begin_map());
+  for (i = 0; i < 16; i++)
+  {
+    CHECK(msg.pack(i));
+    CHECK(msg.pack(i));
+  }
+  CHECK(msg.end_map());
+  CHECK_EQUAL(3 + 32, msg.used());
+  CHECK(msg.unpack_map(items));
+  CHECK_EQUAL(16, items);
+
+  /* A key with no value, or a mismatched end, is refused */
+  msg.clear();
+  CHECK(msg.begin_map());
+  CHECK(msg.pack("a"));
+  CHECK(!msg.end_map());
+  CHECK(!msg.end_array());
+  CHECK(msg.pack_nil());
+  CHECK(msg.end_map());
+  CHECK(!msg.end_map());
+}
+
+static void testUnpackView(void)
+{
+  static const uint8_t data[] = {0xa2, 'h', 'i', 0xc4, 0x01, 0x07};
+  BERGCloudMessageView view(data, sizeof(data));
+  BERGCloudMessage msg(32);
+  const uint8_t *p = NULL;
+  uint16_t size = 0;
+  uint8_t n = 0;
+
+  /* Strings and binary data are given in place */
+  CHECK(msg.pack("abc"));
+  CHECK(msg.pack(""));
+  CHECK(msg.pack((uint8_t)1));
+  CHECK(msg.unpack_view(p, size));
+  CHECK(p == msg.ptr() + 1);
+  CHECK_EQUAL(3, size);
+  CHECK(msg.unpack_view(p, size));
+  CHECK_EQUAL(0, size);
+
+  /* Anything else is refused and left to be unpacked */
+  CHECK(!msg.unpack_view(p, size));
+  CHECK(msg.unpack(n));
+  CHECK_EQUAL(1, n);
+
+  /* As is an item cut short */
+  msg.restart();
+  msg.used(3);
+  CHECK(!msg.unpack_view(p, size));
+  CHECK_EQUAL(3, msg.remaining());
+
+  /* A view gives pointers into the memory it is over */
+  CHECK(view.unpack_view(p, size));
+  CHECK(p == &data[1]);
+  CHECK_EQUAL(2, size);
+  CHECK(view.unpack_view(p, size));
+  CHECK(p == &data[5]);
+  CHECK_EQUAL(1, size);
+  CHECK_EQUAL(0, view.remaining());
+}
+
+#if BC_CHUNKED_MESSAGES
+static void testUnpackViewChunks(void)
+{
+  BERGCloudChunkPool pool;
+  BERGCloudChunkedMessage msg(pool);
+  uint8_t data[BC_CHUNK_POOL_CHUNK_SIZE_BYTES];
+  uint8_t out[sizeof(data)];
+  const uint8_t *p = NULL;
+  uint16_t size = 0;
+  uint16_t left;
+  uint32_t outSize = 0;
+
+  memset(data, 0x55, sizeof(data));
+
+  /* Within a chunk the data is given in place */
+  CHECK(msg.pack("ab"));
+  CHECK(msg.pack(data, sizeof(data)));
+  CHECK(msg.unpack_view(p, size));
+  CHECK(p == msg.ptr() + 1);
+  CHECK_EQUAL(2, size);
+
+  /* Across a chunk boundary it can't be, and is left to be copied out */
+  left = msg.remaining();
+  CHECK(!msg.unpack_view(p, size));
+  CHECK_EQUAL(left, msg.remaining());
+  CHECK(msg.unpack(out, sizeof(out), &outSize));
+  CHECK_EQUAL(sizeof(data), outSize);
+  CHECK(memcmp(out, data, sizeof(data)) == 0);
+}
+#endif
+
+static void testUnpackString(void)
+{
+  BERGCloudMessage msg(128);
+  uint8_t data[STRING_CHUNK_SIZE_BYTES + 10];
+  uint8_t out[sizeof(data)];
+  uint32_t size = 0;
+  String s;
+
+  /* Appended a chunk at a time */
+  memset(data, 'a', sizeof(data));
+  CHECK(msg.pack("hello"));
+  CHECK(msg.pack(data, sizeof(data)));
+  CHECK(msg.unpack(s));
+  CHECK(s == "hello");
+  CHECK(msg.unpack(s));
+  CHECK_EQUAL(sizeof(data), s.length());
+
+  /* Data with a null character, in any chunk, is refused and left */
+  /* to be unpacked as binary data */
+  data[STRING_CHUNK_SIZE_BYTES + 5] = '\0';
+  msg.clear();
+  CHECK(msg.pack(data, sizeof(data)));
+  CHECK(!msg.unpack(s));
+  CHECK_EQUAL(0, s.length());
+  CHECK(msg.unpack(out, sizeof(out), &size));
+  CHECK_EQUAL(sizeof(data), size);
+  CHECK(memcmp(out, data, sizeof(data)) == 0);
+}
+
+int main(void)
+{
+  RUN_TEST(testCopy);
+  RUN_TEST(testAssign);
+  RUN_TEST(testSelfAssign);
+  RUN_TEST(testAssignFromStatic);
+  RUN_TEST(testCopyProgmem);
+  RUN_TEST(testAssignBlock);
+#if BC_CHUNKED_MESSAGES
+  RUN_TEST(testAssignChunks);
+#endif
+  RUN_TEST(testIntegerRange);
+  RUN_TEST(testPackSmallest);
+  RUN_TEST(testWideEncodings);
+  RUN_TEST(testBeginEnd);
+  RUN_TEST(testUnpackView);
+  RUN_TEST(testUnpackString);
+#if BC_CHUNKED_MESSAGES
+  RUN_TEST(testUnpackViewChunks);
+#endif
+  return testResult();
+}
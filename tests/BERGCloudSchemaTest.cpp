@@ -0,0 +1,212 @@
+/*
+
+Tests for pack_schema() and unpack_schema()
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <string.h>
+
+#include "TestCommon.h"
+
+struct Reading {
+  uint8_t level;
+  uint16_t battery;
+  uint32_t uptime;
+  int8_t offset;
+  int16_t temperature;
+  int32_t position;
+  float humidity;
+  bool door;
+  char status[12];
+  uint8_t serial[4];
+};
+
+BC_SCHEMA_BEGIN(readingSchema)
+  BC_SCHEMA_FIELD(Reading, level)
+  BC_SCHEMA_FIELD(Reading, battery)
+  BC_SCHEMA_FIELD(Reading, uptime)
+  BC_SCHEMA_FIELD(Reading, offset)
+  BC_SCHEMA_FIELD(Reading, temperature)
+  BC_SCHEMA_FIELD(Reading, position)
+  BC_SCHEMA_FIELD(Reading, humidity)
+  BC_SCHEMA_FIELD(Reading, door)
+  BC_SCHEMA_FIELD_KEY(Reading, status, "state")
+  BC_SCHEMA_FIELD(Reading, serial)
+BC_SCHEMA_END(readingSchema)
+
+static void fillReading(Reading& r)
+{
+  memset(&r, 0x00, sizeof(r));
+  r.level = 200;
+  r.battery = 3700;
+  r.uptime = 86400;
+  r.offset = -5;
+  r.temperature = -1250;
+  r.position = -100000;
+  r.humidity = 45.5f;
+  r.door = true;
+  strcpy(r.status, "ok");
+  r.serial[0] = 0xde;
+  r.serial[1] = 0xad;
+  r.serial[2] = 0xbe;
+  r.serial[3] = 0xef;
+}
+
+static void checkReading(const Reading& r)
+{
+  CHECK_EQUAL(200, r.level);
+  CHECK_EQUAL(3700, r.battery);
+  CHECK_EQUAL(86400, r.uptime);
+  CHECK_EQUAL(-5, r.offset);
+  CHECK_EQUAL(-1250, r.temperature);
+  CHECK_EQUAL(-100000, r.position);
+  CHECK(r.humidity == 45.5f);
+  CHECK(r.door);
+  CHECK(strcmp(r.status, "ok") == 0);
+  CHECK_EQUAL(0xdeadbeef, ((uint32_t)r.serial[0] << 24) | ((uint32_t)r.serial[1] << 16) | (r.serial[2] << 8) | r.serial[3]);
+}
+
+static void testRoundTrip(void)
+{
+  BERGCloudMessage msg(128);
+  Reading in;
+  Reading out;
+
+  fillReading(in);
+  memset(&out, 0x00, sizeof(out));
+
+  CHECK(msg.pack_schema(readingSchema, &in));
+  CHECK(msg.unpack_schema(readingSchema, &out));
+  checkReading(out);
+  CHECK_EQUAL(0, msg.remaining());
+}
+
+static void testPackedAsMap(void)
+{
+  BERGCloudMessage msg(128);
+  Reading in;
+  uint16_t items = 0;
+  uint16_t battery = 0;
+  char status[12];
+
+  /* Read back as an ordinary map, under each key */
+  fillReading(in);
+  CHECK(msg.pack_schema(readingSchema, &in));
+
+  CHECK(msg.unpack_map(items));
+  CHECK_EQUAL(10, items);
+  CHECK(msg.unpack_find("battery"));
+  CHECK(msg.unpack(battery));
+  CHECK_EQUAL(3700, battery);
+  CHECK(msg.unpack_find("state"));
+  CHECK(msg.unpack(status, sizeof(status)));
+  CHECK(strcmp(status, "ok") == 0);
+  CHECK(!msg.unpack_find("status"));
+}
+
+static void testAnyOrder(void)
+{
+  BERGCloudMessage msg(128);
+  Reading out;
+  uint8_t serial[4] = {0xde, 0xad, 0xbe, 0xef};
+
+  /* Keys in another order, with one not in the schema */
+  msg.pack_map(11);
+  msg.pack("serial");
+  msg.pack_bin(serial, sizeof(serial));
+  msg.pack("state");
+  msg.pack("ok");
+  msg.pack("door");
+  msg.pack(true);
+  msg.pack("extra");
+  msg.pack((uint16_t)1);
+  msg.pack("humidity");
+  msg.pack(45.5f);
+  msg.pack("position");
+  msg.pack((int32_t)-100000);
+  msg.pack("temperature");
+  msg.pack((int16_t)-1250);
+  msg.pack("offset");
+  msg.pack((int8_t)-5);
+  msg.pack("uptime");
+  msg.pack((uint32_t)86400);
+  msg.pack("battery");
+  msg.pack((uint16_t)3700);
+  msg.pack("level");
+  msg.pack((uint8_t)200);
+
+  memset(&out, 0x00, sizeof(out));
+  CHECK(msg.unpack_schema(readingSchema, &out));
+  checkReading(out);
+}
+
+static void testMissingMember(void)
+{
+  BERGCloudMessage msg(128);
+  Reading out;
+
+  /* Every member must be found */
+  msg.pack_map(1);
+  msg.pack("battery");
+  msg.pack((uint16_t)3700);
+
+  memset(&out, 0x00, sizeof(out));
+  CHECK(!msg.unpack_schema(readingSchema, &out));
+  CHECK_EQUAL(3700, out.battery);
+}
+
+static void testOutOfRange(void)
+{
+  BERGCloudMessage msg(128);
+  Reading out;
+
+  /* A value too large for its member is refused */
+  msg.pack_map(1);
+  msg.pack("level");
+  msg.pack((uint16_t)300);
+
+  memset(&out, 0x00, sizeof(out));
+  CHECK(!msg.unpack_schema(readingSchema, &out));
+}
+
+static void testNoSpace(void)
+{
+  BERGCloudMessage msg(16);
+  Reading in;
+
+  /* Nothing is packed unless all of it fits */
+  fillReading(in);
+  CHECK(!msg.pack_schema(readingSchema, &in));
+  CHECK_EQUAL(0, msg.used());
+}
+
+int main(void)
+{
+  RUN_TEST(testRoundTrip);
+  RUN_TEST(testPackedAsMap);
+  RUN_TEST(testAnyOrder);
+  RUN_TEST(testMissingMember);
+  RUN_TEST(testOutOfRange);
+  RUN_TEST(testNoSpace);
+  return testResult();
+}
@@ -0,0 +1,137 @@
+/*
+
+Tests for BERGCloudStaticMessage
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <string.h>
+
+#include "TestCommon.h"
+
+static void testPackUnpack(void)
+{
+  BERGCloudStaticMessage<32> msg;
+  uint16_t items = 0;
+  uint16_t value = 0;
+  char name[16];
+
+  CHECK_EQUAL(32, msg.size());
+  CHECK(msg.pack_map(2));
+  CHECK(msg.pack("name"));
+  CHECK(msg.pack("led"));
+  CHECK(msg.pack("level"));
+  CHECK(msg.pack((uint16_t)500));
+
+  /* fixmap, fixstr "name", fixstr "led", fixstr "level", uint16 500 */
+  CHECK_EQUAL(1 + 5 + 4 + 6 + 3, msg.used());
+
+  CHECK(msg.unpack_map(items));
+  CHECK_EQUAL(2, items);
+  CHECK(msg.unpack(name, sizeof(name)));
+  CHECK(strcmp(name, "name") == 0);
+  CHECK(msg.unpack(name, sizeof(name)));
+  CHECK(strcmp(name, "led") == 0);
+  CHECK(msg.unpack(name, sizeof(name)));
+  CHECK(strcmp(name, "level") == 0);
+  CHECK(msg.unpack(value));
+  CHECK_EQUAL(500, value);
+  CHECK(!msg.unpack(value));
+}
+
+static void testFull(void)
+{
+  BERGCloudStaticMessage<4> msg;
+
+  /* A uint32 takes five bytes */
+  CHECK(!msg.pack((uint32_t)0x12345678));
+  CHECK_EQUAL(0, msg.used());
+  CHECK(msg.pack((uint16_t)0x1234));
+  CHECK(!msg.pack((uint16_t)0x1234));
+  CHECK_EQUAL(3, msg.used());
+}
+
+static void testCopy(void)
+{
+  BERGCloudStaticMessage<16> msg;
+  uint8_t value = 0;
+
+  CHECK(msg.pack((uint8_t)200));
+
+  BERGCloudStaticMessage<16> copy(msg);
+  CHECK(copy.ptr() != msg.ptr());
+  CHECK_EQUAL(msg.used(), copy.used());
+  CHECK(memcmp(copy.ptr(), msg.ptr(), msg.used()) == 0);
+
+  /* Changing the copy leaves the original as it was */
+  CHECK(copy.pack((uint8_t)100));
+  CHECK_EQUAL(4, copy.used());
+  CHECK_EQUAL(2, msg.used());
+
+  BERGCloudStaticMessage<16> assigned;
+  assigned = copy;
+  CHECK(assigned.ptr() != copy.ptr());
+  CHECK_EQUAL(copy.used(), assigned.used());
+  CHECK(assigned.unpack(value));
+  CHECK_EQUAL(200, value);
+  CHECK(assigned.unpack(value));
+  CHECK_EQUAL(100, value);
+
+  /* Assigning a message to itself changes nothing */
+  assigned = assigned;
+  CHECK_EQUAL(copy.used(), assigned.used());
+  CHECK(memcmp(assigned.ptr(), copy.ptr(), copy.used()) == 0);
+
+  /* A copy packs integers as the original does */
+  BERGCloudStaticMessage<16> smallest;
+  smallest.pack_smallest();
+  BERGCloudStaticMessage<16> smallestCopy(smallest);
+  CHECK(smallestCopy.pack((uint8_t)5));
+  CHECK_EQUAL(1, smallestCopy.used());
+
+  assigned = smallest;
+  CHECK(assigned.pack((uint8_t)5));
+  CHECK_EQUAL(1, assigned.used());
+
+  smallest.pack_smallest(false);
+  assigned = smallest;
+  CHECK(assigned.pack((uint8_t)5));
+  CHECK_EQUAL(2, assigned.used());
+}
+
+static void testHeadroom(void)
+{
+  BERGCloudStaticMessage<16, BC_EVENT_HEADROOM_BYTES> msg;
+
+  CHECK_EQUAL(BC_EVENT_HEADROOM_BYTES, msg.headroom());
+  CHECK_EQUAL(16, msg.size());
+  CHECK_EQUAL(16, msg.available());
+}
+
+int main(void)
+{
+  RUN_TEST(testPackUnpack);
+  RUN_TEST(testFull);
+  RUN_TEST(testCopy);
+  RUN_TEST(testHeadroom);
+  return testResult();
+}
@@ -0,0 +1,405 @@
+/*
+
+Tests for decoding MessagePack as it arrives
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <stdarg.h>
+#include <string.h>
+
+#include "TestCommon.h"
+#include "BERGCloudStreamDecoder.h"
+
+/* Writes each item decoded into 'trace', so that what is decoded */
+/* can be compared however the input was split */
+class TraceHandler : public BERGCloudStreamHandler
+{
+public:
+  TraceHandler() : calls(0), failAt(0)
+  {
+    clear();
+  }
+
+  void clear(void)
+  {
+    trace[0] = '\0';
+    used = 0;
+    calls = 0;
+  }
+
+  virtual bool mapStart(uint16_t items) { return add(" {%u", items); }
+  virtual bool arrayStart(uint16_t items) { return add(" [%u", items); }
+  virtual bool end(void) { return add(" end"); }
+  virtual bool nil(void) { return add(" nil"); }
+  virtual bool boolean(bool value) { return add(value ? " true" : " false"); }
+  virtual bool integer(int32_t value) { return add(" i%ld", (long)value); }
+  virtual bool unsignedInteger(uint32_t value) { return add(" u%lu", (unsigned long)value); }
+  virtual bool real(float value) { return add(" f%g", (double)value); }
+  virtual bool rawStart(uint16_t size, bool key) { return add(key ? " k%u:" : " s%u:", size); }
+
+  virtual bool rawData(const uint8_t *data, uint16_t size)
+  {
+    /* Appended as it is, so that the pieces join up */
+    if ((used + size) >= sizeof(trace))
+    {
+      return false;
+    }
+
+    memcpy(&trace[used], data, size);
+    used += size;
+    trace[used] = '\0';
+    return counted();
+  }
+
+  char trace[512];
+  uint16_t used;
+  uint16_t calls;
+  uint16_t failAt;   /* The call that returns false, from 1, or 0 for none */
+
+private:
+  bool add(const char *format, ...)
+  {
+    va_list args;
+    int written;
+
+    va_start(args, format);
+    written = vsnprintf(&trace[used], sizeof(trace) - used, format, args);
+    va_end(args);
+
+    if ((written < 0) || ((used + written) >= (int)sizeof(trace)))
+    {
+      return false;
+    }
+
+    used += written;
+    return counted();
+  }
+
+  bool counted(void)
+  {
+    return ++calls != failAt;
+  }
+};
+
+/* Feed 'size' bytes of 'data', 'chunkSize' at a time; returns the */
+/* result of the last feed() */
+static bool decode(BERGCloudStreamDecoder& decoder, const uint8_t *data, uint16_t size, uint16_t chunkSize)
+{
+  uint16_t offset = 0;
+  uint16_t chunk;
+  bool fed = true;
+
+  while (fed && (offset < size))
+  {
+    chunk = ((size - offset) < chunkSize) ? (size - offset) : chunkSize;
+    fed = decoder.feed(&data[offset], chunk);
+    offset += chunk;
+  }
+
+  return fed;
+}
+
+/* Check that 'data' decodes to 'expected', fed a byte at a time, */
+/* a few bytes at a time and whole */
+static void checkDecode(const uint8_t *data, uint16_t size, const char *expected)
+{
+  static const uint16_t chunkSizes[] = {1, 3, 0xffff};
+  TraceHandler handler;
+  BERGCloudStreamDecoder decoder(handler);
+  uint8_t i;
+
+  for (i = 0; i < (sizeof(chunkSizes) / sizeof(chunkSizes[0])); i++)
+  {
+    handler.clear();
+    decoder.reset();
+
+    CHECK(decode(decoder, data, size, chunkSizes[i]));
+    CHECK(decoder.idle());
+    CHECK(!decoder.failed());
+
+    if (!CHECK(strcmp(handler.trace, expected) == 0))
+    {
+      fprintf(stderr, "  fed %u at a time: \"%s\"\n  expected: \"%s\"\n", chunkSizes[i], handler.trace, expected);
+    }
+  }
+}
+
+/* Check that decoding 'data' fails, however it is fed */
+static void checkFails(const uint8_t *data, uint16_t size)
+{
+  static const uint16_t chunkSizes[] = {1, 0xffff};
+  TraceHandler handler;
+  BERGCloudStreamDecoder decoder(handler);
+  uint8_t i;
+
+  for (i = 0; i < (sizeof(chunkSizes) / sizeof(chunkSizes[0])); i++)
+  {
+    decoder.reset();
+    CHECK(!decode(decoder, data, size, chunkSizes[i]));
+    CHECK(decoder.failed());
+    CHECK(!decoder.idle());
+  }
+}
+
+static void testScalars(void)
+{
+  static const uint8_t data[] = {
+    0xc0, 0xc2, 0xc3,                    /* nil, false, true */
+    0x00, 0x7f, 0xe0, 0xff,              /* fixnums */
+    0xcc, 0xff,                          /* uint 8 */
+    0xcd, 0xff, 0xfe,                    /* uint 16 */
+    0xce, 0x7f, 0xff, 0xff, 0xff,        /* uint 32, largest signed */
+    0xce, 0xff, 0xff, 0xff, 0xff,        /* uint 32, largest */
+    0xd0, 0x80,                          /* int 8 */
+    0xd1, 0x80, 0x00,                    /* int 16 */
+    0xd2, 0x80, 0x00, 0x00, 0x00,        /* int 32 */
+    0xca, 0x3f, 0xc0, 0x00, 0x00         /* float 1.5 */
+  };
+
+  checkDecode(data, sizeof(data),
+    " nil false true i0 i127 i-32 i-1 i255 i65534 i2147483647 u4294967295"
+    " i-128 i-32768 i-2147483648 f1.5");
+}
+
+static void testStrings(void)
+{
+  static const uint8_t data[] = {
+    0xa0,                                /* empty fix str */
+    0xa3, 'a', 'b', 'c',                 /* fix str */
+    0xd9, 0x02, 'd', 'e',                /* str 8 */
+    0xda, 0x00, 0x01, 'f',               /* raw 16 */
+    0xdb, 0x00, 0x00, 0x00, 0x02, 'g', 'h', /* raw 32 */
+    0xc4, 0x01, 'i',                     /* bin 8 */
+    0xc5, 0x00, 0x00,                    /* empty bin 16 */
+    0xc6, 0x00, 0x00, 0x00, 0x03, 'j', 'k', 'l' /* bin 32 */
+  };
+
+  checkDecode(data, sizeof(data), " s0: s3:abc s2:de s1:f s2:gh s1:i s0: s3:jkl");
+}
+
+static void testNested(void)
+{
+  static const uint8_t data[] = {
+    0x82,                                /* map of 2 */
+      0xa1, 'a', 0x93,                   /* "a": array of 3 */
+        0x01,
+        0x81, 0xa1, 'b', 0xc3,           /* {"b": true} */
+        0x90,                            /* empty array */
+      0xa1, 'c', 0xde, 0x00, 0x01,       /* "c": map 16 of 1 */
+        0xa1, 'd', 0xdc, 0x00, 0x02,     /* "d": array 16 of 2 */
+          0xa1, 'e', 0x80,               /* "e", empty map */
+    0xdd, 0x00, 0x00, 0x00, 0x01, 0x05,  /* array 32 of 1, then a map 32 */
+    0xdf, 0x00, 0x00, 0x00, 0x01, 0xa1, 'f', 0xa1, 'g'
+  };
+
+  checkDecode(data, sizeof(data),
+    " {2 k1:a [3 i1 {1 k1:b true end [0 end end k1:c {1 k1:d [2 s1:e {0 end end end end"
+    " [1 i5 end {1 k1:f s1:g end");
+}
+
+static void testKeys(void)
+{
+  /* Keys of maps inside arrays inside maps; values that are strings */
+  /* and strings in arrays are not keys */
+  static const uint8_t data[] = {
+    0x82,
+      0xa1, 'a', 0x92, 0xa1, 'x', 0x81, 0xa1, 'b', 0xa1, 'y',
+      0xc4, 0x01, 'c', 0xa1, 'z'
+  };
+
+  checkDecode(data, sizeof(data), " {2 k1:a [2 s1:x {1 k1:b s1:y end end k1:c s1:z end");
+}
+
+static void testExtensionsSkipped(void)
+{
+  static const uint8_t data[] = {
+    0x94,                                          /* array of 4 */
+      0xd4, 0x01, 0xaa,                            /* fix ext 1 */
+      0xd8, 0x01, 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, /* fix ext 16 */
+      0xc7, 0x00, 0x01,                            /* empty ext 8 */
+      0x01,
+    0xc8, 0x00, 0x03, 0x02, 0xc0, 0xc0, 0xc0,      /* ext 16, data that looks like nil */
+    0xc9, 0x00, 0x00, 0x00, 0x02, 0x03, 0xa1, 'x', /* ext 32 */
+    0xd5, 0x01, 0x90, 0x90,                        /* fix ext 2 */
+    0xd6, 0x01, 1, 2, 3, 4,                        /* fix ext 4 */
+    0xd7, 0x01, 1, 2, 3, 4, 5, 6, 7, 8,            /* fix ext 8 */
+    0xc3
+  };
+
+  checkDecode(data, sizeof(data), " [4 i1 end true");
+}
+
+static void test64BitIntegers(void)
+{
+  static const uint8_t data[] = {
+    0xcf, 0, 0, 0, 0, 0x7f, 0xff, 0xff, 0xff,                   /* uint 64 */
+    0xcf, 0, 0, 0, 0, 0xff, 0xff, 0xff, 0xff,
+    0xd3, 0, 0, 0, 0, 0, 0, 0, 5,                               /* int 64 */
+    0xd3, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xd3, 0xff, 0xff, 0xff, 0xff, 0x80, 0x00, 0x00, 0x00,
+    0xd3, 0, 0, 0, 0, 0xff, 0xff, 0xff, 0xff
+  };
+  static const uint8_t uintTooLarge[] = {0xcf, 0, 0, 0, 1, 0, 0, 0, 0};
+  static const uint8_t intTooLarge[] = {0xd3, 0, 0, 0, 1, 0, 0, 0, 0};
+  static const uint8_t intTooSmall[] = {0xd3, 0xff, 0xff, 0xff, 0xff, 0x7f, 0xff, 0xff, 0xff};
+  static const uint8_t intLowest[] = {0xd3, 0x80, 0, 0, 0, 0, 0, 0, 0};
+
+  checkDecode(data, sizeof(data),
+    " i2147483647 u4294967295 i5 i-1 i-2147483648 u4294967295");
+
+  checkFails(uintTooLarge, sizeof(uintTooLarge));
+  checkFails(intTooLarge, sizeof(intTooLarge));
+  checkFails(intTooSmall, sizeof(intTooSmall));
+  checkFails(intLowest, sizeof(intLowest));
+}
+
+static void testDoubles(void)
+{
+  static const uint8_t data[] = {
+    0xcb, 0x3f, 0xf8, 0, 0, 0, 0, 0, 0,           /* 1.5 */
+    0xcb, 0xc0, 0x5e, 0xdd, 0x2f, 0x1a, 0x9f, 0xbe, 0x77, /* -123.456 */
+    0xcb, 0, 0, 0, 0, 0, 0, 0, 0,                 /* 0 */
+    0xcb, 0x7f, 0xf0, 0, 0, 0, 0, 0, 0            /* infinity */
+  };
+
+  checkDecode(data, sizeof(data), " f1.5 f-123.456 f0 finf");
+}
+
+static void testNeverUsed(void)
+{
+  static const uint8_t data[] = {0x91, 0xc1};
+
+  checkFails(data, 1 + 1);
+  checkFails(&data[1], 1);
+}
+
+static void testDepth(void)
+{
+  uint8_t data[BC_STREAM_DECODER_DEPTH + 2];
+  char expected[(BC_STREAM_DECODER_DEPTH * 7) + 8];
+  uint8_t i;
+
+  /* As deep as allowed, with an empty array at the bottom */
+  expected[0] = '\0';
+  for (i = 0; i < BC_STREAM_DECODER_DEPTH; i++)
+  {
+    data[i] = 0x91;
+    strcat(expected, " [1");
+  }
+  data[i] = 0x90;
+  strcat(expected, " [0 end");
+  for (i = 0; i < BC_STREAM_DECODER_DEPTH; i++)
+  {
+    strcat(expected, " end");
+  }
+
+  checkDecode(data, BC_STREAM_DECODER_DEPTH + 1, expected);
+
+  /* One more that is not empty is too deep */
+  data[BC_STREAM_DECODER_DEPTH] = 0x91;
+  data[BC_STREAM_DECODER_DEPTH + 1] = 0xc0;
+  checkFails(data, sizeof(data));
+}
+
+static void testPartial(void)
+{
+  static const uint8_t data[] = {0x92, 0xcd, 0x01, 0x02, 0xa2, 'h', 'i'};
+  TraceHandler handler;
+  BERGCloudStreamDecoder decoder(handler);
+  uint16_t i;
+
+  /* Not idle until the last byte has arrived */
+  for (i = 0; i < sizeof(data); i++)
+  {
+    CHECK(decoder.idle() == (i == 0));
+    CHECK(decoder.feed(&data[i], 1));
+  }
+
+  CHECK(decoder.idle());
+  CHECK(strcmp(handler.trace, " [2 i258 s2:hi end") == 0);
+}
+
+static void testHandlerStops(void)
+{
+  static const uint8_t data[] = {0x93, 0x01, 0x02, 0x03};
+  TraceHandler handler;
+  BERGCloudStreamDecoder decoder(handler);
+
+  /* The third call is refused, and nothing more is decoded */
+  handler.failAt = 3;
+  CHECK(!decoder.feed(data, sizeof(data)));
+  CHECK(decoder.failed());
+  CHECK(strcmp(handler.trace, " [3 i1 i2") == 0);
+
+  CHECK(!decoder.feed(data, sizeof(data)));
+  CHECK(strcmp(handler.trace, " [3 i1 i2") == 0);
+}
+
+static void testResetAfterFailure(void)
+{
+  static const uint8_t bad[] = {0x92, 0x01, 0xc1};
+  static const uint8_t good[] = {0x92, 0x01, 0x81, 0xa1, 'k', 0x02};
+  TraceHandler handler;
+  BERGCloudStreamDecoder decoder(handler);
+
+  CHECK(!decoder.feed(bad, sizeof(bad)));
+  CHECK(decoder.failed());
+
+  /* Nothing is decoded until reset(), which forgets the open array */
+  handler.clear();
+  CHECK(!decoder.feed(good, sizeof(good)));
+  CHECK_EQUAL(0, handler.used);
+
+  decoder.reset();
+  CHECK(!decoder.failed());
+  CHECK(decoder.idle());
+  CHECK(decoder.feed(good, sizeof(good)));
+  CHECK(decoder.idle());
+  CHECK(strcmp(handler.trace, " [2 i1 {1 k1:k i2 end end") == 0);
+}
+
+static void testSeveralMessages(void)
+{
+  /* One after another, idle between each */
+  static const uint8_t data[] = {0x81, 0xa1, 'a', 0x01, 0x81, 0xa1, 'b', 0x02};
+
+  checkDecode(data, sizeof(data), " {1 k1:a i1 end {1 k1:b i2 end");
+}
+
+int main(void)
+{
+  RUN_TEST(testScalars);
+  RUN_TEST(testStrings);
+  RUN_TEST(testNested);
+  RUN_TEST(testKeys);
+  RUN_TEST(testExtensionsSkipped);
+  RUN_TEST(test64BitIntegers);
+  RUN_TEST(testDoubles);
+  RUN_TEST(testNeverUsed);
+  RUN_TEST(testDepth);
+  RUN_TEST(testPartial);
+  RUN_TEST(testHandlerStops);
+  RUN_TEST(testResetAfterFailure);
+  RUN_TEST(testSeveralMessages);
+  return testResult();
+}
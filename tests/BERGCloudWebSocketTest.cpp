@@ -0,0 +1,625 @@
+/*
+
+Tests for the WebSocket frames read and written by the device
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#include <pthread.h>
+#include <string.h>
+
+#include "TestCommon.h"
+#include "HostBridge.h"
+#include "WebSocketClient.h" /* For the WS_ defines */
+
+#define RECEIVE_TIMEOUT_MS 5000
+#define EVENT_DATA_BYTES   50000
+
+/* Gives the tests the device's own command polling */
+class FrameDevice : public BERGCloudCC3000
+{
+public:
+  using BERGCloudCC3000::pollForDeviceCommand;
+
+  /* Free every block and clear the statistics */
+  void resetCommandPool(void)
+  {
+    commandPool.reset();
+  }
+
+  /* Take every block of a reset pool, as unread commands would */
+  void fillCommandPool(void)
+  {
+    uint8_t i;
+
+    for (i = 0; i < BC_COMMAND_POOL_BLOCKS; i++)
+    {
+      commandPool.acquire(commandPool.blockSize());
+    }
+  }
+};
+
+/* A device connected to its own bridge */
+struct FrameLink
+{
+  HostBridge bridge;
+  FrameDevice device;
+};
+
+/* The bridge accepts while the device connects */
+struct Handshake
+{
+  HostBridge *bridge;
+  bool binary;
+  bool accepted;
+};
+
+static void *acceptDevice(void *arg)
+{
+  Handshake *handshake = (Handshake *)arg;
+
+  handshake->accepted = handshake->bridge->accept(handshake->binary);
+  return NULL;
+}
+
+/* Device ID given during setup */
+static const uint8_t deviceID[BC_DEVICE_ID_SIZE_BYTES] = {8, 7, 6, 5, 4, 3, 2, 1};
+
+static bool receiveType(HostBridge& bridge, uint8_t type, uint32_t commandID = 0)
+{
+  static BRIDGE_MESSAGE message;
+
+  if (bridge.receive(message, RECEIVE_TIMEOUT_MS) != type)
+  {
+    return false;
+  }
+
+  return (type != BRIDGE_RESPONSE) || (message.commandID == commandID);
+}
+
+/* Wait for a command to arrive at the device */
+static bool pollUntilReceived(FrameDevice& device)
+{
+  uint32_t start = millis();
+
+  while ((millis() - start) < RECEIVE_TIMEOUT_MS)
+  {
+    if (device.pollForDeviceCommand())
+    {
+      /* Polling again sends anything the device left in its buffer */
+      device.pollForDeviceCommand();
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/* Poll the device for a while, for frames that it answers itself */
+static void pollFor(FrameDevice& device, uint32_t timeout_mS)
+{
+  uint32_t start = millis();
+
+  while ((millis() - start) < timeout_mS)
+  {
+    device.pollForDeviceCommand();
+  }
+}
+
+/* Poll the device until it finds that it has been disconnected */
+static bool pollUntilDisconnected(FrameDevice& device, uint32_t timeout_mS)
+{
+  uint32_t start = millis();
+  uint8_t state;
+
+  while ((millis() - start) < timeout_mS)
+  {
+    device.pollForDeviceCommand();
+
+    if (device.getConnectionState(state) && (state == BC_CONNECT_STATE_DISCONNECTED))
+    {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+/* Claim the device, with a SET_ADDRESS command of 'commandID' */
+static bool sendClaim(FrameLink& link, uint32_t commandID)
+{
+  uint8_t data[BC_DEVICE_ID_SIZE_BYTES];
+  uint8_t i;
+
+  for (i = 0; i < sizeof(data); i++)
+  {
+    data[i] = deviceID[sizeof(data) - i - 1];
+  }
+
+  return link.bridge.sendCommand(BC_COMMAND_SET_ADDRESS, commandID, data, sizeof(data));
+}
+
+static FrameLink *setUp(bool binary)
+{
+  FrameLink *link = new FrameLink;
+  BERGCloudWLANConfig WLANConfig;
+  Handshake handshake;
+  pthread_t thread;
+  char port[8];
+  bool connected;
+
+  if (!link->bridge.listen())
+  {
+    delete link;
+    return NULL;
+  }
+
+  /* The host CC3000 stand-in connects wherever these point */
+  snprintf(port, sizeof(port), "%u", link->bridge.port());
+  setenv("CC3000_HOST", "127.0.0.1", 1);
+  setenv("CC3000_PORT", port, 1);
+
+  handshake.bridge = &link->bridge;
+  handshake.binary = binary;
+  handshake.accepted = false;
+  pthread_create(&thread, NULL, acceptDevice, &handshake);
+
+  WLANConfig.ssid = "host";
+  WLANConfig.pass = "";
+  link->device.begin(WLANConfig);
+  connected = link->device.connect("00000000000000000000000000000000", 1);
+  pthread_join(thread, NULL);
+
+  if (connected)
+  {
+    /* Send the rest of the connect event */
+    link->device.pollForDeviceCommand();
+  }
+
+  if (!connected || !handshake.accepted || (link->bridge.binary() != binary) ||
+      !receiveType(link->bridge, BRIDGE_CONNECT) ||
+      !sendClaim(*link, 1) || !pollUntilReceived(link->device) ||
+      !receiveType(link->bridge, BRIDGE_RESPONSE, 1))
+  {
+    delete link;
+    return NULL;
+  }
+
+  return link;
+}
+
+/* Send 'text' as a text frame, as the bridge does, unmasked */
+static bool sendText(HostBridge& bridge, const char *text)
+{
+  uint8_t header[4];
+  uint16_t size = strlen(text);
+
+  header[0] = WS_FIN | WS_OPCODE_TEXT;
+
+  if (size > 125)
+  {
+    header[1] = WS_SIZE16;
+    header[2] = (uint8_t)(size >> 8);
+    header[3] = (uint8_t)size;
+    return bridge.sendRaw(header, 4) && bridge.sendRaw((const uint8_t *)text, size);
+  }
+
+  header[1] = (uint8_t)size;
+  return bridge.sendRaw(header, 2) && bridge.sendRaw((const uint8_t *)text, size);
+}
+
+/* Read one frame sent by the device, unmasking its payload */
+static bool receiveFrame(HostBridge& bridge, uint8_t& opcode, uint8_t *payload, uint32_t maxSize, uint32_t& size)
+{
+  uint8_t header[2];
+  uint8_t extended[8];
+  uint8_t mask[4];
+  uint32_t i;
+
+  if (!bridge.receiveRaw(header, sizeof(header), RECEIVE_TIMEOUT_MS))
+  {
+    return false;
+  }
+
+  opcode = header[0] & ~WS_FIN;
+  size = header[1] & ~WS_MASK;
+
+  if (!(header[0] & WS_FIN) || !(header[1] & WS_MASK))
+  {
+    return false;
+  }
+
+  if (size == WS_SIZE16)
+  {
+    if (!bridge.receiveRaw(extended, 2, RECEIVE_TIMEOUT_MS))
+    {
+      return false;
+    }
+    size = ((uint32_t)extended[0] << 8) | extended[1];
+  }
+  else if (size == WS_SIZE64)
+  {
+    if (!bridge.receiveRaw(extended, 8, RECEIVE_TIMEOUT_MS) ||
+        ((extended[0] | extended[1] | extended[2] | extended[3]) != 0))
+    {
+      return false;
+    }
+
+    size = 0;
+    for (i = 4; i < 8; i++)
+    {
+      size = (size << 8) | extended[i];
+    }
+
+    /* Only used for what the shorter forms cannot hold */
+    if (size <= 0xffff)
+    {
+      return false;
+    }
+  }
+
+  if ((size > maxSize) || !bridge.receiveRaw(mask, sizeof(mask), RECEIVE_TIMEOUT_MS) ||
+      ((size > 0) && !bridge.receiveRaw(payload, size, RECEIVE_TIMEOUT_MS)))
+  {
+    return false;
+  }
+
+  for (i = 0; i < size; i++)
+  {
+    payload[i] ^= mask[i % 4];
+  }
+
+  return true;
+}
+
+/* The device's frames are read while it sends them, as a large one */
+/* would fill the socket before the device returned */
+struct FrameReader
+{
+  HostBridge *bridge;
+  uint8_t opcode;
+  uint8_t *payload;
+  uint32_t maxSize;
+  uint32_t size;
+  bool received;
+};
+
+static void *readFrame(void *arg)
+{
+  FrameReader *reader = (FrameReader *)arg;
+
+  reader->received = receiveFrame(*reader->bridge, reader->opcode, reader->payload, reader->maxSize, reader->size);
+  return NULL;
+}
+
+static void testPing(void)
+{
+  FrameLink *link = setUp(true);
+  uint8_t payload[16];
+  uint8_t opcode = 0;
+  uint32_t size = 0;
+
+  if (!CHECK(link != NULL))
+  {
+    return;
+  }
+
+  /* The payload comes back in a pong */
+  CHECK(link->bridge.sendPing());
+  pollFor(link->device, 100);
+  CHECK(receiveFrame(link->bridge, opcode, payload, sizeof(payload), size));
+  CHECK_EQUAL(WS_OPCODE_PONG, opcode);
+  CHECK_EQUAL(6, size);
+  CHECK(memcmp(payload, "bridge", 6) == 0);
+
+  delete link;
+}
+
+static void testFragmentsDropped(void)
+{
+  FrameLink *link = setUp(true);
+  uint8_t frame[2 + BC_COMMAND_HEADER_SIZE_BYTES + BC_DEVICE_ID_SIZE_BYTES];
+  uint8_t i;
+
+  if (!CHECK(link != NULL))
+  {
+    return;
+  }
+
+  /* A claim, split into two fragments; if either were taken as a */
+  /* command there would be a response to command ID 2 */
+  memset(frame, 0x00, sizeof(frame));
+  frame[0] = WS_OPCODE_BINARY;
+  frame[1] = BC_COMMAND_HEADER_SIZE_BYTES;
+  frame[2 + 2] = (uint8_t)BC_COMMAND_SET_ADDRESS;
+  frame[2 + 3] = (uint8_t)(BC_COMMAND_SET_ADDRESS >> 8);
+  frame[2 + BC_COMMAND_ID_OFFSET] = 2;
+  CHECK(link->bridge.sendRaw(frame, 2 + BC_COMMAND_HEADER_SIZE_BYTES));
+
+  frame[0] = WS_FIN | WS_OPCODE_CONTINUATION;
+  frame[1] = BC_DEVICE_ID_SIZE_BYTES;
+  for (i = 0; i < BC_DEVICE_ID_SIZE_BYTES; i++)
+  {
+    frame[2 + i] = deviceID[sizeof(deviceID) - i - 1];
+  }
+  CHECK(link->bridge.sendRaw(frame, 2 + BC_DEVICE_ID_SIZE_BYTES));
+
+  /* The next whole command is read as normal */
+  CHECK(sendClaim(*link, 3));
+  CHECK(pollUntilReceived(link->device));
+  CHECK(receiveType(link->bridge, BRIDGE_RESPONSE, 3));
+
+  delete link;
+}
+
+static void testCloseDisconnects(void)
+{
+  FrameLink *link = setUp(false);
+  static const uint8_t close[] = {WS_FIN | WS_OPCODE_CLOSE, 0};
+
+  if (!CHECK(link != NULL))
+  {
+    return;
+  }
+
+  CHECK(link->bridge.sendRaw(close, sizeof(close)));
+  CHECK(pollUntilDisconnected(link->device, RECEIVE_TIMEOUT_MS));
+
+  /* The device closed the socket */
+  CHECK(receiveType(link->bridge, BRIDGE_CLOSED));
+
+  delete link;
+}
+
+static void testPartialFrameTimesOut(void)
+{
+  FrameLink *link = setUp(true);
+  static const uint8_t partial[] = {WS_FIN | WS_OPCODE_BINARY, WS_SIZE16};
+  uint32_t start;
+
+  if (!CHECK(link != NULL))
+  {
+    return;
+  }
+
+  /* The frame's length never arrives */
+  CHECK(link->bridge.sendRaw(partial, sizeof(partial)));
+  start = millis();
+  CHECK(pollUntilDisconnected(link->device, FRAME_TIMEOUT_MS * 2));
+  CHECK((millis() - start) >= FRAME_TIMEOUT_MS);
+  CHECK(receiveType(link->bridge, BRIDGE_CLOSED));
+
+  delete link;
+}
+
+static void testCommandBlocks(void)
+{
+  FrameLink *link = setUp(false);
+  uint8_t data[BC_COMMAND_POOL_BLOCK_SIZE_BYTES];
+  BC_POOL_STATS stats;
+
+  if (!CHECK(link != NULL))
+  {
+    return;
+  }
+
+  link->device.resetCommandPool();
+
+  /* A payload in anything but a DeviceCommand takes no block, */
+  /* once the type is known */
+  CHECK(sendText(link->bridge, "{\"type\":\"DeviceEvent\",\"binary_payload\":\"AAAAAAAAAAAAAAAAAAAAAAAA\"}"));
+  pollFor(link->device, 100);
+  CHECK(link->device.getCommandPoolStats(stats));
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, stats.lowestFree);
+
+  /* Before then it does, but the block is freed */
+  CHECK(sendText(link->bridge, "{\"binary_payload\":\"AAAAAAAAAAAAAAAAAAAAAAAA\",\"type\":\"DeviceEvent\"}"));
+  pollFor(link->device, 100);
+  CHECK(link->device.getCommandPoolStats(stats));
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, stats.free);
+  link->device.resetCommandPool();
+
+  /* A command too large for a block is counted, and its block freed */
+  memset(data, 0x00, sizeof(data));
+  CHECK(link->bridge.sendCommand(BC_COMMAND_SET_ADDRESS, 2, data, sizeof(data)));
+  pollFor(link->device, 100);
+  CHECK(link->device.getCommandPoolStats(stats));
+  CHECK_EQUAL(1, stats.oversize);
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, stats.free);
+
+  /* The next command is read as normal */
+  CHECK(sendClaim(*link, 3));
+  CHECK(pollUntilReceived(link->device));
+  CHECK(receiveType(link->bridge, BRIDGE_RESPONSE, 3));
+  CHECK(link->device.getCommandPoolStats(stats));
+  CHECK_EQUAL(1, stats.oversize);
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, stats.free);
+
+  delete link;
+}
+
+static void testPoolExhausted(bool binary)
+{
+  FrameLink *link = setUp(binary);
+  BC_POOL_STATS stats;
+
+  if (!CHECK(link != NULL))
+  {
+    return;
+  }
+
+  /* A command received while no block is free is dropped and counted */
+  link->device.resetCommandPool();
+  link->device.fillCommandPool();
+  CHECK(sendClaim(*link, 2));
+  pollFor(link->device, 100);
+  CHECK(link->device.getCommandPoolStats(stats));
+  CHECK_EQUAL(1, stats.exhausted);
+  CHECK_EQUAL(0, stats.oversize);
+
+  /* Once blocks are free the next is read as normal */
+  link->device.resetCommandPool();
+  CHECK(sendClaim(*link, 3));
+  CHECK(pollUntilReceived(link->device));
+  CHECK(receiveType(link->bridge, BRIDGE_RESPONSE, 3));
+
+  delete link;
+}
+
+static void testPoolExhaustedBinary(void)
+{
+  testPoolExhausted(true);
+}
+
+static void testPoolExhaustedJSON(void)
+{
+  testPoolExhausted(false);
+}
+
+static void testPayloadBeforeType(void)
+{
+  FrameLink *link = setUp(false);
+  uint8_t command[BC_COMMAND_HEADER_SIZE_BYTES + BC_DEVICE_ID_SIZE_BYTES];
+  char text[256];
+  char encoded[BC_BASE64_SIZE(sizeof(command)) + 1];
+  BERGCloudBase64Encoder base64;
+  const uint8_t *data = command;
+  uint16_t size = sizeof(command);
+  uint16_t encodedSize;
+  BC_POOL_STATS stats;
+  uint8_t i;
+
+  if (!CHECK(link != NULL))
+  {
+    return;
+  }
+
+  /* A claim, with the members in an unusual order */
+  memset(command, 0x00, sizeof(command));
+  command[2] = (uint8_t)BC_COMMAND_SET_ADDRESS;
+  command[3] = (uint8_t)(BC_COMMAND_SET_ADDRESS >> 8);
+  for (i = 0; i < BC_DEVICE_ID_SIZE_BYTES; i++)
+  {
+    command[BC_COMMAND_HEADER_SIZE_BYTES + i] = deviceID[sizeof(deviceID) - i - 1];
+  }
+
+  encodedSize = base64.encode(data, size, encoded, sizeof(encoded));
+  encodedSize += base64.end(&encoded[encodedSize]);
+  encoded[encodedSize] = '\0';
+
+  snprintf(text, sizeof(text), "{\"binary_payload\":\"%s\",\"command_id\":4,\"type\":\"DeviceCommand\"}", encoded);
+  CHECK(sendText(link->bridge, text));
+  CHECK(pollUntilReceived(link->device));
+  CHECK(receiveType(link->bridge, BRIDGE_RESPONSE, 4));
+
+  CHECK(link->device.getCommandPoolStats(stats));
+  CHECK_EQUAL(BC_COMMAND_POOL_BLOCKS, stats.free);
+
+  delete link;
+}
+
+static void testLargeEvent(bool binary)
+{
+  static uint8_t data[EVENT_DATA_BYTES];
+  static uint8_t payload[EVENT_DATA_BYTES * 2];
+  static const char start[] = "{\"type\":\"DeviceEvent\"";
+  FrameLink *link = setUp(binary);
+  BERGCloudMessage msg(EVENT_DATA_BYTES + 8, BC_EVENT_HEADROOM_BYTES);
+  FrameReader reader;
+  pthread_t thread;
+  uint32_t i;
+
+  if (!CHECK(link != NULL))
+  {
+    return;
+  }
+
+  for (i = 0; i < sizeof(data); i++)
+  {
+    data[i] = (uint8_t)(i * 7);
+  }
+
+  CHECK(msg.pack(data, sizeof(data)));
+
+  reader.bridge = &link->bridge;
+  reader.payload = payload;
+  reader.maxSize = sizeof(payload);
+  reader.received = false;
+  pthread_create(&thread, NULL, readFrame, &reader);
+
+  /* Polling sends anything left in the device's buffer */
+  CHECK(link->device.sendEvent("large", msg));
+  link->device.pollForDeviceCommand();
+  pthread_join(thread, NULL);
+
+  /* The whole event is in one frame, of the right length */
+  if (!CHECK(reader.received))
+  {
+    delete link;
+    return;
+  }
+
+  if (binary)
+  {
+    CHECK_EQUAL(WS_OPCODE_BINARY, reader.opcode);
+    CHECK_EQUAL(BC_EVENT_HEADER_SIZE_BYTES + 1 + strlen("large") + msg.used(), reader.size);
+    CHECK(memcmp(&payload[reader.size - sizeof(data)], data, sizeof(data)) == 0);
+  }
+  else
+  {
+    CHECK_EQUAL(WS_OPCODE_TEXT, reader.opcode);
+    CHECK(memcmp(payload, start, strlen(start)) == 0);
+    CHECK_EQUAL('}', payload[reader.size - 1]);
+  }
+
+  /* And nothing follows it */
+  CHECK(!link->bridge.receiveRaw(payload, 1, 100));
+
+  delete link;
+}
+
+static void testLargeEventBinary(void)
+{
+  testLargeEvent(true);
+}
+
+static void testLargeEventJSON(void)
+{
+  testLargeEvent(false);
+}
+
+int main(void)
+{
+  setenv("BC_HOST_EEPROM", "bergcloud_websocket_test.eeprom", 1);
+
+  RUN_TEST(testPing);
+  RUN_TEST(testFragmentsDropped);
+  RUN_TEST(testCloseDisconnects);
+  RUN_TEST(testPartialFrameTimesOut);
+  RUN_TEST(testCommandBlocks);
+  RUN_TEST(testPoolExhaustedBinary);
+  RUN_TEST(testPoolExhaustedJSON);
+  RUN_TEST(testPayloadBeforeType);
+  RUN_TEST(testLargeEventBinary);
+  RUN_TEST(testLargeEventJSON);
+  return testResult();
+}
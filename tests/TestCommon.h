@@ -0,0 +1,91 @@
+/*
+
+Shared checks for the host tests
+
+Copyright (c) 2014 BERG Cloud Ltd. http://bergcloud.com/
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*/
+
+#ifndef TESTCOMMON_H
+#define TESTCOMMON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "BERGCloudCC3000.h"
+
+/* Checks made, and those that failed, across every test */
+static unsigned testChecks = 0;
+static unsigned testFailures = 0;
+
+static inline bool testCheck(bool passed, const char *check, const char *file, int line)
+{
+  testChecks++;
+
+  if (!passed)
+  {
+    testFailures++;
+    fprintf(stderr, "%s:%d: check failed: %s\n", file, line, check);
+  }
+
+  return passed;
+}
+
+/* Record a failure if 'condition' is false, and carry on */
+#define CHECK(condition) testCheck((condition), #condition, __FILE__, __LINE__)
+
+/* Compare two integers, printing both if they differ */
+#define CHECK_EQUAL(expected, actual) \
+  testCheckEqual((long long)(expected), (long long)(actual), #actual, __FILE__, __LINE__)
+
+static inline bool testCheckEqual(long long expected, long long actual, const char *check, const char *file, int line)
+{
+  if (expected != actual)
+  {
+    fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", file, line, check, actual, expected);
+  }
+
+  return testCheck(expected == actual, check, file, line);
+}
+
+/* Run a test function, naming it if any of its checks fail */
+#define RUN_TEST(test) testRun(test, #test)
+
+static inline void testRun(void (*test)(void), const char *name)
+{
+  unsigned failures = testFailures;
+
+  test();
+
+  if (testFailures != failures)
+  {
+    fprintf(stderr, "FAILED: %s\n", name);
+  }
+}
+
+/* The exit status for main() */
+static inline int testResult(void)
+{
+  printf("%u checks, %u failed\n", testChecks, testFailures);
+  return (testFailures == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif // #ifndef TESTCOMMON_H